@@ -53,6 +53,10 @@
  //#define JUCE_INCLUDE_ZLIB_CODE
 #endif
 
+#ifndef    JUCE_UNIT_TEST_BENCHMARKS
+ //#define JUCE_UNIT_TEST_BENCHMARKS
+#endif
+
 //==============================================================================
 // juce_graphics flags:
 
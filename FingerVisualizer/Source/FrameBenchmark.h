@@ -0,0 +1,425 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_FRAMEBENCHMARK_H_INCLUDED
+#define FINGERVISUALIZER_FRAMEBENCHMARK_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FrameSnapshot.h"
+#include "SyntheticHands.h"
+#include "JointFilter.h"
+#include "GestureEngine.h"
+#include <iostream>
+
+//==============================================================================
+/**
+    Counts calls to the global operator new.
+
+    Main.cpp replaces the global allocation functions to bump the counter when
+    FINGERVISUALIZER_COUNT_ALLOCATIONS is enabled, otherwise isEnabled() is false
+    and the count stays at zero.
+*/
+struct AllocationCounter
+{
+    static bool isEnabled() noexcept;
+
+    static int64 getCount() noexcept            { return s_numAllocations.get(); }
+    static void increment() noexcept            { ++s_numAllocations; }
+
+    static Atomic<int64> s_numAllocations;
+};
+
+//==============================================================================
+/**
+    Renders a fixed, deterministic sequence of synthetic frames as fast as possible
+    and reports how long each one took.
+
+    The renderer calls beginBenchmarkFrame() and endBenchmarkFrame() around every
+    frame until isFinished().  The first few frames warm up caches and drivers and
+    are not measured.  All bookkeeping storage is allocated up front, so the
+    allocations counted per frame are the renderer's own.
+*/
+class FrameBenchmark
+{
+public:
+    struct Settings
+    {
+        Settings()
+          : iNumFrames( 1000 ),
+            iNumWarmupFrames( 60 ),
+            iNumHands( 4 ),
+            iWidth( 1280 ),
+            iHeight( 720 ),
+            bSoftware( false ),
+            bJointFilter( false ),
+            bGestures( false )
+        {
+        }
+
+        int     iNumFrames;
+        int     iNumWarmupFrames;
+        int     iNumHands;
+        int     iWidth;
+        int     iHeight;
+        /// render with the software renderer instead of OpenGL.
+        bool    bSoftware;
+        /// measure the JointFilter instead of rendering.
+        bool    bJointFilter;
+        /// measure the GestureEngine instead of rendering.
+        bool    bGestures;
+        /// where the JSON report goes, stdout when this is File::nonexistent.
+        File    outputFile;
+    };
+
+    explicit FrameBenchmark( const Settings& settings )
+      : m_settings( settings ),
+        m_hands( settings.iNumHands ),
+        m_iNumFramesDone( 0 ),
+        m_iStartTicks( 0 ),
+        m_iFrameStartTicks( 0 ),
+        m_iFrameStartAllocations( 0 )
+    {
+        m_settings.iNumFrames       = jmax( 1, m_settings.iNumFrames );
+        m_settings.iNumWarmupFrames = jmax( 0, m_settings.iNumWarmupFrames );
+        m_settings.iWidth           = jmax( 1, m_settings.iWidth );
+        m_settings.iHeight          = jmax( 1, m_settings.iHeight );
+
+        m_afFrameMs.allocate( static_cast<size_t>(m_settings.iNumFrames), true );
+        m_aiFrameAllocations.allocate( static_cast<size_t>(m_settings.iNumFrames), true );
+    }
+
+    const Settings& getSettings() const noexcept    { return m_settings; }
+
+    bool isFinished() const noexcept                { return m_iNumFramesDone >= getNumFramesTotal(); }
+
+    int getNumFramesTotal() const noexcept          { return m_settings.iNumWarmupFrames + m_settings.iNumFrames; }
+
+    //==============================================================================
+    /** Poses the next frame of the sequence and starts timing it. */
+    const FrameSnapshot& beginBenchmarkFrame()
+    {
+        jassert( !isFinished() );
+
+        m_hands.poseFrame( m_iNumFramesDone / 60.0, m_frame );
+        m_frame.iFrameId = m_iNumFramesDone + 1;
+
+        m_iFrameStartAllocations = AllocationCounter::getCount();
+        m_iFrameStartTicks = Time::getHighResolutionTicks();
+
+        if ( m_iNumFramesDone == m_settings.iNumWarmupFrames )
+            m_iStartTicks = m_iFrameStartTicks;
+
+        return m_frame;
+    }
+
+    void endBenchmarkFrame()
+    {
+        const int64 iEndTicks = Time::getHighResolutionTicks();
+        const int   iMeasured = m_iNumFramesDone - m_settings.iNumWarmupFrames;
+
+        if ( iMeasured >= 0 )
+        {
+            m_afFrameMs[iMeasured] = Time::highResolutionTicksToSeconds( iEndTicks - m_iFrameStartTicks ) * 1000.0;
+            m_aiFrameAllocations[iMeasured] = AllocationCounter::getCount() - m_iFrameStartAllocations;
+        }
+
+        m_iNumFramesDone++;
+    }
+
+    //==============================================================================
+    /** Builds the JSON report.  Call this once the renderer has finished all frames
+        and waited for any queued work to complete, so throughput covers the whole
+        run and not just the time taken to submit it.
+    */
+    String createReport( const String& strRenderer ) const
+    {
+        const int     iCount = m_settings.iNumFrames;
+        const double  fWallSeconds = Time::highResolutionTicksToSeconds( Time::getHighResolutionTicks() - m_iStartTicks );
+
+        Array<double> afSorted;
+        afSorted.ensureStorageAllocated( iCount );
+
+        double  fTotalMs = 0.0;
+        int64   iTotalAllocations = 0;
+        int64   iMaxAllocations = 0;
+
+        for ( int i = 0; i < iCount; i++ )
+        {
+            afSorted.add( m_afFrameMs[i] );
+            fTotalMs += m_afFrameMs[i];
+            iTotalAllocations += m_aiFrameAllocations[i];
+            iMaxAllocations = jmax( iMaxAllocations, m_aiFrameAllocations[i] );
+        }
+
+        DefaultElementComparator<double> sorter;
+        afSorted.sort( sorter );
+
+        DynamicObject::Ptr pCpu( new DynamicObject() );
+        pCpu->setProperty( "min",  afSorted.getFirst() );
+        pCpu->setProperty( "p50",  getPercentile( afSorted, 50.0 ) );
+        pCpu->setProperty( "p90",  getPercentile( afSorted, 90.0 ) );
+        pCpu->setProperty( "p99",  getPercentile( afSorted, 99.0 ) );
+        pCpu->setProperty( "max",  afSorted.getLast() );
+        pCpu->setProperty( "mean", fTotalMs / iCount );
+
+        DynamicObject::Ptr pAllocations( new DynamicObject() );
+
+        if ( AllocationCounter::isEnabled() )
+        {
+            pAllocations->setProperty( "total", iTotalAllocations );
+            pAllocations->setProperty( "meanPerFrame", iTotalAllocations / static_cast<double>(iCount) );
+            pAllocations->setProperty( "maxPerFrame", iMaxAllocations );
+        }
+
+        DynamicObject::Ptr pReport( new DynamicObject() );
+        pReport->setProperty( "renderer", strRenderer );
+        pReport->setProperty( "width", m_settings.iWidth );
+        pReport->setProperty( "height", m_settings.iHeight );
+        pReport->setProperty( "hands", m_hands.getNumHands() );
+        pReport->setProperty( "warmupFrames", m_settings.iNumWarmupFrames );
+        pReport->setProperty( "frames", iCount );
+        pReport->setProperty( "cpuFrameMs", var( pCpu ) );
+        pReport->setProperty( "allocations", AllocationCounter::isEnabled() ? var( pAllocations ) : var::null );
+        pReport->setProperty( "wallSeconds", fWallSeconds );
+        pReport->setProperty( "framesPerSecond", fWallSeconds > 0.0 ? iCount / fWallSeconds : 0.0 );
+
+        return JSON::toString( var( pReport ) );
+    }
+
+    /** Writes the report to the output file, or stdout. */
+    bool writeReport( const String& strRenderer ) const
+    {
+        return writeReportText( m_settings, createReport( strRenderer ) );
+    }
+
+    static bool writeReportText( const Settings& settings, const String& strReport )
+    {
+        if ( settings.outputFile == File::nonexistent )
+        {
+            std::cout << strReport << std::endl;
+            return true;
+        }
+
+        return settings.outputFile.replaceWithText( strReport + newLine );
+    }
+
+    /** Nearest-rank percentile of an ascending array. */
+    static double getPercentile( const Array<double>& afSorted, double fPercent )
+    {
+        if ( afSorted.size() == 0 )
+            return 0.0;
+
+        const int iRank = static_cast<int>(std::ceil( fPercent / 100.0 * afSorted.size() ));
+
+        return afSorted[jlimit( 0, afSorted.size() - 1, iRank - 1 )];
+    }
+
+private:
+    Settings            m_settings;
+    SyntheticHands      m_hands;
+    FrameSnapshot       m_frame;
+    HeapBlock<double>   m_afFrameMs;
+    HeapBlock<int64>    m_aiFrameAllocations;
+    int                 m_iNumFramesDone;
+    int64               m_iStartTicks;
+    int64               m_iFrameStartTicks;
+    int64               m_iFrameStartAllocations;
+
+    JUCE_DECLARE_NON_COPYABLE (FrameBenchmark)
+};
+
+//==============================================================================
+/**
+    Runs synthetic hands arriving at 1000 Hz through the JointFilter, once with
+    each kernel, and reports what filtering costs per frame and per joint.
+*/
+class FilterBenchmark
+{
+public:
+    enum { kInputHz = 1000 };
+
+    explicit FilterBenchmark( const FrameBenchmark::Settings& settings )
+      : m_settings( settings ),
+        m_hands( settings.iNumHands )
+    {
+        m_settings.iNumFrames       = jmax( 1, m_settings.iNumFrames );
+        m_settings.iNumWarmupFrames = jmax( 0, m_settings.iNumWarmupFrames );
+    }
+
+    String createReport()
+    {
+        const int iNumJoints = m_hands.getNumHands() * JointFilter::kPointsPerHand;
+
+        DynamicObject::Ptr pReport( new DynamicObject() );
+        pReport->setProperty( "benchmark", "jointFilter" );
+        pReport->setProperty( "inputHz", static_cast<int>(kInputHz) );
+        pReport->setProperty( "hands", m_hands.getNumHands() );
+        pReport->setProperty( "jointsPerFrame", iNumJoints );
+        pReport->setProperty( "warmupFrames", m_settings.iNumWarmupFrames );
+        pReport->setProperty( "frames", m_settings.iNumFrames );
+        pReport->setProperty( "simd", JointFilter::isSIMDAvailable() ? measure( true, iNumJoints ) : var::null );
+        pReport->setProperty( "scalar", measure( false, iNumJoints ) );
+
+        return JSON::toString( var( pReport ) );
+    }
+
+private:
+    var measure( bool bSIMD, int iNumJoints )
+    {
+        JointFilter filter;
+        filter.setUseSIMD( bSIMD );
+
+        Array<double> afFrameNs;
+        afFrameNs.ensureStorageAllocated( m_settings.iNumFrames );
+
+        double fTotalNs = 0.0;
+
+        for ( int i = 0; i < m_settings.iNumWarmupFrames + m_settings.iNumFrames; i++ )
+        {
+            m_hands.poseFrame( i / static_cast<double>(kInputHz), m_frame );
+
+            const int64 iStartTicks = Time::getHighResolutionTicks();
+            filter.process( m_frame );
+            const int64 iEndTicks   = Time::getHighResolutionTicks();
+
+            if ( i >= m_settings.iNumWarmupFrames )
+            {
+                const double fNs = Time::highResolutionTicksToSeconds( iEndTicks - iStartTicks ) * 1.0e9;
+                afFrameNs.add( fNs );
+                fTotalNs += fNs;
+            }
+        }
+
+        DefaultElementComparator<double> sorter;
+        afFrameNs.sort( sorter );
+
+        const double fMeanNs      = fTotalNs / m_settings.iNumFrames;
+        const double fJointScale  = iNumJoints > 0 ? 1.0 / iNumJoints : 0.0;
+
+        DynamicObject::Ptr pFrame( new DynamicObject() );
+        pFrame->setProperty( "p50", FrameBenchmark::getPercentile( afFrameNs, 50.0 ) * 0.001 );
+        pFrame->setProperty( "p99", FrameBenchmark::getPercentile( afFrameNs, 99.0 ) * 0.001 );
+        pFrame->setProperty( "mean", fMeanNs * 0.001 );
+
+        DynamicObject::Ptr pJoint( new DynamicObject() );
+        pJoint->setProperty( "p50", FrameBenchmark::getPercentile( afFrameNs, 50.0 ) * fJointScale );
+        pJoint->setProperty( "p99", FrameBenchmark::getPercentile( afFrameNs, 99.0 ) * fJointScale );
+        pJoint->setProperty( "mean", fMeanNs * fJointScale );
+
+        DynamicObject::Ptr pResult( new DynamicObject() );
+        pResult->setProperty( "frameUs", var( pFrame ) );
+        pResult->setProperty( "jointNs", var( pJoint ) );
+        // share of the time between two input frames spent filtering
+        pResult->setProperty( "budgetPercent", fMeanNs * kInputHz * 1.0e-7 );
+
+        return var( pResult );
+    }
+
+    FrameBenchmark::Settings    m_settings;
+    SyntheticHands              m_hands;
+    FrameSnapshot               m_frame;
+
+    JUCE_DECLARE_NON_COPYABLE (FilterBenchmark)
+};
+
+//==============================================================================
+/**
+    Runs synthetic hands arriving at 1000 Hz through the GestureEngine and
+    reports what recognition costs per frame and per hand.
+
+    Hands come and go every few seconds so slots are recycled, and the warm up
+    fills every window, so the measured frames are the steady state.
+*/
+class GestureBenchmark  : private GestureEngine::Listener
+{
+public:
+    enum { kInputHz = 1000 };
+
+    explicit GestureBenchmark( const FrameBenchmark::Settings& settings )
+      : m_settings( settings ),
+        m_hands( jmin( settings.iNumHands, static_cast<int>(GestureEngine::kMaxHands) ), 3.0f ),
+        m_iNumEvents( 0 )
+    {
+        m_settings.iNumFrames       = jmax( 1, m_settings.iNumFrames );
+        m_settings.iNumWarmupFrames = jmax( static_cast<int>(GestureEngine::kMaxSamples), m_settings.iNumWarmupFrames );
+    }
+
+    String createReport()
+    {
+        GestureEngine engine;
+        engine.addListener( this );
+
+        Array<double> afFrameNs;
+        afFrameNs.ensureStorageAllocated( m_settings.iNumFrames );
+
+        double fTotalNs = 0.0;
+
+        for ( int i = 0; i < m_settings.iNumWarmupFrames + m_settings.iNumFrames; i++ )
+        {
+            const double fSeconds = i / static_cast<double>(kInputHz);
+
+            m_hands.poseFrame( fSeconds, m_frame );
+
+            const int64 iStartTicks = Time::getHighResolutionTicks();
+            engine.process( m_frame, fSeconds );
+            const int64 iEndTicks   = Time::getHighResolutionTicks();
+
+            if ( i == m_settings.iNumWarmupFrames )
+                m_iNumEvents = 0;
+
+            if ( i >= m_settings.iNumWarmupFrames )
+            {
+                const double fNs = Time::highResolutionTicksToSeconds( iEndTicks - iStartTicks ) * 1.0e9;
+                afFrameNs.add( fNs );
+                fTotalNs += fNs;
+            }
+        }
+
+        DefaultElementComparator<double> sorter;
+        afFrameNs.sort( sorter );
+
+        const double fMeanNs    = fTotalNs / m_settings.iNumFrames;
+        const double fHandScale = m_hands.getNumHands() > 0 ? 1.0 / m_hands.getNumHands() : 0.0;
+
+        DynamicObject::Ptr pFrame( new DynamicObject() );
+        pFrame->setProperty( "p50", FrameBenchmark::getPercentile( afFrameNs, 50.0 ) * 0.001 );
+        pFrame->setProperty( "p99", FrameBenchmark::getPercentile( afFrameNs, 99.0 ) * 0.001 );
+        pFrame->setProperty( "max", afFrameNs.getLast() * 0.001 );
+        pFrame->setProperty( "mean", fMeanNs * 0.001 );
+
+        DynamicObject::Ptr pReport( new DynamicObject() );
+        pReport->setProperty( "benchmark", "gestures" );
+        pReport->setProperty( "inputHz", static_cast<int>(kInputHz) );
+        pReport->setProperty( "hands", m_hands.getNumHands() );
+        pReport->setProperty( "warmupFrames", m_settings.iNumWarmupFrames );
+        pReport->setProperty( "frames", m_settings.iNumFrames );
+        pReport->setProperty( "events", m_iNumEvents );
+        pReport->setProperty( "frameUs", var( pFrame ) );
+        pReport->setProperty( "handNs", fMeanNs * fHandScale );
+        // share of one core spent recognizing at the input rate
+        pReport->setProperty( "budgetPercent", fMeanNs * kInputHz * 1.0e-7 );
+
+        engine.removeListener( this );
+        return JSON::toString( var( pReport ) );
+    }
+
+private:
+    void gestureRecognized( const GestureEvent& )
+    {
+        ++m_iNumEvents;
+    }
+
+    FrameBenchmark::Settings    m_settings;
+    SyntheticHands              m_hands;
+    FrameSnapshot               m_frame;
+    int                         m_iNumEvents;
+
+    JUCE_DECLARE_NON_COPYABLE (GestureBenchmark)
+};
+
+#endif // FINGERVISUALIZER_FRAMEBENCHMARK_H_INCLUDED
@@ -0,0 +1,89 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_FRAMEMAILBOX_H_INCLUDED
+#define FINGERVISUALIZER_FRAMEMAILBOX_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/**
+    Lock-free triple buffer for handing the newest value from one producer
+    thread to one consumer thread.
+
+    The producer fills getWriteBuffer() and calls publish(), the consumer calls
+    acquire() and then reads getReadBuffer().  Neither side ever blocks or waits
+    on the other: the producer always has a buffer of its own to write into and
+    the consumer always sees the most recently published complete value.
+    Intermediate values are dropped if the producer runs faster than the consumer.
+
+    The three buffers are exchanged by swapping indices through a single atomic
+    word that holds the index of the "middle" buffer plus a flag telling the
+    consumer whether it contains something it hasn't seen yet.
+*/
+template <typename ValueType>
+class FrameMailbox
+{
+public:
+    FrameMailbox()
+      : m_iWriteIndex( 0 ),
+        m_iReadIndex( 1 ),
+        m_middle( 2 )
+    {
+    }
+
+    //==============================================================================
+    /** Producer side: the buffer to fill before calling publish(). */
+    ValueType& getWriteBuffer() noexcept                { return m_aBuffers[m_iWriteIndex]; }
+
+    /** Producer side: makes the contents of the write buffer visible to the consumer
+        and takes a new buffer to write into.  The new write buffer holds stale data.
+    */
+    void publish() noexcept
+    {
+        const int iPrevious = m_middle.exchange( m_iWriteIndex | kFreshBit );
+        m_iWriteIndex = iPrevious & kIndexMask;
+    }
+
+    //==============================================================================
+    /** Consumer side: picks up the most recently published value, if there is one.
+        Returns false and leaves the read buffer untouched when nothing new has
+        been published since the last call.
+    */
+    bool acquire() noexcept
+    {
+        if ( (m_middle.get() & kFreshBit) == 0 )
+            return false;
+
+        const int iPrevious = m_middle.exchange( m_iReadIndex );
+        m_iReadIndex = iPrevious & kIndexMask;
+        return true;
+    }
+
+    /** Consumer side: the value obtained by the last successful acquire(). */
+    const ValueType& getReadBuffer() const noexcept     { return m_aBuffers[m_iReadIndex]; }
+
+    /** True if a value has been published that the consumer hasn't acquired yet. */
+    bool hasNewValue() const noexcept                   { return (m_middle.get() & kFreshBit) != 0; }
+
+private:
+    enum
+    {
+        kIndexMask = 3,
+        kFreshBit  = 4
+    };
+
+    ValueType   m_aBuffers[3];
+    int         m_iWriteIndex;   // owned by the producer
+    int         m_iReadIndex;    // owned by the consumer
+    Atomic<int> m_middle;
+
+    JUCE_DECLARE_NON_COPYABLE (FrameMailbox)
+};
+
+#endif // FINGERVISUALIZER_FRAMEMAILBOX_H_INCLUDED
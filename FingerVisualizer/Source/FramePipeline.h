@@ -0,0 +1,111 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_FRAMEPIPELINE_H_INCLUDED
+#define FINGERVISUALIZER_FRAMEPIPELINE_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FrameSnapshot.h"
+#include "FrameQueue.h"
+
+//==============================================================================
+/**
+    Moves frames from the thread a FrameSource delivers them on to a processing
+    thread of their own, so per-frame work never holds up delivery.
+
+    A FrameSource is started with the pipeline as its consumer.  Each frame is
+    stamped with the time it arrived and queued, and the processing thread
+    passes it on to the processor: it pops the frame into the processor's
+    beginFrame() and calls endFrame().  The processor's beginFrame() is called
+    speculatively, so it mustn't do anything but return a buffer.
+
+    The processor normally publishes into a FrameMailbox for the render thread,
+    which makes three stages that only meet at the queue and the mailbox.
+*/
+class FramePipeline  : public FrameSnapshotConsumer,
+                       private Thread
+{
+public:
+    enum { kDefaultQueueSize = 8 };
+
+    explicit FramePipeline( FrameSnapshotConsumer& processor )
+      : Thread( "Frame processing" ),
+        m_processor( processor ),
+        m_queue( kDefaultQueueSize, FrameQueue<FrameSnapshot>::kDropOldest )
+    {
+    }
+
+    ~FramePipeline()
+    {
+        stop();
+    }
+
+    //==============================================================================
+    /** Starts the processing thread with an empty queue, call before starting the source. */
+    void start()
+    {
+        stop();
+        m_queue.clear();
+        startThread( 8 );
+    }
+
+    /** Stops the processing thread, call after stopping the source.  Queued frames are discarded. */
+    void stop()
+    {
+        signalThreadShouldExit();
+        m_frameQueued.signal();
+        stopThread( 5000 );
+    }
+
+    /** Only while stopped. */
+    void setQueue( int iSize, FrameQueue<FrameSnapshot>::OverflowPolicy policy )
+    {
+        jassert( !isThreadRunning() );
+
+        m_queue.setCapacity( iSize );
+        m_queue.setOverflowPolicy( policy );
+    }
+
+    const FrameQueue<FrameSnapshot>& getQueue() const noexcept  { return m_queue; }
+
+    //==============================================================================
+    // FrameSnapshotConsumer, on the source's thread.
+    FrameSnapshot& beginFrame()
+    {
+        FrameSnapshot& frame = m_queue.beginPush();
+
+        frame.iReceivedTicks = Time::getHighResolutionTicks();
+        return frame;
+    }
+
+    void endFrame()
+    {
+        m_queue.endPush();
+        m_frameQueued.signal();
+    }
+
+private:
+    void run()
+    {
+        while ( !threadShouldExit() )
+        {
+            m_frameQueued.wait( 100 );
+
+            while ( !threadShouldExit() && m_queue.pop( m_processor.beginFrame() ) )
+                m_processor.endFrame();
+        }
+    }
+
+    FrameSnapshotConsumer&      m_processor;
+    FrameQueue<FrameSnapshot>   m_queue;
+    WaitableEvent               m_frameQueued;
+
+    JUCE_DECLARE_NON_COPYABLE (FramePipeline)
+};
+
+#endif // FINGERVISUALIZER_FRAMEPIPELINE_H_INCLUDED
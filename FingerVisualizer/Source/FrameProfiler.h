@@ -0,0 +1,708 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_FRAMEPROFILER_H_INCLUDED
+#define FINGERVISUALIZER_FRAMEPROFILER_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "LatencyMonitor.h"
+#include "SceneShading.h"
+#include <algorithm>
+#include <cmath>
+
+#ifndef GL_TIMESTAMP
+ #define GL_TIMESTAMP 0x8E28
+#endif
+
+#ifndef GL_QUERY_RESULT
+ #define GL_QUERY_RESULT 0x8866
+#endif
+
+#ifndef GL_QUERY_RESULT_AVAILABLE
+ #define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+
+//==============================================================================
+/**
+    Times named scopes on the render, processing and message threads.
+
+    Every scope belongs to one thread, and each thread writes its events into a
+    ring of its own, so timing a scope never blocks, allocates or shares a cache
+    line with another producer.  The message thread calls collect() to drain the
+    rings.  Each thread's events add up per scope until that thread's root scope
+    ends, which makes one sample per scope and frame, however often the scope
+    ran in it (once per view, for instance).  The samples go into rolling
+    windows summarized as percentiles and log-scale histograms, and the last
+    render frame's scopes are kept as a flame graph.
+
+    GPU times arrive the same way from a GpuScopeTimer, a few frames late.
+    While the profiler is disabled a scope costs one atomic read.
+*/
+class FrameProfiler
+{
+public:
+    enum Thread
+    {
+        kThread_Render,
+        kThread_Processing,
+        kThread_Message,
+        kNumThreads
+    };
+
+    enum Scope
+    {
+        /// renderOpenGL(), the render thread's root
+        kScope_Render,
+        kScope_SetupScene,
+        kScope_Grid,
+        kScope_Hands,
+        kScope_Trails,
+        /// renderOpenGL2D()
+        kScope_Overlay,
+        /// from the end of one render to the start of the next: the buffer swap and any wait for a repaint
+        kScope_Swap,
+        /// endFrame(), the processing thread's root
+        kScope_Ingest,
+        kScope_Filter,
+        kScope_Gestures,
+        /// the timer callback, the message thread's root
+        kScope_Timer,
+        kNumScopes
+    };
+
+    enum
+    {
+        /// bucket i holds times from 2^(i - kBucketShift) ms, bucket 0 everything shorter
+        kNumBuckets     = 14,
+        kBucketShift    = 6,
+        kWindowSize     = 512,
+        kMaxFlameBars   = 64,
+        kRingSize       = 4096
+    };
+
+    static const char* getScopeName( Scope scope ) noexcept
+    {
+        static const char* const s_aszNames[kNumScopes] =
+        {
+            "render", "setupScene", "grid", "drawHands", "trails", "renderOpenGL2D", "swap/wait",
+            "ingest", "filter", "gestures", "timer"
+        };
+
+        return s_aszNames[scope];
+    }
+
+    static Thread getScopeThread( Scope scope ) noexcept
+    {
+        if ( scope == kScope_Timer )
+            return kThread_Message;
+
+        return scope >= kScope_Ingest ? kThread_Processing : kThread_Render;
+    }
+
+    static bool isRootScope( Scope scope ) noexcept
+    {
+        return scope == kScope_Render || scope == kScope_Ingest || scope == kScope_Timer;
+    }
+
+    static int getBucket( float fMs ) noexcept
+    {
+        if ( fMs <= 0.0f )
+            return 0;
+
+        return jlimit( 0, kNumBuckets - 1, static_cast<int>(std::floor( std::log( fMs ) / std::log( 2.0f ) )) + kBucketShift );
+    }
+
+    /** The shortest time counted in a bucket, in milliseconds. */
+    static float getBucketStartMs( int iBucket ) noexcept
+    {
+        return std::pow( 2.0f, static_cast<float>(iBucket - kBucketShift) );
+    }
+
+    //==============================================================================
+    struct ScopeStats
+    {
+        int     iNumSamples;
+        float   fP50Ms;
+        float   fP99Ms;
+        float   fMaxMs;
+        int     aiHistogram[kNumBuckets];
+    };
+
+    /** One scope of the last frame, relative to the frame's first scope. */
+    struct FlameBar
+    {
+        int     iScope;
+        int     iDepth;
+        float   fStartMs;
+        float   fDurationMs;
+    };
+
+    struct Flame
+    {
+        int         iNumBars;
+        float       fLengthMs;
+        FlameBar    aBars[kMaxFlameBars];
+    };
+
+    struct Report
+    {
+        Report()
+            : aCpu(), aGpu(), cpuFlame(), gpuFlame(), bHasGpu( false ), iNumDropped( 0 )
+        {
+        }
+
+        ScopeStats  aCpu[kNumScopes];
+        ScopeStats  aGpu[kNumScopes];
+        Flame       cpuFlame;
+        Flame       gpuFlame;
+        bool        bHasGpu;
+        int         iNumDropped;
+    };
+
+    FrameProfiler()
+    {
+        for ( int i = 0; i < kNumSeries; i++ )
+            m_aWindows[i].afMs.allocate( kWindowSize, true );
+
+        m_afSorted.allocate( kWindowSize, true );
+        clearWindows();
+    }
+
+    //==============================================================================
+    /** Any thread: whether scopes are being timed. */
+    bool isEnabled() const noexcept             { return m_iEnabled.get() != 0; }
+
+    /** Consumer side: starts or stops timing, starting from empty windows. */
+    void setEnabled( bool bEnabled )
+    {
+        if ( bEnabled && !isEnabled() )
+            clearWindows();
+
+        m_iEnabled.set( bEnabled ? 1 : 0 );
+    }
+
+    //==============================================================================
+    /** Producer side, on the scope's thread: returns the nesting depth for leaveScope(). */
+    int enterScope( Scope scope ) noexcept
+    {
+        return m_aThreads[getScopeThread( scope )].iDepth++;
+    }
+
+    void leaveScope( Scope scope, int64 iStartTicks, int64 iEndTicks, int iDepth ) noexcept
+    {
+        ThreadRing& thread = m_aThreads[getScopeThread( scope )];
+
+        thread.iDepth = iDepth;
+        push( thread, scope, iStartTicks, iEndTicks, iDepth, false );
+    }
+
+    /** Producer side: a scope timed some other way, like the gap between renders. */
+    void addEvent( Scope scope, int64 iStartTicks, int64 iEndTicks ) noexcept
+    {
+        ThreadRing& thread = m_aThreads[getScopeThread( scope )];
+
+        push( thread, scope, iStartTicks, iEndTicks, thread.iDepth, false );
+    }
+
+    /** Producer side, render thread: GPU timestamps in nanoseconds. */
+    void addGpuEvent( Scope scope, int64 iStartNs, int64 iEndNs, int iDepth ) noexcept
+    {
+        push( m_aThreads[kThread_Render], scope, iStartNs, iEndNs, iDepth, true );
+    }
+
+    //==============================================================================
+    /** Consumer side: takes every thread's events and updates the report.
+        Returns false if there was nothing new.
+    */
+    bool collect()
+    {
+        bool bChanged = false;
+
+        for ( int t = 0; t < kNumThreads; t++ )
+        {
+            ThreadRing&   thread = m_aThreads[t];
+            uint32        iRead  = thread.iReadCount.get();
+            const uint32  iWrite = thread.iWriteCount.get();
+
+            for ( ; iRead != iWrite; ++iRead )
+                bChanged = addToFrame( thread.aRing[iRead & (kRingSize - 1)] ) || bChanged;
+
+            thread.iReadCount.set( iRead );
+        }
+
+        int iNumDropped = 0;
+
+        for ( int t = 0; t < kNumThreads; t++ )
+            iNumDropped += m_aThreads[t].iNumDropped.get();
+
+        m_report.iNumDropped = iNumDropped;
+
+        if ( bChanged )
+            updateStats();
+
+        return bChanged;
+    }
+
+    /** Consumer side. */
+    const Report& getReport() const noexcept    { return m_report; }
+
+    /** Consumer side: one line per scope that ran, for logs. */
+    String getSummary() const
+    {
+        String strSummary;
+
+        for ( int i = 0; i < kNumScopes; i++ )
+        {
+            const ScopeStats& cpu = m_report.aCpu[i];
+
+            if ( cpu.iNumSamples == 0 )
+                continue;
+
+            strSummary << getScopeName( static_cast<Scope>(i) ) << ": p50 " << String( cpu.fP50Ms, 3 )
+                       << " ms, p99 " << String( cpu.fP99Ms, 3 ) << " ms, max " << String( cpu.fMaxMs, 3 ) << " ms";
+
+            if ( m_report.aGpu[i].iNumSamples > 0 )
+                strSummary << ", gpu p50 " << String( m_report.aGpu[i].fP50Ms, 3 ) << " ms";
+
+            strSummary << newLine;
+        }
+
+        return strSummary;
+    }
+
+private:
+    //==============================================================================
+    enum { kNumSeries = kNumScopes * 2 };
+
+    struct Event
+    {
+        int64   iStart;
+        int64   iEnd;
+        int16   iScope;
+        int8    iDepth;
+        bool    bGpu;
+    };
+
+    /// written by one thread, read by the consumer; padded so rings don't share lines.
+    struct ThreadRing
+    {
+        ThreadRing() : iDepth( 0 ) {}
+
+        Event           aRing[kRingSize];
+        Atomic<uint32>  iWriteCount;
+        char            acPad0[64];
+        Atomic<uint32>  iReadCount;
+        Atomic<int>     iNumDropped;
+        int             iDepth;
+        char            acPad1[64];
+    };
+
+    /// a frame being added up on the consumer side.
+    struct PendingFrame
+    {
+        float   afMs[kNumScopes];
+        bool    abSeen[kNumScopes];
+        int     iNumBars;
+        int64   aiBarStart[kMaxFlameBars];
+        int64   aiBarEnd[kMaxFlameBars];
+        int     aiBarScope[kMaxFlameBars];
+        int     aiBarDepth[kMaxFlameBars];
+    };
+
+    struct Window
+    {
+        HeapBlock<float>    afMs;
+        int                 iCount;
+        int                 iNext;
+    };
+
+    void push( ThreadRing& thread, Scope scope, int64 iStart, int64 iEnd, int iDepth, bool bGpu ) noexcept
+    {
+        const uint32 iWrite = thread.iWriteCount.get();
+
+        if ( iWrite - thread.iReadCount.get() >= static_cast<uint32>(kRingSize) )
+        {
+            ++thread.iNumDropped;
+            return;
+        }
+
+        Event& event = thread.aRing[iWrite & (kRingSize - 1)];
+
+        event.iStart = iStart;
+        event.iEnd   = iEnd;
+        event.iScope = static_cast<int16>(scope);
+        event.iDepth = static_cast<int8>(jmin( iDepth, 127 ));
+        event.bGpu   = bGpu;
+
+        thread.iWriteCount.set( iWrite + 1 );
+    }
+
+    static float toMs( const Event& event, int64 iTicks ) noexcept
+    {
+        return event.bGpu ? static_cast<float>(iTicks * 1.0e-6)
+                          : static_cast<float>(Time::highResolutionTicksToSeconds( iTicks ) * 1000.0);
+    }
+
+    /// returns true when the event ended a frame.
+    bool addToFrame( const Event& event )
+    {
+        const Scope     scope   = static_cast<Scope>(event.iScope);
+        const int       iThread = getScopeThread( scope );
+        PendingFrame&   frame   = event.bGpu ? m_gpuFrame : m_aCpuFrames[iThread];
+
+        frame.afMs[scope]  += toMs( event, event.iEnd - event.iStart );
+        frame.abSeen[scope] = true;
+
+        if ( iThread == kThread_Render && frame.iNumBars < kMaxFlameBars )
+        {
+            frame.aiBarStart[frame.iNumBars] = event.iStart;
+            frame.aiBarEnd[frame.iNumBars]   = event.iEnd;
+            frame.aiBarScope[frame.iNumBars] = scope;
+            frame.aiBarDepth[frame.iNumBars] = event.iDepth;
+            ++frame.iNumBars;
+        }
+
+        if ( !isRootScope( scope ) )
+            return false;
+
+        for ( int i = 0; i < kNumScopes; i++ )
+        {
+            if ( frame.abSeen[i] )
+                addSample( m_aWindows[getSeries( i, event.bGpu )], frame.afMs[i] );
+        }
+
+        if ( iThread == kThread_Render )
+        {
+            makeFlame( event, frame, event.bGpu ? m_report.gpuFlame : m_report.cpuFlame );
+            m_report.bHasGpu = m_report.bHasGpu || event.bGpu;
+        }
+
+        zerostruct( frame );
+        return true;
+    }
+
+    static void makeFlame( const Event& event, const PendingFrame& frame, Flame& flame )
+    {
+        int64 iFirst = event.iStart;
+        int64 iLast  = event.iEnd;
+
+        for ( int i = 0; i < frame.iNumBars; i++ )
+        {
+            iFirst = jmin( iFirst, frame.aiBarStart[i] );
+            iLast  = jmax( iLast, frame.aiBarEnd[i] );
+        }
+
+        flame.iNumBars  = frame.iNumBars;
+        flame.fLengthMs = toMs( event, iLast - iFirst );
+
+        for ( int i = 0; i < frame.iNumBars; i++ )
+        {
+            FlameBar& bar = flame.aBars[i];
+
+            bar.iScope      = frame.aiBarScope[i];
+            bar.iDepth      = frame.aiBarDepth[i];
+            bar.fStartMs    = toMs( event, frame.aiBarStart[i] - iFirst );
+            bar.fDurationMs = toMs( event, frame.aiBarEnd[i] - frame.aiBarStart[i] );
+        }
+    }
+
+    static int getSeries( int iScope, bool bGpu ) noexcept      { return iScope * 2 + (bGpu ? 1 : 0); }
+
+    static void addSample( Window& window, float fMs ) noexcept
+    {
+        window.afMs[window.iNext] = fMs;
+        window.iNext  = (window.iNext + 1) % kWindowSize;
+        window.iCount = jmin( window.iCount + 1, static_cast<int>(kWindowSize) );
+    }
+
+    void updateStats()
+    {
+        for ( int i = 0; i < kNumScopes; i++ )
+        {
+            updateScopeStats( m_aWindows[getSeries( i, false )], m_report.aCpu[i] );
+            updateScopeStats( m_aWindows[getSeries( i, true )], m_report.aGpu[i] );
+        }
+    }
+
+    void updateScopeStats( const Window& window, ScopeStats& stats )
+    {
+        zerostruct( stats );
+        stats.iNumSamples = window.iCount;
+
+        if ( window.iCount == 0 )
+            return;
+
+        for ( int i = 0; i < window.iCount; i++ )
+        {
+            m_afSorted[i] = window.afMs[i];
+            ++stats.aiHistogram[getBucket( window.afMs[i] )];
+        }
+
+        std::sort( m_afSorted.getData(), m_afSorted.getData() + window.iCount );
+
+        stats.fP50Ms = LatencyMonitor::getPercentile( m_afSorted, window.iCount, 50.0 );
+        stats.fP99Ms = LatencyMonitor::getPercentile( m_afSorted, window.iCount, 99.0 );
+        stats.fMaxMs = m_afSorted[window.iCount - 1];
+    }
+
+    void clearWindows()
+    {
+        for ( int i = 0; i < kNumSeries; i++ )
+        {
+            m_aWindows[i].iCount = 0;
+            m_aWindows[i].iNext  = 0;
+        }
+
+        for ( int t = 0; t < kNumThreads; t++ )
+            zerostruct( m_aCpuFrames[t] );
+
+        zerostruct( m_gpuFrame );
+        m_report = Report();
+    }
+
+    // rings, one producer each
+    ThreadRing          m_aThreads[kNumThreads];
+    Atomic<int>         m_iEnabled;
+
+    // windows, owned by the consumer
+    Window              m_aWindows[kNumSeries];
+    PendingFrame        m_aCpuFrames[kNumThreads];
+    PendingFrame        m_gpuFrame;
+    HeapBlock<float>    m_afSorted;
+    Report              m_report;
+
+    JUCE_DECLARE_NON_COPYABLE (FrameProfiler)
+};
+
+//==============================================================================
+/**
+    Times render thread scopes on the GPU with timestamp queries.
+
+    Queries can't be read back without a stall until the GPU has caught up, so
+    each frame's queries are only read when their slot comes round again, a few
+    frames later, and handed to the FrameProfiler then.  Timestamps nest, unlike
+    elapsed time queries, so scopes inside scopes are timed too.  Without
+    GL 3.3 or ARB_timer_query initialise() returns false and only CPU times are
+    collected.
+*/
+class GpuScopeTimer
+{
+public:
+    enum
+    {
+        kFramesInFlight     = 4,
+        kMaxScopesPerFrame  = 64
+    };
+
+    explicit GpuScopeTimer( FrameProfiler& profiler )
+      : m_profiler( profiler ),
+        m_iFrame( 0 ),
+        m_bAvailable( false ),
+        m_pfnGenQueries( nullptr ),
+        m_pfnDeleteQueries( nullptr ),
+        m_pfnQueryCounter( nullptr ),
+        m_pfnGetQueryObjectiv( nullptr ),
+        m_pfnGetQueryObjectui64v( nullptr )
+    {
+        zerostruct( m_aFrames );
+    }
+
+    ~GpuScopeTimer()
+    {
+        // release() has to be called while the context is still active.
+        jassert( !m_bAvailable );
+    }
+
+    //==============================================================================
+    /** Creates the queries, call from newOpenGLContextCreated(). */
+    bool initialise()
+    {
+        release();
+
+        m_pfnGenQueries          = reinterpret_cast<GenQueriesFunction>(SceneLighting::getExtensionFunction( "glGenQueries" ));
+        m_pfnDeleteQueries       = reinterpret_cast<GenQueriesFunction>(SceneLighting::getExtensionFunction( "glDeleteQueries" ));
+        m_pfnQueryCounter        = reinterpret_cast<QueryCounterFunction>(SceneLighting::getExtensionFunction( "glQueryCounter" ));
+        m_pfnGetQueryObjectiv    = reinterpret_cast<GetQueryObjectivFunction>(SceneLighting::getExtensionFunction( "glGetQueryObjectiv" ));
+        m_pfnGetQueryObjectui64v = reinterpret_cast<GetQueryObjectui64vFunction>(SceneLighting::getExtensionFunction( "glGetQueryObjectui64v" ));
+
+        if ( m_pfnGenQueries == nullptr || m_pfnDeleteQueries == nullptr || m_pfnQueryCounter == nullptr
+              || m_pfnGetQueryObjectiv == nullptr || m_pfnGetQueryObjectui64v == nullptr )
+            return false;
+
+        for ( int i = 0; i < kFramesInFlight; i++ )
+            m_pfnGenQueries( kMaxScopesPerFrame * 2, m_aFrames[i].aiQueries );
+
+        m_bAvailable = true;
+        return true;
+    }
+
+    /** Frees the queries, call from openGLContextClosing(). */
+    void release()
+    {
+        if ( m_bAvailable )
+        {
+            for ( int i = 0; i < kFramesInFlight; i++ )
+                m_pfnDeleteQueries( kMaxScopesPerFrame * 2, m_aFrames[i].aiQueries );
+        }
+
+        zerostruct( m_aFrames );
+        m_bAvailable = false;
+    }
+
+    bool isAvailable() const noexcept       { return m_bAvailable; }
+
+    //==============================================================================
+    /** Moves on to the next slot, reading back the frame that used it last.  Call before the root scope. */
+    void beginFrame()
+    {
+        if ( !m_bAvailable )
+            return;
+
+        m_iFrame = (m_iFrame + 1) % kFramesInFlight;
+
+        FrameQueries& frame = m_aFrames[m_iFrame];
+
+        if ( frame.iNumScopes > 0 )
+        {
+            GLint iAvailable = 0;
+            m_pfnGetQueryObjectiv( frame.aiQueries[frame.iLastQuery], GL_QUERY_RESULT_AVAILABLE, &iAvailable );
+
+            // still not done after a few frames, drop it rather than stall
+            if ( iAvailable != 0 )
+                readBack( frame );
+        }
+
+        frame.iNumScopes = 0;
+    }
+
+    /** Returns the scope's index for end(), or -1 if it isn't timed. */
+    int begin( FrameProfiler::Scope scope, int iDepth )
+    {
+        FrameQueries& frame = m_aFrames[m_iFrame];
+
+        if ( !m_bAvailable || frame.iNumScopes >= kMaxScopesPerFrame )
+            return -1;
+
+        const int iIndex = frame.iNumScopes++;
+
+        frame.aiScope[iIndex] = scope;
+        frame.aiDepth[iIndex] = iDepth;
+        frame.iLastQuery = iIndex * 2;
+        m_pfnQueryCounter( frame.aiQueries[frame.iLastQuery], GL_TIMESTAMP );
+        return iIndex;
+    }
+
+    void end( int iIndex )
+    {
+        if ( iIndex < 0 )
+            return;
+
+        FrameQueries& frame = m_aFrames[m_iFrame];
+
+        frame.iLastQuery = iIndex * 2 + 1;
+        m_pfnQueryCounter( frame.aiQueries[frame.iLastQuery], GL_TIMESTAMP );
+    }
+
+private:
+    typedef void (FINGERVISUALIZER_GL_CALL *GenQueriesFunction) (GLsizei, GLuint*);
+    typedef void (FINGERVISUALIZER_GL_CALL *QueryCounterFunction) (GLuint, GLenum);
+    typedef void (FINGERVISUALIZER_GL_CALL *GetQueryObjectivFunction) (GLuint, GLenum, GLint*);
+    typedef void (FINGERVISUALIZER_GL_CALL *GetQueryObjectui64vFunction) (GLuint, GLenum, uint64*);
+
+    struct FrameQueries
+    {
+        GLuint  aiQueries[kMaxScopesPerFrame * 2];
+        int     aiScope[kMaxScopesPerFrame];
+        int     aiDepth[kMaxScopesPerFrame];
+        int     iNumScopes;
+        /// queries finish in the order they were issued, so this one going through means they all have.
+        int     iLastQuery;
+    };
+
+    void readBack( const FrameQueries& frame )
+    {
+        // the root scope began first and has to arrive last, it ends the frame
+        for ( int i = frame.iNumScopes; --i >= 0; )
+        {
+            uint64 iStartNs = 0, iEndNs = 0;
+
+            m_pfnGetQueryObjectui64v( frame.aiQueries[i * 2], GL_QUERY_RESULT, &iStartNs );
+            m_pfnGetQueryObjectui64v( frame.aiQueries[i * 2 + 1], GL_QUERY_RESULT, &iEndNs );
+
+            m_profiler.addGpuEvent( static_cast<FrameProfiler::Scope>(frame.aiScope[i]),
+                                    static_cast<int64>(iStartNs), static_cast<int64>(iEndNs), frame.aiDepth[i] );
+        }
+    }
+
+    FrameProfiler&                  m_profiler;
+    FrameQueries                    m_aFrames[kFramesInFlight];
+    int                             m_iFrame;
+    bool                            m_bAvailable;
+    GenQueriesFunction              m_pfnGenQueries;
+    GenQueriesFunction              m_pfnDeleteQueries;
+    QueryCounterFunction            m_pfnQueryCounter;
+    GetQueryObjectivFunction        m_pfnGetQueryObjectiv;
+    GetQueryObjectui64vFunction     m_pfnGetQueryObjectui64v;
+
+    JUCE_DECLARE_NON_COPYABLE (GpuScopeTimer)
+};
+
+//==============================================================================
+/**
+    Times the rest of the enclosing block as one FrameProfiler scope, on the
+    GPU as well when given a GpuScopeTimer.
+*/
+class ScopedProfile
+{
+public:
+    ScopedProfile( FrameProfiler& profiler, FrameProfiler::Scope scope, GpuScopeTimer* pGpuTimer = nullptr ) noexcept
+      : m_profiler( profiler ),
+        m_scope( scope ),
+        m_bActive( profiler.isEnabled() ),
+        m_iDepth( 0 ),
+        m_iGpuIndex( -1 ),
+        m_pGpuTimer( pGpuTimer ),
+        m_iStartTicks( 0 )
+    {
+        if ( !m_bActive )
+            return;
+
+        m_iDepth = m_profiler.enterScope( scope );
+
+        if ( m_pGpuTimer != nullptr )
+            m_iGpuIndex = m_pGpuTimer->begin( scope, m_iDepth );
+
+        m_iStartTicks = Time::getHighResolutionTicks();
+    }
+
+    ~ScopedProfile()
+    {
+        if ( !m_bActive )
+            return;
+
+        const int64 iEndTicks = Time::getHighResolutionTicks();
+
+        if ( m_pGpuTimer != nullptr )
+            m_pGpuTimer->end( m_iGpuIndex );
+
+        m_profiler.leaveScope( m_scope, m_iStartTicks, iEndTicks, m_iDepth );
+    }
+
+private:
+    FrameProfiler&          m_profiler;
+    FrameProfiler::Scope    m_scope;
+    bool                    m_bActive;
+    int                     m_iDepth;
+    int                     m_iGpuIndex;
+    GpuScopeTimer*          m_pGpuTimer;
+    int64                   m_iStartTicks;
+
+    JUCE_DECLARE_NON_COPYABLE (ScopedProfile)
+};
+
+#endif // FINGERVISUALIZER_FRAMEPROFILER_H_INCLUDED
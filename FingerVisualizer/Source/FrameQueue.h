@@ -0,0 +1,160 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_FRAMEQUEUE_H_INCLUDED
+#define FINGERVISUALIZER_FRAMEQUEUE_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/**
+    Bounded lock-free queue of values from one producer thread to one consumer
+    thread, for stages that have to see every frame rather than the newest one
+    like FrameMailbox.
+
+    The producer fills the slot returned by beginPush() in place and calls
+    endPush().  What happens when the queue is full is up to the OverflowPolicy,
+    and neither side ever blocks: with kDropOldest the producer discards the
+    oldest queued value to make room, with kDropNewest it writes into a spare
+    slot that endPush() throws away.  Producers that would rather wait, like a
+    file being replayed, can check isFull() first.
+
+    Because the producer may drop the value the consumer is copying, pop()
+    copies first and then claims it with a compare and swap on the read count;
+    if the claim fails the copy may be torn and it tries the next value.
+*/
+template <typename ValueType>
+class FrameQueue
+{
+public:
+    enum OverflowPolicy
+    {
+        /// the consumer always gets the newest values, for the lowest latency.
+        kDropOldest,
+        /// the consumer gets an unbroken run of values, new ones are lost instead.
+        kDropNewest
+    };
+
+    FrameQueue( int iCapacity, OverflowPolicy policy )
+      : m_policy( policy ),
+        m_bPushingToSpare( false )
+    {
+        setCapacity( iCapacity );
+    }
+
+    /** Resizes and empties the queue.  Only while neither side is using it. */
+    void setCapacity( int iCapacity )
+    {
+        m_iCapacity = static_cast<uint32>(nextPowerOfTwo( jmax( 1, iCapacity ) ));
+
+        m_aSlots.clearQuick();
+        m_aSlots.insertMultiple( 0, ValueType(), static_cast<int>(m_iCapacity) );
+        clear();
+    }
+
+    /** Only while neither side is using the queue. */
+    void setOverflowPolicy( OverflowPolicy policy ) noexcept    { m_policy = policy; }
+    OverflowPolicy getOverflowPolicy() const noexcept           { return m_policy; }
+
+    /** Empties the queue and the dropped count.  Only while neither side is using it. */
+    void clear() noexcept
+    {
+        m_iReadCount.set( m_iWriteCount.get() );
+        m_iNumDropped.set( 0 );
+    }
+
+    //==============================================================================
+    /** Producer side: the slot to fill before calling endPush().  Its contents are stale. */
+    ValueType& beginPush() noexcept
+    {
+        const uint32 iWrite = m_iWriteCount.get();
+
+        for (;;)
+        {
+            const uint32 iRead = m_iReadCount.get();
+
+            if ( iWrite - iRead < m_iCapacity )
+            {
+                m_bPushingToSpare = false;
+                return m_aSlots.getReference( static_cast<int>(iWrite & (m_iCapacity - 1)) );
+            }
+
+            if ( m_policy == kDropNewest )
+            {
+                m_bPushingToSpare = true;
+                return m_spare;
+            }
+
+            // the consumer may claim the oldest value first, then there's room anyway
+            if ( m_iReadCount.compareAndSetBool( iRead + 1, iRead ) )
+                ++m_iNumDropped;
+        }
+    }
+
+    /** Producer side: queues the slot filled since beginPush().  Returns false if
+        the queue was full and the value has been dropped.
+    */
+    bool endPush() noexcept
+    {
+        if ( m_bPushingToSpare )
+        {
+            ++m_iNumDropped;
+            return false;
+        }
+
+        m_iWriteCount.set( m_iWriteCount.get() + 1 );
+        return true;
+    }
+
+    /** Producer side: true if the next push is going to drop a value. */
+    bool isFull() const noexcept
+    {
+        return getNumQueued() >= static_cast<int>(m_iCapacity);
+    }
+
+    //==============================================================================
+    /** Consumer side: copies the oldest value into out and removes it.
+        Returns false if the queue is empty.
+    */
+    bool pop( ValueType& out )
+    {
+        for (;;)
+        {
+            const uint32 iRead = m_iReadCount.get();
+
+            if ( iRead == m_iWriteCount.get() )
+                return false;
+
+            out = m_aSlots.getReference( static_cast<int>(iRead & (m_iCapacity - 1)) );
+
+            if ( m_iReadCount.compareAndSetBool( iRead + 1, iRead ) )
+                return true;
+        }
+    }
+
+    //==============================================================================
+    int getCapacity() const noexcept        { return static_cast<int>(m_iCapacity); }
+    int getNumQueued() const noexcept       { return static_cast<int>(m_iWriteCount.get() - m_iReadCount.get()); }
+
+    /** Values lost to a full queue since the last clear(), by either policy. */
+    int getNumDropped() const noexcept      { return m_iNumDropped.get(); }
+
+private:
+    Array<ValueType>    m_aSlots;
+    ValueType           m_spare;            // owned by the producer
+    uint32              m_iCapacity;
+    OverflowPolicy      m_policy;
+    bool                m_bPushingToSpare;  // owned by the producer
+    Atomic<uint32>      m_iWriteCount;      // advanced by the producer
+    Atomic<uint32>      m_iReadCount;       // advanced by either side
+    Atomic<int>         m_iNumDropped;
+
+    JUCE_DECLARE_NON_COPYABLE (FrameQueue)
+};
+
+#endif // FINGERVISUALIZER_FRAMEQUEUE_H_INCLUDED
@@ -0,0 +1,168 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_FRAMESNAPSHOT_H_INCLUDED
+#define FINGERVISUALIZER_FRAMESNAPSHOT_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "Leap.h"
+
+//==============================================================================
+/**
+    Plain copy of the parts of a Leap::Finger that the visualizer draws.
+
+    Joint 0 is the base of the metacarpal, joints 1-4 are the far ends of the
+    metacarpal, proximal, intermediate and distal bones.
+*/
+struct FingerSnapshot
+{
+    enum { kNumJoints = 5 };
+
+    void setFromFinger( const Leap::Finger& finger )
+    {
+        avJoints[0] = finger.bone( Leap::Bone::TYPE_METACARPAL ).prevJoint();
+
+        for ( int i = Leap::Bone::TYPE_METACARPAL; i <= Leap::Bone::TYPE_DISTAL; i++ )
+        {
+            avJoints[i + 1] = finger.bone( static_cast<Leap::Bone::Type>(i) ).nextJoint();
+        }
+
+        fWidth = finger.width();
+    }
+
+    const Leap::Vector& tipPosition() const   { return avJoints[kNumJoints - 1]; }
+
+    Leap::Vector    avJoints[kNumJoints];
+    float           fWidth;
+};
+
+//==============================================================================
+/** Plain copy of the parts of a Leap::Hand that the visualizer draws. */
+struct HandSnapshot
+{
+    enum { kNumFingers = 5 };
+
+    void setFromHand( const Leap::Hand& hand )
+    {
+        iId           = hand.id();
+        bIsLeft       = hand.isLeft();
+        vPalmPosition = hand.palmPosition();
+        vPalmNormal   = hand.palmNormal();
+        vDirection    = hand.direction();
+        vWrist        = hand.arm().wristPosition();
+
+        const Leap::FingerList& fingers = hand.fingers();
+
+        for ( int i = 0; i < kNumFingers; i++ )
+        {
+            aFingers[i].setFromFinger( fingers[i] );
+        }
+    }
+
+    int32_t         iId;
+    bool            bIsLeft;
+    Leap::Vector    vPalmPosition;
+    Leap::Vector    vPalmNormal;
+    Leap::Vector    vDirection;
+    Leap::Vector    vWrist;
+    FingerSnapshot  aFingers[kNumFingers];
+};
+
+//==============================================================================
+/**
+    Fixed capacity, allocation free copy of a Leap::Frame.
+
+    Leap::Frame objects are reference counted handles into the tracking service's
+    data, so they are captured into one of these on the listener thread and only
+    the copy is handed to the render thread.
+*/
+struct FrameSnapshot
+{
+    enum { kMaxHands = 64 };
+
+    FrameSnapshot()
+      : iFrameId( 0 ),
+        iTimestamp( 0 ),
+        fUpdateFPS( 0.0f ),
+        iReceivedTicks( 0 ),
+        iPublishedTicks( 0 ),
+        fDeviceLatencyMs( 0.0f ),
+        iNumHands( 0 )
+    {
+    }
+
+    void setFromFrame( const Leap::Frame& frame )
+    {
+        iFrameId    = frame.id();
+        iTimestamp  = frame.timestamp();
+
+        const Leap::HandList& hands = frame.hands();
+
+        iNumHands = jmin( hands.count(), static_cast<int>(kMaxHands) );
+
+        for ( int i = 0; i < iNumHands; i++ )
+        {
+            aHands[i].setFromHand( hands[i] );
+        }
+    }
+
+    int64_t         iFrameId;
+    /// device timestamp in microseconds
+    int64_t         iTimestamp;
+    float           fUpdateFPS;
+    /// when the visualizer received and published the frame, in high resolution ticks
+    int64_t         iReceivedTicks;
+    int64_t         iPublishedTicks;
+    /// estimated time from the device timestamp to iReceivedTicks
+    float           fDeviceLatencyMs;
+    int             iNumHands;
+    HandSnapshot    aHands[kMaxHands];
+};
+
+//==============================================================================
+/**
+    Receives frames from anything producing FrameSnapshots on its own thread.
+
+    The producer fills the snapshot returned by beginFrame() in place and then
+    calls endFrame(), so no frame data is copied on the way to the renderer.
+*/
+class FrameSnapshotConsumer
+{
+public:
+    virtual ~FrameSnapshotConsumer() {}
+
+    /** Returns the snapshot the next frame should be written into. */
+    virtual FrameSnapshot& beginFrame() = 0;
+
+    /** Hands over the snapshot returned by the last beginFrame(). */
+    virtual void endFrame() = 0;
+};
+
+//==============================================================================
+/**
+    Anything that can drive the visualizer: the Leap service, a recorded trace
+    or a generator.  Frames are delivered to the consumer from whatever thread
+    the source likes, between start() and stop().
+*/
+class FrameSource
+{
+public:
+    /** Implementations must stop() in their own destructor. */
+    virtual ~FrameSource() {}
+
+    /** Begins delivering frames to the consumer. */
+    virtual void start( FrameSnapshotConsumer& consumer ) = 0;
+
+    /** Stops delivering frames; once this returns the consumer won't be called again. */
+    virtual void stop() = 0;
+
+    /** Short human readable description, for the HUD and log. */
+    virtual String getDescription() const = 0;
+};
+
+#endif // FINGERVISUALIZER_FRAMESNAPSHOT_H_INCLUDED
@@ -0,0 +1,802 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_FRAMESTREAM_H_INCLUDED
+#define FINGERVISUALIZER_FRAMESTREAM_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FrameSnapshot.h"
+#include "FrameQueue.h"
+
+//==============================================================================
+/**
+    Wire format for streaming frames to visualizers on other machines.
+
+    Every message is one InterprocessConnection message, all values little
+    endian.  Frames go from the server to its clients:
+
+        uint8   messageType         kMessage_Frame
+        uint8   frameFlags          kFrameFlag_KeyFrame
+        uint32  sequence
+        int64   frameId
+        int64   timestamp           device microseconds
+        int64   sendTime            server's high resolution clock, microseconds
+        uint8   numHands
+        per hand:
+            int32   handId
+            uint8   handFlags       kHandFlag_Left, kHandFlag_Delta
+            varint  values[kValuesPerHand]
+
+    The values of a hand are its palm position, palm normal, direction, wrist,
+    finger widths and joints, in that order, quantized to 1/100 mm or 1/16384
+    of a unit vector.  With kHandFlag_Delta each value is the difference from
+    the same hand in the previous frame, which is usually a byte or two, so
+    both ends keep the previous quantized hands.  Values are zigzag encoded
+    LEB128 varints.  Key frames carry no deltas; the server sends one every
+    kKeyFrameInterval frames and whenever a client connects or asks for one.
+
+    Clients answer each frame with kMessage_Ack, its sequence and send time,
+    from which the server measures the round trip.  A client that can't decode
+    a delta sends kMessage_KeyFrameRequest.
+*/
+namespace FrameStream
+{
+    enum
+    {
+        kDefaultPort        = 7680,
+        kMagicHeader        = 0x5356464c,   // "LFVS"
+        kKeyFrameInterval   = 120,
+        kPositionScale      = 100,
+        kUnitScale          = 16384,
+        kNumFingers         = HandSnapshot::kNumFingers,
+        kNumJoints          = FingerSnapshot::kNumJoints,
+        kValuesPerHand      = 4 * 3 + kNumFingers + kNumFingers * kNumJoints * 3,
+        kMaxHands           = FrameSnapshot::kMaxHands
+    };
+
+    enum MessageType
+    {
+        kMessage_Frame              = 1,
+        kMessage_Ack                = 2,
+        kMessage_KeyFrameRequest    = 3
+    };
+
+    enum
+    {
+        kFrameFlag_KeyFrame = 1,
+        kHandFlag_Left      = 1,
+        kHandFlag_Delta     = 2
+    };
+
+    inline int getMaxFrameSize() noexcept
+    {
+        return 2 + 4 + 3 * 8 + 1 + kMaxHands * (4 + 1 + kValuesPerHand * 5);
+    }
+
+    inline int64 getNowMicros() noexcept
+    {
+        return static_cast<int64>(Time::highResolutionTicksToSeconds( Time::getHighResolutionTicks() ) * 1000000.0);
+    }
+
+    //==============================================================================
+    /** A hand as the integers that are actually sent. */
+    struct QuantizedHand
+    {
+        void setFromHand( const HandSnapshot& hand ) noexcept
+        {
+            int32* pi = aiValues;
+
+            iId     = hand.iId;
+            bIsLeft = hand.bIsLeft;
+
+            pi = putVector( pi, hand.vPalmPosition, kPositionScale );
+            pi = putVector( pi, hand.vPalmNormal, kUnitScale );
+            pi = putVector( pi, hand.vDirection, kUnitScale );
+            pi = putVector( pi, hand.vWrist, kPositionScale );
+
+            for ( int i = 0; i < kNumFingers; i++ )
+                *pi++ = roundToInt( hand.aFingers[i].fWidth * kPositionScale );
+
+            for ( int i = 0; i < kNumFingers; i++ )
+                for ( int j = 0; j < kNumJoints; j++ )
+                    pi = putVector( pi, hand.aFingers[i].avJoints[j], kPositionScale );
+
+            jassert( pi == aiValues + kValuesPerHand );
+        }
+
+        void copyTo( HandSnapshot& hand ) const noexcept
+        {
+            const int32* pi = aiValues;
+
+            hand.iId     = iId;
+            hand.bIsLeft = bIsLeft;
+
+            pi = getVector( pi, hand.vPalmPosition, kPositionScale );
+            pi = getVector( pi, hand.vPalmNormal, kUnitScale );
+            pi = getVector( pi, hand.vDirection, kUnitScale );
+            pi = getVector( pi, hand.vWrist, kPositionScale );
+
+            for ( int i = 0; i < kNumFingers; i++ )
+                hand.aFingers[i].fWidth = *pi++ / static_cast<float>(kPositionScale);
+
+            for ( int i = 0; i < kNumFingers; i++ )
+                for ( int j = 0; j < kNumJoints; j++ )
+                    pi = getVector( pi, hand.aFingers[i].avJoints[j], kPositionScale );
+        }
+
+        static int32* putVector( int32* pi, const Leap::Vector& v, int iScale ) noexcept
+        {
+            *pi++ = roundToInt( v.x * iScale );
+            *pi++ = roundToInt( v.y * iScale );
+            *pi++ = roundToInt( v.z * iScale );
+            return pi;
+        }
+
+        static const int32* getVector( const int32* pi, Leap::Vector& v, int iScale ) noexcept
+        {
+            const float fScale = 1.0f / iScale;
+
+            v = Leap::Vector( pi[0] * fScale, pi[1] * fScale, pi[2] * fScale );
+            return pi + 3;
+        }
+
+        int32   iId;
+        bool    bIsLeft;
+        int32   aiValues[kValuesPerHand];
+    };
+
+    inline const QuantizedHand* findHand( const QuantizedHand* aHands, int iNumHands, int32 iId ) noexcept
+    {
+        for ( int i = 0; i < iNumHands; i++ )
+        {
+            if ( aHands[i].iId == iId )
+                return aHands + i;
+        }
+
+        return nullptr;
+    }
+
+    //==============================================================================
+    /** Appends little endian values to a fixed size buffer. */
+    class Writer
+    {
+    public:
+        Writer( uint8* pData, int iCapacity ) noexcept : m_pData( pData ), m_iCapacity( iCapacity ), m_iSize( 0 ) {}
+
+        int getSize() const noexcept                { return m_iSize; }
+
+        void writeByte( int iValue ) noexcept
+        {
+            jassert( m_iSize < m_iCapacity );
+            m_pData[m_iSize++] = static_cast<uint8>(iValue);
+        }
+
+        void writeInt32( int32 iValue ) noexcept
+        {
+            for ( int i = 0; i < 4; i++ )
+                writeByte( static_cast<int>((static_cast<uint32>(iValue) >> (8 * i)) & 0xff) );
+        }
+
+        void writeInt64( int64 iValue ) noexcept
+        {
+            for ( int i = 0; i < 8; i++ )
+                writeByte( static_cast<int>((static_cast<uint64>(iValue) >> (8 * i)) & 0xff) );
+        }
+
+        void writeSignedVarint( int32 iValue ) noexcept
+        {
+            // zigzag, so small negative numbers are short too
+            uint32 iBits = (static_cast<uint32>(iValue) << 1) ^ static_cast<uint32>(iValue >> 31);
+
+            while ( iBits >= 0x80 )
+            {
+                writeByte( static_cast<int>((iBits & 0x7f) | 0x80) );
+                iBits >>= 7;
+            }
+
+            writeByte( static_cast<int>(iBits) );
+        }
+
+    private:
+        uint8*  m_pData;
+        int     m_iCapacity;
+        int     m_iSize;
+    };
+
+    /** Reads what Writer wrote, remembering if it ran off the end. */
+    class Reader
+    {
+    public:
+        Reader( const void* pData, size_t iSize ) noexcept
+          : m_pData( static_cast<const uint8*>(pData) ), m_iSize( iSize ), m_iPosition( 0 ), m_bFailed( false ) {}
+
+        bool failed() const noexcept                { return m_bFailed; }
+
+        int readByte() noexcept
+        {
+            if ( m_iPosition >= m_iSize )
+            {
+                m_bFailed = true;
+                return 0;
+            }
+
+            return m_pData[m_iPosition++];
+        }
+
+        int32 readInt32() noexcept
+        {
+            uint32 iValue = 0;
+
+            for ( int i = 0; i < 4; i++ )
+                iValue |= static_cast<uint32>(readByte()) << (8 * i);
+
+            return static_cast<int32>(iValue);
+        }
+
+        int64 readInt64() noexcept
+        {
+            uint64 iValue = 0;
+
+            for ( int i = 0; i < 8; i++ )
+                iValue |= static_cast<uint64>(readByte()) << (8 * i);
+
+            return static_cast<int64>(iValue);
+        }
+
+        int32 readSignedVarint() noexcept
+        {
+            uint32 iBits = 0;
+
+            for ( int iShift = 0; iShift < 35 && !m_bFailed; iShift += 7 )
+            {
+                const int iByte = readByte();
+
+                iBits |= static_cast<uint32>(iByte & 0x7f) << iShift;
+
+                if ( (iByte & 0x80) == 0 )
+                    return static_cast<int32>(iBits >> 1) ^ -static_cast<int32>(iBits & 1);
+            }
+
+            m_bFailed = true;
+            return 0;
+        }
+
+    private:
+        const uint8*    m_pData;
+        size_t          m_iSize;
+        size_t          m_iPosition;
+        bool            m_bFailed;
+    };
+
+    //==============================================================================
+    /** Turns frames into kMessage_Frame messages, deltas against the last one encoded. */
+    class Encoder
+    {
+    public:
+        Encoder()
+          : m_iNumPrevious( 0 ),
+            m_iSequence( 0 ),
+            m_iFramesSinceKeyFrame( 0 ),
+            m_bKeyFrameRequested( 1 )
+        {
+            m_aiBuffer.allocate( static_cast<size_t>(getMaxFrameSize()), true );
+            m_aCurrent.allocate( kMaxHands, true );
+            m_aPrevious.allocate( kMaxHands, true );
+        }
+
+        /** Makes the next frame a key frame, from any thread. */
+        void requestKeyFrame() noexcept     { m_bKeyFrameRequested.set( 1 ); }
+
+        /** Encodes the frame into getData() and returns its size in bytes. */
+        int encode( const FrameSnapshot& frame, int64 iSendMicros ) noexcept
+        {
+            bool bKeyFrame = m_bKeyFrameRequested.exchange( 0 ) != 0 || ++m_iFramesSinceKeyFrame >= kKeyFrameInterval;
+
+            if ( bKeyFrame )
+                m_iFramesSinceKeyFrame = 0;
+
+            const int iNumHands = jmin( frame.iNumHands, static_cast<int>(kMaxHands) );
+            Writer    out( m_aiBuffer, getMaxFrameSize() );
+
+            out.writeByte( kMessage_Frame );
+            out.writeByte( bKeyFrame ? kFrameFlag_KeyFrame : 0 );
+            out.writeInt32( static_cast<int32>(m_iSequence++) );
+            out.writeInt64( frame.iFrameId );
+            out.writeInt64( frame.iTimestamp );
+            out.writeInt64( iSendMicros );
+            out.writeByte( iNumHands );
+
+            for ( int i = 0; i < iNumHands; i++ )
+            {
+                QuantizedHand& hand = m_aCurrent[i];
+                hand.setFromHand( frame.aHands[i] );
+
+                const QuantizedHand* pReference = bKeyFrame ? nullptr : findHand( m_aPrevious, m_iNumPrevious, hand.iId );
+
+                out.writeInt32( hand.iId );
+                out.writeByte( (hand.bIsLeft ? kHandFlag_Left : 0) | (pReference != nullptr ? kHandFlag_Delta : 0) );
+
+                for ( int j = 0; j < kValuesPerHand; j++ )
+                    out.writeSignedVarint( hand.aiValues[j] - (pReference != nullptr ? pReference->aiValues[j] : 0) );
+            }
+
+            m_aCurrent.swapWith( m_aPrevious );
+            m_iNumPrevious = iNumHands;
+
+            return out.getSize();
+        }
+
+        const uint8* getData() const noexcept       { return m_aiBuffer; }
+
+    private:
+        HeapBlock<uint8>            m_aiBuffer;
+        HeapBlock<QuantizedHand>    m_aCurrent;
+        HeapBlock<QuantizedHand>    m_aPrevious;
+        int                         m_iNumPrevious;
+        uint32                      m_iSequence;
+        int                         m_iFramesSinceKeyFrame;
+        Atomic<int>                 m_bKeyFrameRequested;
+
+        JUCE_DECLARE_NON_COPYABLE (Encoder)
+    };
+
+    //==============================================================================
+    /** Turns kMessage_Frame messages back into frames. */
+    class Decoder
+    {
+    public:
+        struct FrameInfo
+        {
+            uint32  iSequence;
+            bool    bKeyFrame;
+            int64   iSendMicros;
+        };
+
+        Decoder()
+          : m_iNumPrevious( 0 )
+        {
+            m_aCurrent.allocate( kMaxHands, true );
+            m_aPrevious.allocate( kMaxHands, true );
+        }
+
+        /** Forgets the previous frame, for a new connection. */
+        void reset() noexcept               { m_iNumPrevious = 0; }
+
+        /** Returns false, leaving frame partly written, if the message is malformed
+            or deltas against a hand it hasn't seen; only a key frame fixes that.
+        */
+        bool decode( const void* pData, size_t iSize, FrameSnapshot& frame, FrameInfo& info ) noexcept
+        {
+            Reader in( pData, iSize );
+
+            if ( in.readByte() != kMessage_Frame )
+                return false;
+
+            info.bKeyFrame   = (in.readByte() & kFrameFlag_KeyFrame) != 0;
+            info.iSequence   = static_cast<uint32>(in.readInt32());
+            frame.iFrameId   = in.readInt64();
+            frame.iTimestamp = in.readInt64();
+            info.iSendMicros = in.readInt64();
+
+            const int iNumHands = in.readByte();
+
+            if ( iNumHands > kMaxHands )
+                return false;
+
+            for ( int i = 0; i < iNumHands && !in.failed(); i++ )
+            {
+                QuantizedHand& hand = m_aCurrent[i];
+
+                hand.iId = in.readInt32();
+
+                const int iFlags = in.readByte();
+                hand.bIsLeft = (iFlags & kHandFlag_Left) != 0;
+
+                const QuantizedHand* pReference = nullptr;
+
+                if ( (iFlags & kHandFlag_Delta) != 0 )
+                {
+                    pReference = findHand( m_aPrevious, m_iNumPrevious, hand.iId );
+
+                    if ( pReference == nullptr )
+                        return false;
+                }
+
+                for ( int j = 0; j < kValuesPerHand; j++ )
+                    hand.aiValues[j] = in.readSignedVarint() + (pReference != nullptr ? pReference->aiValues[j] : 0);
+            }
+
+            if ( in.failed() )
+                return false;
+
+            frame.iNumHands = iNumHands;
+
+            for ( int i = 0; i < iNumHands; i++ )
+                m_aCurrent[i].copyTo( frame.aHands[i] );
+
+            m_aCurrent.swapWith( m_aPrevious );
+            m_iNumPrevious = iNumHands;
+            return true;
+        }
+
+    private:
+        HeapBlock<QuantizedHand>    m_aCurrent;
+        HeapBlock<QuantizedHand>    m_aPrevious;
+        int                         m_iNumPrevious;
+
+        JUCE_DECLARE_NON_COPYABLE (Decoder)
+    };
+
+    //==============================================================================
+    /** Bandwidth and latency of one end of a stream. */
+    struct Stats
+    {
+        Stats() : iNumFrames( 0 ), iNumBytes( 0 ), iLastFrameBytes( 0 ), fBytesPerSecond( 0.0f ),
+                  fLastLatencyMs( 0.0f ), fAverageLatencyMs( 0.0f ) {}
+
+        String toString() const
+        {
+            return String( iLastFrameBytes ) + " B/frame, " + String( fBytesPerSecond / 1024.0f, 1 ) + " KB/s, "
+                     + String( fAverageLatencyMs, 2 ) + " ms";
+        }
+
+        int     iNumFrames;
+        int64   iNumBytes;
+        /// size of the newest frame message
+        int     iLastFrameBytes;
+        /// over the last second or so
+        float   fBytesPerSecond;
+        /// one way for a client, round trip for the server
+        float   fLastLatencyMs;
+        float   fAverageLatencyMs;
+    };
+
+    /** Updates Stats from one thread for frames and one for latencies, read from any. */
+    class StatsCounter
+    {
+    public:
+        StatsCounter() : m_iWindowBytes( 0 ), m_fWindowStart( 0.0 ) {}
+
+        void addFrame( int iBytes, double fNowSeconds ) noexcept
+        {
+            const SpinLock::ScopedLockType lock( m_lock );
+
+            m_stats.iNumFrames++;
+            m_stats.iNumBytes      += iBytes;
+            m_stats.iLastFrameBytes = iBytes;
+            m_iWindowBytes         += iBytes;
+
+            if ( fNowSeconds - m_fWindowStart >= 1.0 )
+            {
+                if ( m_fWindowStart > 0.0 )
+                    m_stats.fBytesPerSecond = static_cast<float>(m_iWindowBytes / (fNowSeconds - m_fWindowStart));
+
+                m_fWindowStart = fNowSeconds;
+                m_iWindowBytes = 0;
+            }
+        }
+
+        void addLatency( float fMs ) noexcept
+        {
+            const SpinLock::ScopedLockType lock( m_lock );
+
+            m_stats.fAverageLatencyMs = m_stats.fLastLatencyMs == 0.0f ? fMs : m_stats.fAverageLatencyMs + (fMs - m_stats.fAverageLatencyMs) * 0.05f;
+            m_stats.fLastLatencyMs    = fMs;
+        }
+
+        Stats get() const noexcept
+        {
+            const SpinLock::ScopedLockType lock( m_lock );
+            return m_stats;
+        }
+
+    private:
+        SpinLock    m_lock;
+        Stats       m_stats;
+        int64       m_iWindowBytes;
+        double      m_fWindowStart;
+    };
+}
+
+//==============================================================================
+/**
+    Publishes frames to any number of FrameStreamClients over TCP.
+
+    addFrame() only queues a copy, a thread of its own encodes each frame once
+    and sends it to every client, so a slow network drops frames from the queue
+    instead of holding up tracking.  Clients that go away are cleaned up by the
+    same thread.
+*/
+class FrameStreamServer  : private InterprocessConnectionServer
+{
+public:
+    FrameStreamServer()
+      : m_sender( *this ),
+        m_queue( 4, FrameQueue<FrameSnapshot>::kDropOldest ),
+        m_iPort( 0 )
+    {
+    }
+
+    ~FrameStreamServer()
+    {
+        stop();
+    }
+
+    /** Starts listening, returns false if the port can't be opened. */
+    bool start( int iPort )
+    {
+        stop();
+
+        if ( !beginWaitingForSocket( iPort ) )
+            return false;
+
+        m_iPort = iPort;
+        m_queue.clear();
+        m_sender.startThread( 7 );
+        return true;
+    }
+
+    void stop()
+    {
+        InterprocessConnectionServer::stop();
+
+        m_sender.signalThreadShouldExit();
+        m_frameQueued.signal();
+        m_sender.stopThread( 5000 );
+
+        const ScopedLock connectionsLock( m_connectionsLock );
+        m_apConnections.clear();
+    }
+
+    int getPort() const noexcept            { return m_iPort; }
+
+    int getNumClients() const
+    {
+        const ScopedLock connectionsLock( m_connectionsLock );
+        return m_apConnections.size();
+    }
+
+    FrameStream::Stats getStats() const     { return m_stats.get(); }
+
+    /** From the thread processing frames, never blocks. */
+    void addFrame( const FrameSnapshot& frame )
+    {
+        m_queue.beginPush() = frame;
+        m_queue.endPush();
+        m_frameQueued.signal();
+    }
+
+private:
+    class Connection  : public InterprocessConnection
+    {
+    public:
+        explicit Connection( FrameStreamServer& owner )
+          : InterprocessConnection( false, FrameStream::kMagicHeader ),
+            m_owner( owner )
+        {
+        }
+
+        ~Connection()
+        {
+            disconnect();
+        }
+
+        void connectionMade()
+        {
+            m_owner.m_encoder.requestKeyFrame();
+        }
+
+        void connectionLost()
+        {
+        }
+
+        void messageReceived( const MemoryBlock& message )
+        {
+            FrameStream::Reader in( message.getData(), message.getSize() );
+
+            const int iType = in.readByte();
+
+            if ( iType == FrameStream::kMessage_KeyFrameRequest )
+            {
+                m_owner.m_encoder.requestKeyFrame();
+            }
+            else if ( iType == FrameStream::kMessage_Ack )
+            {
+                in.readInt32();
+                const int64 iSendMicros = in.readInt64();
+
+                if ( !in.failed() )
+                    m_owner.m_stats.addLatency( static_cast<float>((FrameStream::getNowMicros() - iSendMicros) * 0.001) );
+            }
+        }
+
+    private:
+        FrameStreamServer& m_owner;
+    };
+
+    class SendThread  : public juce::Thread
+    {
+    public:
+        explicit SendThread( FrameStreamServer& owner ) : juce::Thread( "FrameStreamServer" ), m_owner( owner ) {}
+
+        void run()      { m_owner.sendFrames(); }
+
+    private:
+        FrameStreamServer& m_owner;
+    };
+
+    InterprocessConnection* createConnectionObject()
+    {
+        Connection* pConnection = new Connection( *this );
+
+        const ScopedLock connectionsLock( m_connectionsLock );
+        return m_apConnections.add( pConnection );
+    }
+
+    void sendFrames()
+    {
+        while ( !m_sender.threadShouldExit() )
+        {
+            m_frameQueued.wait( 100 );
+
+            while ( !m_sender.threadShouldExit() && m_queue.pop( m_frame ) )
+            {
+                const int iSize = m_encoder.encode( m_frame, FrameStream::getNowMicros() );
+                const MemoryBlock message( m_encoder.getData(), static_cast<size_t>(iSize) );
+
+                const ScopedLock connectionsLock( m_connectionsLock );
+
+                for ( int i = m_apConnections.size(); --i >= 0; )
+                {
+                    Connection* pConnection = m_apConnections.getUnchecked( i );
+
+                    // a connection only just accepted has no socket yet
+                    if ( pConnection->getSocket() == nullptr )
+                        continue;
+
+                    if ( !pConnection->isConnected() || !pConnection->sendMessage( message ) )
+                        m_apConnections.remove( i );
+                }
+
+                m_stats.addFrame( iSize, Time::highResolutionTicksToSeconds( Time::getHighResolutionTicks() ) );
+            }
+        }
+    }
+
+    SendThread                  m_sender;
+    FrameQueue<FrameSnapshot>   m_queue;
+    WaitableEvent               m_frameQueued;
+    FrameSnapshot               m_frame;            // sender thread
+    FrameStream::Encoder        m_encoder;          // sender thread
+    FrameStream::StatsCounter   m_stats;
+    CriticalSection             m_connectionsLock;
+    OwnedArray<Connection>      m_apConnections;
+    int                         m_iPort;
+
+    JUCE_DECLARE_NON_COPYABLE (FrameStreamServer)
+};
+
+//==============================================================================
+/**
+    FrameSource that receives frames from a FrameStreamServer on another machine.
+
+    Frames are decoded and delivered on the connection's thread.  If the server
+    isn't there or goes away, it keeps trying to connect once a second.
+*/
+class FrameStreamClient  : public FrameSource,
+                           private InterprocessConnection
+{
+public:
+    FrameStreamClient( const String& strHost, int iPort )
+      : InterprocessConnection( false, FrameStream::kMagicHeader ),
+        m_connector( *this ),
+        m_strHost( strHost ),
+        m_iPort( iPort ),
+        m_pConsumer( nullptr )
+    {
+    }
+
+    ~FrameStreamClient()
+    {
+        stop();
+    }
+
+    void start( FrameSnapshotConsumer& consumer )
+    {
+        stop();
+        m_pConsumer = &consumer;
+        m_connector.startThread();
+    }
+
+    void stop()
+    {
+        m_connector.stopThread( 5000 );
+        disconnect();
+    }
+
+    String getDescription() const
+    {
+        return "Stream: " + m_strHost + ":" + String( m_iPort ) + (isConnected() ? ", " + getStats().toString() : ", connecting");
+    }
+
+    bool isConnectedToServer() const        { return isConnected(); }
+
+    /** Latency is from the server sending to the frame being delivered, which only
+        means something when both share a clock, as over localhost; the server's
+        round trip works across machines.
+    */
+    FrameStream::Stats getStats() const     { return m_stats.get(); }
+
+private:
+    class ConnectThread  : public juce::Thread
+    {
+    public:
+        explicit ConnectThread( FrameStreamClient& owner ) : juce::Thread( "FrameStreamClient" ), m_owner( owner ) {}
+
+        void run()
+        {
+            while ( !threadShouldExit() )
+            {
+                if ( !m_owner.isConnected() )
+                    m_owner.connectToSocket( m_owner.m_strHost, m_owner.m_iPort, 1000 );
+
+                wait( 1000 );
+            }
+        }
+
+    private:
+        FrameStreamClient& m_owner;
+    };
+
+    void connectionMade()
+    {
+        // the reading thread hasn't started yet
+        m_decoder.reset();
+    }
+
+    void connectionLost()
+    {
+    }
+
+    void messageReceived( const MemoryBlock& message )
+    {
+        FrameStream::Decoder::FrameInfo info;
+        uint8                           aiReply[1 + 4 + 8];
+        FrameStream::Writer             reply( aiReply, sizeof (aiReply) );
+
+        if ( !m_decoder.decode( message.getData(), message.getSize(), m_pConsumer->beginFrame(), info ) )
+        {
+            reply.writeByte( FrameStream::kMessage_KeyFrameRequest );
+            sendMessage( MemoryBlock( aiReply, static_cast<size_t>(reply.getSize()) ) );
+            return;
+        }
+
+        m_pConsumer->endFrame();
+
+        const int64 iNowMicros = FrameStream::getNowMicros();
+
+        m_stats.addFrame( static_cast<int>(message.getSize()), iNowMicros * 0.000001 );
+        m_stats.addLatency( static_cast<float>((iNowMicros - info.iSendMicros) * 0.001) );
+
+        reply.writeByte( FrameStream::kMessage_Ack );
+        reply.writeInt32( static_cast<int32>(info.iSequence) );
+        reply.writeInt64( info.iSendMicros );
+        sendMessage( MemoryBlock( aiReply, static_cast<size_t>(reply.getSize()) ) );
+    }
+
+    ConnectThread               m_connector;
+    String                      m_strHost;
+    int                         m_iPort;
+    FrameSnapshotConsumer*      m_pConsumer;
+    FrameStream::Decoder        m_decoder;          // connection thread
+    FrameStream::StatsCounter   m_stats;
+
+    JUCE_DECLARE_NON_COPYABLE (FrameStreamClient)
+};
+
+#endif // FINGERVISUALIZER_FRAMESTREAM_H_INCLUDED
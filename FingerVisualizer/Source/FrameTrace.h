@@ -0,0 +1,523 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_FRAMETRACE_H_INCLUDED
+#define FINGERVISUALIZER_FRAMETRACE_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FrameSnapshot.h"
+
+#if JUCE_BIG_ENDIAN
+ #error "frame traces are mapped in place and assume a little endian host"
+#endif
+
+//==============================================================================
+/**
+    Layout of a recorded frame trace (.lfvt) file.
+
+    All values are little endian and naturally aligned.  The file starts with
+    a FileHeader followed by one block per frame.  Each block starts with a
+    BlockHeader and then stores the hands column by column, so every column is
+    a contiguous array that can be read in place from a memory mapped file:
+
+        int32   handId       [numHands]
+        int32   handFlags    [numHands]          kHandFlag_Left
+        float   palmPosition [numHands][3]
+        float   palmNormal   [numHands][3]
+        float   direction    [numHands][3]
+        float   wrist        [numHands][3]
+        float   fingerWidth  [numHands][5]
+        float   joints       [numHands][5][5][3] finger, joint, xyz
+
+    Blocks are padded to a multiple of 8 bytes.  Readers skip blocks using
+    blockSize, and must reject files with a different major version.
+*/
+namespace FrameTrace
+{
+    enum
+    {
+        kVersionMajor   = 1,
+        kVersionMinor   = 0,
+        kHandFlag_Left  = 1,
+        kBlockAlignment = 8
+    };
+
+    struct FileHeader
+    {
+        char    acMagic[4];     // "LFVT"
+        uint16  iVersionMajor;
+        uint16  iVersionMinor;
+        uint32  iHeaderSize;
+        uint32  iFlags;
+    };
+
+    struct BlockHeader
+    {
+        uint32  iBlockSize;     // including this header and padding
+        uint32  iNumHands;
+        int64   iFrameId;
+        int64   iTimestamp;
+    };
+
+    enum
+    {
+        kNumFingers     = HandSnapshot::kNumFingers,
+        kNumJoints      = FingerSnapshot::kNumJoints,
+        kFloatsPerHand  = 3 * 4 + kNumFingers + kNumFingers * kNumJoints * 3,
+        kBytesPerHand   = 2 * sizeof (int32) + kFloatsPerHand * sizeof (float)
+    };
+
+    inline const char* getMagic() noexcept          { return "LFVT"; }
+
+    inline size_t getBlockSize( int iNumHands ) noexcept
+    {
+        const size_t iSize = sizeof (BlockHeader) + static_cast<size_t>(iNumHands) * kBytesPerHand;
+        return (iSize + kBlockAlignment - 1) & ~static_cast<size_t>(kBlockAlignment - 1);
+    }
+
+    //==============================================================================
+    /** Pointers to the columns of one frame block, straight into the mapped file. */
+    struct FrameView
+    {
+        FrameView() : pHeader( nullptr ), piHandIds( nullptr ), piHandFlags( nullptr ), pfPalmPositions( nullptr ),
+                      pfPalmNormals( nullptr ), pfDirections( nullptr ), pfWrists( nullptr ),
+                      pfFingerWidths( nullptr ), pfJoints( nullptr ) {}
+
+        explicit FrameView( const void* pBlock )
+        {
+            pHeader = static_cast<const BlockHeader*>(pBlock);
+
+            const int n = static_cast<int>(pHeader->iNumHands);
+
+            piHandIds       = reinterpret_cast<const int32*>(pHeader + 1);
+            piHandFlags     = piHandIds + n;
+            pfPalmPositions = reinterpret_cast<const float*>(piHandFlags + n);
+            pfPalmNormals   = pfPalmPositions + n * 3;
+            pfDirections    = pfPalmNormals + n * 3;
+            pfWrists        = pfDirections + n * 3;
+            pfFingerWidths  = pfWrists + n * 3;
+            pfJoints        = pfFingerWidths + n * kNumFingers;
+        }
+
+        int     getNumHands() const noexcept        { return static_cast<int>(pHeader->iNumHands); }
+        int64   getFrameId() const noexcept         { return pHeader->iFrameId; }
+        int64   getTimestamp() const noexcept       { return pHeader->iTimestamp; }
+
+        static Leap::Vector toVector( const float* pf ) noexcept     { return Leap::Vector( pf[0], pf[1], pf[2] ); }
+
+        const float* getJoints( int iHand, int iFinger ) const noexcept
+        {
+            return pfJoints + ((iHand * kNumFingers) + iFinger) * kNumJoints * 3;
+        }
+
+        /// copies the frame into a snapshot, dropping hands beyond FrameSnapshot::kMaxHands.
+        void copyTo( FrameSnapshot& frame ) const
+        {
+            frame.iFrameId   = getFrameId();
+            frame.iTimestamp = getTimestamp();
+            frame.iNumHands  = jmin( getNumHands(), static_cast<int>(FrameSnapshot::kMaxHands) );
+
+            for ( int i = 0; i < frame.iNumHands; i++ )
+            {
+                HandSnapshot& hand = frame.aHands[i];
+
+                hand.iId           = piHandIds[i];
+                hand.bIsLeft       = (piHandFlags[i] & kHandFlag_Left) != 0;
+                hand.vPalmPosition = toVector( pfPalmPositions + i * 3 );
+                hand.vPalmNormal   = toVector( pfPalmNormals + i * 3 );
+                hand.vDirection    = toVector( pfDirections + i * 3 );
+                hand.vWrist        = toVector( pfWrists + i * 3 );
+
+                for ( int j = 0; j < kNumFingers; j++ )
+                {
+                    FingerSnapshot& finger = hand.aFingers[j];
+                    const float*    pfJoint = getJoints( i, j );
+
+                    finger.fWidth = pfFingerWidths[i * kNumFingers + j];
+
+                    for ( int k = 0; k < kNumJoints; k++, pfJoint += 3 )
+                    {
+                        finger.avJoints[k] = toVector( pfJoint );
+                    }
+                }
+            }
+        }
+
+        const BlockHeader*  pHeader;
+        const int32*        piHandIds;
+        const int32*        piHandFlags;
+        const float*        pfPalmPositions;
+        const float*        pfPalmNormals;
+        const float*        pfDirections;
+        const float*        pfWrists;
+        const float*        pfFingerWidths;
+        const float*        pfJoints;
+    };
+
+    //==============================================================================
+    /** Serializes a snapshot into one block, pDest must hold getBlockSize(frame.iNumHands) bytes. */
+    inline size_t writeBlock( const FrameSnapshot& frame, void* pDest )
+    {
+        const int     n          = frame.iNumHands;
+        const size_t  iBlockSize = getBlockSize( n );
+
+        zeromem( pDest, iBlockSize );
+
+        BlockHeader* pHeader = static_cast<BlockHeader*>(pDest);
+
+        pHeader->iBlockSize = static_cast<uint32>(iBlockSize);
+        pHeader->iNumHands  = static_cast<uint32>(n);
+        pHeader->iFrameId   = frame.iFrameId;
+        pHeader->iTimestamp = frame.iTimestamp;
+
+        int32* piHandIds   = reinterpret_cast<int32*>(pHeader + 1);
+        int32* piHandFlags = piHandIds + n;
+        float* pfColumn    = reinterpret_cast<float*>(piHandFlags + n);
+
+        for ( int i = 0; i < n; i++ )
+        {
+            piHandIds[i]   = frame.aHands[i].iId;
+            piHandFlags[i] = frame.aHands[i].bIsLeft ? kHandFlag_Left : 0;
+        }
+
+        const Leap::Vector HandSnapshot::* const apvVectors[] = { &HandSnapshot::vPalmPosition, &HandSnapshot::vPalmNormal,
+                                                                  &HandSnapshot::vDirection, &HandSnapshot::vWrist };
+
+        for ( int c = 0; c < numElementsInArray( apvVectors ); c++ )
+        {
+            for ( int i = 0; i < n; i++, pfColumn += 3 )
+            {
+                const Leap::Vector& v = frame.aHands[i].*apvVectors[c];
+                pfColumn[0] = v.x;
+                pfColumn[1] = v.y;
+                pfColumn[2] = v.z;
+            }
+        }
+
+        for ( int i = 0; i < n; i++ )
+        {
+            for ( int j = 0; j < kNumFingers; j++ )
+            {
+                *pfColumn++ = frame.aHands[i].aFingers[j].fWidth;
+            }
+        }
+
+        for ( int i = 0; i < n; i++ )
+        {
+            for ( int j = 0; j < kNumFingers; j++ )
+            {
+                for ( int k = 0; k < kNumJoints; k++, pfColumn += 3 )
+                {
+                    const Leap::Vector& v = frame.aHands[i].aFingers[j].avJoints[k];
+                    pfColumn[0] = v.x;
+                    pfColumn[1] = v.y;
+                    pfColumn[2] = v.z;
+                }
+            }
+        }
+
+        return iBlockSize;
+    }
+}
+
+//==============================================================================
+/**
+    Records frames to a trace file.
+
+    addFrame() is called on the thread delivering frames; it only serializes the
+    frame into a lock-free FIFO.  A background thread drains the FIFO to disk, so
+    a slow disk drops frames (counted by getNumDroppedFrames) rather than
+    stalling tracking.
+*/
+class FrameTraceWriter  : private Thread
+{
+public:
+    FrameTraceWriter( const File& file, int iBufferSizeBytes = 4 * 1024 * 1024 )
+      : Thread( "FrameTraceWriter" ),
+        m_fifo( iBufferSizeBytes ),
+        m_iNumFramesWritten( 0 )
+    {
+        m_buffer.allocate( static_cast<size_t>(iBufferSizeBytes), false );
+        m_scratch.allocate( FrameTrace::getBlockSize( FrameSnapshot::kMaxHands ), true );
+
+        file.deleteFile();
+        m_pStream = file.createOutputStream();
+
+        if ( m_pStream != nullptr )
+        {
+            FrameTrace::FileHeader header;
+            memcpy( header.acMagic, FrameTrace::getMagic(), sizeof (header.acMagic) );
+            header.iVersionMajor = FrameTrace::kVersionMajor;
+            header.iVersionMinor = FrameTrace::kVersionMinor;
+            header.iHeaderSize   = sizeof (header);
+            header.iFlags        = 0;
+
+            m_pStream->write( &header, sizeof (header) );
+
+            startThread();
+        }
+    }
+
+    ~FrameTraceWriter()
+    {
+        signalThreadShouldExit();
+        m_dataReady.signal();
+        stopThread( 5000 );
+    }
+
+    bool openedOk() const noexcept                  { return m_pStream != nullptr; }
+
+    int getNumFramesWritten() const noexcept        { return m_iNumFramesWritten.get(); }
+    int getNumDroppedFrames() const noexcept        { return m_iNumDroppedFrames.get(); }
+
+    /// call from a single producer thread.  never blocks.
+    bool addFrame( const FrameSnapshot& frame )
+    {
+        if ( m_pStream == nullptr )
+            return false;
+
+        const int iBlockSize = static_cast<int>(FrameTrace::writeBlock( frame, m_scratch ));
+
+        int iStart1, iSize1, iStart2, iSize2;
+        m_fifo.prepareToWrite( iBlockSize, iStart1, iSize1, iStart2, iSize2 );
+
+        if ( iSize1 + iSize2 < iBlockSize )
+        {
+            ++m_iNumDroppedFrames;
+            return false;
+        }
+
+        memcpy( m_buffer + iStart1, m_scratch, static_cast<size_t>(iSize1) );
+        memcpy( m_buffer + iStart2, m_scratch + iSize1, static_cast<size_t>(iSize2) );
+        m_fifo.finishedWrite( iBlockSize );
+
+        ++m_iNumFramesWritten;
+        m_dataReady.signal();
+        return true;
+    }
+
+private:
+    void run()
+    {
+        while ( !threadShouldExit() )
+        {
+            m_dataReady.wait( 100 );
+            drain();
+        }
+
+        drain();
+        m_pStream->flush();
+    }
+
+    void drain()
+    {
+        int iStart1, iSize1, iStart2, iSize2;
+        m_fifo.prepareToRead( m_fifo.getNumReady(), iStart1, iSize1, iStart2, iSize2 );
+
+        if ( iSize1 > 0 )
+            m_pStream->write( m_buffer + iStart1, static_cast<size_t>(iSize1) );
+
+        if ( iSize2 > 0 )
+            m_pStream->write( m_buffer + iStart2, static_cast<size_t>(iSize2) );
+
+        m_fifo.finishedRead( iSize1 + iSize2 );
+    }
+
+    ScopedPointer<FileOutputStream> m_pStream;
+    AbstractFifo                    m_fifo;
+    HeapBlock<char>                 m_buffer;
+    HeapBlock<char>                 m_scratch;
+    WaitableEvent                   m_dataReady;
+    Atomic<int>                     m_iNumFramesWritten;
+    Atomic<int>                     m_iNumDroppedFrames;
+
+    JUCE_DECLARE_NON_COPYABLE (FrameTraceWriter)
+};
+
+//==============================================================================
+/**
+    Read-only access to a trace file through a memory mapping.
+
+    Opening the file only walks the block headers to index the frames; the hand
+    data is read in place from the mapping when a frame is accessed.
+*/
+class FrameTraceReader
+{
+public:
+    explicit FrameTraceReader( const File& file )
+      : m_mappedFile( file, MemoryMappedFile::readOnly )
+    {
+        const char* pData = static_cast<const char*>(m_mappedFile.getData());
+        const size_t iSize = m_mappedFile.getSize();
+
+        if ( pData == nullptr || iSize < sizeof (FrameTrace::FileHeader) )
+        {
+            m_strError = "Couldn't map " + file.getFullPathName();
+            return;
+        }
+
+        const FrameTrace::FileHeader* pHeader = reinterpret_cast<const FrameTrace::FileHeader*>(pData);
+
+        if ( memcmp( pHeader->acMagic, FrameTrace::getMagic(), sizeof (pHeader->acMagic) ) != 0 )
+        {
+            m_strError = file.getFileName() + " is not a frame trace";
+            return;
+        }
+
+        if ( pHeader->iVersionMajor != FrameTrace::kVersionMajor )
+        {
+            m_strError = file.getFileName() + " has unsupported trace version " + String( pHeader->iVersionMajor );
+            return;
+        }
+
+        size_t iOffset = pHeader->iHeaderSize;
+
+        // a trace cut short by a crash just ends at the last complete block.
+        while ( iOffset + sizeof (FrameTrace::BlockHeader) <= iSize )
+        {
+            const FrameTrace::BlockHeader* pBlock = reinterpret_cast<const FrameTrace::BlockHeader*>(pData + iOffset);
+            const size_t iBlockSize = pBlock->iBlockSize;
+
+            if ( iBlockSize != FrameTrace::getBlockSize( static_cast<int>(pBlock->iNumHands) )
+                  || iOffset + iBlockSize > iSize )
+                break;
+
+            m_aiFrameOffsets.add( iOffset );
+            iOffset += iBlockSize;
+        }
+    }
+
+    bool openedOk() const noexcept                  { return m_strError.isEmpty(); }
+    const String& getLastError() const noexcept     { return m_strError; }
+
+    int getNumFrames() const noexcept               { return m_aiFrameOffsets.size(); }
+
+    FrameTrace::FrameView getFrame( int iIndex ) const noexcept
+    {
+        jassert( isPositiveAndBelow( iIndex, getNumFrames() ) );
+        return FrameTrace::FrameView( static_cast<const char*>(m_mappedFile.getData()) + m_aiFrameOffsets.getUnchecked( iIndex ) );
+    }
+
+private:
+    MemoryMappedFile    m_mappedFile;
+    Array<size_t>       m_aiFrameOffsets;
+    String              m_strError;
+
+    JUCE_DECLARE_NON_COPYABLE (FrameTraceReader)
+};
+
+//==============================================================================
+/**
+    FrameSource that plays a trace back at the recorded rate.
+
+    Frames are never sent closer together than kMinFrameIntervalUs, so a trace
+    whose timestamps repeat can't flood the pipeline.  A looped trace waits one
+    mean frame interval after its last frame before replaying the first.
+*/
+class FrameTracePlayer  : public FrameSource,
+                          private Thread
+{
+public:
+    enum
+    {
+        /// the Leap service's fastest rate
+        kMinFrameIntervalUs = 1000
+    };
+
+    explicit FrameTracePlayer( const File& file, bool bLoop = true )
+      : Thread( "FrameTracePlayer" ),
+        m_reader( file ),
+        m_pConsumer( nullptr ),
+        m_bLoop( bLoop ),
+        m_strName( file.getFileName() )
+    {
+    }
+
+    ~FrameTracePlayer()
+    {
+        stop();
+    }
+
+    /** Playback only starts if the trace opened and holds at least one frame. */
+    void start( FrameSnapshotConsumer& consumer )
+    {
+        stop();
+        m_pConsumer = &consumer;
+
+        if ( m_reader.openedOk() && m_reader.getNumFrames() > 0 )
+            startThread();
+    }
+
+    void stop()
+    {
+        stopThread( 5000 );
+    }
+
+    String getDescription() const
+    {
+        return "Replay: " + m_strName;
+    }
+
+    const FrameTraceReader& getReader() const noexcept      { return m_reader; }
+
+    /** The mean spacing of the trace's frames, and never less than kMinFrameIntervalUs. */
+    int64 getFrameIntervalUs() const noexcept
+    {
+        const int iNumFrames = m_reader.getNumFrames();
+
+        if ( iNumFrames < 2 )
+            return kMinFrameIntervalUs;
+
+        const int64 iSpanUs = m_reader.getFrame( iNumFrames - 1 ).getTimestamp() - m_reader.getFrame( 0 ).getTimestamp();
+        return jmax( static_cast<int64>(kMinFrameIntervalUs), iSpanUs / (iNumFrames - 1) );
+    }
+
+private:
+    void run()
+    {
+        const int64   iFirstTimestamp = m_reader.getFrame( 0 ).getTimestamp();
+        const double  fIntervalMs     = getFrameIntervalUs() * 0.001;
+        const double  fMinIntervalMs  = kMinFrameIntervalUs * 0.001;
+        double        fStartMs        = Time::getMillisecondCounterHiRes();
+        double        fLastDueMs      = fStartMs - fMinIntervalMs;
+
+        do
+        {
+            for ( int i = 0; i < m_reader.getNumFrames() && !threadShouldExit(); i++ )
+            {
+                const FrameTrace::FrameView frame = m_reader.getFrame( i );
+
+                // repeated or backwards timestamps still get the minimum spacing
+                const double fDueMs  = jmax( fStartMs + (frame.getTimestamp() - iFirstTimestamp) * 0.001,
+                                             fLastDueMs + fMinIntervalMs );
+                const double fWaitMs = fDueMs - Time::getMillisecondCounterHiRes();
+
+                if ( fWaitMs >= 1.0 )
+                    wait( static_cast<int>(fWaitMs) );
+
+                frame.copyTo( m_pConsumer->beginFrame() );
+                m_pConsumer->endFrame();
+
+                fLastDueMs = fDueMs;
+            }
+
+            // the first frame follows the last as if the trace carried on
+            fStartMs = fLastDueMs + fIntervalMs;
+        }
+        while ( m_bLoop && !threadShouldExit() );
+    }
+
+    FrameTraceReader        m_reader;
+    FrameSnapshotConsumer*  m_pConsumer;
+    bool                    m_bLoop;
+    String                  m_strName;
+
+    JUCE_DECLARE_NON_COPYABLE (FrameTracePlayer)
+};
+
+#endif // FINGERVISUALIZER_FRAMETRACE_H_INCLUDED
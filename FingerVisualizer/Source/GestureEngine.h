@@ -0,0 +1,538 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_GESTUREENGINE_H_INCLUDED
+#define FINGERVISUALIZER_GESTUREENGINE_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FrameSnapshot.h"
+#include <cmath>
+
+//==============================================================================
+/** A gesture starting, ending, or for swipes and circles, having happened. */
+struct GestureEvent
+{
+    enum Type
+    {
+        kPinch,
+        kGrab,
+        kSwipe,
+        kCircle
+    };
+
+    enum State
+    {
+        kStart,
+        kEnd,
+        /// swipes and circles are reported once, when they're complete
+        kComplete
+    };
+
+    GestureEvent() : type( kPinch ), state( kStart ), iHandId( 0 ), fSeconds( 0.0 ), fValue( 0.0f ) {}
+
+    static const char* getTypeName( Type type ) noexcept
+    {
+        switch ( type )
+        {
+        case kPinch: return "pinch";
+        case kGrab:  return "grab";
+        case kSwipe: return "swipe";
+        default:     return "circle";
+        }
+    }
+
+    /** Short description for the HUD, like "swipe left (hand 3)". */
+    String getDescription() const
+    {
+        String str( getTypeName( type ) );
+
+        if ( state == kStart )
+            str << " start";
+        else if ( state == kEnd )
+            str << " end";
+        else if ( type == kSwipe )
+            str << " " << getDirectionName( vDirection );
+        else if ( type == kCircle )
+            str << (vDirection.z >= 0.0f ? " anticlockwise" : " clockwise");
+
+        return str << " (hand " << iHandId << ")";
+    }
+
+    /// the axis a vector mostly points along, as seen by the user.
+    static const char* getDirectionName( const Leap::Vector& v ) noexcept
+    {
+        const float fX = std::abs( v.x ), fY = std::abs( v.y ), fZ = std::abs( v.z );
+
+        if ( fX >= fY && fX >= fZ )
+            return v.x > 0.0f ? "right" : "left";
+
+        if ( fY >= fZ )
+            return v.y > 0.0f ? "up" : "down";
+
+        return v.z > 0.0f ? "back" : "forward";
+    }
+
+    Type            type;
+    State           state;
+    int32_t         iHandId;
+    double          fSeconds;
+    /// between the pinching fingers, the palm, the palm or the center of the circle
+    Leap::Vector    vPosition;
+    /// swipe direction or circle normal (right-handed, towards the user when anticlockwise), unit length
+    Leap::Vector    vDirection;
+    /// swipe speed in mm/s or circle radius in mm
+    float           fValue;
+};
+
+//==============================================================================
+/**
+    Recognizes pinch, grab, swipe and circle gestures from the hands in each frame.
+
+    Every tracked hand keeps a ring of per-frame samples of the few features
+    the gestures need: the palm and index tip, the pinch and grab distances,
+    and how far the index tip turned and moved since the last sample.  Each
+    gesture looks at the ring through a Window of its own length, a tail
+    index and the running sums of the samples inside it, which are updated by
+    adding the newest sample and subtracting the ones that fall out.  So the
+    cost per frame doesn't depend on the window lengths or the frame rate and
+    history is never rescanned.  At rates where a window would need more
+    samples than the ring holds, it covers the last kMaxSamples - 1 frames
+    instead, so the slot the next sample is written to is never one a window
+    still has to subtract.
+
+    process() runs on the thread processing frames and calls the listeners
+    there.  Listeners are added and removed while no frames are processed.
+*/
+class GestureEngine
+{
+public:
+    enum
+    {
+        kMaxHands   = 8,
+        /// per hand, covers the longest window at 1000 Hz
+        kMaxSamples = 1024
+    };
+
+    class Listener
+    {
+    public:
+        virtual ~Listener() {}
+
+        /** Called on the thread calling process(). */
+        virtual void gestureRecognized( const GestureEvent& event ) = 0;
+    };
+
+    GestureEngine()
+    {
+        m_aHands.allocate( kMaxHands, true );
+        m_aSamples.allocate( static_cast<size_t>(kMaxHands * kMaxSamples), true );
+
+        for ( int i = 0; i < kMaxHands; i++ )
+            m_aHands[i].aSamples = m_aSamples + i * kMaxSamples;
+
+        reset();
+    }
+
+    void addListener( Listener* pListener )         { m_listeners.add( pListener ); }
+    void removeListener( Listener* pListener )      { m_listeners.remove( pListener ); }
+
+    /** Forgets all hands without reporting the end of their gestures. */
+    void reset() noexcept
+    {
+        for ( int i = 0; i < kMaxHands; i++ )
+            m_aHands[i].bActive = false;
+    }
+
+    int getNumTrackedHands() const noexcept
+    {
+        int iCount = 0;
+
+        for ( int i = 0; i < kMaxHands; i++ )
+            iCount += m_aHands[i].bActive ? 1 : 0;
+
+        return iCount;
+    }
+
+    /** Updates every hand in the frame, seen fSeconds into any clock that doesn't go backwards. */
+    void process( const FrameSnapshot& frame, double fSeconds )
+    {
+        for ( int i = 0; i < kMaxHands; i++ )
+            m_aHands[i].bSeen = false;
+
+        for ( int i = 0; i < frame.iNumHands; i++ )
+        {
+            Hand* pHand = findHand( frame.aHands[i].iId );
+
+            if ( pHand != nullptr )
+                updateHand( *pHand, frame.aHands[i], fSeconds );
+        }
+
+        // hands that left end their gestures
+        for ( int i = 0; i < kMaxHands; i++ )
+        {
+            Hand& hand = m_aHands[i];
+
+            if ( hand.bActive && !hand.bSeen )
+            {
+                if ( hand.bPinching )
+                    sendEvent( hand, GestureEvent::kPinch, GestureEvent::kEnd, fSeconds, hand.vPinchPosition, Leap::Vector(), 0.0f );
+
+                if ( hand.bGrabbing )
+                    sendEvent( hand, GestureEvent::kGrab, GestureEvent::kEnd, fSeconds, hand.vPalmPosition, Leap::Vector(), 0.0f );
+
+                hand.bActive = false;
+            }
+        }
+    }
+
+    //==============================================================================
+    /// thresholds, in millimeters and millimeters per second
+    static float getPinchStartDistance() noexcept   { return 25.0f; }
+    static float getPinchEndDistance() noexcept     { return 40.0f; }
+    static float getGrabStartDistance() noexcept    { return 50.0f; }
+    static float getGrabEndDistance() noexcept      { return 65.0f; }
+    static float getSwipeStartSpeed() noexcept      { return 1000.0f; }
+    static float getSwipeEndSpeed() noexcept        { return 500.0f; }
+    static float getMinCircleRadius() noexcept      { return 10.0f; }
+    static float getMaxCircleRadius() noexcept      { return 150.0f; }
+    /// the index tip has to move this far before its direction counts
+    static float getTurnStep() noexcept             { return 2.0f; }
+
+private:
+    //==============================================================================
+    enum Value
+    {
+        kValue_PalmX, kValue_PalmY, kValue_PalmZ,
+        kValue_TipX,  kValue_TipY,  kValue_TipZ,
+        kValue_Pinch,
+        kValue_Grab,
+        /// axis times angle the index tip's path turned through
+        kValue_TurnX, kValue_TurnY, kValue_TurnZ,
+        kValue_TurnAngle,
+        kValue_Path,
+        kNumValues
+    };
+
+    struct Sample
+    {
+        double  fSeconds;
+        float   afValues[kNumValues];
+    };
+
+    /** The samples of a ring within fSeconds of the newest, and their sums. */
+    struct Window
+    {
+        void clear( int64 iNewest ) noexcept
+        {
+            iOldest = iNewest + 1;
+
+            for ( int i = 0; i < kNumValues; i++ )
+                afSums[i] = 0.0;
+        }
+
+        /// takes in the newest sample and lets out the ones that are too old, or that
+        /// the sample after it will overwrite.
+        void advance( const Sample* aSamples, int64 iNewest ) noexcept
+        {
+            const Sample& newest = aSamples[iNewest & (kMaxSamples - 1)];
+
+            for ( int i = 0; i < kNumValues; i++ )
+                afSums[i] += newest.afValues[i];
+
+            while ( iOldest < iNewest
+                     && (iNewest - iOldest >= kMaxSamples - 1 || aSamples[iOldest & (kMaxSamples - 1)].fSeconds < newest.fSeconds - fSeconds) )
+            {
+                const Sample& oldest = aSamples[iOldest & (kMaxSamples - 1)];
+
+                for ( int i = 0; i < kNumValues; i++ )
+                    afSums[i] -= oldest.afValues[i];
+
+                ++iOldest;
+            }
+        }
+
+        int getNumSamples( int64 iNewest ) const noexcept   { return static_cast<int>(iNewest + 1 - iOldest); }
+
+        float getMean( Value value, int64 iNewest ) const noexcept
+        {
+            const int iCount = getNumSamples( iNewest );
+            return iCount > 0 ? static_cast<float>(afSums[value] / iCount) : 0.0f;
+        }
+
+        Leap::Vector getSum( Value x ) const noexcept
+        {
+            return Leap::Vector( static_cast<float>(afSums[x]), static_cast<float>(afSums[x + 1]), static_cast<float>(afSums[x + 2]) );
+        }
+
+        double  fSeconds;
+        int64   iOldest;
+        // doubles, so adding and subtracting for hours doesn't drift
+        double  afSums[kNumValues];
+    };
+
+    struct Hand
+    {
+        int32_t             iId;
+        bool                bActive;
+        bool                bSeen;
+        /// kMaxSamples of them, indexed by sample number
+        Sample*             aSamples;
+        int64               iNewest;
+
+        Window              pinchWindow;
+        Window              grabWindow;
+        Window              swipeWindow;
+        Window              circleWindow;
+
+        bool                bPinching;
+        bool                bGrabbing;
+        bool                bSwiping;
+        bool                bHasTurnDirection;
+        Leap::Vector        vTurnPoint;
+        Leap::Vector        vTurnDirection;
+        Leap::Vector        vPinchPosition;
+        Leap::Vector        vPalmPosition;
+    };
+
+    //==============================================================================
+    Hand* findHand( int32_t iId ) noexcept
+    {
+        Hand* pFree = nullptr;
+
+        for ( int i = 0; i < kMaxHands; i++ )
+        {
+            Hand& hand = m_aHands[i];
+
+            if ( hand.bActive && hand.iId == iId )
+                return &hand;
+
+            if ( !hand.bActive && pFree == nullptr )
+                pFree = &hand;
+        }
+
+        // more hands than slots, the rest go unrecognized
+        if ( pFree != nullptr )
+            startHand( *pFree, iId );
+
+        return pFree;
+    }
+
+    static void startHand( Hand& hand, int32_t iId ) noexcept
+    {
+        hand.iId                = iId;
+        hand.bActive            = true;
+        hand.iNewest            = -1;
+        hand.bPinching          = false;
+        hand.bGrabbing          = false;
+        hand.bSwiping           = false;
+        hand.bHasTurnDirection  = false;
+
+        hand.pinchWindow.fSeconds  = 0.03;
+        hand.grabWindow.fSeconds   = 0.05;
+        hand.swipeWindow.fSeconds  = 0.1;
+        hand.circleWindow.fSeconds = 1.0;
+
+        hand.pinchWindow.clear( -1 );
+        hand.grabWindow.clear( -1 );
+        hand.swipeWindow.clear( -1 );
+        hand.circleWindow.clear( -1 );
+    }
+
+    void updateHand( Hand& hand, const HandSnapshot& snapshot, double fSeconds )
+    {
+        hand.bSeen = true;
+
+        const Leap::Vector& vThumb = snapshot.aFingers[0].tipPosition();
+        const Leap::Vector& vIndex = snapshot.aFingers[1].tipPosition();
+
+        float fGrab = 0.0f;
+
+        for ( int i = 1; i < HandSnapshot::kNumFingers; i++ )
+            fGrab += snapshot.aFingers[i].tipPosition().distanceTo( snapshot.vPalmPosition );
+
+        Sample& sample = hand.aSamples[++hand.iNewest & (kMaxSamples - 1)];
+
+        sample.fSeconds = fSeconds;
+        setVector( sample, kValue_PalmX, snapshot.vPalmPosition );
+        setVector( sample, kValue_TipX, vIndex );
+        sample.afValues[kValue_Pinch] = vThumb.distanceTo( vIndex );
+        sample.afValues[kValue_Grab]  = fGrab / (HandSnapshot::kNumFingers - 1);
+        setTurn( hand, sample, vIndex );
+
+        hand.pinchWindow.advance( hand.aSamples, hand.iNewest );
+        hand.grabWindow.advance( hand.aSamples, hand.iNewest );
+        hand.swipeWindow.advance( hand.aSamples, hand.iNewest );
+        hand.circleWindow.advance( hand.aSamples, hand.iNewest );
+
+        hand.vPinchPosition = (vThumb + vIndex) * 0.5f;
+        hand.vPalmPosition  = snapshot.vPalmPosition;
+
+        updatePinch( hand, fSeconds );
+        updateGrab( hand, fSeconds );
+        updateSwipe( hand, fSeconds );
+        updateCircle( hand, fSeconds );
+    }
+
+    static void setVector( Sample& sample, Value x, const Leap::Vector& v ) noexcept
+    {
+        sample.afValues[x]     = v.x;
+        sample.afValues[x + 1] = v.y;
+        sample.afValues[x + 2] = v.z;
+    }
+
+    /// how far the index tip turned since it last moved a turn step, so tremor doesn't count.
+    static void setTurn( Hand& hand, Sample& sample, const Leap::Vector& vTip ) noexcept
+    {
+        setVector( sample, kValue_TurnX, Leap::Vector() );
+        sample.afValues[kValue_TurnAngle] = 0.0f;
+        sample.afValues[kValue_Path]      = 0.0f;
+
+        if ( hand.iNewest == 0 )
+        {
+            hand.vTurnPoint = vTip;
+            return;
+        }
+
+        const Leap::Vector vStep   = vTip - hand.vTurnPoint;
+        const float        fLength = vStep.magnitude();
+
+        if ( fLength < getTurnStep() )
+            return;
+
+        const Leap::Vector vDirection = vStep / fLength;
+
+        if ( hand.bHasTurnDirection )
+        {
+            const Leap::Vector vAxis  = hand.vTurnDirection.cross( vDirection );
+            const float        fSin   = vAxis.magnitude();
+            const float        fAngle = std::atan2( fSin, hand.vTurnDirection.dot( vDirection ) );
+
+            if ( fSin > 1.0e-6f )
+                setVector( sample, kValue_TurnX, vAxis * (fAngle / fSin) );
+
+            sample.afValues[kValue_TurnAngle] = fAngle;
+        }
+
+        sample.afValues[kValue_Path] = fLength;
+
+        hand.vTurnPoint        = vTip;
+        hand.vTurnDirection    = vDirection;
+        hand.bHasTurnDirection = true;
+    }
+
+    //==============================================================================
+    void updatePinch( Hand& hand, double fSeconds )
+    {
+        const float fDistance = hand.pinchWindow.getMean( kValue_Pinch, hand.iNewest );
+
+        if ( !hand.bPinching && fDistance < getPinchStartDistance() )
+        {
+            hand.bPinching = true;
+            sendEvent( hand, GestureEvent::kPinch, GestureEvent::kStart, fSeconds, hand.vPinchPosition, Leap::Vector(), fDistance );
+        }
+        else if ( hand.bPinching && fDistance > getPinchEndDistance() )
+        {
+            hand.bPinching = false;
+            sendEvent( hand, GestureEvent::kPinch, GestureEvent::kEnd, fSeconds, hand.vPinchPosition, Leap::Vector(), fDistance );
+        }
+    }
+
+    void updateGrab( Hand& hand, double fSeconds )
+    {
+        const float fDistance = hand.grabWindow.getMean( kValue_Grab, hand.iNewest );
+
+        if ( !hand.bGrabbing && fDistance < getGrabStartDistance() )
+        {
+            hand.bGrabbing = true;
+            sendEvent( hand, GestureEvent::kGrab, GestureEvent::kStart, fSeconds, hand.vPalmPosition, Leap::Vector(), fDistance );
+        }
+        else if ( hand.bGrabbing && fDistance > getGrabEndDistance() )
+        {
+            hand.bGrabbing = false;
+            sendEvent( hand, GestureEvent::kGrab, GestureEvent::kEnd, fSeconds, hand.vPalmPosition, Leap::Vector(), fDistance );
+        }
+    }
+
+    /// the palm's average velocity across the window, reported once per fast movement.
+    void updateSwipe( Hand& hand, double fSeconds )
+    {
+        const Window& window = hand.swipeWindow;
+        const Sample& oldest = hand.aSamples[window.iOldest & (kMaxSamples - 1)];
+        const double  fSpan  = fSeconds - oldest.fSeconds;
+
+        // too little history for a speed yet
+        if ( fSpan < window.fSeconds * 0.5 )
+            return;
+
+        const Leap::Vector vOldest( oldest.afValues[kValue_PalmX], oldest.afValues[kValue_PalmY], oldest.afValues[kValue_PalmZ] );
+        const Leap::Vector vMotion = hand.vPalmPosition - vOldest;
+        const float        fSpeed  = static_cast<float>(vMotion.magnitude() / fSpan);
+
+        if ( !hand.bSwiping && fSpeed > getSwipeStartSpeed() )
+        {
+            hand.bSwiping = true;
+            sendEvent( hand, GestureEvent::kSwipe, GestureEvent::kComplete, fSeconds, hand.vPalmPosition, vMotion.normalized(), fSpeed );
+        }
+        else if ( hand.bSwiping && fSpeed < getSwipeEndSpeed() )
+        {
+            hand.bSwiping = false;
+        }
+    }
+
+    /// a full turn of the index tip in a consistent direction around a plausible radius.
+    void updateCircle( Hand& hand, double fSeconds )
+    {
+        Window&            window     = hand.circleWindow;
+        const Leap::Vector vTurn      = window.getSum( kValue_TurnX );
+        const float        fTurn      = vTurn.magnitude();
+        const float        fTurnTotal = static_cast<float>(window.afSums[kValue_TurnAngle]);
+
+        if ( fTurn < 2.0f * static_cast<float>(double_Pi) || fTurn < 0.8f * fTurnTotal )
+            return;
+
+        const float fRadius = static_cast<float>(window.afSums[kValue_Path]) / fTurn;
+
+        if ( fRadius < getMinCircleRadius() || fRadius > getMaxCircleRadius() )
+            return;
+
+        const int          iCount   = window.getNumSamples( hand.iNewest );
+        const Leap::Vector vCenter  = window.getSum( kValue_TipX ) / static_cast<float>(iCount);
+
+        sendEvent( hand, GestureEvent::kCircle, GestureEvent::kComplete, fSeconds, vCenter, vTurn / fTurn, fRadius );
+
+        // the next circle starts from here
+        window.clear( hand.iNewest );
+    }
+
+    void sendEvent( const Hand& hand, GestureEvent::Type type, GestureEvent::State state, double fSeconds,
+                    const Leap::Vector& vPosition, const Leap::Vector& vDirection, float fValue )
+    {
+        GestureEvent event;
+
+        event.type       = type;
+        event.state      = state;
+        event.iHandId    = hand.iId;
+        event.fSeconds   = fSeconds;
+        event.vPosition  = vPosition;
+        event.vDirection = vDirection;
+        event.fValue     = fValue;
+
+        m_listeners.call( &Listener::gestureRecognized, event );
+    }
+
+    HeapBlock<Hand>         m_aHands;
+    HeapBlock<Sample>       m_aSamples;
+    ListenerList<Listener>  m_listeners;
+
+    // checks the running sums against the ring
+    friend class GestureEngineTests;
+
+    JUCE_DECLARE_NON_COPYABLE (GestureEngine)
+};
+
+#endif // FINGERVISUALIZER_GESTUREENGINE_H_INCLUDED
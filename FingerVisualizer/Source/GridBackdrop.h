@@ -0,0 +1,220 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_GRIDBACKDROP_H_INCLUDED
+#define FINGERVISUALIZER_GRIDBACKDROP_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "LeapUtilGL.h"
+#include "SceneShading.h"
+
+//==============================================================================
+/**
+    The grid planes behind and below the hands, built once into a vertex buffer.
+
+    The lines are the same ones LeapUtilGL::drawGrid() emits, with each plane's
+    placement baked into the vertices, so the whole backdrop is a single
+    glDrawArrays call.  The geometry is in scene units and doesn't depend on
+    the viewport, so it only has to be rebuilt when the context is recreated.
+
+    The lines are drawn by a flat color shader with the SceneTransform's
+    matrices; without the shader pipeline the same buffer goes through the
+    fixed-function vertex array instead.
+*/
+class GridBackdrop
+{
+public:
+    explicit GridBackdrop( OpenGLContext& context )
+      : m_context( context ),
+        m_iBuffer( 0 ),
+        m_iNumVertices( 0 )
+    {
+    }
+
+    ~GridBackdrop()
+    {
+        // release() has to be called while the context is still active.
+        jassert( m_iBuffer == 0 && m_pProgram == nullptr );
+    }
+
+    //==============================================================================
+    /** Builds the vertex buffer and shader, call from newOpenGLContextCreated(). */
+    void initialise( const SceneLighting& lighting )
+    {
+        release();
+
+        if ( lighting.isAvailable() )
+            createProgram( lighting );
+
+        Array<GLfloat> afVertices;
+        afVertices.ensureStorageAllocated( 2 * kNumPlaneVertices * 3 );
+
+        // back wall, then floor, both 3 units across
+        addPlane( afVertices, LeapUtilGL::kPlane_XY, Leap::Vector( 0.0f, 0.0f, -1.5f ), 3.0f );
+        addPlane( afVertices, LeapUtilGL::kPlane_ZX, Leap::Vector( 0.0f, -1.5f, 0.0f ), 3.0f );
+
+        m_context.extensions.glGenBuffers( 1, &m_iBuffer );
+        m_context.extensions.glBindBuffer( GL_ARRAY_BUFFER, m_iBuffer );
+        m_context.extensions.glBufferData( GL_ARRAY_BUFFER, static_cast<pointer_sized_int>(afVertices.size() * sizeof (GLfloat)),
+                                           afVertices.getRawDataPointer(), GL_STATIC_DRAW );
+        m_context.extensions.glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+        m_iNumVertices = afVertices.size() / 3;
+    }
+
+    /** Frees the vertex buffer, call from openGLContextClosing(). */
+    void release()
+    {
+        if ( m_iBuffer != 0 )
+            m_context.extensions.glDeleteBuffers( 1, &m_iBuffer );
+
+        m_iBuffer      = 0;
+        m_iNumVertices = 0;
+
+        m_pScene    = nullptr;
+        m_pColor    = nullptr;
+        m_pPosition = nullptr;
+        m_pProgram  = nullptr;
+    }
+
+    /** Draws both planes as unlit lines. */
+    void draw( const SceneTransform& transform, const GLfloat* pfColor ) const
+    {
+        if ( m_pProgram == nullptr )
+        {
+            drawFixedFunction( transform, pfColor );
+            return;
+        }
+
+        OpenGLExtensionFunctions& gl = m_context.extensions;
+        const GLuint iPosition = static_cast<GLuint>(m_pPosition->attributeID);
+
+        m_pProgram->use();
+        m_pScene->set( transform );
+        m_pColor->set( pfColor[0], pfColor[1], pfColor[2], pfColor[3] );
+
+        gl.glBindBuffer( GL_ARRAY_BUFFER, m_iBuffer );
+        gl.glVertexAttribPointer( iPosition, 3, GL_FLOAT, GL_FALSE, 0, nullptr );
+        gl.glEnableVertexAttribArray( iPosition );
+
+        glDrawArrays( GL_LINES, 0, m_iNumVertices );
+
+        gl.glDisableVertexAttribArray( iPosition );
+        gl.glBindBuffer( GL_ARRAY_BUFFER, 0 );
+        gl.glUseProgram( 0 );
+    }
+
+private:
+    enum
+    {
+        kNumDivisions     = 20,
+        kNumPlaneVertices = (kNumDivisions + 1) * 4
+    };
+
+    void createProgram( const SceneLighting& lighting )
+    {
+        static const char* szVertexShader =
+            "attribute vec3 position;\n"
+            "uniform mat4 projectionMatrix;\n"
+            "uniform mat4 modelViewMatrix;\n"
+            "void main()\n"
+            "{\n"
+            "    gl_Position = projectionMatrix * (modelViewMatrix * vec4 (position, 1.0));\n"
+            "}\n";
+
+        static const char* szFragmentShader =
+            "uniform vec4 lineColor;\n"
+            "void main()\n"
+            "{\n"
+            "    gl_FragColor = lineColor;\n"
+            "}\n";
+
+        m_pProgram = new OpenGLShaderProgram( m_context );
+
+        if ( !m_pProgram->addShader( lighting.getShaderSource( szVertexShader, GL_VERTEX_SHADER ).toRawUTF8(), GL_VERTEX_SHADER )
+              || !m_pProgram->addShader( lighting.getShaderSource( szFragmentShader, GL_FRAGMENT_SHADER ).toRawUTF8(), GL_FRAGMENT_SHADER )
+              || !m_pProgram->link() )
+        {
+            Logger::writeToLog( "GridBackdrop: " + m_pProgram->getLastError() );
+            m_pProgram = nullptr;
+            return;
+        }
+
+        m_pPosition = new OpenGLShaderProgram::Attribute( *m_pProgram, "position" );
+        m_pColor    = new OpenGLShaderProgram::Uniform( *m_pProgram, "lineColor" );
+        m_pScene    = new SceneUniforms( *m_pProgram );
+    }
+
+    void drawFixedFunction( const SceneTransform& transform, const GLfloat* pfColor ) const
+    {
+        LeapUtilGL::GLMatrixScope matrixScope;
+        LeapUtilGL::GLAttribScope attribScope( GL_CURRENT_BIT | GL_LIGHTING_BIT );
+
+        transform.loadIntoFixedFunction();
+        glColor4fv( pfColor );
+
+        glDisable( GL_LIGHTING );
+
+        m_context.extensions.glBindBuffer( GL_ARRAY_BUFFER, m_iBuffer );
+        glEnableClientState( GL_VERTEX_ARRAY );
+        glVertexPointer( 3, GL_FLOAT, 0, nullptr );
+
+        glDrawArrays( GL_LINES, 0, m_iNumVertices );
+
+        glDisableClientState( GL_VERTEX_ARRAY );
+        m_context.extensions.glBindBuffer( GL_ARRAY_BUFFER, 0 );
+    }
+
+    /// a unit grid centered on the origin like drawGrid(), scaled and moved to vCenter.
+    static void addPlane( Array<GLfloat>& afVertices, LeapUtilGL::ePlane plane, const Leap::Vector& vCenter, float fScale )
+    {
+        for ( int i = 0; i <= kNumDivisions; i++ )
+        {
+            const float fLine = static_cast<float>(i) / kNumDivisions - 0.5f;
+
+            // one line along each in-plane axis through fLine
+            addPoint( afVertices, plane, fLine, -0.5f, vCenter, fScale );
+            addPoint( afVertices, plane, fLine,  0.5f, vCenter, fScale );
+            addPoint( afVertices, plane, -0.5f, fLine, vCenter, fScale );
+            addPoint( afVertices, plane,  0.5f, fLine, vCenter, fScale );
+        }
+    }
+
+    static void addPoint( Array<GLfloat>& afVertices, LeapUtilGL::ePlane plane, float fU, float fV,
+                          const Leap::Vector& vCenter, float fScale )
+    {
+        Leap::Vector vPoint;
+
+        switch ( plane )
+        {
+        case LeapUtilGL::kPlane_XY: vPoint = Leap::Vector( fU, fV, 0.0f ); break;
+        case LeapUtilGL::kPlane_YZ: vPoint = Leap::Vector( 0.0f, fU, fV ); break;
+        case LeapUtilGL::kPlane_ZX: vPoint = Leap::Vector( fV, 0.0f, fU ); break;
+        default:                    jassertfalse; break;
+        }
+
+        vPoint = vCenter + vPoint * fScale;
+
+        afVertices.add( vPoint.x );
+        afVertices.add( vPoint.y );
+        afVertices.add( vPoint.z );
+    }
+
+    OpenGLContext&                                  m_context;
+    GLuint                                          m_iBuffer;
+    GLsizei                                         m_iNumVertices;
+
+    ScopedPointer<OpenGLShaderProgram>              m_pProgram;
+    ScopedPointer<OpenGLShaderProgram::Attribute>   m_pPosition;
+    ScopedPointer<OpenGLShaderProgram::Uniform>     m_pColor;
+    ScopedPointer<SceneUniforms>                    m_pScene;
+
+    JUCE_DECLARE_NON_COPYABLE (GridBackdrop)
+};
+
+#endif // FINGERVISUALIZER_GRIDBACKDROP_H_INCLUDED
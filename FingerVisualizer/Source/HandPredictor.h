@@ -0,0 +1,201 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_HANDPREDICTOR_H_INCLUDED
+#define FINGERVISUALIZER_HANDPREDICTOR_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FrameSnapshot.h"
+
+//==============================================================================
+/**
+    Poses hands at an arbitrary time from the last few tracking frames, so the
+    renderer can draw at the display rate instead of the tracking rate.
+
+    A short history is kept for each hand id.  predictFrame() blends the two
+    samples around the requested time, or extrapolates past the newest one at
+    its current velocity for at most kMaxExtrapolationMs, so a hand that stops
+    being tracked doesn't fly off.  Hands missing from the newest frame are
+    dropped.  Everything is preallocated, and only the render thread uses it.
+*/
+class HandPredictor
+{
+public:
+    enum
+    {
+        kHistorySize        = 4,
+        kMaxExtrapolationMs = 50
+    };
+
+    HandPredictor()
+      : m_iNumTracks( 0 )
+    {
+    }
+
+    void reset() noexcept
+    {
+        m_iNumTracks = 0;
+    }
+
+    int getNumTracks() const noexcept     { return m_iNumTracks; }
+
+    //==============================================================================
+    /** Adds a tracking frame, taken at fSeconds on the same clock predictFrame() uses. */
+    void addFrame( const FrameSnapshot& frame, double fSeconds )
+    {
+        // forget hands that are no longer tracked
+        for ( int i = m_iNumTracks; --i >= 0; )
+        {
+            if ( findHand( frame, m_aTracks[i].iId ) < 0 )
+                m_aTracks[i] = m_aTracks[--m_iNumTracks];
+        }
+
+        for ( int i = 0; i < frame.iNumHands; i++ )
+        {
+            const HandSnapshot& hand    = frame.aHands[i];
+            int                 iTrack  = findTrack( hand.iId );
+
+            if ( iTrack < 0 )
+            {
+                iTrack = m_iNumTracks++;
+                m_aTracks[iTrack].iId = hand.iId;
+                m_aTracks[iTrack].iNumSamples = 0;
+            }
+
+            Track& track = m_aTracks[iTrack];
+
+            // time going backwards means a new source or a replay that looped
+            if ( track.iNumSamples > 0 && track.getNewestTime() >= fSeconds )
+                track.iNumSamples = 0;
+
+            track.addSample( hand, fSeconds );
+        }
+    }
+
+    /** Fills frame with every tracked hand as it is expected to be at fSeconds. */
+    void predictFrame( double fSeconds, FrameSnapshot& frame ) const
+    {
+        frame.iNumHands = m_iNumTracks;
+
+        for ( int i = 0; i < m_iNumTracks; i++ )
+            m_aTracks[i].predict( fSeconds, frame.aHands[i] );
+    }
+
+    //==============================================================================
+    /** Linear blend from a (fT = 0) to b (fT = 1), extrapolating outside that range. */
+    static void blendHands( const HandSnapshot& a, const HandSnapshot& b, float fT, HandSnapshot& out )
+    {
+        out = b;
+
+        out.vPalmPosition = blend( a.vPalmPosition, b.vPalmPosition, fT );
+        out.vWrist        = blend( a.vWrist, b.vWrist, fT );
+        out.vPalmNormal   = blend( a.vPalmNormal, b.vPalmNormal, fT ).normalized();
+        out.vDirection    = blend( a.vDirection, b.vDirection, fT ).normalized();
+
+        for ( int i = 0; i < HandSnapshot::kNumFingers; i++ )
+        {
+            for ( int j = 0; j < FingerSnapshot::kNumJoints; j++ )
+            {
+                out.aFingers[i].avJoints[j] = blend( a.aFingers[i].avJoints[j], b.aFingers[i].avJoints[j], fT );
+            }
+        }
+    }
+
+private:
+    static int findHand( const FrameSnapshot& frame, int32_t iId ) noexcept
+    {
+        for ( int i = 0; i < frame.iNumHands; i++ )
+        {
+            if ( frame.aHands[i].iId == iId )
+                return i;
+        }
+
+        return -1;
+    }
+
+    int findTrack( int32_t iId ) const noexcept
+    {
+        for ( int i = 0; i < m_iNumTracks; i++ )
+        {
+            if ( m_aTracks[i].iId == iId )
+                return i;
+        }
+
+        return -1;
+    }
+
+    static Leap::Vector blend( const Leap::Vector& a, const Leap::Vector& b, float fT )
+    {
+        return a + (b - a) * fT;
+    }
+
+    /// samples of one hand, oldest first.
+    struct Track
+    {
+        Track() : iId( 0 ), iNumSamples( 0 ) {}
+
+        double getNewestTime() const noexcept
+        {
+            return iNumSamples > 0 ? afTimes[iNumSamples - 1] : 0.0;
+        }
+
+        void addSample( const HandSnapshot& hand, double fSeconds )
+        {
+            if ( iNumSamples == kHistorySize )
+            {
+                for ( int i = 1; i < kHistorySize; i++ )
+                {
+                    aHands[i - 1]  = aHands[i];
+                    afTimes[i - 1] = afTimes[i];
+                }
+
+                iNumSamples--;
+            }
+
+            aHands[iNumSamples]  = hand;
+            afTimes[iNumSamples] = fSeconds;
+            iNumSamples++;
+        }
+
+        void predict( double fSeconds, HandSnapshot& out ) const
+        {
+            if ( iNumSamples < 2 )
+            {
+                out = aHands[0];
+                return;
+            }
+
+            // the pair around fSeconds, or the newest pair when extrapolating
+            int iNewer = 1;
+
+            while ( iNewer < iNumSamples - 1 && afTimes[iNewer] < fSeconds )
+                iNewer++;
+
+            const double fOlderTime = afTimes[iNewer - 1];
+            const double fNewerTime = afTimes[iNewer];
+            const double fLimit     = afTimes[iNumSamples - 1] + kMaxExtrapolationMs * 0.001;
+            const double fTarget    = jlimit( afTimes[0], fLimit, fSeconds );
+
+            const float fT = static_cast<float>((fTarget - fOlderTime) / (fNewerTime - fOlderTime));
+
+            blendHands( aHands[iNewer - 1], aHands[iNewer], fT, out );
+        }
+
+        int32_t         iId;
+        int             iNumSamples;
+        HandSnapshot    aHands[kHistorySize];
+        double          afTimes[kHistorySize];
+    };
+
+    Track   m_aTracks[FrameSnapshot::kMaxHands];
+    int     m_iNumTracks;
+
+    JUCE_DECLARE_NON_COPYABLE (HandPredictor)
+};
+
+#endif // FINGERVISUALIZER_HANDPREDICTOR_H_INCLUDED
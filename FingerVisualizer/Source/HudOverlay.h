@@ -0,0 +1,631 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_HUDOVERLAY_H_INCLUDED
+#define FINGERVISUALIZER_HUDOVERLAY_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FrameProfiler.h"
+#include "LeapUtilGL.h"
+#include "ViewLayout.h"
+
+//==============================================================================
+/**
+    The text overlay, drawn from cached textures.
+
+    Everything that only changes on user input (help, prompt, labels, the
+    recording marker) is rasterized in software into a window sized texture
+    that is rebuilt only when the Content changes.  The frame rate and latency
+    Values are drawn every frame as quads from a small glyph atlas of digits, so
+    no text is laid out, rasterized or allocated per frame.  The profiler panel
+    arrives as an image painted on the message thread with paintProfilerPanel(),
+    and is only uploaded when a new one comes along.
+*/
+class HudOverlay
+{
+public:
+    /** The parts of the overlay that only change occasionally. */
+    struct Content
+    {
+        Content()
+          : iWidth( 0 ),
+            iHeight( 0 ),
+            bShowHelp( false ),
+            bShowUpdateFPS( false ),
+            bRecording( false ),
+            iViewLayout( ViewLayout::kLayout_Single )
+        {
+        }
+
+        bool operator== ( const Content& other ) const noexcept
+        {
+            return iWidth == other.iWidth && iHeight == other.iHeight
+                && bShowHelp == other.bShowHelp && bShowUpdateFPS == other.bShowUpdateFPS
+                && bRecording == other.bRecording && iViewLayout == other.iViewLayout
+                && strSource == other.strSource && strGestures == other.strGestures
+                && strHelp == other.strHelp && strPrompt == other.strPrompt;
+        }
+
+        bool operator!= ( const Content& other ) const noexcept     { return !operator== ( other ); }
+
+        int     iWidth;
+        int     iHeight;
+        bool    bShowHelp;
+        bool    bShowUpdateFPS;
+        bool    bRecording;
+        /// a ViewLayout::Layout, each pane is labelled when there are several
+        int     iViewLayout;
+        String  strSource;
+        /// recent gestures, shown with or without the help
+        String  strGestures;
+        String  strHelp;
+        String  strPrompt;
+    };
+
+    /** The numbers that change every frame. */
+    struct Values
+    {
+        Values()
+          : fUpdateFPS( 0.0f ),
+            fRenderFPS( 0.0f ),
+            fLatencyP50Ms( 0.0f ),
+            fLatencyP99Ms( 0.0f ),
+            fLatencyMaxMs( 0.0f )
+        {
+        }
+
+        float   fUpdateFPS;
+        float   fRenderFPS;
+        float   fLatencyP50Ms;
+        float   fLatencyP99Ms;
+        float   fLatencyMaxMs;
+    };
+
+    HudOverlay()
+      : m_iNumStaticRebuilds( 0 ),
+        m_fGlyphHeight( 0.0f ),
+        m_fUpdateValueX( 0.0f ),
+        m_fRenderValueX( 0.0f ),
+        m_iNumQuads( 0 )
+    {
+    }
+
+    //==============================================================================
+    /** Builds the glyph atlas, call from newOpenGLContextCreated(). */
+    void initialise( const Font& helpFont )
+    {
+        release();
+
+        m_helpFont  = helpFont;
+        m_valueFont = Font( helpFont.getHeight() );
+
+        m_fUpdateValueX = kMargin + m_valueFont.getStringWidthFloat( "UpdateFPS: " );
+        m_fRenderValueX = kMargin + m_valueFont.getStringWidthFloat( "RenderFPS: " );
+
+        // the latency values each get a column as wide as "0000.00  "
+        const float fColumnWidth = m_valueFont.getStringWidthFloat( "0000.00  " );
+
+        m_afLatencyLabelX[0] = static_cast<float>(kMargin);
+        m_afLatencyValueX[0] = kMargin + m_valueFont.getStringWidthFloat( getLatencyLabel( 0 ) );
+
+        for ( int i = 1; i < kNumLatencyValues; i++ )
+        {
+            m_afLatencyLabelX[i] = m_afLatencyValueX[i - 1] + fColumnWidth;
+            m_afLatencyValueX[i] = m_afLatencyLabelX[i] + m_valueFont.getStringWidthFloat( getLatencyLabel( i ) );
+        }
+
+        createGlyphAtlas();
+    }
+
+    /** Frees both textures, call from openGLContextClosing(). */
+    void release()
+    {
+        m_staticTexture.release();
+        m_glyphTexture.release();
+        m_panelTexture.release();
+
+        // forces the static layer and panel to be reloaded in the next context
+        m_content = Content();
+        m_panel   = Image();
+    }
+
+    /** How often the static layer has been rasterized, for diagnostics. */
+    int getNumStaticRebuilds() const noexcept       { return m_iNumStaticRebuilds; }
+
+    //==============================================================================
+    /** Draws the overlay over the whole viewport, with the profiler panel in the
+        bottom right corner unless it's a null image.
+    */
+    void draw( const Content& content, const Values& values, const Image& panel = Image() )
+    {
+        if ( content != m_content )
+        {
+            m_content = content;
+            rebuildStaticLayer();
+        }
+
+        // images share their pixels when copied, so this only catches a newly painted panel
+        if ( panel != m_panel )
+        {
+            m_panel = panel;
+
+            if ( m_panel.isValid() )
+                m_panelTexture.loadImage( m_panel );
+            else
+                m_panelTexture.release();
+        }
+
+        LeapUtilGL::GLAttribScope attribScope( GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT | GL_TEXTURE_BIT );
+
+        glDisable( GL_DEPTH_TEST );
+        glDisable( GL_LIGHTING );
+        glDisable( GL_CULL_FACE );
+        glEnable( GL_TEXTURE_2D );
+        glEnable( GL_BLEND );
+
+        // JUCE images are premultiplied
+        glBlendFunc( GL_ONE, GL_ONE_MINUS_SRC_ALPHA );
+        glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
+        glColor4f( 1.0f, 1.0f, 1.0f, 1.0f );
+
+        glMatrixMode( GL_PROJECTION );
+        glPushMatrix();
+        glLoadIdentity();
+        glOrtho( 0, m_content.iWidth, m_content.iHeight, 0, -1, 1 );
+
+        glMatrixMode( GL_MODELVIEW );
+        glPushMatrix();
+        glLoadIdentity();
+
+        m_iNumQuads = 0;
+        addQuad( 0.0f, 0.0f, static_cast<float>(m_content.iWidth), static_cast<float>(m_content.iHeight),
+                 0.0f, 0.0f, static_cast<float>(m_content.iWidth), static_cast<float>(m_content.iHeight),
+                 m_staticTexture );
+        drawQuads( m_staticTexture );
+
+        if ( m_panel.isValid() )
+        {
+            const float fW = static_cast<float>(m_panel.getWidth());
+            const float fH = static_cast<float>(m_panel.getHeight());
+
+            m_iNumQuads = 0;
+            addQuad( m_content.iWidth - kMargin - fW, m_content.iHeight - kMargin - fH, fW, fH,
+                     0.0f, 0.0f, fW, fH, m_panelTexture );
+            drawQuads( m_panelTexture );
+        }
+
+        if ( m_content.bShowHelp )
+        {
+            m_iNumQuads = 0;
+
+            const float fLatencyBaseLine = static_cast<float>(kBaseLine + getLineStep() * 2);
+
+            if ( m_content.bShowUpdateFPS )
+                addValue( values.fUpdateFPS, m_fUpdateValueX, static_cast<float>(kBaseLine) );
+
+            addValue( values.fRenderFPS, m_fRenderValueX, static_cast<float>(kBaseLine + getLineStep()) );
+
+            addValue( values.fLatencyP50Ms, m_afLatencyValueX[0], fLatencyBaseLine );
+            addValue( values.fLatencyP99Ms, m_afLatencyValueX[1], fLatencyBaseLine );
+            addValue( values.fLatencyMaxMs, m_afLatencyValueX[2], fLatencyBaseLine );
+
+            drawQuads( m_glyphTexture );
+        }
+
+        glMatrixMode( GL_PROJECTION );
+        glPopMatrix();
+        glMatrixMode( GL_MODELVIEW );
+        glPopMatrix();
+    }
+
+    /** Writes fValue with two decimals, like "%.2f", without allocating.
+        Returns the number of characters written.
+    */
+    static int formatValue( float fValue, char* pcOut, int iMaxChars ) noexcept
+    {
+        const int64 iHundredths = static_cast<int64>(jlimit( 0.0f, 1.0e9f, fValue ) * 100.0f + 0.5f);
+
+        char   acReversed[24];
+        int    iNumDigits = 0;
+        int64  iRemaining = iHundredths;
+
+        do
+        {
+            acReversed[iNumDigits++] = static_cast<char>('0' + iRemaining % 10);
+            iRemaining /= 10;
+        }
+        while ( iRemaining > 0 || iNumDigits < 3 );
+
+        int iCount = 0;
+
+        for ( int i = iNumDigits - 1; i >= 0 && iCount < iMaxChars; i-- )
+        {
+            pcOut[iCount++] = acReversed[i];
+
+            if ( i == 2 && iCount < iMaxChars )
+                pcOut[iCount++] = '.';
+        }
+
+        return iCount;
+    }
+
+    //==============================================================================
+    /** Paints the profiler's report: a row per scope that ran with its CPU (and
+        GPU) p50 and p99 times and histogram, then the last render frame's scopes
+        as flame graphs, nested scopes below the ones they ran in.
+    */
+    static Image paintProfilerPanel( const FrameProfiler::Report& report, const Font& font )
+    {
+        const int iRowHeight   = static_cast<int>(std::ceil( font.getHeight() )) + 4;
+        const int iFlameHeight = kFlameRowHeight * kMaxFlameDepth;
+        const int iNameWidth   = static_cast<int>(font.getStringWidthFloat( "renderOpenGL2D  " ));
+        const int iTimesWidth  = static_cast<int>(font.getStringWidthFloat( "00.000 00.000  " ));
+        const int iHistWidth   = FrameProfiler::kNumBuckets * kBucketWidth + kMargin;
+        const int iNumColumns  = report.bHasGpu ? 2 : 1;
+        const int iWidth       = kMargin * 2 + iNameWidth + (iTimesWidth + iHistWidth) * iNumColumns;
+
+        int iNumRows = 0;
+
+        for ( int i = 0; i < FrameProfiler::kNumScopes; i++ )
+        {
+            if ( report.aCpu[i].iNumSamples > 0 )
+                ++iNumRows;
+        }
+
+        const int iNumFlames = report.bHasGpu ? 2 : 1;
+        const int iHeight    = kMargin * 2 + iRowHeight * (iNumRows + 1) + (iRowHeight + iFlameHeight) * iNumFlames;
+
+        Image     image( Image::ARGB, iWidth, iHeight, true, SoftwareImageType() );
+        Graphics  g( image );
+
+        g.fillAll( Colours::black.withAlpha( 0.6f ) );
+        g.setFont( font );
+
+        int iY = kMargin;
+
+        // header, one column of times and histogram per clock
+        g.setColour( Colours::lightgrey );
+
+        for ( int iColumn = 0; iColumn < iNumColumns; iColumn++ )
+        {
+            g.drawText( iColumn == 0 ? "cpu p50 p99 ms" : "gpu p50 p99 ms",
+                        kMargin + iNameWidth + (iTimesWidth + iHistWidth) * iColumn, iY, iTimesWidth + iHistWidth, iRowHeight,
+                        Justification::centredLeft, false );
+        }
+
+        g.drawText( String( report.iNumDropped ) + " dropped", kMargin, iY, iNameWidth, iRowHeight, Justification::centredLeft, false );
+        iY += iRowHeight;
+
+        for ( int i = 0; i < FrameProfiler::kNumScopes; i++ )
+        {
+            if ( report.aCpu[i].iNumSamples == 0 )
+                continue;
+
+            const FrameProfiler::Scope scope = static_cast<FrameProfiler::Scope>(i);
+
+            g.setColour( getScopeColour( scope ) );
+            g.drawText( FrameProfiler::getScopeName( scope ), kMargin, iY, iNameWidth, iRowHeight, Justification::centredLeft, false );
+
+            for ( int iColumn = 0; iColumn < iNumColumns; iColumn++ )
+            {
+                const FrameProfiler::ScopeStats& stats = iColumn == 0 ? report.aCpu[i] : report.aGpu[i];
+                const int                        iX    = kMargin + iNameWidth + (iTimesWidth + iHistWidth) * iColumn;
+
+                if ( stats.iNumSamples == 0 )
+                    continue;
+
+                g.setColour( Colours::seagreen );
+                g.drawText( String( stats.fP50Ms, 3 ) + " " + String( stats.fP99Ms, 3 ), iX, iY, iTimesWidth, iRowHeight,
+                            Justification::centredLeft, false );
+
+                paintHistogram( g, stats, iX + iTimesWidth, iY + 2, iRowHeight - 4, getScopeColour( scope ) );
+            }
+
+            iY += iRowHeight;
+        }
+
+        for ( int iFlame = 0; iFlame < iNumFlames; iFlame++ )
+        {
+            const FrameProfiler::Flame& flame = iFlame == 0 ? report.cpuFlame : report.gpuFlame;
+
+            g.setColour( Colours::lightgrey );
+            g.drawText( String( iFlame == 0 ? "last frame, cpu " : "gpu, frames ago " ) + String( flame.fLengthMs, 3 ) + " ms",
+                        kMargin, iY, iWidth - kMargin * 2, iRowHeight, Justification::centredLeft, false );
+            iY += iRowHeight;
+
+            paintFlame( g, flame, font, kMargin, iY, iWidth - kMargin * 2 );
+            iY += iFlameHeight;
+        }
+
+        return image;
+    }
+
+private:
+    //==============================================================================
+    enum
+    {
+        kMargin     = 10,
+        kBaseLine   = 20,
+        kMaxQuads   = 32,
+        kNumGlyphs  = 11,
+        kPointGlyph = 10,
+        kNumLatencyValues = 3
+    };
+
+    enum
+    {
+        kBucketWidth    = 6,
+        kFlameRowHeight = 14,
+        kMaxFlameDepth  = 4
+    };
+
+    static const char* getGlyphs() noexcept     { return "0123456789."; }
+
+    static Colour getScopeColour( FrameProfiler::Scope scope )
+    {
+        return Colour::fromHSV( scope / static_cast<float>(FrameProfiler::kNumScopes), 0.6f, 0.9f, 1.0f );
+    }
+
+    /// bars as high as each bucket's share of the fullest one.
+    static void paintHistogram( Graphics& g, const FrameProfiler::ScopeStats& stats, int iX, int iY, int iHeight, const Colour& colour )
+    {
+        int iMaxCount = 1;
+
+        for ( int i = 0; i < FrameProfiler::kNumBuckets; i++ )
+            iMaxCount = jmax( iMaxCount, stats.aiHistogram[i] );
+
+        g.setColour( Colours::darkgrey );
+        g.fillRect( iX, iY + iHeight - 1, FrameProfiler::kNumBuckets * kBucketWidth, 1 );
+        g.setColour( colour );
+
+        for ( int i = 0; i < FrameProfiler::kNumBuckets; i++ )
+        {
+            if ( stats.aiHistogram[i] == 0 )
+                continue;
+
+            const int iBarHeight = jmax( 1, stats.aiHistogram[i] * iHeight / iMaxCount );
+
+            g.fillRect( iX + i * kBucketWidth, iY + iHeight - iBarHeight, kBucketWidth - 1, iBarHeight );
+        }
+    }
+
+    static void paintFlame( Graphics& g, const FrameProfiler::Flame& flame, const Font& font, int iX, int iY, int iWidth )
+    {
+        if ( flame.fLengthMs <= 0.0f )
+            return;
+
+        const float fScale = iWidth / flame.fLengthMs;
+
+        g.setFont( font.withHeight( kFlameRowHeight - 3.0f ) );
+
+        for ( int i = 0; i < flame.iNumBars; i++ )
+        {
+            const FrameProfiler::FlameBar& bar = flame.aBars[i];
+
+            if ( bar.iDepth >= kMaxFlameDepth )
+                continue;
+
+            const FrameProfiler::Scope scope = static_cast<FrameProfiler::Scope>(bar.iScope);
+            const Rectangle<float>     rect( iX + bar.fStartMs * fScale, static_cast<float>(iY + bar.iDepth * kFlameRowHeight),
+                                             jmax( 1.0f, bar.fDurationMs * fScale ), kFlameRowHeight - 1.0f );
+
+            g.setColour( getScopeColour( scope ) );
+            g.fillRect( rect );
+
+            if ( rect.getWidth() > 30.0f )
+            {
+                g.setColour( Colours::black );
+                g.drawText( FrameProfiler::getScopeName( scope ), rect.reduced( 2.0f, 0.0f ).getSmallestIntegerContainer(), Justification::centredLeft, true );
+            }
+        }
+    }
+
+
+    static const char* getLatencyLabel( int iIndex ) noexcept
+    {
+        static const char* const s_aszLabels[kNumLatencyValues] = { "Latency ms  p50: ", "p99: ", "max: " };
+        return s_aszLabels[iIndex];
+    }
+
+    int getFontSize() const                     { return static_cast<int>(m_helpFont.getHeight()); }
+    int getLineStep() const                     { return getFontSize() + (getFontSize() >> 2); }
+
+    /// same layout the overlay has always had, minus the numbers.
+    void rebuildStaticLayer()
+    {
+        ++m_iNumStaticRebuilds;
+
+        const int iWidth    = jmax( 1, m_content.iWidth );
+        const int iHeight   = jmax( 1, m_content.iHeight );
+        const int iFontSize = getFontSize();
+        const int iLineStep = getLineStep();
+
+        Image     image( Image::ARGB, iWidth, iHeight, true, SoftwareImageType() );
+        Graphics  g( image );
+
+        const ViewLayout::Layout layout = static_cast<ViewLayout::Layout>(m_content.iViewLayout);
+
+        if ( ViewLayout::getNumViews( layout ) > 1 )
+        {
+            g.setColour( Colours::lightgrey );
+            g.setFont( m_valueFont );
+
+            for ( int i = 0; i < ViewLayout::getNumViews( layout ); i++ )
+            {
+                const Rectangle<int> pane = ViewLayout::getViewBounds( layout, i, iWidth, iHeight );
+
+                g.drawSingleLineText( ViewLayout::getViewName( ViewLayout::getViewAngle( layout, i ) ),
+                                      pane.getRight() - kMargin, pane.getBottom() - kMargin, Justification::right );
+            }
+        }
+
+        if ( m_content.bShowHelp )
+        {
+            g.setColour( Colours::seagreen );
+            g.setFont( m_valueFont );
+
+            if ( m_content.bShowUpdateFPS )
+            {
+              g.drawSingleLineText( "UpdateFPS: ", kMargin, kBaseLine );
+            }
+
+            g.drawSingleLineText( "RenderFPS: ", kMargin, kBaseLine + iLineStep );
+
+            for ( int i = 0; i < kNumLatencyValues; i++ )
+                g.drawSingleLineText( getLatencyLabel( i ), static_cast<int>(m_afLatencyLabelX[i]), kBaseLine + iLineStep * 2 );
+
+            g.drawSingleLineText( m_content.strSource, kMargin, kBaseLine + iLineStep * 3 );
+
+            g.setFont( m_helpFont );
+            g.setColour( Colours::slateblue );
+
+            g.drawMultiLineText(  m_content.strHelp,
+                                  kMargin,
+                                  kBaseLine + iLineStep * 5,
+                                  iWidth - kMargin*2 );
+        }
+
+        g.setFont( m_valueFont );
+
+        if ( m_content.strGestures.isNotEmpty() )
+        {
+            g.setColour( Colours::gold );
+            g.drawSingleLineText( m_content.strGestures, kMargin, kBaseLine + iLineStep * 4 );
+        }
+
+        if ( m_content.bRecording )
+        {
+            g.setColour( Colours::red );
+            g.drawSingleLineText( "REC", iWidth - kMargin, kBaseLine, Justification::right );
+        }
+
+        g.setColour( Colours::salmon );
+        g.drawMultiLineText(  m_content.strPrompt,
+                              kMargin,
+                              iHeight - (iFontSize + iFontSize + iLineStep),
+                              iWidth/4 );
+
+        m_staticTexture.loadImage( image );
+    }
+
+    void createGlyphAtlas()
+    {
+        const char* const szGlyphs = getGlyphs();
+
+        float fX = 1.0f;
+
+        for ( int i = 0; i < kNumGlyphs; i++ )
+        {
+            m_afGlyphX[i]     = fX;
+            m_afGlyphWidth[i] = m_valueFont.getStringWidthFloat( String::charToString( static_cast<juce_wchar>(szGlyphs[i]) ) );
+            fX += std::ceil( m_afGlyphWidth[i] ) + 2.0f;
+        }
+
+        m_fGlyphHeight = std::ceil( m_valueFont.getHeight() );
+
+        Image     image( Image::ARGB, static_cast<int>(fX), static_cast<int>(m_fGlyphHeight) + 2, true, SoftwareImageType() );
+        Graphics  g( image );
+
+        g.setFont( m_valueFont );
+        g.setColour( Colours::seagreen );
+
+        for ( int i = 0; i < kNumGlyphs; i++ )
+        {
+            g.drawSingleLineText( String::charToString( static_cast<juce_wchar>(szGlyphs[i]) ),
+                                  static_cast<int>(m_afGlyphX[i]), 1 + static_cast<int>(m_valueFont.getAscent()) );
+        }
+
+        m_glyphTexture.loadImage( image );
+    }
+
+    /// lays out fValue as glyph quads with its baseline at fBaseLine.
+    void addValue( float fValue, float fX, float fBaseLine )
+    {
+        char acText[16];
+        const int iCount = formatValue( fValue, acText, numElementsInArray( acText ) );
+        const float fTop = fBaseLine - m_valueFont.getAscent() - 1.0f;
+
+        for ( int i = 0; i < iCount; i++ )
+        {
+            const int iGlyph = (acText[i] == '.') ? kPointGlyph : acText[i] - '0';
+
+            addQuad( fX - 1.0f, fTop, m_afGlyphWidth[iGlyph] + 2.0f, m_fGlyphHeight + 2.0f,
+                     m_afGlyphX[iGlyph] - 1.0f, 0.0f, m_afGlyphWidth[iGlyph] + 2.0f, m_fGlyphHeight + 2.0f,
+                     m_glyphTexture );
+
+            fX += m_afGlyphWidth[iGlyph];
+        }
+    }
+
+    /// a screen rectangle showing the given pixel rectangle of a texture loaded with loadImage().
+    void addQuad( float fX, float fY, float fW, float fH,
+                  float fImageX, float fImageY, float fImageW, float fImageH,
+                  const OpenGLTexture& texture )
+    {
+        if ( m_iNumQuads >= kMaxQuads || texture.getWidth() == 0 || texture.getHeight() == 0 )
+            return;
+
+        // loadImage() puts the image's top left corner at texture coordinate (0, 1)
+        const float fS0 = fImageX / texture.getWidth();
+        const float fS1 = (fImageX + fImageW) / texture.getWidth();
+        const float fT0 = 1.0f - fImageY / texture.getHeight();
+        const float fT1 = 1.0f - (fImageY + fImageH) / texture.getHeight();
+
+        const GLfloat afVertices[]  = { fX, fY,     fX, fY + fH,    fX + fW, fY + fH,   fX + fW, fY };
+        const GLfloat afTexCoords[] = { fS0, fT0,   fS0, fT1,       fS1, fT1,           fS1, fT0 };
+
+        memcpy( m_afVertices  + m_iNumQuads * 8, afVertices,  sizeof (afVertices) );
+        memcpy( m_afTexCoords + m_iNumQuads * 8, afTexCoords, sizeof (afTexCoords) );
+        ++m_iNumQuads;
+    }
+
+    void drawQuads( const OpenGLTexture& texture )
+    {
+        if ( m_iNumQuads == 0 )
+            return;
+
+        texture.bind();
+
+        glEnableClientState( GL_VERTEX_ARRAY );
+        glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+        glVertexPointer( 2, GL_FLOAT, 0, m_afVertices );
+        glTexCoordPointer( 2, GL_FLOAT, 0, m_afTexCoords );
+
+        glDrawArrays( GL_QUADS, 0, m_iNumQuads * 4 );
+
+        glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+        glDisableClientState( GL_VERTEX_ARRAY );
+
+        texture.unbind();
+    }
+
+    Content         m_content;
+    Font            m_helpFont;
+    Font            m_valueFont;
+    OpenGLTexture   m_staticTexture;
+    OpenGLTexture   m_glyphTexture;
+    OpenGLTexture   m_panelTexture;
+    Image           m_panel;
+    int             m_iNumStaticRebuilds;
+
+    float           m_afGlyphX[kNumGlyphs];
+    float           m_afGlyphWidth[kNumGlyphs];
+    float           m_fGlyphHeight;
+    float           m_fUpdateValueX;
+    float           m_fRenderValueX;
+    float           m_afLatencyLabelX[kNumLatencyValues];
+    float           m_afLatencyValueX[kNumLatencyValues];
+
+    GLfloat         m_afVertices[kMaxQuads * 8];
+    GLfloat         m_afTexCoords[kMaxQuads * 8];
+    int             m_iNumQuads;
+
+    JUCE_DECLARE_NON_COPYABLE (HudOverlay)
+};
+
+#endif // FINGERVISUALIZER_HUDOVERLAY_H_INCLUDED
@@ -0,0 +1,341 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_JOINTFILTER_H_INCLUDED
+#define FINGERVISUALIZER_JOINTFILTER_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FrameSnapshot.h"
+
+#ifndef FINGERVISUALIZER_USE_SSE
+ #if JUCE_INTEL
+  #define FINGERVISUALIZER_USE_SSE 1
+ #else
+  #define FINGERVISUALIZER_USE_SSE 0
+ #endif
+#endif
+
+#if FINGERVISUALIZER_USE_SSE
+ #include <emmintrin.h>
+#endif
+
+//==============================================================================
+/**
+    One Euro filter over every joint position of every tracked hand.
+
+    The One Euro filter is a low pass filter whose cutoff rises with speed, so a
+    hand held still loses its jitter while a moving one doesn't lag behind.
+
+    Each hand id gets a slot holding its palm, wrist and finger joints.  Within a
+    slot the x, y and z coordinates are stored as three separate, padded runs, and
+    the slots are kept packed at the start of each array, so a whole frame is
+    filtered by one pass over contiguous floats, four at a time with SSE2 when
+    it's available.  A hand that appears starts out unfiltered, and its slot is
+    freed as soon as it's missing from a frame.
+
+    Only directions and normals are left alone, blending unit vectors needs
+    renormalizing and they're derived from the joints anyway.  Only the thread
+    delivering frames may use it.
+*/
+class JointFilter
+{
+public:
+    struct Settings
+    {
+        Settings()
+          : fMinCutoffHz( 1.0f ),
+            fBeta( 0.02f ),
+            fDerivativeCutoffHz( 1.0f )
+        {
+        }
+
+        /// cutoff when still, lower removes more jitter.
+        float   fMinCutoffHz;
+        /// cutoff added per mm/s of speed, higher lags less.
+        float   fBeta;
+        /// cutoff of the speed estimate.
+        float   fDerivativeCutoffHz;
+    };
+
+    enum
+    {
+        /// palm, wrist and every finger joint.
+        kPointsPerHand  = 2 + HandSnapshot::kNumFingers * FingerSnapshot::kNumJoints,
+        /// one coordinate of every point, padded to whole SSE registers.
+        kRunLength      = (kPointsPerHand + 3) & ~3,
+        kFloatsPerSlot  = kRunLength * 3
+    };
+
+    explicit JointFilter( const Settings& settings = Settings() )
+      : m_settings( settings ),
+        m_iNumSlots( 0 ),
+        m_iLastTimestamp( 0 ),
+        m_bHasTimestamp( false ),
+        m_bUseSIMD( isSIMDAvailable() )
+    {
+        m_afRaw         = allocateAligned( m_rawStorage );
+        m_afValue       = allocateAligned( m_valueStorage );
+        m_afDerivative  = allocateAligned( m_derivativeStorage );
+    }
+
+    static bool isSIMDAvailable() noexcept
+    {
+       #if FINGERVISUALIZER_USE_SSE
+        return SystemStats::hasSSE2();
+       #else
+        return false;
+       #endif
+    }
+
+    /** Switches between the SSE2 and scalar kernels, for benchmarking. */
+    void setUseSIMD( bool bUseSIMD ) noexcept       { m_bUseSIMD = bUseSIMD && isSIMDAvailable(); }
+    bool isUsingSIMD() const noexcept               { return m_bUseSIMD; }
+
+    const Settings& getSettings() const noexcept    { return m_settings; }
+    void setSettings( const Settings& settings )    { m_settings = settings; }
+
+    int getNumSlots() const noexcept                { return m_iNumSlots; }
+
+    /** Forgets all hands, the next frame passes through unfiltered. */
+    void reset() noexcept
+    {
+        m_iNumSlots     = 0;
+        m_bHasTimestamp = false;
+    }
+
+    //==============================================================================
+    /** Filters the joint positions of frame in place. */
+    void process( FrameSnapshot& frame )
+    {
+        const double fDeltaSeconds = (frame.iTimestamp - m_iLastTimestamp) * 1.0e-6;
+
+        // a first frame, a gap or time going backwards starts over
+        const bool bRestart = !m_bHasTimestamp || fDeltaSeconds <= 0.0 || fDeltaSeconds > 0.25;
+
+        if ( bRestart )
+            m_iNumSlots = 0;
+
+        m_iLastTimestamp = frame.iTimestamp;
+        m_bHasTimestamp  = true;
+
+        releaseMissingHands( frame );
+
+        int aiSlots[FrameSnapshot::kMaxHands];
+
+        for ( int i = 0; i < frame.iNumHands; i++ )
+        {
+            const HandSnapshot& hand  = frame.aHands[i];
+            int                 iSlot = findSlot( hand.iId );
+
+            if ( iSlot < 0 )
+            {
+                // a new hand starts at its raw position, so this frame leaves it unchanged
+                iSlot = m_iNumSlots++;
+                m_aiSlotIds[iSlot] = hand.iId;
+
+                gather( hand, m_afValue + iSlot * kFloatsPerSlot );
+                zeromem( m_afDerivative + iSlot * kFloatsPerSlot, kFloatsPerSlot * sizeof (float) );
+            }
+
+            gather( hand, m_afRaw + iSlot * kFloatsPerSlot );
+            aiSlots[i] = iSlot;
+        }
+
+        if ( m_iNumSlots > 0 && !bRestart )
+        {
+            const Coefficients coefficients( m_settings, static_cast<float>(fDeltaSeconds) );
+            const int          iNumFloats = m_iNumSlots * kFloatsPerSlot;
+
+           #if FINGERVISUALIZER_USE_SSE
+            if ( m_bUseSIMD )
+                filterSSE( m_afRaw, m_afValue, m_afDerivative, iNumFloats, coefficients );
+            else
+           #endif
+                filterScalar( m_afRaw, m_afValue, m_afDerivative, iNumFloats, coefficients );
+        }
+
+        for ( int i = 0; i < frame.iNumHands; i++ )
+            scatter( m_afValue + aiSlots[i] * kFloatsPerSlot, frame.aHands[i] );
+    }
+
+private:
+    //==============================================================================
+    /// the per-frame constants of the filter, the same for every coordinate.
+    struct Coefficients
+    {
+        Coefficients( const Settings& settings, float fDeltaSeconds )
+          : fInvDelta( 1.0f / fDeltaSeconds ),
+            fTwoPiDelta( 2.0f * float_Pi * fDeltaSeconds ),
+            fMinCutoff( settings.fMinCutoffHz ),
+            fBeta( settings.fBeta )
+        {
+            fDerivativeAlpha = getAlpha( fTwoPiDelta * settings.fDerivativeCutoffHz );
+        }
+
+        /// smoothing factor of a first order low pass, given 2 pi * cutoff * dt.
+        static float getAlpha( float fR ) noexcept     { return fR / (1.0f + fR); }
+
+        float fInvDelta;
+        float fTwoPiDelta;
+        float fMinCutoff;
+        float fBeta;
+        float fDerivativeAlpha;
+    };
+
+    static void filterScalar( const float* afRaw, float* afValue, float* afDerivative, int iNum, const Coefficients& c ) noexcept
+    {
+        for ( int i = 0; i < iNum; i++ )
+        {
+            const float fSpeed  = (afRaw[i] - afValue[i]) * c.fInvDelta;
+            afDerivative[i]    += c.fDerivativeAlpha * (fSpeed - afDerivative[i]);
+
+            const float fR      = c.fTwoPiDelta * (c.fMinCutoff + c.fBeta * std::abs( afDerivative[i] ));
+            afValue[i]         += Coefficients::getAlpha( fR ) * (afRaw[i] - afValue[i]);
+        }
+    }
+
+   #if FINGERVISUALIZER_USE_SSE
+    /// the same arithmetic as filterScalar(), on aligned runs that are a multiple of four long.
+    static void filterSSE( const float* afRaw, float* afValue, float* afDerivative, int iNum, const Coefficients& c ) noexcept
+    {
+        jassert( (iNum & 3) == 0 );
+
+        const __m128 invDelta        = _mm_set1_ps( c.fInvDelta );
+        const __m128 twoPiDelta      = _mm_set1_ps( c.fTwoPiDelta );
+        const __m128 minCutoff       = _mm_set1_ps( c.fMinCutoff );
+        const __m128 beta            = _mm_set1_ps( c.fBeta );
+        const __m128 derivativeAlpha = _mm_set1_ps( c.fDerivativeAlpha );
+        const __m128 one             = _mm_set1_ps( 1.0f );
+        const __m128 signMask        = _mm_set1_ps( -0.0f );
+
+        for ( int i = 0; i < iNum; i += 4 )
+        {
+            const __m128 raw    = _mm_load_ps( afRaw + i );
+            __m128       value  = _mm_load_ps( afValue + i );
+            __m128       deriv  = _mm_load_ps( afDerivative + i );
+
+            const __m128 speed  = _mm_mul_ps( _mm_sub_ps( raw, value ), invDelta );
+            deriv               = _mm_add_ps( deriv, _mm_mul_ps( derivativeAlpha, _mm_sub_ps( speed, deriv ) ) );
+
+            const __m128 cutoff = _mm_add_ps( minCutoff, _mm_mul_ps( beta, _mm_andnot_ps( signMask, deriv ) ) );
+            const __m128 r      = _mm_mul_ps( twoPiDelta, cutoff );
+            const __m128 alpha  = _mm_div_ps( r, _mm_add_ps( one, r ) );
+            value               = _mm_add_ps( value, _mm_mul_ps( alpha, _mm_sub_ps( raw, value ) ) );
+
+            _mm_store_ps( afValue + i, value );
+            _mm_store_ps( afDerivative + i, deriv );
+        }
+    }
+   #endif
+
+    //==============================================================================
+    int findSlot( int32_t iId ) const noexcept
+    {
+        for ( int i = 0; i < m_iNumSlots; i++ )
+        {
+            if ( m_aiSlotIds[i] == iId )
+                return i;
+        }
+
+        return -1;
+    }
+
+    /// frees the slots of hands that aren't in frame, moving the last slot into each gap.
+    void releaseMissingHands( const FrameSnapshot& frame ) noexcept
+    {
+        for ( int iSlot = m_iNumSlots; --iSlot >= 0; )
+        {
+            bool bFound = false;
+
+            for ( int i = 0; i < frame.iNumHands && !bFound; i++ )
+                bFound = (frame.aHands[i].iId == m_aiSlotIds[iSlot]);
+
+            if ( bFound )
+                continue;
+
+            const int iLast = --m_iNumSlots;
+
+            if ( iSlot != iLast )
+            {
+                m_aiSlotIds[iSlot] = m_aiSlotIds[iLast];
+                memcpy( m_afValue + iSlot * kFloatsPerSlot, m_afValue + iLast * kFloatsPerSlot, kFloatsPerSlot * sizeof (float) );
+                memcpy( m_afDerivative + iSlot * kFloatsPerSlot, m_afDerivative + iLast * kFloatsPerSlot, kFloatsPerSlot * sizeof (float) );
+            }
+        }
+    }
+
+    static void setPoint( float* afSlot, int iPoint, const Leap::Vector& v ) noexcept
+    {
+        afSlot[iPoint]                  = v.x;
+        afSlot[iPoint + kRunLength]     = v.y;
+        afSlot[iPoint + kRunLength * 2] = v.z;
+    }
+
+    static Leap::Vector getPoint( const float* afSlot, int iPoint ) noexcept
+    {
+        return Leap::Vector( afSlot[iPoint], afSlot[iPoint + kRunLength], afSlot[iPoint + kRunLength * 2] );
+    }
+
+    static void gather( const HandSnapshot& hand, float* afSlot ) noexcept
+    {
+        setPoint( afSlot, 0, hand.vPalmPosition );
+        setPoint( afSlot, 1, hand.vWrist );
+
+        for ( int i = 0; i < HandSnapshot::kNumFingers; i++ )
+        {
+            for ( int j = 0; j < FingerSnapshot::kNumJoints; j++ )
+                setPoint( afSlot, 2 + i * FingerSnapshot::kNumJoints + j, hand.aFingers[i].avJoints[j] );
+        }
+
+        // keep the padding finite so it can't slow the SSE loop down with denormals or NaNs
+        for ( int i = kPointsPerHand; i < kRunLength; i++ )
+            setPoint( afSlot, i, Leap::Vector::zero() );
+    }
+
+    static void scatter( const float* afSlot, HandSnapshot& hand ) noexcept
+    {
+        hand.vPalmPosition = getPoint( afSlot, 0 );
+        hand.vWrist        = getPoint( afSlot, 1 );
+
+        for ( int i = 0; i < HandSnapshot::kNumFingers; i++ )
+        {
+            for ( int j = 0; j < FingerSnapshot::kNumJoints; j++ )
+                hand.aFingers[i].avJoints[j] = getPoint( afSlot, 2 + i * FingerSnapshot::kNumJoints + j );
+        }
+    }
+
+    /// room for every slot, starting on a 16 byte boundary.
+    static float* allocateAligned( HeapBlock<float>& storage )
+    {
+        storage.allocate( FrameSnapshot::kMaxHands * kFloatsPerSlot + 4, true );
+
+        float* p = storage;
+
+        while ( (reinterpret_cast<pointer_sized_int>(p) & 15) != 0 )
+            ++p;
+
+        return p;
+    }
+
+    Settings            m_settings;
+    HeapBlock<float>    m_rawStorage;
+    HeapBlock<float>    m_valueStorage;
+    HeapBlock<float>    m_derivativeStorage;
+    float*              m_afRaw;
+    float*              m_afValue;
+    float*              m_afDerivative;
+    int32_t             m_aiSlotIds[FrameSnapshot::kMaxHands];
+    int                 m_iNumSlots;
+    int64_t             m_iLastTimestamp;
+    bool                m_bHasTimestamp;
+    bool                m_bUseSIMD;
+
+    JUCE_DECLARE_NON_COPYABLE (JointFilter)
+};
+
+#endif // FINGERVISUALIZER_JOINTFILTER_H_INCLUDED
@@ -0,0 +1,288 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_LATENCYMONITOR_H_INCLUDED
+#define FINGERVISUALIZER_LATENCYMONITOR_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <algorithm>
+
+//==============================================================================
+/**
+    How long one frame spent in each part of the pipeline, in milliseconds.
+*/
+struct LatencySample
+{
+    enum Stage
+    {
+        /// device timestamp to the frame arriving in the listener, above the lowest seen recently.
+        kStage_Device,
+        /// arrival to being published for the render thread: the ingest queue, update, filtering and recording.
+        kStage_Capture,
+        /// published to the render thread picking it up, waiting for the triggered repaint.
+        kStage_Queue,
+        /// render thread picking it up to handing the finished frame to the buffer swap.
+        kStage_Render,
+        kNumStages
+    };
+
+    float getTotalMs() const noexcept
+    {
+        float fTotal = 0.0f;
+
+        for ( int i = 0; i < kNumStages; i++ )
+            fTotal += afStageMs[i];
+
+        return fTotal;
+    }
+
+    float afStageMs[kNumStages];
+};
+
+//==============================================================================
+/**
+    Estimates how long ago a frame left the device, from its device timestamp.
+
+    The device clock isn't synchronized with the host, so the offset between the
+    two is taken to be the smallest one seen over the last few seconds and the
+    estimate is the latency above that floor.  Keeping the window short follows
+    drift between the two clocks, and a jump of more than a second (a replayed
+    trace looping, a new device) starts over.  Only the thread delivering frames
+    may call it.
+*/
+class DeviceLatencyEstimator
+{
+public:
+    DeviceLatencyEstimator()
+    {
+        reset();
+    }
+
+    /** Forgets the offset, call when the frame source changes. */
+    void reset() noexcept
+    {
+        m_bHasOffset        = false;
+        m_fBucketStartMs    = 0.0;
+        m_fCurrentMinMs     = 0.0;
+        m_fPreviousMinMs    = 0.0;
+    }
+
+    float getLatencyMs( int64 iDeviceMicros, int64 iHostTicks ) noexcept
+    {
+        const double fHostMs   = Time::highResolutionTicksToSeconds( iHostTicks ) * 1000.0;
+        const double fOffsetMs = fHostMs - iDeviceMicros * 0.001;
+
+        if ( !m_bHasOffset || fOffsetMs - getFloorMs() > kDiscontinuityMs )
+        {
+            m_bHasOffset      = true;
+            m_fBucketStartMs  = fHostMs;
+            m_fCurrentMinMs   = fOffsetMs;
+            m_fPreviousMinMs  = fOffsetMs;
+        }
+        else if ( fHostMs - m_fBucketStartMs > kBucketMs )
+        {
+            m_fBucketStartMs  = fHostMs;
+            m_fPreviousMinMs  = m_fCurrentMinMs;
+            m_fCurrentMinMs   = fOffsetMs;
+        }
+        else
+        {
+            m_fCurrentMinMs   = jmin( m_fCurrentMinMs, fOffsetMs );
+        }
+
+        return static_cast<float>(fOffsetMs - getFloorMs());
+    }
+
+private:
+    enum
+    {
+        kBucketMs         = 5000,
+        kDiscontinuityMs  = 1000
+    };
+
+    double getFloorMs() const noexcept  { return jmin( m_fCurrentMinMs, m_fPreviousMinMs ); }
+
+    bool    m_bHasOffset;
+    double  m_fBucketStartMs;
+    double  m_fCurrentMinMs;
+    double  m_fPreviousMinMs;
+};
+
+//==============================================================================
+/**
+    Collects LatencySamples from the render thread and summarizes them.
+
+    The render thread calls addSample() once per new frame.  It only writes into
+    a fixed size single producer, single consumer ring, so it never blocks or
+    allocates; if the ring is full the sample is dropped and counted.  Another
+    thread (the message thread) periodically calls collectSamples() to move them
+    into a rolling window of recent frames and recompute the percentiles.
+*/
+class LatencyMonitor
+{
+public:
+    enum
+    {
+        /// summary index of the whole pipeline, after the per-stage ones.
+        kTotal       = LatencySample::kNumStages,
+        kNumSeries   = LatencySample::kNumStages + 1,
+        kWindowSize  = 1024
+    };
+
+    struct Summary
+    {
+        Summary()
+          : iNumSamples( 0 ),
+            iNumDropped( 0 )
+        {
+            zeromem( afP50Ms, sizeof (afP50Ms) );
+            zeromem( afP99Ms, sizeof (afP99Ms) );
+            zeromem( afMaxMs, sizeof (afMaxMs) );
+        }
+
+        int     iNumSamples;
+        int     iNumDropped;
+        float   afP50Ms[kNumSeries];
+        float   afP99Ms[kNumSeries];
+        float   afMaxMs[kNumSeries];
+    };
+
+    LatencyMonitor()
+      : m_iNumInWindow( 0 ),
+        m_iWindowNext( 0 )
+    {
+        m_aWindow.allocate( kWindowSize, true );
+        m_afSorted.allocate( kWindowSize, true );
+    }
+
+    //==============================================================================
+    /** Producer side: queues one frame's sample.  Returns false if it was dropped. */
+    bool addSample( const LatencySample& sample ) noexcept
+    {
+        const uint32 iWrite = m_iWriteCount.get();
+
+        if ( iWrite - m_iReadCount.get() >= static_cast<uint32>(kRingSize) )
+        {
+            ++m_iNumDropped;
+            return false;
+        }
+
+        m_aRing[iWrite & (kRingSize - 1)] = sample;
+        m_iWriteCount.set( iWrite + 1 );
+        return true;
+    }
+
+    //==============================================================================
+    /** Consumer side: takes everything queued since the last call into the window
+        and updates the summary.  Returns false if there was nothing new.
+    */
+    bool collectSamples()
+    {
+        uint32        iRead   = m_iReadCount.get();
+        const uint32  iWrite  = m_iWriteCount.get();
+
+        if ( iRead == iWrite )
+            return false;
+
+        for ( ; iRead != iWrite; ++iRead )
+        {
+            m_aWindow[m_iWindowNext] = m_aRing[iRead & (kRingSize - 1)];
+            m_iWindowNext  = (m_iWindowNext + 1) % kWindowSize;
+            m_iNumInWindow = jmin( m_iNumInWindow + 1, static_cast<int>(kWindowSize) );
+        }
+
+        m_iReadCount.set( iRead );
+
+        updateSummary();
+        return true;
+    }
+
+    /** Consumer side: empties the window, samples still in the ring are kept. */
+    void clearWindow()
+    {
+        m_iNumInWindow = 0;
+        m_iWindowNext  = 0;
+        m_summary      = Summary();
+    }
+
+    /** Consumer side: percentiles over the current window. */
+    const Summary& getSummary() const noexcept      { return m_summary; }
+
+    /** Consumer side: writes the window, oldest first, as CSV. */
+    bool writeToFile( const File& file ) const
+    {
+        String strCSV( "device_ms,capture_ms,queue_ms,render_ms,total_ms" );
+        strCSV << newLine;
+
+        const int iOldest = (m_iWindowNext - m_iNumInWindow + kWindowSize) % kWindowSize;
+
+        for ( int i = 0; i < m_iNumInWindow; i++ )
+        {
+            const LatencySample& sample = m_aWindow[(iOldest + i) % kWindowSize];
+
+            for ( int j = 0; j < LatencySample::kNumStages; j++ )
+                strCSV << String( sample.afStageMs[j], 3 ) << ",";
+
+            strCSV << String( sample.getTotalMs(), 3 ) << newLine;
+        }
+
+        return file.replaceWithText( strCSV );
+    }
+
+    /** Nearest-rank percentile of an ascending array, like FrameBenchmark::getPercentile(). */
+    static float getPercentile( const float* afSorted, int iCount, double fPercent ) noexcept
+    {
+        if ( iCount == 0 )
+            return 0.0f;
+
+        const int iRank = static_cast<int>(std::ceil( fPercent / 100.0 * iCount ));
+
+        return afSorted[jlimit( 0, iCount - 1, iRank - 1 )];
+    }
+
+private:
+    enum { kRingSize = 256 };
+
+    void updateSummary()
+    {
+        m_summary.iNumSamples = m_iNumInWindow;
+        m_summary.iNumDropped = m_iNumDropped.get();
+
+        for ( int iSeries = 0; iSeries < kNumSeries; iSeries++ )
+        {
+            for ( int i = 0; i < m_iNumInWindow; i++ )
+            {
+                const LatencySample& sample = m_aWindow[i];
+                m_afSorted[i] = (iSeries == kTotal) ? sample.getTotalMs() : sample.afStageMs[iSeries];
+            }
+
+            std::sort( m_afSorted.getData(), m_afSorted.getData() + m_iNumInWindow );
+
+            m_summary.afP50Ms[iSeries] = getPercentile( m_afSorted, m_iNumInWindow, 50.0 );
+            m_summary.afP99Ms[iSeries] = getPercentile( m_afSorted, m_iNumInWindow, 99.0 );
+            m_summary.afMaxMs[iSeries] = m_iNumInWindow > 0 ? m_afSorted[m_iNumInWindow - 1] : 0.0f;
+        }
+    }
+
+    // ring, shared by both threads
+    LatencySample       m_aRing[kRingSize];
+    Atomic<uint32>      m_iWriteCount;      // advanced by the producer
+    Atomic<uint32>      m_iReadCount;       // advanced by the consumer
+    Atomic<int>         m_iNumDropped;
+
+    // window, owned by the consumer
+    HeapBlock<LatencySample> m_aWindow;
+    HeapBlock<float>    m_afSorted;
+    int                 m_iNumInWindow;
+    int                 m_iWindowNext;
+    Summary             m_summary;
+
+    JUCE_DECLARE_NON_COPYABLE (LatencyMonitor)
+};
+
+#endif // FINGERVISUALIZER_LATENCYMONITOR_H_INCLUDED
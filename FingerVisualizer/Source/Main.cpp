@@ -9,11 +9,85 @@
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "Leap.h"
 #include "LeapUtilGL.h"
+#include "FrameSnapshot.h"
+#include "FrameMailbox.h"
+#include "FramePipeline.h"
+#include "FrameTrace.h"
+#include "FrameStream.h"
+#include "SyntheticHands.h"
+#include "FrameBenchmark.h"
+#include "SceneShading.h"
+#include "SkeletonDetail.h"
+#include "SkeletonRenderer.h"
+#include "GridBackdrop.h"
+#include "HudOverlay.h"
+#include "LatencyMonitor.h"
+#include "FrameProfiler.h"
+#include "RenderScheduler.h"
+#include "HandPredictor.h"
+#include "JointFilter.h"
+#include "GestureEngine.h"
+#include "TrailRenderer.h"
+#include "ViewLayout.h"
 #include <cctype>
+#include <cstdlib>
+#include <new>
+
+// replacing the global allocation functions costs every allocation an atomic
+// increment, so it is left to benchmark builds to turn this on.
+#ifndef FINGERVISUALIZER_COUNT_ALLOCATIONS
+ #define FINGERVISUALIZER_COUNT_ALLOCATIONS 0
+#endif
 
 class FingerVisualizerWindow;
 class OpenGLCanvas;
 
+//==============================================================================
+Atomic<int64> AllocationCounter::s_numAllocations;
+
+#if FINGERVISUALIZER_COUNT_ALLOCATIONS
+
+bool AllocationCounter::isEnabled() noexcept    { return true; }
+
+// every heap allocation in the process comes through here, so the benchmark can
+// report allocations per frame.
+static void* countedAllocate( std::size_t iSize ) noexcept
+{
+    AllocationCounter::increment();
+    return std::malloc( iSize > 0 ? iSize : 1 );
+}
+
+void* operator new( std::size_t iSize )
+{
+    if ( void* p = countedAllocate( iSize ) )
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[]( std::size_t iSize )
+{
+    if ( void* p = countedAllocate( iSize ) )
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new( std::size_t iSize, const std::nothrow_t& ) noexcept      { return countedAllocate( iSize ); }
+void* operator new[]( std::size_t iSize, const std::nothrow_t& ) noexcept    { return countedAllocate( iSize ); }
+void operator delete( void* p ) noexcept                                      { std::free( p ); }
+void operator delete[]( void* p ) noexcept                                    { std::free( p ); }
+void operator delete( void* p, const std::nothrow_t& ) noexcept               { std::free( p ); }
+void operator delete[]( void* p, const std::nothrow_t& ) noexcept             { std::free( p ); }
+void operator delete( void* p, std::size_t ) noexcept                         { std::free( p ); }
+void operator delete[]( void* p, std::size_t ) noexcept                       { std::free( p ); }
+
+#else
+
+bool AllocationCounter::isEnabled() noexcept    { return false; }
+
+#endif
+
 // intermediate class for convenient conversion from JUCE color
 // to float vector argument passed to GL functions
 struct GLColor  : public LeapUtilGL::GLVector4fv
@@ -32,12 +106,192 @@ struct GLColor  : public LeapUtilGL::GLVector4fv
   {}
 };
 
+// same skeleton as LeapUtilGL::drawSkeletonHand, drawn from a captured HandSnapshot
+static void drawSkeletonHand( const HandSnapshot& hand, const GLColor& vBoneColor, const GLColor& vJointColor )
+{
+    static const float kfJointRadiusScale = 0.75f;
+    static const float kfBoneRadiusScale  = 0.5f;
+    static const float kfPalmRadiusScale  = 1.15f;
+
+    LeapUtilGL::GLAttribScope colorScope( GL_CURRENT_BIT | GL_LIGHTING_BIT );
+
+    float         fRadius = 0.0f;
+    Leap::Vector  vLastBoxBase = hand.vWrist;
+
+    for ( int i = 0; i < HandSnapshot::kNumFingers; i++ )
+    {
+        const FingerSnapshot& finger = hand.aFingers[i];
+
+        fRadius = finger.fWidth * 0.5f;
+
+        // skip the metacarpal, a box around the metacarpals is drawn instead.
+        for ( int j = 2; j < FingerSnapshot::kNumJoints; j++ )
+        {
+            glColor4fv( vBoneColor );
+            LeapUtilGL::drawCylinder( LeapUtilGL::kStyle_Solid, finger.avJoints[j - 1], finger.avJoints[j], kfBoneRadiusScale * fRadius );
+            glColor4fv( vJointColor );
+            LeapUtilGL::drawSphere( LeapUtilGL::kStyle_Solid, finger.avJoints[j], kfJointRadiusScale * fRadius );
+        }
+
+        // segment of the metacarpal box
+        const Leap::Vector& vCurBoxBase = finger.avJoints[1];
+
+        glColor4fv( vBoneColor );
+        LeapUtilGL::drawCylinder( LeapUtilGL::kStyle_Solid, vCurBoxBase, vLastBoxBase, kfBoneRadiusScale * fRadius );
+        glColor4fv( vJointColor );
+        LeapUtilGL::drawSphere( LeapUtilGL::kStyle_Solid, vCurBoxBase, kfJointRadiusScale * fRadius );
+
+        vLastBoxBase = vCurBoxBase;
+    }
+
+    // close the metacarpal box at the wrist
+    fRadius = hand.aFingers[0].fWidth * 0.5f;
+
+    glColor4fv( vBoneColor );
+    LeapUtilGL::drawCylinder( LeapUtilGL::kStyle_Solid, hand.vWrist, vLastBoxBase, kfBoneRadiusScale * fRadius );
+    glColor4fv( vJointColor );
+    LeapUtilGL::drawSphere( LeapUtilGL::kStyle_Solid, hand.vWrist, kfJointRadiusScale * fRadius );
+
+    // palm position
+    LeapUtilGL::drawSphere( LeapUtilGL::kStyle_Solid, hand.vPalmPosition, kfPalmRadiusScale * fRadius );
+}
+
+// the same skeleton for a hand that's only a few pixels across: bones as lines
+// and joints as points, the immediate mode stand-in for SkeletonRenderer's impostors.
+static void drawSkeletonHandImpostor( const HandSnapshot& hand, const GLColor& vBoneColor, const GLColor& vJointColor )
+{
+    LeapUtilGL::GLAttribScope attribScope( GL_CURRENT_BIT | GL_ENABLE_BIT | GL_POINT_BIT );
+
+    glDisable( GL_LIGHTING );
+
+    Leap::Vector vLastBoxBase = hand.vWrist;
+
+    glColor4fv( vBoneColor );
+    glBegin( GL_LINES );
+
+    for ( int i = 0; i < HandSnapshot::kNumFingers; i++ )
+    {
+        const FingerSnapshot& finger = hand.aFingers[i];
+
+        for ( int j = 1; j < FingerSnapshot::kNumJoints; j++ )
+        {
+            const Leap::Vector& vFrom = j == 1 ? vLastBoxBase : finger.avJoints[j - 1];
+
+            glVertex3f( vFrom.x, vFrom.y, vFrom.z );
+            glVertex3f( finger.avJoints[j].x, finger.avJoints[j].y, finger.avJoints[j].z );
+        }
+
+        vLastBoxBase = finger.avJoints[1];
+    }
+
+    glVertex3f( vLastBoxBase.x, vLastBoxBase.y, vLastBoxBase.z );
+    glVertex3f( hand.vWrist.x, hand.vWrist.y, hand.vWrist.z );
+    glEnd();
+
+    glPointSize( 3.0f );
+    glColor4fv( vJointColor );
+    glBegin( GL_POINTS );
+
+    for ( int i = 0; i < HandSnapshot::kNumFingers; i++ )
+    {
+        for ( int j = 1; j < FingerSnapshot::kNumJoints; j++ )
+            glVertex3f( hand.aFingers[i].avJoints[j].x, hand.aFingers[i].avJoints[j].y, hand.aFingers[i].avJoints[j].z );
+    }
+
+    glVertex3f( hand.vWrist.x, hand.vWrist.y, hand.vWrist.z );
+    glVertex3f( hand.vPalmPosition.x, hand.vPalmPosition.y, hand.vPalmPosition.z );
+    glEnd();
+}
+
+// flat, front-on version of drawSkeletonHand for the software renderer.  Leap
+// millimeters are mapped to pixels by fScale about the device position vOrigin.
+static void drawSkeletonHand2D( Graphics& g, const HandSnapshot& hand, const Point<float>& vOrigin, float fScale,
+                                const Colour& boneColor, const Colour& jointColor )
+{
+    struct Project
+    {
+        static Point<float> toScreen( const Leap::Vector& v, const Point<float>& vOrigin, float fScale )
+        {
+            return Point<float>( vOrigin.x + v.x * fScale, vOrigin.y - v.y * fScale );
+        }
+    };
+
+    Point<float> vLastBoxBase = Project::toScreen( hand.vWrist, vOrigin, fScale );
+
+    for ( int i = 0; i < HandSnapshot::kNumFingers; i++ )
+    {
+        const FingerSnapshot& finger  = hand.aFingers[i];
+        const float           fRadius = finger.fWidth * 0.5f * fScale;
+        Point<float>          vPrev   = Project::toScreen( finger.avJoints[1], vOrigin, fScale );
+
+        g.setColour( boneColor );
+        g.drawLine( Line<float>( vLastBoxBase, vPrev ), fRadius );
+        vLastBoxBase = vPrev;
+
+        for ( int j = 2; j < FingerSnapshot::kNumJoints; j++ )
+        {
+            const Point<float> vJoint = Project::toScreen( finger.avJoints[j], vOrigin, fScale );
+
+            g.setColour( boneColor );
+            g.drawLine( Line<float>( vPrev, vJoint ), fRadius );
+            g.setColour( jointColor );
+            g.fillEllipse( vJoint.x - fRadius, vJoint.y - fRadius, fRadius * 2.0f, fRadius * 2.0f );
+
+            vPrev = vJoint;
+        }
+    }
+
+    const Point<float> vPalm = Project::toScreen( hand.vPalmPosition, vOrigin, fScale );
+    const float        fPalmRadius = hand.aFingers[0].fWidth * 0.6f * fScale;
+
+    g.setColour( jointColor );
+    g.fillEllipse( vPalm.x - fPalmRadius, vPalm.y - fPalmRadius, fPalmRadius * 2.0f, fPalmRadius * 2.0f );
+}
+
+// renders the benchmark sequence into an image with the software renderer, on
+// the calling thread.  Used when asked to, or when OpenGL doesn't come up.
+static void runSoftwareBenchmark( FrameBenchmark& benchmark )
+{
+    const FrameBenchmark::Settings& settings = benchmark.getSettings();
+
+    Image                               image( Image::ARGB, settings.iWidth, settings.iHeight, true, SoftwareImageType() );
+    LowLevelGraphicsSoftwareRenderer    renderer( image );
+    Graphics                            g( renderer );
+
+    const Point<float>  vOrigin( settings.iWidth * 0.5f, settings.iHeight * 0.95f );
+    const float         fScale = settings.iHeight / 500.0f;
+
+    while ( !benchmark.isFinished() )
+    {
+        const FrameSnapshot& frame = benchmark.beginBenchmarkFrame();
+
+        g.fillAll( Colours::black );
+
+        for ( int i = 0; i < frame.iNumHands; i++ )
+        {
+            const HandSnapshot& hand = frame.aHands[i];
+
+            drawSkeletonHand2D( g, hand, vOrigin, fScale, Colours::darkgrey,
+                                Colour::fromHSV( (static_cast<uint32_t>(hand.iId) % 8) / 8.0f, 0.8f, 0.9f, 1.0f ) );
+        }
+
+        g.setColour( Colours::seagreen );
+        g.drawSingleLineText( String::formatted( "Frame: %d", static_cast<int>(frame.iFrameId) ), 10, 20 );
+
+        benchmark.endBenchmarkFrame();
+    }
+
+    benchmark.writeReport( "Software" );
+}
+
 //==============================================================================
-class FingerVisualizerApplication  : public JUCEApplication
+class FingerVisualizerApplication  : public JUCEApplication,
+                                     private Timer
 {
 public:
     //==============================================================================
     FingerVisualizerApplication()
+      : m_iBenchmarkStartMs( 0 )
     {
     }
 
@@ -89,483 +343,3629 @@ public:
     }
 
 private:
+    bool startBenchmark( const StringArray& astrArgs );
+    void finishSoftwareBenchmark();
+    void timerCallback();
+
     ScopedPointer<FingerVisualizerWindow>  m_pMainWindow; 
+    FrameBenchmark::Settings               m_benchmarkSettings;
+    uint32                                 m_iBenchmarkStartMs;
+};
+
+//==============================================================================
+/** FrameSource that captures frames from the Leap service on its listener thread. */
+class LeapFrameSource  : public FrameSource,
+                         private Leap::Listener
+{
+public:
+    LeapFrameSource()
+      : m_pConsumer( nullptr ),
+        m_bListening( false )
+    {
+    }
+
+    ~LeapFrameSource()
+    {
+        stop();
+    }
+
+    void start( FrameSnapshotConsumer& consumer )
+    {
+        stop();
+        m_pConsumer = &consumer;
+        FingerVisualizerApplication::getController().addListener( *this );
+        m_bListening = true;
+    }
+
+    void stop()
+    {
+        if ( m_bListening )
+        {
+          FingerVisualizerApplication::getController().removeListener( *this );
+          m_bListening = false;
+        }
+    }
+
+    String getDescription() const
+    {
+        return "Leap";
+    }
+
+private:
+    virtual void onFrame(const Leap::Controller& controller)
+    {
+        m_pConsumer->beginFrame().setFromFrame( controller.frame() );
+        m_pConsumer->endFrame();
+    }
+
+    FrameSnapshotConsumer*  m_pConsumer;
+    bool                    m_bListening;
+
+    JUCE_DECLARE_NON_COPYABLE (LeapFrameSource)
 };
 
 //==============================================================================
 class OpenGLCanvas  : public Component,
                       public OpenGLRenderer,
-                      Leap::Listener
+                      public FrameSnapshotConsumer,
+                      private GestureEngine::Listener,
+                      private Timer
 {
 public:
     OpenGLCanvas()
-      : Component( "OpenGLCanvas" )
+      : Component( "OpenGLCanvas" ),
+        m_sceneLighting( m_openGLContext ),
+        m_skeletonRenderer( m_openGLContext, FrameSnapshot::kMaxHands ),
+        m_gridBackdrop( m_openGLContext ),
+        m_trailRenderer( m_openGLContext, kMaxTrailHands, 1024 ),
+        m_gpuScopeTimer( m_frameProfiler ),
+        m_fUpdateFPS( 0.0f ),
+        m_fRenderFPS( 0.0f ),
+        m_framePipeline( *this ),
+        m_bShowHelp( false ),
+        m_bPaused( false ),
+        m_bImmediateMode( false ),
+        m_bSmoothing( false ),
+        m_predictionMode( kPrediction_Off ),
+        m_fPredictionDelayMs( 20.0f ),
+        m_bShowTrails( false ),
+        m_fTrailSeconds( 2.0f ),
+        m_iTrailSamples( 1024 ),
+        m_viewLayout( ViewLayout::kLayout_Single ),
+        m_gestureEvents( 16, FrameQueue<GestureEvent>::kDropOldest ),
+        m_bShowProfiler( false ),
+        m_bLevelOfDetail( true ),
+        m_iVertexBudget( 0 ),
+        m_predictorMode( kPrediction_Off ),
+        m_fRenderStartSeconds( 0.0 ),
+        m_iRenderEndTicks( 0 )
     {
         m_openGLContext.setRenderer (this);
-        m_openGLContext.setComponentPaintingEnabled (true);
+        // everything is drawn by renderOpenGL, painting the component would make
+        // the GL thread take the message manager lock on each repaint.
+        m_openGLContext.setComponentPaintingEnabled (false);
         m_openGLContext.attachTo (*this);
         setBounds( 0, 0, 1024, 768 );
 
         m_fLastUpdateTimeSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks());
         m_fLastRenderTimeSeconds = m_fLastUpdateTimeSeconds;
 
-        FingerVisualizerApplication::getController().addListener( *this );
-
         initColors();
 
         resetCamera();
 
-        setWantsKeyboardFocus( true );
+        for ( int i = 0; i < ViewLayout::kMaxViews; i++ )
+            ViewLayout::setupFixedCamera( static_cast<ViewLayout::ViewAngle>(i), m_aFixedCameras[i] );
 
-        m_bPaused = false;
+        setWantsKeyboardFocus( true );
 
         m_fFrameScale = 0.0075f;
         m_vFrameTranslation = Leap::Vector(0.0f, -2.0f, 0.5f);
 
-        m_bShowHelp = false;
-
         m_strHelp = "ESC - quit\n"
                     "h - Toggle help and frame rate display\n"
                     "p - Toggle pause\n"
+                    "r - Toggle recording a frame trace\n"
+                    "i - Toggle immediate mode hand drawing\n"
+                    "l - Write recent frame latencies to a file\n"
+                    "e - Cycle frame prediction: off, extrapolate, interpolate\n"
+                    "s - Toggle joint smoothing\n"
+                    "t - Toggle joint trails\n"
+                    "v - Toggle drawing per tracking frame or per display refresh\n"
+                    "q - Toggle one view or top, front, side and perspective views\n"
+                    "f - Toggle the frame-time profiler\n"
+                    "d - Toggle level of detail for small and distant hands\n"
                     "Mouse Drag  - Rotate camera\n"
                     "Mouse Wheel - Zoom camera\n"
                     "Arrow Keys  - Rotate camera\n"
                     "Space       - Reset camera";
 
         m_strPrompt = "Press 'h' for help";
+
+        m_gestureEngine.addListener( this );
+
+        setFrameSource( new LeapFrameSource() );
+
+        m_renderScheduler.noteActivity( getNowSeconds() );
+        updateRenderSchedule();
+
+        // picks up the latency samples measured on the render thread, and redraws while idle
+        startTimer( 250 );
     }
 
     ~OpenGLCanvas()
     {
-        FingerVisualizerApplication::getController().removeListener( *this );
+        stopTimer();
+        setFrameSource( nullptr );
+        stopRecording();
+        stopStreaming();
+        m_gestureEngine.removeListener( this );
         m_openGLContext.detach();
     }
 
-    void newOpenGLContextCreated()
+    //==============================================================================
+    /// starts writing every displayed frame to a trace file.
+    bool startRecording( const File& file )
     {
-        glEnable(GL_BLEND);
-        glEnable(GL_TEXTURE_2D);
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_BACK);
-        glFrontFace(GL_CCW);
+        ScopedPointer<FrameTraceWriter> pWriter( new FrameTraceWriter( file ) );
 
-        glEnable(GL_DEPTH_TEST);
-        glDepthMask(true);
-        glDepthFunc(GL_LESS);
+        if ( !pWriter->openedOk() )
+            return false;
 
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        {
+            const SpinLock::ScopedLockType recorderLock( m_recorderLock );
+            m_pRecorder.swapWith( pWriter );
+        }
 
-        glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
-        glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
-        glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
-        glEnable(GL_COLOR_MATERIAL);
-        glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
-        glShadeModel(GL_SMOOTH);
+        m_fileRecording = file;
+        publishRenderState();
+        return true;
+    }
 
-        glEnable(GL_LIGHTING);
+    void stopRecording()
+    {
+        ScopedPointer<FrameTraceWriter> pWriter;
 
-        m_fixedFont = Font("Courier New", 24, Font::plain );
+        {
+            const SpinLock::ScopedLockType recorderLock( m_recorderLock );
+            m_pRecorder.swapWith( pWriter );
+        }
+
+        if ( pWriter != nullptr )
+        {
+            Logger::writeToLog( "Recorded " + String( pWriter->getNumFramesWritten() ) + " frames to " + m_fileRecording.getFullPathName()
+                                + " (" + String( pWriter->getNumDroppedFrames() ) + " dropped)" );
+            pWriter = nullptr;
+            publishRenderState();
+        }
     }
 
-    void openGLContextClosing()
+    bool isRecording() const
     {
+        return m_pRecorder != nullptr;
     }
 
-    bool keyPressed( const KeyPress& keyPress )
+    //==============================================================================
+    /// starts serving every incoming frame to FrameStreamClients on the port.
+    bool startStreaming( int iPort )
     {
-      int iKeyCode = toupper(keyPress.getKeyCode());
+        stopStreaming();
 
-      if ( iKeyCode == KeyPress::escapeKey )
-      {
-        JUCEApplication::quit();
-        return true;
-      }
+        ScopedPointer<FrameStreamServer> pServer( new FrameStreamServer() );
 
-      if ( iKeyCode == KeyPress::upKey )
-      {
-        m_camera.RotateOrbit( 0, 0, LeapUtil::kfHalfPi * -0.05f );
-        return true;
-      }
+        if ( !pServer->start( iPort ) )
+            return false;
 
-      if ( iKeyCode == KeyPress::downKey )
-      {
-        m_camera.RotateOrbit( 0, 0, LeapUtil::kfHalfPi * 0.05f );
-        return true;
-      }
+        {
+            const SpinLock::ScopedLockType streamLock( m_streamLock );
+            m_pStreamServer.swapWith( pServer );
+        }
 
-      if ( iKeyCode == KeyPress::leftKey )
-      {
-        m_camera.RotateOrbit( 0, LeapUtil::kfHalfPi * -0.05f, 0 );
+        Logger::writeToLog( "Streaming frames on port " + String( iPort ) );
+        publishRenderState();
         return true;
-      }
+    }
 
-      if ( iKeyCode == KeyPress::rightKey )
-      {
-        m_camera.RotateOrbit( 0, LeapUtil::kfHalfPi * 0.05f, 0 );
-        return true;
-      }
+    void stopStreaming()
+    {
+        ScopedPointer<FrameStreamServer> pServer;
 
-      switch( iKeyCode )
-      {
-      case ' ':
-        resetCamera();
-        break;
-      case 'H':
-        m_bShowHelp = !m_bShowHelp;
-        break;
-      case 'P':
-        m_bPaused = !m_bPaused;
-        break;
-      default:
-        return false;
-      }
+        {
+            const SpinLock::ScopedLockType streamLock( m_streamLock );
+            m_pStreamServer.swapWith( pServer );
+        }
 
-      return true;
+        if ( pServer != nullptr )
+        {
+            Logger::writeToLog( "Streamed " + String( pServer->getStats().iNumFrames ) + " frames on port " + String( pServer->getPort() ) );
+            pServer = nullptr;
+            publishRenderState();
+        }
     }
 
-    void mouseDown (const MouseEvent& e)
+    bool isStreaming() const
     {
-        m_camera.OnMouseDown( LeapUtil::FromVector2( e.getPosition() ) );
+        return m_pStreamServer != nullptr;
     }
 
-    void mouseDrag (const MouseEvent& e)
+    /// replaces the frame source with frames streamed from another visualizer.
+    void connectToStream( const String& strHost, int iPort )
     {
-        m_camera.OnMouseMoveOrbit( LeapUtil::FromVector2( e.getPosition() ) );
-        m_openGLContext.triggerRepaint();
+        setFrameSource( new FrameStreamClient( strHost, iPort ) );
     }
 
-    void mouseWheelMove ( const MouseEvent& e,
-                          const MouseWheelDetails& wheel )
+    //==============================================================================
+    /// takes ownership of pNewSource and makes it the only thing delivering frames.
+    void setFrameSource( FrameSource* pNewSource )
     {
-      (void)e;
-      m_camera.OnMouseWheel( wheel.deltaY );
-      m_openGLContext.triggerRepaint();
+        // the old source has to stop before the new one starts delivering frames.
+        stopFrames();
+
+        m_pFrameSource = pNewSource;
+
+        // nothing is delivering or processing frames, so the estimator can be reset from here
+        m_deviceLatency.reset();
+        m_latencyMonitor.clearWindow();
+        m_jointFilter.reset();
+        m_gestureEngine.reset();
+
+        if ( m_pFrameSource != nullptr )
+            Logger::writeToLog( "Frame source: " + m_pFrameSource->getDescription() );
+
+        startFrames();
+        publishRenderState();
     }
 
-    void resized()
+    /// sets how many frames can wait for the processing thread, and what a full queue drops.
+    void setIngestQueue( int iSize, FrameQueue<FrameSnapshot>::OverflowPolicy policy )
     {
+        stopFrames();
+        m_framePipeline.setQueue( iSize, policy );
+        startFrames();
     }
 
-    void paint(Graphics&)
+    //==============================================================================
+    /// runs every frame through the JointFilter before it's drawn, recordings stay raw.
+    void setSmoothing( bool bSmoothing )
     {
+        m_bSmoothing = bSmoothing;
+        publishRenderState();
     }
 
-    void renderOpenGL2D() 
+    //==============================================================================
+    enum PredictionMode
+    {
+        /// draw each tracking frame as it arrives.
+        kPrediction_Off,
+        /// redraw every display refresh, extrapolating the hands to when it's shown.
+        kPrediction_Extrapolate,
+        /// redraw every display refresh, a fixed delay behind, blending between frames.
+        kPrediction_Interpolate,
+        kNumPredictionModes
+    };
+
+    /// with prediction on the context repaints every vsync instead of every tracking frame.
+    void setPredictionMode( PredictionMode mode )
     {
-        LeapUtilGL::GLAttribScope attribScope( GL_ENABLE_BIT );
+        m_predictionMode = mode;
+        updateRenderSchedule();
+        publishRenderState();
+    }
 
-        // when enabled text draws poorly.
-        glDisable(GL_CULL_FACE);
+    PredictionMode getPredictionMode() const      { return m_predictionMode; }
 
-        ScopedPointer<LowLevelGraphicsContext> glRenderer (createOpenGLGraphicsContext (m_openGLContext, getWidth(), getHeight()));
+    /// how far behind the display interpolation runs, ideally a little over one tracking frame.
+    void setPredictionDelay( float fDelayMs )
+    {
+        m_fPredictionDelayMs = jlimit( 0.0f, 1000.0f, fDelayMs );
+        publishRenderState();
+    }
 
-        if (glRenderer != nullptr)
-        {
-            Graphics g(*glRenderer.get());
+    //==============================================================================
+    /// draw per tracking frame or per display refresh, while anybody is using it.
+    void setRenderMode( RenderScheduler::Mode mode )
+    {
+        m_renderScheduler.setPreferredMode( mode );
+        updateRenderSchedule();
+        publishRenderState();
+    }
 
-            int iMargin   = 10;
-            int iFontSize = static_cast<int>(m_fixedFont.getHeight());
-            int iLineStep = iFontSize + (iFontSize >> 2);
-            int iBaseLine = 20;
-            Font origFont = g.getCurrentFont();
+    /// how long without hands or input before only redrawing a few times a second, zero never does.
+    void setIdleTimeout( double fSeconds )
+    {
+        m_renderScheduler.setIdleTimeout( fSeconds );
+        updateRenderSchedule();
+        publishRenderState();
+    }
 
-            const Rectangle<int>& rectBounds = getBounds();
+    //==============================================================================
+    /// fading trails behind every joint, of hands tracked within the last fSeconds.
+    void setShowTrails( bool bShowTrails )
+    {
+        m_bShowTrails = bShowTrails;
+        publishRenderState();
+    }
 
-            if ( m_bShowHelp )
-            {
-                g.setColour( Colours::seagreen );
-                g.setFont( static_cast<float>(iFontSize) );
+    /// how long trails last, and how many samples each keeps, which should cover
+    /// that long at the tracking rate.  Changing the sample count clears them.
+    void setTrailLength( float fSeconds, int iSamples )
+    {
+        m_fTrailSeconds = jlimit( 0.01f, 600.0f, fSeconds );
+        m_iTrailSamples = jlimit( static_cast<int>(TrailHistory::kMinCapacity), static_cast<int>(TrailHistory::kMaxCapacity), iSamples );
+        publishRenderState();
+    }
 
-                if ( !m_bPaused )
-                {
-                  g.drawSingleLineText( m_strUpdateFPS, iMargin, iBaseLine );
-                }
+    /// one view from the orbit camera, or four panes that add fixed top, front and side views.
+    void setViewLayout( ViewLayout::Layout layout )
+    {
+        m_viewLayout = layout;
+        publishRenderState();
+    }
 
-                g.drawSingleLineText( m_strRenderFPS, iMargin, iBaseLine + iLineStep );
+    /// coarser skeletons for hands that are small on screen, sprites for the smallest.
+    void setLevelOfDetail( bool bLevelOfDetail )
+    {
+        m_bLevelOfDetail = bLevelOfDetail;
+        publishRenderState();
+    }
 
-                g.setFont( m_fixedFont );
-                g.setColour( Colours::slateblue );
+    /// caps the vertices drawn for hands each frame by coarsening the smallest first, 0 for no cap.
+    void setVertexBudget( int iVertices )
+    {
+        m_iVertexBudget = jmax( 0, iVertices );
+        publishRenderState();
+    }
 
-                g.drawMultiLineText(  m_strHelp,
-                                      iMargin,
-                                      iBaseLine + iLineStep * 3,
-                                      rectBounds.getWidth() - iMargin*2 );
-            }
+    /// times the render, processing and message thread scopes and shows them in the overlay.
+    void setProfiling( bool bProfiling )
+    {
+        m_bShowProfiler = bProfiling;
+        m_frameProfiler.setEnabled( bProfiling );
 
-            g.setFont( origFont );
-            g.setFont( static_cast<float>(iFontSize) );
+        if ( !bProfiling )
+            m_profilerPanel = Image();
 
-            g.setColour( Colours::salmon );
-            g.drawMultiLineText(  m_strPrompt,
-                                  iMargin,
-                                  rectBounds.getBottom() - (iFontSize + iFontSize + iLineStep),
-                                  rectBounds.getWidth()/4 );
-        }
+        publishRenderState();
+    }
+
+    //==============================================================================
+    enum BenchmarkState
+    {
+        kBenchmark_Waiting,
+        kBenchmark_Running,
+        kBenchmark_Finished,
+        kBenchmark_Failed
+    };
+
+    /// stops the frame source and renders the benchmark sequence offscreen instead.
+    void runBenchmark( FrameBenchmark* pBenchmark )
+    {
+        setFrameSource( nullptr );
+
+        m_benchmarkState.set( kBenchmark_Waiting );
+        m_pBenchmark = pBenchmark;
+        publishRenderState();
+    }
+
+    BenchmarkState getBenchmarkState() const
+    {
+        return static_cast<BenchmarkState>(m_benchmarkState.get());
+    }
+
+    /// replaces the current frame source with frames played back from a trace file.
+    Result replayTrace( const File& file )
+    {
+        ScopedPointer<FrameTracePlayer> pPlayer( new FrameTracePlayer( file ) );
+
+        const FrameTraceReader& reader = pPlayer->getReader();
+
+        if ( !reader.openedOk() )
+            return Result::fail( reader.getLastError() );
+
+        if ( reader.getNumFrames() == 0 )
+            return Result::fail( file.getFileName() + " contains no frames" );
+
+        setFrameSource( pPlayer.release() );
+        return Result::ok();
+    }
+
+    //==============================================================================
+    /// writes the frames in the latency window to a CSV file and logs their summary.
+    bool writeLatencyLog( const File& file )
+    {
+        m_latencyMonitor.collectSamples();
+
+        if ( !m_latencyMonitor.writeToFile( file ) )
+            return false;
+
+        const LatencyMonitor::Summary& summary = m_latencyMonitor.getSummary();
+
+        Logger::writeToLog( "Latency over " + String( summary.iNumSamples ) + " frames: p50 "
+                            + String( summary.afP50Ms[LatencyMonitor::kTotal], 2 ) + " ms, p99 "
+                            + String( summary.afP99Ms[LatencyMonitor::kTotal], 2 ) + " ms, max "
+                            + String( summary.afMaxMs[LatencyMonitor::kTotal], 2 ) + " ms ("
+                            + String( summary.iNumDropped ) + " dropped), written to " + file.getFullPathName() );
+        return true;
+    }
+
+    void newOpenGLContextCreated()
+    {
+        // predicted frames are aimed at the next vsync
+        m_openGLContext.setSwapInterval( 1 );
+
+        glEnable(GL_BLEND);
+        glEnable(GL_TEXTURE_2D);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_BACK);
+        glFrontFace(GL_CCW);
+
+        glEnable(GL_DEPTH_TEST);
+        glDepthMask(true);
+        glDepthFunc(GL_LESS);
+
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
+        glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
+        glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
+
+        // the lights are set once per context, the shaders share them through
+        // one uniform block and immediate mode drawing through the fixed-function state.
+        if ( !m_sceneLighting.initialise() )
+            Logger::writeToLog( "GLSL 1.20 isn't available, the scene is drawn with the fixed-function pipeline" );
+        else if ( !m_sceneLighting.hasUniformBlock() )
+            Logger::writeToLog( "Uniform buffers aren't available, lights are copied into each shader" );
+
+        glEnable(GL_COLOR_MATERIAL);
+        glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
+        glShadeModel(GL_SMOOTH);
+        SceneLighting::applyToFixedFunction();
+
+        m_fixedFont = Font("Courier New", 24, Font::plain );
+
+        m_hudOverlay.initialise( m_fixedFont );
+
+        m_gridBackdrop.initialise( m_sceneLighting );
+
+        if ( !m_skeletonRenderer.initialise( m_sceneLighting ) )
+            Logger::writeToLog( "Instanced drawing isn't available, hands are drawn in immediate mode" );
+
+        if ( !m_trailRenderer.initialise( m_sceneLighting ) )
+            Logger::writeToLog( "GLSL 1.20 isn't available, joint trails are disabled" );
+
+        if ( !m_gpuScopeTimer.initialise() )
+            Logger::writeToLog( "Timer queries aren't available, the profiler only times the CPU" );
+    }
+
+    void openGLContextClosing()
+    {
+        m_gpuScopeTimer.release();
+        m_trailRenderer.release();
+        m_skeletonRenderer.release();
+        m_gridBackdrop.release();
+        m_sceneLighting.release();
+        m_hudOverlay.release();
+    }
+
+    bool keyPressed( const KeyPress& keyPress )
+    {
+      int iKeyCode = toupper(keyPress.getKeyCode());
+
+      if ( iKeyCode == KeyPress::escapeKey )
+      {
+        JUCEApplication::quit();
+        return true;
+      }
+
+      if ( iKeyCode == KeyPress::upKey )
+      {
+        m_camera.RotateOrbit( 0, 0, LeapUtil::kfHalfPi * -0.05f );
+        userActivity();
+        publishRenderState();
+        return true;
+      }
+
+      if ( iKeyCode == KeyPress::downKey )
+      {
+        m_camera.RotateOrbit( 0, 0, LeapUtil::kfHalfPi * 0.05f );
+        userActivity();
+        publishRenderState();
+        return true;
+      }
+
+      if ( iKeyCode == KeyPress::leftKey )
+      {
+        m_camera.RotateOrbit( 0, LeapUtil::kfHalfPi * -0.05f, 0 );
+        userActivity();
+        publishRenderState();
+        return true;
+      }
+
+      if ( iKeyCode == KeyPress::rightKey )
+      {
+        m_camera.RotateOrbit( 0, LeapUtil::kfHalfPi * 0.05f, 0 );
+        userActivity();
+        publishRenderState();
+        return true;
+      }
+
+      switch( iKeyCode )
+      {
+      case ' ':
+        resetCamera();
+        break;
+      case 'H':
+        m_bShowHelp = !m_bShowHelp;
+        break;
+      case 'P':
+        m_bPaused = !m_bPaused;
+        break;
+      case 'I':
+        m_bImmediateMode = !m_bImmediateMode;
+        break;
+      case 'S':
+        m_bSmoothing = !m_bSmoothing;
+        break;
+      case 'T':
+        m_bShowTrails = !m_bShowTrails;
+        break;
+      case 'Q':
+        m_viewLayout = static_cast<ViewLayout::Layout>((m_viewLayout + 1) % ViewLayout::kNumLayouts);
+        break;
+      case 'V':
+        m_renderScheduler.setPreferredMode( m_renderScheduler.getPreferredMode() == RenderScheduler::kMode_TrackDriven
+                                              ? RenderScheduler::kMode_DisplayLocked : RenderScheduler::kMode_TrackDriven );
+        break;
+      case 'D':
+        m_bLevelOfDetail = !m_bLevelOfDetail;
+        break;
+      case 'F':
+        setProfiling( !m_bShowProfiler );
+        break;
+      case 'E':
+        setPredictionMode( static_cast<PredictionMode>((m_predictionMode + 1) % kNumPredictionModes) );
+        break;
+      case 'L':
+        writeLatencyLog( File::getSpecialLocation( File::userDocumentsDirectory )
+                           .getNonexistentChildFile( "FingerVisualizerLatency", ".csv" ) );
+        break;
+      case 'R':
+        if ( isRecording() )
+          stopRecording();
+        else
+          startRecording( File::getSpecialLocation( File::userDocumentsDirectory )
+                            .getNonexistentChildFile( "FingerVisualizer", ".lfvt" ) );
+        break;
+      default:
+        return false;
+      }
+
+      userActivity();
+      publishRenderState();
+
+      return true;
+    }
+
+    void mouseDown (const MouseEvent& e)
+    {
+        m_camera.OnMouseDown( LeapUtil::FromVector2( e.getPosition() ) );
+
+        if ( userActivity() )
+            publishRenderState();
+    }
+
+    void mouseDrag (const MouseEvent& e)
+    {
+        m_camera.OnMouseMoveOrbit( LeapUtil::FromVector2( e.getPosition() ) );
+        userActivity();
+        publishRenderState();
+    }
+
+    void mouseWheelMove ( const MouseEvent& e,
+                          const MouseWheelDetails& wheel )
+    {
+      (void)e;
+      m_camera.OnMouseWheel( wheel.deltaY );
+      userActivity();
+      publishRenderState();
+    }
+
+    void resized()
+    {
+        publishRenderState();
+    }
+
+    /// copies the state owned by the message thread over to the render thread.
+    void publishRenderState()
+    {
+        RenderState& state = m_renderStateMailbox.getWriteBuffer();
+
+        state.camera    = m_camera;
+        state.iWidth    = jmax( getWidth(), 1 );
+        state.iHeight   = jmax( getHeight(), 1 );
+        state.bShowHelp = m_bShowHelp;
+        state.bPaused   = m_bPaused;
+        state.bImmediateMode = m_bImmediateMode;
+        state.bRecording = isRecording();
+        state.pBenchmark = m_pBenchmark;
+        state.strSource  = m_pFrameSource != nullptr ? m_pFrameSource->getDescription() : String::empty;
+        state.predictionMode = m_predictionMode;
+        state.fPredictionDelaySeconds = m_fPredictionDelayMs * 0.001;
+        state.bShowTrails    = m_bShowTrails;
+        state.fTrailSeconds  = m_fTrailSeconds;
+        state.iTrailSamples  = m_iTrailSamples;
+        state.viewLayout     = m_viewLayout;
+        state.strGestures    = m_strGestures;
+        state.profilerPanel  = m_profilerPanel;
+        state.bLevelOfDetail = m_bLevelOfDetail;
+        state.iVertexBudget  = m_iVertexBudget;
+
+        if ( m_bSmoothing )
+            state.strSource << ", smoothed";
+
+        if ( !m_bLevelOfDetail )
+            state.strSource << ", full detail";
+        else if ( m_iVertexBudget > 0 )
+            state.strSource << ", " << m_iVertexBudget << " hand vertices at most";
+
+        if ( m_predictionMode == kPrediction_Extrapolate )
+            state.strSource << ", extrapolated to vsync";
+        else if ( m_predictionMode == kPrediction_Interpolate )
+            state.strSource << ", interpolated " << String( m_fPredictionDelayMs, 1 ) << " ms behind";
+
+        state.strSource << ", " << RenderScheduler::getModeName( m_renderScheduler.getMode() );
+
+        if ( m_pStreamServer != nullptr )
+            state.strSource << ", streaming to " << m_pStreamServer->getNumClients() << " (" << m_pStreamServer->getStats().toString() << " round trip)";
+
+        state.latency    = m_latencyMonitor.getSummary();
+
+        m_renderStateMailbox.publish();
+        m_openGLContext.triggerRepaint();
+    }
+
+    void paint(Graphics&)
+    {
+    }
+
+    void renderOpenGL2D() 
+    {
+        const ScopedProfile profile( m_frameProfiler, FrameProfiler::kScope_Overlay, &m_gpuScopeTimer );
+
+        HudOverlay::Content content;
+
+        content.iWidth          = m_renderState.iWidth;
+        content.iHeight         = m_renderState.iHeight;
+        content.bShowHelp       = m_renderState.bShowHelp;
+        content.bShowUpdateFPS  = !m_renderState.bPaused;
+        content.bRecording      = m_renderState.bRecording;
+        content.iViewLayout     = m_renderState.viewLayout;
+        content.strSource       = m_renderState.strSource;
+        content.strGestures     = m_renderState.strGestures;
+        content.strHelp         = m_strHelp;
+        content.strPrompt       = m_strPrompt;
+
+        const LatencyMonitor::Summary& latency = m_renderState.latency;
+        HudOverlay::Values values;
+
+        values.fUpdateFPS       = m_fUpdateFPS;
+        values.fRenderFPS       = m_fRenderFPS;
+        values.fLatencyP50Ms    = latency.afP50Ms[LatencyMonitor::kTotal];
+        values.fLatencyP99Ms    = latency.afP99Ms[LatencyMonitor::kTotal];
+        values.fLatencyMaxMs    = latency.afMaxMs[LatencyMonitor::kTotal];
+
+        m_hudOverlay.draw( content, values, m_renderState.profilerPanel );
     }
 
     //
     // calculations that should only be done once per leap data frame but may be drawn many times should go here.
+    // runs on the processing thread, results must be stored in the frame to reach the render thread.
     //   
-    void update( Leap::Frame frame )
+    void update( FrameSnapshot& frame )
+    {
+        double curSysTimeSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks());
+
+        float deltaTimeSeconds = static_cast<float>(curSysTimeSeconds - m_fLastUpdateTimeSeconds);
+      
+        m_fLastUpdateTimeSeconds = curSysTimeSeconds;
+        float fUpdateDT = m_avgUpdateDeltaTime.AddSample( deltaTimeSeconds );
+        frame.fUpdateFPS = (fUpdateDT > 0) ? 1.0f/fUpdateDT : 0.0f;
+    }
+
+    /// clears the current viewport, only as far as the scissor rectangle allows,
+    /// and returns the camera's matrices for the shaders.  no GL matrix or light
+    /// state is touched, that is set once per context.
+    SceneTransform setupScene( LeapUtilGL::CameraGL& camera, float fAspectRatio )
+    {
+        OpenGLHelpers::clear (Colours::black.withAlpha (1.0f));
+
+        camera.SetAspectRatio( fAspectRatio );
+
+        return SceneTransform( camera );
+    }
+
+    // data should be drawn here but no heavy calculations done.
+    // any major calculations that only need to be updated per leap data frame
+    // should be handled in update and cached in members.
+    // runs on the GL thread and never takes the message manager lock, anything
+    // it needs from the message thread arrives by value through publishRenderState.
+    void renderOpenGL()
+    {
+        if ( m_renderStateMailbox.acquire() )
+        {
+            m_renderState = m_renderStateMailbox.getReadBuffer();
+        }
+
+        if ( m_renderState.pBenchmark != nullptr )
+        {
+            renderBenchmark( *m_renderState.pBenchmark );
+            return;
+        }
+
+        const bool    bNewFrame         = m_frameMailbox.acquire();
+        const int64   iRenderStartTicks = Time::getHighResolutionTicks();
+
+        m_fRenderStartSeconds = Time::highResolutionTicksToSeconds( iRenderStartTicks );
+
+        // JUCE swaps the buffers right after this returns, without a hook around
+        // the swap, so it's timed together with any wait for the next repaint.
+        if ( m_frameProfiler.isEnabled() )
+        {
+            if ( m_iRenderEndTicks != 0 )
+                m_frameProfiler.addEvent( FrameProfiler::kScope_Swap, m_iRenderEndTicks, iRenderStartTicks );
+
+            m_gpuScopeTimer.beginFrame();
+        }
+
+        {
+            const ScopedProfile profile( m_frameProfiler, FrameProfiler::kScope_Render, &m_gpuScopeTimer );
+
+            updateTrails( m_frameMailbox.getReadBuffer(), bNewFrame );
+
+            renderFrame( getFrameToDraw( m_frameMailbox.getReadBuffer(), bNewFrame, iRenderStartTicks ) );
+        }
+
+        if ( bNewFrame )
+            addLatencySample( m_frameMailbox.getReadBuffer(), iRenderStartTicks );
+
+        m_iRenderEndTicks = m_frameProfiler.isEnabled() ? Time::getHighResolutionTicks() : 0;
+    }
+
+    /// the newest tracking frame, or the hands predicted for when this render reaches the display.
+    const FrameSnapshot& getFrameToDraw( const FrameSnapshot& frame, bool bNewFrame, int64 iRenderStartTicks )
+    {
+        if ( m_renderState.predictionMode != m_predictorMode )
+        {
+            m_predictorMode = m_renderState.predictionMode;
+            m_predictor.reset();
+        }
+
+        if ( m_predictorMode == kPrediction_Off )
+            return frame;
+
+        // frames are placed at their device time, mapped to the host clock, so
+        // the gaps between them don't include delivery jitter.
+        if ( bNewFrame || m_predictor.getNumTracks() == 0 )
+            m_predictor.addFrame( frame, Time::highResolutionTicksToSeconds( frame.iReceivedTicks ) - frame.fDeviceLatencyMs * 0.001 );
+
+        // the frame goes up at the next vsync, about one render interval from now
+        const double fRenderInterval = m_fRenderFPS > 0.0f ? jmin( 1.0 / m_fRenderFPS, 0.05 ) : 0.0;
+        double       fTarget         = Time::highResolutionTicksToSeconds( iRenderStartTicks ) + fRenderInterval;
+
+        if ( m_predictorMode == kPrediction_Interpolate )
+            fTarget -= m_renderState.fPredictionDelaySeconds;
+
+        m_predictedFrame.iFrameId   = frame.iFrameId;
+        m_predictedFrame.iTimestamp = frame.iTimestamp;
+        m_predictedFrame.fUpdateFPS = frame.fUpdateFPS;
+
+        m_predictor.predictFrame( fTarget, m_predictedFrame );
+
+        return m_predictedFrame;
+    }
+
+    /// adds each tracking frame to the trails once, at the time it arrived.
+    void updateTrails( const FrameSnapshot& frame, bool bNewFrame )
+    {
+        TrailHistory& history = m_trailRenderer.getHistory();
+
+        // turning trails back on starts them from scratch
+        if ( !m_renderState.bShowTrails )
+        {
+            history.reset();
+            return;
+        }
+
+        if ( m_renderState.iTrailSamples != history.getCapacity() )
+            m_trailRenderer.setSamplesPerTrail( m_renderState.iTrailSamples );
+
+        if ( bNewFrame )
+            history.addFrame( frame, Time::highResolutionTicksToSeconds( frame.iReceivedTicks ), m_renderState.fTrailSeconds );
+    }
+
+    /// measures the stages the frame went through, the first time it's drawn.
+    void addLatencySample( const FrameSnapshot& frame, int64 iRenderStartTicks )
+    {
+        if ( frame.iPublishedTicks == 0 )
+            return;
+
+        LatencySample sample;
+
+        sample.afStageMs[LatencySample::kStage_Device]  = frame.fDeviceLatencyMs;
+        sample.afStageMs[LatencySample::kStage_Capture] = ticksToMs( frame.iPublishedTicks - frame.iReceivedTicks );
+        sample.afStageMs[LatencySample::kStage_Queue]   = ticksToMs( iRenderStartTicks - frame.iPublishedTicks );
+        sample.afStageMs[LatencySample::kStage_Render]  = ticksToMs( Time::getHighResolutionTicks() - iRenderStartTicks );
+
+        m_latencyMonitor.addSample( sample );
+    }
+
+    static float ticksToMs( int64 iTicks )
+    {
+        return static_cast<float>(Time::highResolutionTicksToSeconds( iTicks ) * 1000.0);
+    }
+
+    /// draws one frame of hands, with the grids and overlay, into the current frame buffer.
+    void renderFrame( const FrameSnapshot& frame )
+    {
+        m_fUpdateFPS = frame.fUpdateFPS;
+
+        double  curSysTimeSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks());
+        float   fRenderDT = static_cast<float>(curSysTimeSeconds - m_fLastRenderTimeSeconds);
+        fRenderDT = m_avgRenderDeltaTime.AddSample( fRenderDT );
+        m_fLastRenderTimeSeconds = curSysTimeSeconds;
+
+        m_fRenderFPS = (fRenderDT > 0) ? 1.0f/fRenderDT : 0.0f;
+
+        const ViewLayout::Layout layout    = m_renderState.viewLayout;
+        const int                iNumViews = ViewLayout::getNumViews( layout );
+
+        // the viewport JUCE or the benchmark set up, in pixels rather than component units
+        GLint aiViewport[4];
+        glGetIntegerv( GL_VIEWPORT, aiViewport );
+
+        // the hands are batched once and every view draws the same buffers
+        chooseHandDetail( frame, layout, aiViewport );
+        prepareHands( frame );
+
+        /// JUCE turns off the depth test every frame when calling paint.
+        glEnable(GL_DEPTH_TEST);
+        glDepthMask(true);
+        glDepthFunc(GL_LESS);
+        glEnable(GL_BLEND);
+
+        if ( iNumViews > 1 )
+        {
+            // the gaps between the panes
+            OpenGLHelpers::clear( Colours::darkgrey );
+            glEnable( GL_SCISSOR_TEST );
+        }
+
+        for ( int i = 0; i < iNumViews; i++ )
+        {
+            const Rectangle<int> pane  = ViewLayout::getViewBounds( layout, i, aiViewport[2], aiViewport[3] );
+            const GLint          iX    = aiViewport[0] + pane.getX();
+            const GLint          iY    = aiViewport[1] + aiViewport[3] - pane.getBottom();
+
+            glViewport( iX, iY, pane.getWidth(), pane.getHeight() );
+            glScissor( iX, iY, pane.getWidth(), pane.getHeight() );
+
+            drawView( frame, getViewCamera( layout, i ), pane.getWidth() / static_cast<float>(pane.getHeight()) );
+        }
+
+        if ( iNumViews > 1 )
+        {
+            glDisable( GL_SCISSOR_TEST );
+            glViewport( aiViewport[0], aiViewport[1], aiViewport[2], aiViewport[3] );
+        }
+
+        // draw the text overlay
+        renderOpenGL2D();
+    }
+
+    /// draws the scene from one camera into the current viewport.
+    void drawView( const FrameSnapshot& frame, LeapUtilGL::CameraGL& camera, float fAspectRatio )
+    {
+        SceneTransform scene;
+
+        {
+            const ScopedProfile profile( m_frameProfiler, FrameProfiler::kScope_SetupScene, &m_gpuScopeTimer );
+            scene = setupScene( camera, fAspectRatio );
+        }
+
+        {
+            const ScopedProfile profile( m_frameProfiler, FrameProfiler::kScope_Grid, &m_gpuScopeTimer );
+
+            // draw the grid background
+            static const GLfloat afGridColor[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+
+            m_gridBackdrop.draw( scene, afGridColor );
+        }
+
+        {
+            const ScopedProfile profile( m_frameProfiler, FrameProfiler::kScope_Hands, &m_gpuScopeTimer );
+
+            // draw fingers/tools as lines with sphere at the tip.
+            drawHands( frame, scene.withModel( m_vFrameTranslation, m_fFrameScale ) );
+        }
+    }
+
+    /// runs the whole benchmark in one go on the GL thread, into an offscreen target.
+    void renderBenchmark( FrameBenchmark& benchmark )
+    {
+        if ( m_benchmarkState.get() != kBenchmark_Waiting )
+            return;
+
+        const FrameBenchmark::Settings& settings = benchmark.getSettings();
+
+        OpenGLFrameBuffer frameBuffer;
+
+        if ( !frameBuffer.initialise( m_openGLContext, settings.iWidth, settings.iHeight ) )
+        {
+            Logger::writeToLog( "Can't create a " + String( settings.iWidth ) + "x" + String( settings.iHeight ) + " offscreen target" );
+            m_benchmarkState.set( kBenchmark_Failed );
+            return;
+        }
+
+        m_benchmarkState.set( kBenchmark_Running );
+
+        // the offscreen target has the benchmark's size whatever the window's is,
+        // and the overlay is drawn so its cost is included.
+        m_renderState.iWidth    = settings.iWidth;
+        m_renderState.iHeight   = settings.iHeight;
+        m_renderState.bShowHelp = true;
+        m_renderState.bPaused   = false;
+        m_renderState.bShowTrails = false;
+        m_renderState.viewLayout  = ViewLayout::kLayout_Single;
+
+        while ( !benchmark.isFinished() )
+        {
+            const FrameSnapshot& frame = benchmark.beginBenchmarkFrame();
+
+            frameBuffer.makeCurrentRenderingTarget();
+            glViewport( 0, 0, settings.iWidth, settings.iHeight );
+
+            renderFrame( frame );
+
+            benchmark.endBenchmarkFrame();
+        }
+
+        glFinish();
+        frameBuffer.releaseAsRenderingTarget();
+
+        benchmark.writeReport( "OpenGL " + String( reinterpret_cast<const char*>(glGetString( GL_RENDERER )) )
+                                 + (m_skeletonRenderer.isAvailable() && !m_renderState.bImmediateMode ? ", instanced" : ", immediate mode") );
+
+        m_benchmarkState.set( kBenchmark_Finished );
+    }
+
+    LeapUtilGL::CameraGL& getViewCamera( ViewLayout::Layout layout, int iView )
+    {
+        const ViewLayout::ViewAngle angle = ViewLayout::getViewAngle( layout, iView );
+
+        return angle == ViewLayout::kView_Perspective ? m_renderState.camera : m_aFixedCameras[angle];
+    }
+
+    /// picks each hand's level of detail from the largest it appears in any view,
+    /// so one batch serves every view.
+    void chooseHandDetail( const FrameSnapshot& frame, ViewLayout::Layout layout, const GLint* aiViewport )
+    {
+        float afPixels[FrameSnapshot::kMaxHands];
+
+        for ( int i = 0; i < frame.iNumHands; i++ )
+            afPixels[i] = 0.0f;
+
+        for ( int iView = 0; iView < ViewLayout::getNumViews( layout ); iView++ )
+        {
+            const Rectangle<int>    pane   = ViewLayout::getViewBounds( layout, iView, aiViewport[2], aiViewport[3] );
+            LeapUtilGL::CameraGL&   camera = getViewCamera( layout, iView );
+
+            camera.SetAspectRatio( pane.getWidth() / static_cast<float>(pane.getHeight()) );
+
+            const SceneTransform transform = SceneTransform( camera ).withModel( m_vFrameTranslation, m_fFrameScale );
+
+            for ( int i = 0; i < frame.iNumHands; i++ )
+                afPixels[i] = jmax( afPixels[i], SkeletonDetail::getProjectedJointRadius( frame.aHands[i], transform, pane.getHeight() ) );
+        }
+
+        m_skeletonDetail.setEnabled( m_renderState.bLevelOfDetail );
+        m_skeletonDetail.setVertexBudget( m_renderState.iVertexBudget );
+        m_skeletonDetail.chooseLevels( afPixels, frame.iNumHands, m_aHandLevels );
+    }
+
+    bool isBatchingHands() const
+    {
+        return m_skeletonRenderer.isAvailable() && !m_renderState.bImmediateMode;
+    }
+
+    /// collects the frame's hands for the skeleton renderer, once however many views draw them.
+    void prepareHands( const FrameSnapshot& frame )
+    {
+        if ( !isBatchingHands() )
+            return;
+
+        m_skeletonRenderer.beginFrame();
+
+        for ( int i = 0; i < frame.iNumHands; i++ )
+        {
+            const HandSnapshot& hand        = frame.aHands[i];
+            const uint32_t      colorIndex  = static_cast<uint32_t>(hand.iId) % kNumColors;
+
+            m_skeletonRenderer.addHand( hand, m_vBoneColor, m_avJointColors[colorIndex], m_aHandLevels[i] );
+        }
+    }
+
+    void drawHands( const FrameSnapshot& frame, const SceneTransform& transform )
+    {
+        if ( isBatchingHands() )
+        {
+            m_skeletonRenderer.draw( transform );
+        }
+        else
+        {
+            // immediate mode takes the same matrices through the fixed-function stacks
+            LeapUtilGL::GLMatrixScope matrixScope;
+            LeapUtilGL::GLAttribScope lightingScope( GL_ENABLE_BIT );
+
+            transform.loadIntoFixedFunction();
+            glEnable( GL_LIGHTING );
+
+            for ( int i = 0; i < frame.iNumHands; i++ )
+            {
+                const HandSnapshot& hand        = frame.aHands[i];
+                const uint32_t      colorIndex  = static_cast<uint32_t>(hand.iId) % kNumColors;
+
+                // LeapUtilGL's meshes have one tessellation, so only impostors differ here
+                if ( m_aHandLevels[i] == SkeletonDetail::kLevel_Impostor )
+                    drawSkeletonHandImpostor( hand, m_vBoneColor, m_avJointColors[colorIndex] );
+                else
+                    drawSkeletonHand( hand, m_vBoneColor, m_avJointColors[colorIndex] );
+            }
+        }
+
+        if ( m_renderState.bShowTrails )
+            drawTrails( transform );
+    }
+
+    /// drawn after the hands, blended over them without hiding each other.
+    void drawTrails( const SceneTransform& transform )
+    {
+        const ScopedProfile profile( m_frameProfiler, FrameProfiler::kScope_Trails, &m_gpuScopeTimer );
+        LeapUtilGL::GLAttribScope depthScope( GL_DEPTH_BUFFER_BIT );
+
+        glDepthMask( GL_FALSE );
+
+        const GLfloat* apfColors[kNumColors];
+
+        for ( int i = 0; i < kNumColors; i++ )
+            apfColors[i] = m_avJointColors[i];
+
+        m_trailRenderer.draw( transform, m_fRenderStartSeconds, m_renderState.fTrailSeconds, apfColors, kNumColors );
+    }
+
+    // FrameSnapshotConsumer - frames arrive from the FramePipeline's processing thread,
+    // which may call beginFrame() without an endFrame() when its queue turns out empty.
+    virtual FrameSnapshot& beginFrame()
+    {
+        return m_frameMailbox.getWriteBuffer();
+    }
+
+    virtual void endFrame()
+    {
+        if ( m_bPaused )
+          return;
+
+        const ScopedProfile profile( m_frameProfiler, FrameProfiler::kScope_Ingest );
+
+        FrameSnapshot& frame = m_frameMailbox.getWriteBuffer();
+
+        update( frame );
+
+        {
+          // only contended while recording is being started or stopped, skip the frame rather than wait.
+          const GenericScopedTryLock<SpinLock> recorderLock( m_recorderLock );
+
+          if ( recorderLock.isLocked() && m_pRecorder != nullptr )
+            m_pRecorder->addFrame( frame );
+        }
+
+        {
+          const GenericScopedTryLock<SpinLock> streamLock( m_streamLock );
+
+          if ( streamLock.isLocked() && m_pStreamServer != nullptr )
+            m_pStreamServer->addFrame( frame );
+        }
+
+        {
+          const ScopedProfile filterProfile( m_frameProfiler, FrameProfiler::kScope_Filter );
+
+          // the filter starts over whenever it's turned back on
+          if ( m_bSmoothing )
+            m_jointFilter.process( frame );
+          else
+            m_jointFilter.reset();
+        }
+
+        {
+          const ScopedProfile gestureProfile( m_frameProfiler, FrameProfiler::kScope_Gestures );
+
+          // gestures are recognized from what's drawn, smoothed or not
+          m_gestureEngine.process( frame, Time::highResolutionTicksToSeconds( frame.iReceivedTicks ) );
+        }
+
+        frame.fDeviceLatencyMs = m_deviceLatency.getLatencyMs( frame.iTimestamp, frame.iReceivedTicks );
+        frame.iPublishedTicks  = Time::getHighResolutionTicks();
+
+        const bool bRepaint = m_renderScheduler.frameArrived( frame.iNumHands > 0, Time::highResolutionTicksToSeconds( frame.iPublishedTicks ) );
+
+        m_frameMailbox.publish();
+
+        if ( bRepaint )
+          m_openGLContext.triggerRepaint();
+    }
+
+    void resetCamera()
+    {
+        m_camera.SetOrbitTarget( Leap::Vector::zero() );
+        m_camera.SetPOVLookAt( Leap::Vector( 0, 0, 4 ), m_camera.GetOrbitTarget() );
+    }
+
+    void initColors()
+    {
+      unsigned int i = 0;
+
+      m_vBoneColor = GLColor(Colours::darkgrey);
+
+      m_avJointColors[i++] = GLColor(Colours::aqua);
+      m_avJointColors[i++] = GLColor(Colours::darkgreen);
+      m_avJointColors[i++] = GLColor(Colours::blueviolet);
+      m_avJointColors[i++] = GLColor(Colours::crimson);
+      m_avJointColors[i++] = GLColor(Colours::salmon);
+      m_avJointColors[i++] = GLColor(Colours::blue);
+      m_avJointColors[i++] = GLColor(Colours::seagreen);
+      m_avJointColors[i++] = GLColor(Colours::orange);
+
+      jassert(i == kNumColors);
+    }
+
+private:
+    void stopFrames()
+    {
+        if ( m_pFrameSource == nullptr )
+            return;
+
+        m_pFrameSource->stop();
+        m_framePipeline.stop();
+
+        if ( m_framePipeline.getQueue().getNumDropped() > 0 )
+            Logger::writeToLog( String( m_framePipeline.getQueue().getNumDropped() ) + " frames dropped waiting for the processing thread" );
+    }
+
+    void startFrames()
+    {
+        if ( m_pFrameSource != nullptr )
+        {
+            m_framePipeline.start();
+            m_pFrameSource->start( m_framePipeline );
+        }
+    }
+
+    void timerCallback()
+    {
+        const ScopedProfile profile( m_frameProfiler, FrameProfiler::kScope_Timer );
+
+        const bool bLatencyChanged  = m_latencyMonitor.collectSamples();
+        const bool bScheduleChanged = updateRenderSchedule();
+        const bool bGestureChanged  = collectGestures();
+        const bool bProfileChanged  = collectProfile();
+
+        // stream statistics in the source description change all the time
+        const bool bStreamStats = isStreaming() || dynamic_cast<FrameStreamClient*>( m_pFrameSource.get() ) != nullptr;
+
+        // publishing repaints too, so idle redraws come from here either way
+        if ( bLatencyChanged || bScheduleChanged || bGestureChanged || bProfileChanged || bStreamStats )
+            publishRenderState();
+        else if ( m_renderScheduler.getMode() == RenderScheduler::kMode_Idle )
+            m_openGLContext.triggerRepaint();
+    }
+
+    /// processing thread: queues the event for the HUD.
+    void gestureRecognized( const GestureEvent& event )
+    {
+        m_gestureEvents.beginPush() = event;
+        m_gestureEvents.endPush();
+    }
+
+    /// takes the queued gestures and forgets old ones, returns true if the HUD line changed.
+    bool collectGestures()
+    {
+        enum { kMaxRecentGestures = 4 };
+
+        GestureEvent event;
+
+        while ( m_gestureEvents.pop( event ) )
+        {
+            if ( m_aRecentGestures.size() == kMaxRecentGestures )
+                m_aRecentGestures.remove( 0 );
+
+            m_aRecentGestures.add( event );
+        }
+
+        // gestures stay on screen for a few seconds
+        while ( m_aRecentGestures.size() > 0 && m_aRecentGestures.getReference( 0 ).fSeconds < getNowSeconds() - 3.0 )
+            m_aRecentGestures.remove( 0 );
+
+        String strGestures;
+
+        for ( int i = m_aRecentGestures.size(); --i >= 0; )
+            strGestures << (strGestures.isEmpty() ? "Gestures: " : ", ") << m_aRecentGestures.getReference( i ).getDescription();
+
+        if ( strGestures == m_strGestures )
+            return false;
+
+        m_strGestures = strGestures;
+        return true;
+    }
+
+    /// takes the profiler's events and repaints its panel, returns true if there was anything new.
+    bool collectProfile()
+    {
+        if ( !m_bShowProfiler || !m_frameProfiler.collect() )
+            return false;
+
+        m_profilerPanel = HudOverlay::paintProfilerPanel( m_frameProfiler.getReport(), Font( 13.0f ) );
+        return true;
+    }
+
+    static double getNowSeconds()
+    {
+        return Time::highResolutionTicksToSeconds( Time::getHighResolutionTicks() );
+    }
+
+    /// picks the render mode for now, returns true if it changed.
+    bool updateRenderSchedule()
+    {
+        if ( !m_renderScheduler.update( getNowSeconds(), m_bPaused, m_predictionMode != kPrediction_Off ) )
+            return false;
+
+        m_openGLContext.setContinuousRepainting( m_renderScheduler.getMode() == RenderScheduler::kMode_DisplayLocked );
+        return true;
+    }
+
+    /// input keeps it awake like a hand does, returns true if that changed the render mode.
+    bool userActivity()
+    {
+        m_renderScheduler.noteActivity( getNowSeconds() );
+        return updateRenderSchedule();
+    }
+
+    /// per-frame state the render thread takes from the message thread, copied by value.
+    struct RenderState
+    {
+        RenderState() : iWidth( 1 ), iHeight( 1 ), bShowHelp( false ), bPaused( false ), bRecording( false ), bImmediateMode( false ),
+                        predictionMode( kPrediction_Off ), fPredictionDelaySeconds( 0.0 ), bShowTrails( false ), fTrailSeconds( 0.0f ),
+                        iTrailSamples( 0 ), viewLayout( ViewLayout::kLayout_Single ), bLevelOfDetail( true ), iVertexBudget( 0 ),
+                        pBenchmark( nullptr ) {}
+
+        LeapUtilGL::CameraGL    camera;
+        int                     iWidth;
+        int                     iHeight;
+        bool                    bShowHelp;
+        bool                    bPaused;
+        bool                    bRecording;
+        bool                    bImmediateMode;
+        String                  strSource;
+        String                  strGestures;
+        LatencyMonitor::Summary latency;
+        PredictionMode          predictionMode;
+        double                  fPredictionDelaySeconds;
+        bool                    bShowTrails;
+        float                   fTrailSeconds;
+        int                     iTrailSamples;
+        ViewLayout::Layout      viewLayout;
+        /// painted on the message thread, null while the profiler is off
+        Image                   profilerPanel;
+        bool                    bLevelOfDetail;
+        int                     iVertexBudget;
+        FrameBenchmark*         pBenchmark;
+    };
+
+    /// trails are kept for this many hands at once, the rest go without.
+    enum { kMaxTrailHands = 8 };
+
+    OpenGLContext               m_openGLContext;
+    SceneLighting               m_sceneLighting;
+    SkeletonRenderer            m_skeletonRenderer;
+    GridBackdrop                m_gridBackdrop;
+    TrailRenderer               m_trailRenderer;
+    HudOverlay                  m_hudOverlay;
+    FrameProfiler               m_frameProfiler;
+    GpuScopeTimer               m_gpuScopeTimer;
+    LeapUtilGL::CameraGL        m_camera;
+    FrameMailbox<FrameSnapshot> m_frameMailbox;
+    FrameMailbox<RenderState>   m_renderStateMailbox;
+    RenderState                 m_renderState;
+    double                      m_fLastUpdateTimeSeconds;
+    double                      m_fLastRenderTimeSeconds;
+    Leap::Vector                m_vFrameTranslation;
+    float                       m_fFrameScale;
+    LeapUtil::RollingAverage<>  m_avgUpdateDeltaTime;
+    LeapUtil::RollingAverage<>  m_avgRenderDeltaTime;
+    float                       m_fUpdateFPS;
+    float                       m_fRenderFPS;
+    String                      m_strPrompt;
+    String                      m_strHelp;
+    Font                        m_fixedFont;
+    ScopedPointer<FrameTraceWriter> m_pRecorder;
+    SpinLock                    m_recorderLock;
+    File                        m_fileRecording;
+    ScopedPointer<FrameStreamServer> m_pStreamServer;
+    SpinLock                    m_streamLock;
+    ScopedPointer<FrameSource>  m_pFrameSource;
+    FramePipeline               m_framePipeline;
+    bool                        m_bShowHelp;
+    bool                        m_bPaused;
+    bool                        m_bImmediateMode;
+    bool                        m_bSmoothing;
+    ScopedPointer<FrameBenchmark> m_pBenchmark;
+    Atomic<int>                 m_benchmarkState;
+    LatencyMonitor              m_latencyMonitor;
+    RenderScheduler             m_renderScheduler;
+    DeviceLatencyEstimator      m_deviceLatency;
+    JointFilter                 m_jointFilter;
+    PredictionMode              m_predictionMode;
+    float                       m_fPredictionDelayMs;
+    bool                        m_bShowTrails;
+    float                       m_fTrailSeconds;
+    int                         m_iTrailSamples;
+    ViewLayout::Layout          m_viewLayout;
+    GestureEngine               m_gestureEngine;
+    FrameQueue<GestureEvent>    m_gestureEvents;
+    Array<GestureEvent>         m_aRecentGestures;
+    String                      m_strGestures;
+    bool                        m_bShowProfiler;
+    Image                       m_profilerPanel;
+    bool                        m_bLevelOfDetail;
+    int                         m_iVertexBudget;
+    // render thread
+    PredictionMode              m_predictorMode;
+    HandPredictor               m_predictor;
+    SkeletonDetail              m_skeletonDetail;
+    SkeletonDetail::Level       m_aHandLevels[FrameSnapshot::kMaxHands];
+    FrameSnapshot               m_predictedFrame;
+    double                      m_fRenderStartSeconds;
+    int64                       m_iRenderEndTicks;
+    /// cameras of the top, front and side views, indexed by ViewLayout::ViewAngle.
+    LeapUtilGL::CameraGL        m_aFixedCameras[ViewLayout::kMaxViews];
+
+    GLColor                     m_vBoneColor;
+    enum  { kNumColors = 8 };
+    GLColor                     m_avJointColors[kNumColors];
+};
+
+//==============================================================================
+/**
+    This is the top-level window that we'll pop up. Inside it, we'll create and
+    show a component from the MainComponent.cpp file (you can open this file using
+    the Jucer to edit it).
+*/
+class FingerVisualizerWindow  : public DocumentWindow
+{
+public:
+    //==============================================================================
+    FingerVisualizerWindow()
+        : DocumentWindow ("Leap Finger Visualizer",
+                          Colours::lightgrey,
+                          DocumentWindow::allButtons,
+                          true)
+    {
+        setContentOwned (new OpenGLCanvas(), true);
+
+        // Centre the window on the screen
+        centreWithSize (getWidth(), getHeight());
+
+        // And show it!
+        setVisible (true);
+
+        getChildComponent(0)->grabKeyboardFocus();
+    }
+
+    ~FingerVisualizerWindow()
+    {
+        // (the content component will be deleted automatically, so no need to do it here)
+    }
+
+    OpenGLCanvas* getCanvas() const
+    {
+        return dynamic_cast<OpenGLCanvas*>( getContentComponent() );
+    }
+
+    //==============================================================================
+    void closeButtonPressed()
+    {
+        // When the user presses the close button, we'll tell the app to quit. This
+        JUCEApplication::quit();
+    }
+};
+
+void FingerVisualizerApplication::initialise (const String& commandLine)
+{
+   #if JUCE_UNIT_TESTS
+    if ( commandLine.contains( "--unit-tests" ) )
+    {
+        UnitTestRunner runner;
+        runner.runAllTests();
+
+        int iNumFailures = 0;
+
+        for ( int i = 0; i < runner.getNumResults(); i++ )
+        {
+            iNumFailures += runner.getResult(i)->failures;
+        }
+
+        setApplicationReturnValue( iNumFailures > 0 ? 1 : 0 );
+        quit();
+        return;
+    }
+   #endif
+
+    StringArray astrArgs;
+    astrArgs.addTokens( commandLine, true );
+
+    if ( startBenchmark( astrArgs ) )
+        return;
+
+    // Do your application's initialisation code here..
+    m_pMainWindow = new FingerVisualizerWindow();
+
+    OpenGLCanvas* pCanvas = m_pMainWindow->getCanvas();
+
+    int     iSyntheticHands = 0;
+    double  fSyntheticRate  = 120.0;
+    bool    bTrails         = false;
+    float   fTrailSeconds   = 2.0f;
+    int     iTrailSamples   = 1024;
+
+    for ( int i = 0; i < astrArgs.size(); i++ )
+    {
+        const String& strArg  = astrArgs[i];
+        const File    argFile = File::getCurrentWorkingDirectory().getChildFile( strArg.fromFirstOccurrenceOf( "=", false, false ).unquoted() );
+
+        if ( strArg.startsWith( "--replay=" ) )
+        {
+            const Result result = pCanvas->replayTrace( argFile );
+
+            if ( result.failed() )
+                Logger::writeToLog( "Can't replay trace: " + result.getErrorMessage() );
+        }
+        else if ( strArg.startsWith( "--record=" ) )
+        {
+            if ( !pCanvas->startRecording( argFile ) )
+                Logger::writeToLog( "Can't record to " + argFile.getFullPathName() );
+        }
+        else if ( strArg.startsWith( "--synthetic=" ) )
+        {
+            iSyntheticHands = strArg.fromFirstOccurrenceOf( "=", false, false ).getIntValue();
+        }
+        else if ( strArg.startsWith( "--synthetic-rate=" ) )
+        {
+            fSyntheticRate = strArg.fromFirstOccurrenceOf( "=", false, false ).getDoubleValue();
+        }
+        else if ( strArg.startsWith( "--predict=" ) )
+        {
+            const String strMode = strArg.fromFirstOccurrenceOf( "=", false, false );
+
+            if ( strMode == "extrapolate" )
+                pCanvas->setPredictionMode( OpenGLCanvas::kPrediction_Extrapolate );
+            else if ( strMode == "interpolate" )
+                pCanvas->setPredictionMode( OpenGLCanvas::kPrediction_Interpolate );
+            else if ( strMode == "off" )
+                pCanvas->setPredictionMode( OpenGLCanvas::kPrediction_Off );
+            else
+                Logger::writeToLog( "Unknown prediction mode: " + strMode );
+        }
+        else if ( strArg == "--smooth" )
+        {
+            pCanvas->setSmoothing( true );
+        }
+        else if ( strArg.startsWith( "--lod=" ) )
+        {
+            const String strMode = strArg.fromFirstOccurrenceOf( "=", false, false );
+
+            if ( strMode == "on" || strMode == "off" )
+                pCanvas->setLevelOfDetail( strMode == "on" );
+            else
+                Logger::writeToLog( "Unknown level of detail setting: " + strMode );
+        }
+        else if ( strArg.startsWith( "--vertex-budget=" ) )
+        {
+            pCanvas->setVertexBudget( strArg.fromFirstOccurrenceOf( "=", false, false ).getIntValue() );
+        }
+        else if ( strArg == "--profile" )
+        {
+            pCanvas->setProfiling( true );
+        }
+        else if ( strArg.startsWith( "--predict-delay=" ) )
+        {
+            pCanvas->setPredictionDelay( strArg.fromFirstOccurrenceOf( "=", false, false ).getFloatValue() );
+        }
+        else if ( strArg.startsWith( "--render=" ) )
+        {
+            const String strMode = strArg.fromFirstOccurrenceOf( "=", false, false );
+
+            if ( strMode == "track" )
+                pCanvas->setRenderMode( RenderScheduler::kMode_TrackDriven );
+            else if ( strMode == "display" )
+                pCanvas->setRenderMode( RenderScheduler::kMode_DisplayLocked );
+            else
+                Logger::writeToLog( "Unknown render mode: " + strMode );
+        }
+        else if ( strArg.startsWith( "--idle-timeout=" ) )
+        {
+            pCanvas->setIdleTimeout( strArg.fromFirstOccurrenceOf( "=", false, false ).getDoubleValue() );
+        }
+        else if ( strArg.startsWith( "--ingest-queue=" ) )
+        {
+            const String strValue = strArg.fromFirstOccurrenceOf( "=", false, false );
+
+            pCanvas->setIngestQueue( strValue.getIntValue(), strValue.endsWith( ",drop-newest" ) ? FrameQueue<FrameSnapshot>::kDropNewest
+                                                                                                 : FrameQueue<FrameSnapshot>::kDropOldest );
+        }
+        else if ( strArg.startsWith( "--trail-seconds=" ) )
+        {
+            fTrailSeconds = strArg.fromFirstOccurrenceOf( "=", false, false ).getFloatValue();
+            bTrails = true;
+        }
+        else if ( strArg.startsWith( "--trail-samples=" ) )
+        {
+            iTrailSamples = strArg.fromFirstOccurrenceOf( "=", false, false ).getIntValue();
+            bTrails = true;
+        }
+        else if ( strArg == "--trails" )
+        {
+            bTrails = true;
+        }
+        else if ( strArg.startsWith( "--views=" ) )
+        {
+            const String strLayout = strArg.fromFirstOccurrenceOf( "=", false, false );
+
+            if ( strLayout == "quad" )
+                pCanvas->setViewLayout( ViewLayout::kLayout_Quad );
+            else if ( strLayout == "single" )
+                pCanvas->setViewLayout( ViewLayout::kLayout_Single );
+            else
+                Logger::writeToLog( "Unknown view layout: " + strLayout );
+        }
+        else if ( strArg == "--serve" || strArg.startsWith( "--serve=" ) )
+        {
+            const int iPort = strArg.containsChar( '=' ) ? strArg.fromFirstOccurrenceOf( "=", false, false ).getIntValue()
+                                                         : static_cast<int>(FrameStream::kDefaultPort);
+
+            if ( !pCanvas->startStreaming( iPort ) )
+                Logger::writeToLog( "Can't stream on port " + String( iPort ) );
+        }
+        else if ( strArg.startsWith( "--connect=" ) )
+        {
+            const String strAddress = strArg.fromFirstOccurrenceOf( "=", false, false );
+            const int    iPort      = strAddress.containsChar( ':' ) ? strAddress.fromLastOccurrenceOf( ":", false, false ).getIntValue()
+                                                                     : static_cast<int>(FrameStream::kDefaultPort);
+
+            pCanvas->connectToStream( strAddress.upToLastOccurrenceOf( ":", false, false ), iPort );
+        }
+    }
+
+    if ( bTrails )
+    {
+        pCanvas->setTrailLength( fTrailSeconds, iTrailSamples );
+        pCanvas->setShowTrails( true );
+    }
+
+    if ( iSyntheticHands > 0 )
+    {
+        pCanvas->setFrameSource( new SyntheticFrameSource( iSyntheticHands, fSyntheticRate ) );
+    }
+}
+
+//==============================================================================
+/// handles the --bench options, returns false if they aren't present.
+bool FingerVisualizerApplication::startBenchmark( const StringArray& astrArgs )
+{
+    bool bBenchmark = false;
+
+    for ( int i = 0; i < astrArgs.size(); i++ )
+    {
+        const String& strArg   = astrArgs[i];
+        const String  strValue = strArg.fromFirstOccurrenceOf( "=", false, false ).unquoted();
+
+        if ( strArg == "--bench" || strArg.startsWith( "--bench=" ) )
+        {
+            bBenchmark = true;
+            m_benchmarkSettings.bSoftware    = strValue.equalsIgnoreCase( "software" );
+            m_benchmarkSettings.bJointFilter = strValue.equalsIgnoreCase( "filter" );
+            m_benchmarkSettings.bGestures    = strValue.equalsIgnoreCase( "gestures" );
+        }
+        else if ( strArg.startsWith( "--bench-frames=" ) )
+        {
+            m_benchmarkSettings.iNumFrames = strValue.getIntValue();
+        }
+        else if ( strArg.startsWith( "--bench-hands=" ) )
+        {
+            m_benchmarkSettings.iNumHands = strValue.getIntValue();
+        }
+        else if ( strArg.startsWith( "--bench-size=" ) )
+        {
+            m_benchmarkSettings.iWidth  = strValue.upToFirstOccurrenceOf( "x", false, true ).getIntValue();
+            m_benchmarkSettings.iHeight = strValue.fromFirstOccurrenceOf( "x", false, true ).getIntValue();
+        }
+        else if ( strArg.startsWith( "--bench-output=" ) )
+        {
+            m_benchmarkSettings.outputFile = File::getCurrentWorkingDirectory().getChildFile( strValue );
+        }
+    }
+
+    if ( !bBenchmark )
+        return false;
+
+    if ( m_benchmarkSettings.bJointFilter )
+    {
+        FilterBenchmark benchmark( m_benchmarkSettings );
+        FrameBenchmark::writeReportText( m_benchmarkSettings, benchmark.createReport() );
+
+        quit();
+        return true;
+    }
+
+    if ( m_benchmarkSettings.bGestures )
+    {
+        GestureBenchmark benchmark( m_benchmarkSettings );
+        FrameBenchmark::writeReportText( m_benchmarkSettings, benchmark.createReport() );
+
+        quit();
+        return true;
+    }
+
+    if ( m_benchmarkSettings.bSoftware )
+    {
+        finishSoftwareBenchmark();
+        return true;
+    }
+
+    // OpenGL needs an on screen window for its context, the benchmark itself
+    // renders offscreen at the requested size.
+    m_pMainWindow = new FingerVisualizerWindow();
+    m_pMainWindow->getCanvas()->runBenchmark( new FrameBenchmark( m_benchmarkSettings ) );
+
+    m_iBenchmarkStartMs = Time::getMillisecondCounter();
+    startTimer( 100 );
+    return true;
+}
+
+void FingerVisualizerApplication::finishSoftwareBenchmark()
+{
+    FrameBenchmark benchmark( m_benchmarkSettings );
+    runSoftwareBenchmark( benchmark );
+
+    quit();
+}
+
+/// waits for the OpenGL benchmark to finish, falling back to software if it can't run.
+void FingerVisualizerApplication::timerCallback()
+{
+    const OpenGLCanvas::BenchmarkState state = m_pMainWindow->getCanvas()->getBenchmarkState();
+
+    if ( state == OpenGLCanvas::kBenchmark_Finished )
+    {
+        stopTimer();
+        quit();
+    }
+    else if ( state == OpenGLCanvas::kBenchmark_Failed
+              || (state == OpenGLCanvas::kBenchmark_Waiting && Time::getMillisecondCounter() - m_iBenchmarkStartMs > 10000) )
+    {
+        Logger::writeToLog( "OpenGL isn't available, running the benchmark with the software renderer" );
+
+        stopTimer();
+        m_pMainWindow = nullptr;
+        finishSoftwareBenchmark();
+    }
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class FrameMailboxTests  : public UnitTest
+{
+public:
+    FrameMailboxTests() : UnitTest ("FrameMailbox") {}
+
+    struct Payload
+    {
+        Payload() : iSerial (0)     { zerostruct (aiCopies); }
+
+        int iSerial;
+        int aiCopies[1024];
+    };
+
+    class WriteThread  : public Thread
+    {
+    public:
+        WriteThread (FrameMailbox<Payload>& m)
+            : Thread ("mailbox writer"), mailbox (m), iNumPublished (0)
+        {
+            startThread();
+        }
+
+        ~WriteThread()
+        {
+            stopThread (5000);
+        }
+
+        void run()
+        {
+            int n = 0;
+
+            while (! threadShouldExit())
+            {
+                Payload& payload = mailbox.getWriteBuffer();
+
+                payload.iSerial = ++n;
+
+                for (int i = 0; i < numElementsInArray (payload.aiCopies); ++i)
+                    payload.aiCopies[i] = n;
+
+                mailbox.publish();
+                iNumPublished = n;
+            }
+        }
+
+        FrameMailbox<Payload>& mailbox;
+        Atomic<int> iNumPublished;
+    };
+
+    void runTest()
+    {
+        beginTest ("Single thread");
+
+        {
+            FrameMailbox<Payload> mailbox;
+
+            expect (! mailbox.acquire());
+
+            mailbox.getWriteBuffer().iSerial = 1;
+            mailbox.publish();
+            mailbox.getWriteBuffer().iSerial = 2;
+            mailbox.publish();
+
+            expect (mailbox.hasNewValue());
+            expect (mailbox.acquire());
+            expectEquals (mailbox.getReadBuffer().iSerial, 2);
+            expect (! mailbox.acquire());
+            expectEquals (mailbox.getReadBuffer().iSerial, 2);
+        }
+
+        beginTest ("Producer and consumer threads");
+
+        {
+            FrameMailbox<Payload> mailbox;
+            WriteThread writer (mailbox);
+
+            int iLastSerial = 0;
+            int iNumAcquired = 0;
+            bool bTorn = false;
+            bool bOutOfOrder = false;
+
+            for (int count = 200000; --count >= 0;)
+            {
+                if (! mailbox.acquire())
+                    continue;
+
+                const Payload& payload = mailbox.getReadBuffer();
+
+                for (int i = 0; i < numElementsInArray (payload.aiCopies); ++i)
+                    bTorn = (payload.aiCopies[i] != payload.iSerial) || bTorn;
+
+                bOutOfOrder = (payload.iSerial <= iLastSerial) || bOutOfOrder;
+                iLastSerial = payload.iSerial;
+                ++iNumAcquired;
+            }
+
+            writer.stopThread (5000);
+
+            expect (! bTorn, "read a partially written value");
+            expect (! bOutOfOrder, "values were not read in publishing order");
+            expect (iNumAcquired > 0);
+            expect (writer.iNumPublished.get() >= iNumAcquired);
+        }
+    }
+};
+
+static FrameMailboxTests frameMailboxTests;
+
+//==============================================================================
+class FrameQueueTests  : public UnitTest
+{
+public:
+    FrameQueueTests() : UnitTest ("FrameQueue") {}
+
+    struct Payload
+    {
+        Payload() : iSerial (0)     { zerostruct (aiCopies); }
+
+        int iSerial;
+        int aiCopies[256];
+    };
+
+    class PushThread  : public Thread
+    {
+    public:
+        PushThread (FrameQueue<Payload>& q, int iNumValues)
+            : Thread ("queue producer"), queue (q), iNumToPush (iNumValues)
+        {
+            startThread();
+        }
+
+        ~PushThread()
+        {
+            stopThread (5000);
+        }
+
+        void run()
+        {
+            for (int n = 1; n <= iNumToPush && ! threadShouldExit(); ++n)
+            {
+                Payload& payload = queue.beginPush();
+
+                payload.iSerial = n;
+
+                for (int i = 0; i < numElementsInArray (payload.aiCopies); ++i)
+                    payload.aiCopies[i] = n;
+
+                queue.endPush();
+            }
+        }
+
+        FrameQueue<Payload>& queue;
+        const int iNumToPush;
+    };
+
+    void runTest()
+    {
+        Payload payload;
+
+        beginTest ("Values come out in order");
+
+        {
+            FrameQueue<Payload> queue (3, FrameQueue<Payload>::kDropOldest);
+            expectEquals (queue.getCapacity(), 4);
+            expect (! queue.pop (payload));
+
+            for (int i = 1; i <= 3; ++i)
+            {
+                queue.beginPush().iSerial = i;
+                expect (queue.endPush());
+            }
+
+            expectEquals (queue.getNumQueued(), 3);
+
+            for (int i = 1; i <= 3; ++i)
+            {
+                expect (queue.pop (payload));
+                expectEquals (payload.iSerial, i);
+            }
+
+            expect (! queue.pop (payload));
+        }
+
+        beginTest ("Drop oldest");
+
+        {
+            FrameQueue<Payload> queue (4, FrameQueue<Payload>::kDropOldest);
+
+            for (int i = 1; i <= 10; ++i)
+            {
+                queue.beginPush().iSerial = i;
+                expect (queue.endPush());
+            }
+
+            expectEquals (queue.getNumDropped(), 6);
+            expect (queue.pop (payload));
+            expectEquals (payload.iSerial, 7);
+        }
+
+        beginTest ("Drop newest");
+
+        {
+            FrameQueue<Payload> queue (4, FrameQueue<Payload>::kDropNewest);
+
+            for (int i = 1; i <= 10; ++i)
+            {
+                queue.beginPush().iSerial = i;
+                expectEquals (queue.endPush(), i <= 4);
+            }
+
+            expect (queue.isFull());
+            expectEquals (queue.getNumDropped(), 6);
+            expect (queue.pop (payload));
+            expectEquals (payload.iSerial, 1);
+            expect (! queue.isFull());
+        }
+
+        for (int iPolicy = 0; iPolicy < 2; ++iPolicy)
+        {
+            const FrameQueue<Payload>::OverflowPolicy policy = static_cast<FrameQueue<Payload>::OverflowPolicy> (iPolicy);
+
+            beginTest (policy == FrameQueue<Payload>::kDropOldest ? "Producer and consumer threads, drop oldest"
+                                                                  : "Producer and consumer threads, drop newest");
+
+            const int iNumValues = 100000;
+            FrameQueue<Payload> queue (8, policy);
+
+            int iLastSerial = 0;
+            int iNumPopped = 0;
+            bool bTorn = false;
+            bool bOutOfOrder = false;
+
+            {
+                PushThread producer (queue, iNumValues);
+
+                while (producer.isThreadRunning() || queue.getNumQueued() > 0)
+                {
+                    if (! queue.pop (payload))
+                        continue;
+
+                    for (int i = 0; i < numElementsInArray (payload.aiCopies); ++i)
+                        bTorn = (payload.aiCopies[i] != payload.iSerial) || bTorn;
+
+                    bOutOfOrder = (payload.iSerial <= iLastSerial) || bOutOfOrder;
+                    iLastSerial = payload.iSerial;
+                    ++iNumPopped;
+                }
+            }
+
+            expect (! bTorn, "popped a partially written value");
+            expect (! bOutOfOrder, "values were not popped in order");
+            expectEquals (iNumPopped + queue.getNumDropped(), iNumValues);
+
+            if (policy == FrameQueue<Payload>::kDropOldest)
+                expectEquals (iLastSerial, iNumValues);
+        }
+    }
+};
+
+static FrameQueueTests frameQueueTests;
+
+//==============================================================================
+class FrameTraceTests  : public UnitTest
+{
+public:
+    FrameTraceTests() : UnitTest ("FrameTrace") {}
+
+    /** Notes when each frame arrives, on the player's thread. */
+    struct Arrivals  : public FrameSnapshotConsumer
+    {
+        Arrivals()                      { afMs.ensureStorageAllocated (1000); aiIds.ensureStorageAllocated (1000); }
+
+        FrameSnapshot& beginFrame()     { return frame; }
+
+        void endFrame()
+        {
+            afMs.add (Time::getMillisecondCounterHiRes());
+            aiIds.add (frame.iFrameId);
+        }
+
+        FrameSnapshot   frame;
+        Array<double>   afMs;
+        Array<int64>    aiIds;
+    };
+
+    void writeTrace (const File& file, int iNumFrames, int64 iIntervalUs)
+    {
+        FrameTraceWriter writer (file);
+        ScopedPointer<FrameSnapshot> pFrame (new FrameSnapshot());
+
+        for (int i = 0; i < iNumFrames; ++i)
+        {
+            fillFrame (*pFrame, i);
+            pFrame->iTimestamp = 1000000 + i * iIntervalUs;
+            expect (writer.addFrame (*pFrame));
+        }
+    }
+
+    void playFor (const File& file, int iMs, Arrivals& arrivals)
+    {
+        FrameTracePlayer player (file);
+        player.start (arrivals);
+        Thread::sleep (iMs);
+        player.stop();
+    }
+
+    static void fillFrame (FrameSnapshot& frame, int iFrame)
+    {
+        frame.iFrameId   = iFrame;
+        frame.iTimestamp = 1000000 + iFrame * 8000;
+        frame.iNumHands  = iFrame % 5;
+
+        for (int i = 0; i < frame.iNumHands; ++i)
+        {
+            HandSnapshot& hand = frame.aHands[i];
+            const float f = static_cast<float> (iFrame * 100 + i);
+
+            hand.iId           = iFrame + i;
+            hand.bIsLeft       = (i & 1) != 0;
+            hand.vPalmPosition = Leap::Vector (f, f + 0.5f, f + 0.25f);
+            hand.vPalmNormal   = Leap::Vector (0.0f, -1.0f, f);
+            hand.vDirection    = Leap::Vector (0.0f, f, -1.0f);
+            hand.vWrist        = Leap::Vector (f, 0.0f, 1.0f);
+
+            for (int j = 0; j < HandSnapshot::kNumFingers; ++j)
+            {
+                hand.aFingers[j].fWidth = f + j;
+
+                for (int k = 0; k < FingerSnapshot::kNumJoints; ++k)
+                    hand.aFingers[j].avJoints[k] = Leap::Vector (f, static_cast<float> (j), static_cast<float> (k));
+            }
+        }
+    }
+
+    bool framesMatch (const FrameSnapshot& a, const FrameSnapshot& b)
+    {
+        if (a.iFrameId != b.iFrameId || a.iTimestamp != b.iTimestamp || a.iNumHands != b.iNumHands)
+            return false;
+
+        for (int i = 0; i < a.iNumHands; ++i)
+        {
+            const HandSnapshot& ha = a.aHands[i];
+            const HandSnapshot& hb = b.aHands[i];
+
+            if (ha.iId != hb.iId || ha.bIsLeft != hb.bIsLeft || ha.vPalmPosition != hb.vPalmPosition
+                 || ha.vPalmNormal != hb.vPalmNormal || ha.vDirection != hb.vDirection || ha.vWrist != hb.vWrist)
+                return false;
+
+            for (int j = 0; j < HandSnapshot::kNumFingers; ++j)
+            {
+                if (ha.aFingers[j].fWidth != hb.aFingers[j].fWidth)
+                    return false;
+
+                for (int k = 0; k < FingerSnapshot::kNumJoints; ++k)
+                    if (ha.aFingers[j].avJoints[k] != hb.aFingers[j].avJoints[k])
+                        return false;
+            }
+        }
+
+        return true;
+    }
+
+    void runTest()
+    {
+        beginTest ("Write and map back");
+
+        const int iNumFrames = 500;
+        TemporaryFile tempFile (".lfvt");
+        ScopedPointer<FrameSnapshot> pFrame (new FrameSnapshot());
+        ScopedPointer<FrameSnapshot> pReadBack (new FrameSnapshot());
+
+        {
+            FrameTraceWriter writer (tempFile.getFile());
+            expect (writer.openedOk());
+
+            for (int i = 0; i < iNumFrames; ++i)
+            {
+                fillFrame (*pFrame, i);
+                expect (writer.addFrame (*pFrame));
+            }
+        }
+
+        {
+            FrameTraceReader reader (tempFile.getFile());
+            expect (reader.openedOk(), reader.getLastError());
+            expectEquals (reader.getNumFrames(), iNumFrames);
+
+            bool bAllMatch = true;
+
+            for (int i = 0; i < reader.getNumFrames(); ++i)
+            {
+                fillFrame (*pFrame, i);
+                reader.getFrame (i).copyTo (*pReadBack);
+                bAllMatch = framesMatch (*pFrame, *pReadBack) && bAllMatch;
+            }
+
+            expect (bAllMatch, "frames read back differ from the frames written");
+        }
+
+        beginTest ("Truncated and foreign files");
+
+        {
+            const int64 iFullSize = tempFile.getFile().getSize();
+
+            {
+                FileOutputStream out (tempFile.getFile());
+                out.setPosition (iFullSize - 4);
+                out.truncate();
+            }
+
+            FrameTraceReader reader (tempFile.getFile());
+            expect (reader.openedOk());
+            expectEquals (reader.getNumFrames(), iNumFrames - 1);
+        }
+
+        {
+            tempFile.getFile().replaceWithText ("not a trace at all");
+            FrameTraceReader reader (tempFile.getFile());
+            expect (! reader.openedOk());
+        }
+
+        beginTest ("Looped playback is paced");
+
+        {
+            // one frame, and several sharing a timestamp, have no spacing of their own
+            for (int iNumFrames = 1; iNumFrames <= 3; iNumFrames += 2)
+            {
+                TemporaryFile traceFile (".lfvt");
+                writeTrace (traceFile.getFile(), iNumFrames, 0);
+
+                Arrivals arrivals;
+                playFor (traceFile.getFile(), 200, arrivals);
+
+                expect (arrivals.afMs.size() > 0);
+                expect (arrivals.afMs.size() <= 200 * 1000 / FrameTracePlayer::kMinFrameIntervalUs + 10,
+                        String (arrivals.afMs.size()) + " frames in 200 ms");
+            }
+        }
+
+        {
+            TemporaryFile traceFile (".lfvt");
+            writeTrace (traceFile.getFile(), 3, 20000);
+
+            Arrivals arrivals;
+            playFor (traceFile.getFile(), 150, arrivals);
+
+            FrameTracePlayer player (traceFile.getFile());
+            expectEquals (player.getFrameIntervalUs(), (int64) 20000);
+
+            // the first frame comes a whole interval after the last, not straight away
+            bool bWrapped = false;
+
+            for (int i = 1; i < arrivals.aiIds.size(); ++i)
+            {
+                if (arrivals.aiIds[i] == 0)
+                {
+                    bWrapped = true;
+                    expect (arrivals.afMs[i] - arrivals.afMs[i - 1] > 15.0,
+                            "wrapped after " + String (arrivals.afMs[i] - arrivals.afMs[i - 1], 1) + " ms");
+                }
+            }
+
+            expect (bWrapped);
+        }
+    }
+};
+
+static FrameTraceTests frameTraceTests;
+
+//==============================================================================
+class FrameBenchmarkTests  : public UnitTest
+{
+public:
+    FrameBenchmarkTests() : UnitTest ("FrameBenchmark") {}
+
+    void runTest()
+    {
+        beginTest ("Percentiles");
+
+        Array<double> afValues;
+
+        for (int i = 1; i <= 100; ++i)
+            afValues.add (i);
+
+        expectEquals (FrameBenchmark::getPercentile (afValues, 50.0), 50.0);
+        expectEquals (FrameBenchmark::getPercentile (afValues, 99.0), 99.0);
+        expectEquals (FrameBenchmark::getPercentile (afValues, 100.0), 100.0);
+        expectEquals (FrameBenchmark::getPercentile (Array<double>(), 50.0), 0.0);
+
+        beginTest ("Report");
+
+        FrameBenchmark::Settings settings;
+        settings.iNumFrames       = 50;
+        settings.iNumWarmupFrames = 5;
+        settings.iNumHands        = 3;
+
+        FrameBenchmark benchmark (settings);
+        int iNumRendered = 0;
+
+        while (! benchmark.isFinished())
+        {
+            const FrameSnapshot& frame = benchmark.beginBenchmarkFrame();
+            expectEquals (frame.iNumHands, 3);
+            benchmark.endBenchmarkFrame();
+            ++iNumRendered;
+        }
+
+        expectEquals (iNumRendered, 55);
+
+        const var report (JSON::parse (benchmark.createReport ("Test")));
+
+        expectEquals (report["renderer"].toString(), String ("Test"));
+        expectEquals ((int) report["frames"], 50);
+        expect ((double) report["cpuFrameMs"]["p99"] >= (double) report["cpuFrameMs"]["p50"]);
+
+        // posing the synthetic hands must not allocate, or it would show up as renderer allocations
+        if (AllocationCounter::isEnabled())
+            expectEquals ((int) report["allocations"]["maxPerFrame"], 0);
+    }
+};
+
+static FrameBenchmarkTests frameBenchmarkTests;
+
+//==============================================================================
+class HudOverlayTests  : public UnitTest
+{
+public:
+    HudOverlayTests() : UnitTest ("HudOverlay") {}
+
+    void runTest()
+    {
+        beginTest ("Value formatting");
+
+        expectEquals (format (60.0f), String ("60.00"));
+        expectEquals (format (0.004f), String ("0.00"));
+        expectEquals (format (7.5f), String ("7.50"));
+        expectEquals (format (1234.567f), String ("1234.57"));
+        expectEquals (format (-3.0f), String ("0.00"));
+
+        char acText[3];
+        expectEquals (HudOverlay::formatValue (1234.5f, acText, numElementsInArray (acText)), 3);
+    }
+
+private:
+    static String format (float fValue)
+    {
+        char acText[16];
+        const int iCount = HudOverlay::formatValue (fValue, acText, numElementsInArray (acText));
+        return String (acText, (size_t) iCount);
+    }
+};
+
+static HudOverlayTests hudOverlayTests;
+
+//==============================================================================
+class LatencyMonitorTests  : public UnitTest
+{
+public:
+    LatencyMonitorTests() : UnitTest ("LatencyMonitor") {}
+
+    void runTest()
+    {
+        beginTest ("Percentiles");
+
+        {
+            LatencyMonitor monitor;
+            expect (! monitor.collectSamples());
+
+            for (int i = 1; i <= 100; ++i)
+                expect (monitor.addSample (makeSample ((float) i)));
+
+            expect (monitor.collectSamples());
+
+            const LatencyMonitor::Summary& summary = monitor.getSummary();
+            expectEquals (summary.iNumSamples, 100);
+            expectEquals (summary.afP50Ms[LatencySample::kStage_Render], 50.0f);
+            expectEquals (summary.afP99Ms[LatencySample::kStage_Render], 99.0f);
+            expectEquals (summary.afMaxMs[LatencySample::kStage_Render], 100.0f);
+            expectEquals (summary.afMaxMs[LatencyMonitor::kTotal], 103.0f);
+        }
+
+        beginTest ("Full ring drops samples");
+
+        {
+            LatencyMonitor monitor;
+            int iNumAdded = 0;
+
+            for (int i = 0; i < 1000; ++i)
+                if (monitor.addSample (makeSample (1.0f)))
+                    ++iNumAdded;
+
+            expect (iNumAdded < 1000);
+            monitor.collectSamples();
+            expectEquals (monitor.getSummary().iNumSamples, iNumAdded);
+            expectEquals (monitor.getSummary().iNumDropped, 1000 - iNumAdded);
+
+            // draining makes room again
+            expect (monitor.addSample (makeSample (1.0f)));
+        }
+
+        beginTest ("Window keeps the newest frames");
+
+        {
+            LatencyMonitor monitor;
+
+            for (int i = 0; i < LatencyMonitor::kWindowSize + 100; ++i)
+            {
+                monitor.addSample (makeSample (i < 100 ? 1000.0f : 1.0f));
+                monitor.collectSamples();
+            }
+
+            expectEquals (monitor.getSummary().iNumSamples, (int) LatencyMonitor::kWindowSize);
+            expectEquals (monitor.getSummary().afMaxMs[LatencySample::kStage_Render], 1.0f);
+        }
+
+        beginTest ("Device latency");
+
+        {
+            DeviceLatencyEstimator estimator;
+            const int64 iTicksPerMs = Time::getHighResolutionTicksPerSecond() / 1000;
+
+            // host receives frames 10 ms after their timestamp, one of them 4 ms late
+            expect (estimator.getLatencyMs (0, 10 * iTicksPerMs) < 0.01f);
+            expect (std::abs (estimator.getLatencyMs (20000, 34 * iTicksPerMs) - 4.0f) < 0.01f);
+            expect (estimator.getLatencyMs (40000, 50 * iTicksPerMs) < 0.01f);
+
+            // a timestamp jumping back more than a second starts over
+            expect (estimator.getLatencyMs (0, 60 * iTicksPerMs + 5000 * iTicksPerMs) < 0.01f);
+        }
+    }
+
+private:
+    static LatencySample makeSample (float fRenderMs)
+    {
+        LatencySample sample;
+        sample.afStageMs[LatencySample::kStage_Device]  = 0.0f;
+        sample.afStageMs[LatencySample::kStage_Capture] = 1.0f;
+        sample.afStageMs[LatencySample::kStage_Queue]   = 2.0f;
+        sample.afStageMs[LatencySample::kStage_Render]  = fRenderMs;
+        return sample;
+    }
+};
+
+static LatencyMonitorTests latencyMonitorTests;
+
+//==============================================================================
+class HandPredictorTests  : public UnitTest
+{
+public:
+    HandPredictorTests() : UnitTest ("HandPredictor") {}
+
+    void runTest()
+    {
+        HandPredictor predictor;
+        FrameSnapshot frame, predicted;
+
+        beginTest ("Interpolation and extrapolation");
+
+        // a hand moving along x at 1 mm/ms, tracked every 10 ms
+        for (int i = 0; i < 3; ++i)
+            predictor.addFrame (makeFrame (frame, 7, i * 10.0f), i * 0.010);
+
+        expectEquals (predictor.getNumTracks(), 1);
+
+        predictor.predictFrame (0.015, predicted);
+        expectEquals (predicted.iNumHands, 1);
+        expectEquals (predicted.aHands[0].iId, 7);
+        expect (std::abs (predicted.aHands[0].vPalmPosition.x - 15.0f) < 0.001f);
+        expect (std::abs (predicted.aHands[0].aFingers[2].tipPosition().x - 15.0f) < 0.001f);
+
+        predictor.predictFrame (0.028, predicted);
+        expect (std::abs (predicted.aHands[0].vPalmPosition.x - 28.0f) < 0.001f);
+
+        // far in the future it stops at the extrapolation limit
+        predictor.predictFrame (10.0, predicted);
+        expect (std::abs (predicted.aHands[0].vPalmPosition.x - (20.0f + HandPredictor::kMaxExtrapolationMs)) < 0.001f);
+
+        // and before the history it holds the oldest sample
+        predictor.predictFrame (-1.0, predicted);
+        expect (std::abs (predicted.aHands[0].vPalmPosition.x) < 0.001f);
+
+        beginTest ("Hands come and go");
+
+        makeFrame (frame, 8, 30.0f);
+        predictor.addFrame (frame, 0.030);
+        expectEquals (predictor.getNumTracks(), 1);
+
+        predictor.predictFrame (0.040, predicted);
+        expectEquals (predicted.aHands[0].iId, 8);
+        expect (std::abs (predicted.aHands[0].vPalmPosition.x - 30.0f) < 0.001f);
+
+        // time going backwards restarts the history
+        predictor.addFrame (makeFrame (frame, 8, 0.0f), 0.0);
+        predictor.predictFrame (0.005, predicted);
+        expect (std::abs (predicted.aHands[0].vPalmPosition.x) < 0.001f);
+    }
+
+private:
+    static FrameSnapshot& makeFrame (FrameSnapshot& frame, int32_t iId, float fX)
+    {
+        frame.iNumHands = 1;
+
+        HandSnapshot& hand = frame.aHands[0];
+        hand.iId           = iId;
+        hand.bIsLeft       = false;
+        hand.vPalmPosition = Leap::Vector (fX, 200.0f, 0.0f);
+        hand.vWrist        = Leap::Vector (fX, 200.0f, 50.0f);
+        hand.vPalmNormal   = Leap::Vector (0.0f, -1.0f, 0.0f);
+        hand.vDirection    = Leap::Vector (0.0f, 0.0f, -1.0f);
+
+        for (int i = 0; i < HandSnapshot::kNumFingers; ++i)
+        {
+            hand.aFingers[i].fWidth = 18.0f;
+
+            for (int j = 0; j < FingerSnapshot::kNumJoints; ++j)
+                hand.aFingers[i].avJoints[j] = Leap::Vector (fX, 200.0f, -20.0f * j);
+        }
+
+        return frame;
+    }
+};
+
+static HandPredictorTests handPredictorTests;
+
+//==============================================================================
+class JointFilterTests  : public UnitTest
+{
+public:
+    JointFilterTests() : UnitTest ("JointFilter") {}
+
+    void runTest()
+    {
+        SyntheticHands hands (3);
+        FrameSnapshot frame, raw;
+
+        beginTest ("New hands pass through");
+
+        {
+            JointFilter filter;
+            hands.poseFrame (0.0, frame);
+            raw = frame;
+
+            filter.process (frame);
+            expectEquals (filter.getNumSlots(), 3);
+            expect (getMaxDifference (frame, raw) == 0.0f);
+        }
+
+        beginTest ("Jitter is reduced");
+
+        {
+            JointFilter filter;
+            Random random (42);
+            double fRawError = 0.0, fFilteredError = 0.0;
+
+            hands.poseFrame (0.0, raw);
+
+            for (int i = 0; i < 500; ++i)
+            {
+                frame = raw;
+                frame.iTimestamp = i * 10000;
+
+                for (int j = 0; j < frame.iNumHands; ++j)
+                    frame.aHands[j].vPalmPosition += Leap::Vector (random.nextFloat() - 0.5f, random.nextFloat() - 0.5f, random.nextFloat() - 0.5f);
+
+                const float fBefore = getMaxDifference (frame, raw);
+                filter.process (frame);
+
+                if (i >= 100)
+                {
+                    fRawError      += fBefore;
+                    fFilteredError += getMaxDifference (frame, raw);
+                }
+            }
+
+            expect (fFilteredError < fRawError * 0.5);
+        }
+
+        beginTest ("SIMD matches scalar");
+
+        if (JointFilter::isSIMDAvailable())
+        {
+            JointFilter simd, scalar;
+            simd.setUseSIMD (true);
+            scalar.setUseSIMD (false);
+
+            FrameSnapshot other;
+
+            for (int i = 0; i < 200; ++i)
+            {
+                hands.poseFrame (i / 120.0, frame);
+                other = frame;
+
+                simd.process (frame);
+                scalar.process (other);
+            }
+
+            expect (getMaxDifference (frame, other) < 1.0e-3f);
+        }
+
+        beginTest ("Hand lifecycle");
+
+        {
+            SyntheticHands comingAndGoing (4, 0.5f);
+            JointFilter filter;
+
+            for (int i = 0; i < 300; ++i)
+            {
+                comingAndGoing.poseFrame (i / 100.0, frame);
+                raw = frame;
+                filter.process (frame);
+
+                expectEquals (filter.getNumSlots(), frame.iNumHands);
+
+                // every hand stays close to where it is
+                expect (getMaxDifference (frame, raw) < 50.0f);
+            }
+
+            // a gap starts over
+            comingAndGoing.poseFrame (10.0, frame);
+            raw = frame;
+            filter.process (frame);
+            expect (getMaxDifference (frame, raw) == 0.0f);
+        }
+
+        beginTest ("Benchmark report");
+
+        {
+            FrameBenchmark::Settings settings;
+            settings.iNumFrames       = 50;
+            settings.iNumWarmupFrames = 5;
+            settings.iNumHands        = 2;
+
+            FilterBenchmark benchmark (settings);
+            const var report (JSON::parse (benchmark.createReport()));
+
+            expectEquals ((int) report["jointsPerFrame"], 2 * (int) JointFilter::kPointsPerHand);
+            expect ((double) report["scalar"]["jointNs"]["p99"] >= (double) report["scalar"]["jointNs"]["p50"]);
+        }
+    }
+
+private:
+    static float getMaxDifference (const FrameSnapshot& a, const FrameSnapshot& b)
+    {
+        float fMax = 0.0f;
+
+        for (int i = 0; i < a.iNumHands; ++i)
+        {
+            fMax = jmax (fMax, a.aHands[i].vPalmPosition.distanceTo (b.aHands[i].vPalmPosition));
+
+            for (int j = 0; j < HandSnapshot::kNumFingers; ++j)
+                fMax = jmax (fMax, a.aHands[i].aFingers[j].tipPosition().distanceTo (b.aHands[i].aFingers[j].tipPosition()));
+        }
+
+        return fMax;
+    }
+};
+
+static JointFilterTests jointFilterTests;
+
+//==============================================================================
+class TrailHistoryTests  : public UnitTest
+{
+public:
+    TrailHistoryTests() : UnitTest ("TrailHistory") {}
+
+    void runTest()
+    {
+        SyntheticHands hands (2);
+        FrameSnapshot frame;
+
+        beginTest ("Samples wrap around the ring");
+
+        {
+            TrailHistory history (4, 8);
+
+            for (int i = 0; i < 20; ++i)
+            {
+                hands.poseFrame (i / 100.0, frame);
+                history.addFrame (frame, 10.0 + i / 100.0, 5.0);
+            }
+
+            expect (history.isActive (0) && history.isActive (1) && ! history.isActive (2));
+            expectEquals (history.getNumSamples (0), 8);
+            expectEquals (history.getNewestIndex (0), 3);
+
+            const TrailHistory::Vertex* pNewest = history.getSample (0, history.getNewestIndex (0));
+            const Leap::Vector& vTip = frame.aHands[0].aFingers[0].avJoints[0];
+
+            expectEquals (pNewest->x, vTip.x);
+            expectEquals (pNewest->fTime, history.getTime (10.19));
+
+            // the oldest sample kept is the 13th frame
+            const TrailHistory::Vertex* pOldest = history.getSample (0, (history.getNewestIndex (0) + 1) % 8);
+            expect (std::abs (pOldest->fTime - history.getTime (10.12)) < 1.0e-5f);
+        }
+
+        beginTest ("Samples since a time");
+
+        {
+            TrailHistory history (2, 100);
+
+            for (int i = 0; i < 50; ++i)
+            {
+                hands.poseFrame (i / 10.0, frame);
+                history.addFrame (frame, i / 10.0, 100.0);
+            }
+
+            expectEquals (history.getNumSamplesSince (0, history.getTime (4.9)), 1);
+            expectEquals (history.getNumSamplesSince (0, history.getTime (4.05)), 9);
+            expectEquals (history.getNumSamplesSince (0, history.getTime (-1.0)), 50);
+            expectEquals (history.getNumSamplesSince (0, history.getTime (5.0)), 0);
+        }
+
+        beginTest ("Pending uploads");
+
+        {
+            TrailHistory history (2, 4);
+
+            for (int i = 0; i < 3; ++i)
+            {
+                hands.poseFrame (i / 100.0, frame);
+                history.addFrame (frame, i / 100.0, 1.0);
+            }
+
+            expectEquals (history.getNumPending (0), 3);
+            history.clearPending (0);
+            expectEquals (history.getNumPending (0), 0);
+
+            for (int i = 3; i < 10; ++i)
+            {
+                hands.poseFrame (i / 100.0, frame);
+                history.addFrame (frame, i / 100.0, 1.0);
+            }
+
+            expectEquals (history.getNumPending (0), 4);
+            history.clearPending (0);
+            history.markAllPending();
+            expectEquals (history.getNumPending (0), history.getNumSamples (0));
+        }
+
+        beginTest ("Hand lifecycle");
+
+        {
+            TrailHistory history (2, 16);
+
+            hands.poseFrame (0.0, frame);
+            history.addFrame (frame, 0.0, 1.0);
+
+            // hands that stay away longer than the trail lasts free their slots
+            frame.iNumHands = 0;
+            history.addFrame (frame, 0.5, 1.0);
+            expect (history.isActive (0));
+            history.addFrame (frame, 1.5, 1.0);
+            expect (! history.isActive (0) && ! history.isActive (1));
+
+            // a third hand takes the slot idle longest
+            hands.poseFrame (2.0, frame);
+            history.addFrame (frame, 2.0, 10.0);
+            frame.iNumHands = 1;
+            history.addFrame (frame, 2.1, 10.0);
+
+            frame.aHands[0].iId = 1000;
+            history.addFrame (frame, 2.2, 10.0);
+            expectEquals ((int) history.getId (1), 1000);
+            expectEquals (history.getNumSamples (1), 1);
+
+            // but not one already used by this frame
+            FrameSnapshot three;
+            hands.poseFrame (2.3, three);
+            three.iNumHands = 2;
+            three.aHands[0].iId = 1000;
+            three.aHands[1].iId = 2000;
+            history.addFrame (three, 2.3, 10.0);
+            expectEquals ((int) history.getId (1), 1000);
+            expectEquals ((int) history.getId (0), 2000);
+        }
+
+        beginTest ("Time going backwards starts over");
+
+        {
+            TrailHistory history (2, 16);
+
+            for (int i = 0; i < 5; ++i)
+            {
+                hands.poseFrame (i / 100.0, frame);
+                history.addFrame (frame, 100.0 + i / 100.0, 1.0);
+            }
+
+            history.addFrame (frame, 50.0, 1.0);
+            expectEquals (history.getNumSamples (0), 1);
+            expectEquals (history.getTime (50.0), 0.0f);
+        }
+    }
+};
+
+static TrailHistoryTests trailHistoryTests;
+
+//==============================================================================
+class RenderSchedulerTests  : public UnitTest
+{
+public:
+    RenderSchedulerTests() : UnitTest ("RenderScheduler") {}
+
+    void runTest()
+    {
+        beginTest ("Preferred mode while active");
+
+        {
+            RenderScheduler scheduler;
+            scheduler.noteActivity (100.0);
+
+            scheduler.update (101.0, false, false);
+            expect (scheduler.getMode() == RenderScheduler::kMode_TrackDriven);
+            expect (scheduler.frameArrived (false, 101.0));
+
+            scheduler.setPreferredMode (RenderScheduler::kMode_DisplayLocked);
+            expect (scheduler.update (101.0, false, false));
+            expect (scheduler.getMode() == RenderScheduler::kMode_DisplayLocked);
+            expect (! scheduler.frameArrived (true, 101.0));
+            expect (! scheduler.update (101.5, false, false));
+        }
+
+        beginTest ("Prediction needs the display rate");
+
+        {
+            RenderScheduler scheduler;
+            scheduler.noteActivity (0.0);
+
+            scheduler.update (1.0, false, true);
+            expect (scheduler.getMode() == RenderScheduler::kMode_DisplayLocked);
+        }
+
+        beginTest ("Idle without hands, awake with them");
+
+        {
+            RenderScheduler scheduler;
+            scheduler.setIdleTimeout (5.0);
+            scheduler.noteActivity (0.0);
+
+            for (int i = 0; i < 100; ++i)
+                expect (scheduler.frameArrived (false, i * 0.1));
+
+            scheduler.update (4.9, false, true);
+            expect (scheduler.getMode() == RenderScheduler::kMode_DisplayLocked);
+
+            expect (scheduler.update (5.1, false, true));
+            expect (scheduler.getMode() == RenderScheduler::kMode_Idle);
+            expect (! scheduler.frameArrived (false, 5.2));
+
+            // the first hand is drawn at once, the timer then leaves idle
+            expect (scheduler.frameArrived (true, 5.3));
+            expect (scheduler.update (5.4, false, true));
+            expect (scheduler.getMode() == RenderScheduler::kMode_DisplayLocked);
+        }
+
+        beginTest ("Paused and no timeout");
+
+        {
+            RenderScheduler scheduler;
+            scheduler.setIdleTimeout (0.0);
+            scheduler.noteActivity (0.0);
+
+            scheduler.update (1000.0, false, false);
+            expect (scheduler.getMode() == RenderScheduler::kMode_TrackDriven);
+
+            scheduler.update (1000.0, true, false);
+            expect (scheduler.getMode() == RenderScheduler::kMode_Idle);
+        }
+    }
+};
+
+static RenderSchedulerTests renderSchedulerTests;
+
+//==============================================================================
+class FrameStreamTests  : public UnitTest
+{
+public:
+    FrameStreamTests() : UnitTest ("FrameStream") {}
+
+    struct Receiver  : public FrameSnapshotConsumer
+    {
+        FrameSnapshot& beginFrame()     { return frame; }
+        void endFrame()                 { ++iNumFrames; }
+
+        FrameSnapshot   frame;
+        Atomic<int>     iNumFrames;
+    };
+
+    void expectSameHands (const FrameSnapshot& a, const FrameSnapshot& b)
+    {
+        expectEquals (b.iNumHands, a.iNumHands);
+
+        for (int i = 0; i < jmin (a.iNumHands, b.iNumHands); ++i)
+        {
+            const HandSnapshot& handA = a.aHands[i];
+            const HandSnapshot& handB = b.aHands[i];
+
+            expectEquals (handB.iId, handA.iId);
+            expect (handB.bIsLeft == handA.bIsLeft);
+            expect (handB.vPalmPosition.distanceTo (handA.vPalmPosition) < 0.01f);
+            expect (handB.vPalmNormal.distanceTo (handA.vPalmNormal) < 0.001f);
+            expect (std::abs (handB.aFingers[2].fWidth - handA.aFingers[2].fWidth) < 0.01f);
+
+            for (int j = 0; j < FingerSnapshot::kNumJoints; ++j)
+                expect (handB.aFingers[4].avJoints[j].distanceTo (handA.aFingers[4].avJoints[j]) < 0.01f);
+        }
+    }
+
+    void runTest()
+    {
+        SyntheticHands hands (2);
+        FrameSnapshot frame, decoded;
+
+        beginTest ("Varints");
+
+        {
+            const int32 aiValues[] = { 0, 1, -1, 63, -64, 64, 300, -300, 0x7fffffff, (int32) 0x80000000 };
+            uint8 aiBuffer[64];
+            FrameStream::Writer out (aiBuffer, sizeof (aiBuffer));
+
+            for (int i = 0; i < numElementsInArray (aiValues); ++i)
+                out.writeSignedVarint (aiValues[i]);
+
+            // one byte up to 63 either way
+            expectEquals (out.getSize(), 1 + 1 + 1 + 1 + 1 + 2 + 2 + 2 + 5 + 5);
+
+            FrameStream::Reader in (aiBuffer, (size_t) out.getSize());
+
+            for (int i = 0; i < numElementsInArray (aiValues); ++i)
+                expectEquals (in.readSignedVarint(), aiValues[i]);
+
+            expect (! in.failed());
+            in.readSignedVarint();
+            expect (in.failed());
+        }
+
+        beginTest ("Key frames and deltas round trip");
+
+        {
+            FrameStream::Encoder encoder;
+            FrameStream::Decoder decoder;
+            FrameStream::Decoder::FrameInfo info;
+            int iKeyFrameSize = 0, iMaxDeltaSize = 0;
+
+            for (int i = 0; i < 60; ++i)
+            {
+                hands.poseFrame (i / 120.0, frame);
+                frame.iFrameId   = 1000 + i;
+                frame.iTimestamp = 5000000 + i * 8333;
+
+                const int iSize = encoder.encode (frame, 42 + i);
+                expect (iSize <= FrameStream::getMaxFrameSize());
+                expect (decoder.decode (encoder.getData(), (size_t) iSize, decoded, info));
+
+                expectEquals ((int) info.iSequence, i);
+                expect (info.bKeyFrame == (i == 0));
+                expectEquals (info.iSendMicros, (int64) (42 + i));
+                expectEquals (decoded.iFrameId, frame.iFrameId);
+                expectEquals (decoded.iTimestamp, frame.iTimestamp);
+                expectSameHands (frame, decoded);
+
+                if (i == 0)
+                    iKeyFrameSize = iSize;
+                else
+                    iMaxDeltaSize = jmax (iMaxDeltaSize, iSize);
+            }
+
+            // small movements need far fewer bytes than absolute positions
+            expect (iMaxDeltaSize * 2 < iKeyFrameSize);
+
+            encoder.requestKeyFrame();
+            const int iSize = encoder.encode (frame, 0);
+            expect (decoder.decode (encoder.getData(), (size_t) iSize, decoded, info));
+            expect (info.bKeyFrame);
+        }
+
+        beginTest ("Deltas need their reference");
+
+        {
+            FrameStream::Encoder encoder;
+            FrameStream::Decoder decoder;
+            FrameStream::Decoder::FrameInfo info;
+
+            hands.poseFrame (0.0, frame);
+            encoder.encode (frame, 0);
+
+            hands.poseFrame (0.01, frame);
+            const int iSize = encoder.encode (frame, 0);
+
+            expect (! decoder.decode (encoder.getData(), (size_t) iSize, decoded, info));
+            expect (! decoder.decode (encoder.getData(), (size_t) iSize - 1, decoded, info));
+        }
+
+        beginTest ("Streams over localhost");
+
+        {
+            const int iPort = FrameStream::kDefaultPort + 7;
+            FrameStreamServer server;
+            Receiver receiver;
+
+            expect (server.start (iPort));
+
+            FrameStreamClient client ("127.0.0.1", iPort);
+            client.start (receiver);
+
+            for (int i = 0; i < 200 && server.getNumClients() == 0; ++i)
+                Thread::sleep (10);
+
+            expectEquals (server.getNumClients(), 1);
+
+            for (int i = 0; i < 100; ++i)
+            {
+                hands.poseFrame (i / 120.0, frame);
+                frame.iFrameId = i;
+                server.addFrame (frame);
+                Thread::sleep (2);
+            }
+
+            for (int i = 0; i < 200 && receiver.frame.iFrameId != 99; ++i)
+                Thread::sleep (10);
+
+            // the first frames can go before the client is fully connected
+            expectEquals ((int) receiver.frame.iFrameId, 99);
+            expect (receiver.iNumFrames.get() > 50);
+            expectSameHands (frame, receiver.frame);
+
+            const FrameStream::Stats clientStats = client.getStats();
+            expectEquals (clientStats.iNumFrames, receiver.iNumFrames.get());
+            expect (clientStats.iLastFrameBytes > 0);
+            expect (clientStats.fAverageLatencyMs >= 0.0f && clientStats.fAverageLatencyMs < 1000.0f);
+
+            const FrameStream::Stats serverStats = server.getStats();
+            expect (serverStats.iNumBytes >= clientStats.iNumBytes);
+            expect (serverStats.fLastLatencyMs > 0.0f);
+
+            client.stop();
+            server.stop();
+        }
+    }
+};
+
+static FrameStreamTests frameStreamTests;
+
+//==============================================================================
+class ViewLayoutTests  : public UnitTest
+{
+public:
+    ViewLayoutTests() : UnitTest ("ViewLayout") {}
+
+    void runTest()
+    {
+        beginTest ("Single view fills the area");
+
+        expectEquals (ViewLayout::getNumViews (ViewLayout::kLayout_Single), 1);
+        expect (ViewLayout::getViewBounds (ViewLayout::kLayout_Single, 0, 640, 480) == Rectangle<int> (0, 0, 640, 480));
+        expect (ViewLayout::getViewAngle (ViewLayout::kLayout_Single, 0) == ViewLayout::kView_Perspective);
+
+        beginTest ("Quad panes tile the area around the gaps");
+
+        {
+            const int aiSizes[][2] = { { 1024, 768 }, { 1023, 767 }, { 5, 4 } };
+
+            for (int iSize = 0; iSize < numElementsInArray (aiSizes); ++iSize)
+            {
+                const int iWidth  = aiSizes[iSize][0];
+                const int iHeight = aiSizes[iSize][1];
+                int64 iArea = 0;
+                int iNumPerspective = 0;
+
+                for (int i = 0; i < ViewLayout::getNumViews (ViewLayout::kLayout_Quad); ++i)
+                {
+                    const Rectangle<int> pane = ViewLayout::getViewBounds (ViewLayout::kLayout_Quad, i, iWidth, iHeight);
+
+                    expect (Rectangle<int> (0, 0, iWidth, iHeight).contains (pane));
+                    iArea += pane.getWidth() * pane.getHeight();
+
+                    for (int j = 0; j < i; ++j)
+                        expect (! pane.intersects (ViewLayout::getViewBounds (ViewLayout::kLayout_Quad, j, iWidth, iHeight)));
+
+                    if (ViewLayout::getViewAngle (ViewLayout::kLayout_Quad, i) == ViewLayout::kView_Perspective)
+                        ++iNumPerspective;
+                }
+
+                expectEquals (iNumPerspective, 1);
+                expectEquals (iArea, (int64) (iWidth - ViewLayout::kGap) * (iHeight - ViewLayout::kGap));
+            }
+        }
+    }
+};
+
+static ViewLayoutTests viewLayoutTests;
+
+//==============================================================================
+class GestureEngineTests  : public UnitTest
+{
+public:
+    GestureEngineTests() : UnitTest ("GestureEngine") {}
+
+    struct Recorder  : public GestureEngine::Listener
     {
-        ScopedLock sceneLock(m_renderMutex);
+        void gestureRecognized (const GestureEvent& event)     { events.add (event); }
 
-        double curSysTimeSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks());
+        int count (GestureEvent::Type type, GestureEvent::State state) const
+        {
+            int iCount = 0;
 
-        float deltaTimeSeconds = static_cast<float>(curSysTimeSeconds - m_fLastUpdateTimeSeconds);
-      
-        m_fLastUpdateTimeSeconds = curSysTimeSeconds;
-        float fUpdateDT = m_avgUpdateDeltaTime.AddSample( deltaTimeSeconds );
-        float fUpdateFPS = (fUpdateDT > 0) ? 1.0f/fUpdateDT : 0.0f;
-        m_strUpdateFPS = String::formatted( "UpdateFPS: %4.2f", fUpdateFPS );
+            for (int i = 0; i < events.size(); ++i)
+                if (events.getReference (i).type == type && events.getReference (i).state == state)
+                    ++iCount;
+
+            return iCount;
+        }
+
+        const GestureEvent* find (GestureEvent::Type type) const
+        {
+            for (int i = 0; i < events.size(); ++i)
+                if (events.getReference (i).type == type)
+                    return &events.getReference (i);
+
+            return nullptr;
+        }
+
+        Array<GestureEvent> events;
+    };
+
+    static void moveHand (HandSnapshot& hand, const Leap::Vector& vOffset)
+    {
+        hand.vPalmPosition += vOffset;
+        hand.vWrist += vOffset;
+
+        for (int i = 0; i < HandSnapshot::kNumFingers; ++i)
+            for (int j = 0; j < FingerSnapshot::kNumJoints; ++j)
+                hand.aFingers[i].avJoints[j] += vOffset;
     }
 
-    /// affects model view matrix.  needs to be inside a glPush/glPop matrix block!
-    void setupScene()
+    void runTest()
     {
-        OpenGLHelpers::clear (Colours::black.withAlpha (1.0f));
+        SyntheticHands hands (1);
+        FrameSnapshot pose, frame;
+        hands.poseFrame (0.0, pose);
 
-        m_camera.SetAspectRatio( getWidth() / static_cast<float>(getHeight()) );
+        const Leap::Vector vThumb = pose.aHands[0].aFingers[0].tipPosition();
 
-        m_camera.SetupGLProjection();
+        beginTest ("Pinch starts and ends with hysteresis");
 
-        m_camera.ResetGLView();
+        expect (vThumb.distanceTo (pose.aHands[0].aFingers[1].tipPosition()) > GestureEngine::getPinchEndDistance());
 
-        // left, high, near - corner light
-        LeapUtilGL::GLVector4fv vLight0Position( -3.0f, 3.0f, -3.0f, 1.0f );
-        // right, near - side light
-        LeapUtilGL::GLVector4fv vLight1Position(  3.0f, 0.0f, -1.5f, 1.0f );
-        // near - head light
-        LeapUtilGL::GLVector4fv vLight2Position( 0.0f, 0.0f,  -3.0f, 1.0f );
+        {
+            GestureEngine engine;
+            Recorder recorder;
+            engine.addListener (&recorder);
 
-        /// JUCE turns off the depth test every frame when calling paint.
-        glEnable(GL_DEPTH_TEST);
-        glDepthMask(true);
-        glDepthFunc(GL_LESS);
+            for (int i = 0; i < 300; ++i)
+            {
+                frame = pose;
 
-        glEnable(GL_BLEND);
-        glEnable(GL_TEXTURE_2D);
+                // fingers meet between 100 and 200 ms
+                if (i >= 100 && i < 200)
+                    frame.aHands[0].aFingers[1].avJoints[FingerSnapshot::kNumJoints - 1] = vThumb + Leap::Vector (10.0f, 0.0f, 0.0f);
 
-        glLightModelfv(GL_LIGHT_MODEL_AMBIENT, GLColor(Colours::darkgrey));
+                engine.process (frame, i * 0.001);
 
-        glLightfv(GL_LIGHT0, GL_POSITION, vLight0Position);
-        glLightfv(GL_LIGHT0, GL_DIFFUSE, GLColor(0.25f, 0.20f, 0.20f, 1.0f));
-        glLightfv(GL_LIGHT0, GL_AMBIENT, GLColor(Colours::black));
+                if (i == 99)
+                    expectEquals (recorder.count (GestureEvent::kPinch, GestureEvent::kStart), 0);
+            }
 
-        glLightfv(GL_LIGHT1, GL_POSITION, vLight1Position);
-        glLightfv(GL_LIGHT1, GL_DIFFUSE, GLColor(0.0f, 0.0f, 0.125f, 1.0f));
-        glLightfv(GL_LIGHT1, GL_AMBIENT, GLColor(Colours::black));
+            expectEquals (recorder.count (GestureEvent::kPinch, GestureEvent::kStart), 1);
+            expectEquals (recorder.count (GestureEvent::kPinch, GestureEvent::kEnd), 1);
 
-        glLightfv(GL_LIGHT2, GL_POSITION, vLight2Position);
-        glLightfv(GL_LIGHT2, GL_DIFFUSE, GLColor(0.15f, 0.15f, 0.15f, 1.0f));
-        glLightfv(GL_LIGHT2, GL_AMBIENT, GLColor(Colours::black));
+            const GestureEvent* pEvent = recorder.find (GestureEvent::kPinch);
+            expect (pEvent != nullptr && pEvent->iHandId == pose.aHands[0].iId);
 
-        glEnable(GL_LIGHT0);
-        glEnable(GL_LIGHT1);
-        glEnable(GL_LIGHT2);
+            // the window mean needs a few frames to cross the threshold, not the whole window
+            expect (pEvent != nullptr && pEvent->fSeconds > 0.1 && pEvent->fSeconds < 0.13);
+        }
 
-        m_camera.SetupGLView();
-    }
+        beginTest ("A hand leaving ends its gestures");
 
-    // data should be drawn here but no heavy calculations done.
-    // any major calculations that only need to be updated per leap data frame
-    // should be handled in update and cached in members.
-    void renderOpenGL()
-    {
-		    {
-			      MessageManagerLock mm (Thread::getCurrentThread());
-			      if (! mm.lockWasGained())
-				      return;
-		    }
+        {
+            GestureEngine engine;
+            Recorder recorder;
+            engine.addListener (&recorder);
 
-        Leap::Frame frame = m_lastFrame;
+            frame = pose;
+            frame.aHands[0].aFingers[1].avJoints[FingerSnapshot::kNumJoints - 1] = vThumb;
 
-        double  curSysTimeSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks());
-        float   fRenderDT = static_cast<float>(curSysTimeSeconds - m_fLastRenderTimeSeconds);
-        fRenderDT = m_avgRenderDeltaTime.AddSample( fRenderDT );
-        m_fLastRenderTimeSeconds = curSysTimeSeconds;
+            for (int i = 0; i < 50; ++i)
+                engine.process (frame, i * 0.001);
 
-        float fRenderFPS = (fRenderDT > 0) ? 1.0f/fRenderDT : 0.0f;
+            expectEquals (engine.getNumTrackedHands(), 1);
 
-        m_strRenderFPS = String::formatted( "RenderFPS: %4.2f", fRenderFPS );
+            frame.iNumHands = 0;
+            engine.process (frame, 0.05);
 
-        LeapUtilGL::GLMatrixScope sceneMatrixScope;
+            expectEquals (engine.getNumTrackedHands(), 0);
+            expectEquals (recorder.count (GestureEvent::kPinch, GestureEvent::kEnd), 1);
+        }
 
-        setupScene();
+        beginTest ("Swipes are reported once");
 
-        // draw the grid background
         {
-            LeapUtilGL::GLAttribScope colorScope(GL_CURRENT_BIT);
-
-            glColor3f( 0, 0, 1 );
+            GestureEngine engine;
+            Recorder recorder;
+            engine.addListener (&recorder);
 
+            for (int i = 0; i < 600; ++i)
             {
-                LeapUtilGL::GLMatrixScope gridMatrixScope;
+                // still, then 2 m/s to the right for 200 ms, then still again
+                const float fTravel = 2.0f * jlimit (0, 200, i - 200);
 
-                glTranslatef( 0, 0.0f, -1.5f );
+                frame = pose;
+                moveHand (frame.aHands[0], Leap::Vector (fTravel, 0.0f, 0.0f));
+                engine.process (frame, i * 0.001);
+            }
 
-                glScalef( 3, 3, 3 );
+            expectEquals (recorder.count (GestureEvent::kSwipe, GestureEvent::kComplete), 1);
 
-                LeapUtilGL::drawGrid( LeapUtilGL::kPlane_XY, 20, 20 );
-            }
+            const GestureEvent* pEvent = recorder.find (GestureEvent::kSwipe);
+            expect (pEvent != nullptr && pEvent->vDirection.x > 0.99f);
+            expect (pEvent != nullptr && String (GestureEvent::getDirectionName (pEvent->vDirection)) == "right");
+        }
 
-            {
-                LeapUtilGL::GLMatrixScope gridMatrixScope;
+        beginTest ("Circles of the index finger");
+
+        {
+            GestureEngine engine;
+            Recorder recorder;
+            engine.addListener (&recorder);
+
+            const Leap::Vector vCenter = pose.aHands[0].aFingers[1].tipPosition();
+            const float fRadius = 40.0f;
 
-                glTranslatef( 0, -1.5f, 0.0f );
+            // anticlockwise as seen by the user, one turn a second
+            for (int i = 0; i < 2500; ++i)
+            {
+                const float fAngle = 2.0f * float_Pi * i * 0.001f;
 
-                glScalef( 3, 3, 3 );
+                frame = pose;
+                frame.aHands[0].aFingers[1].avJoints[FingerSnapshot::kNumJoints - 1]
+                    = vCenter + Leap::Vector (std::cos (fAngle), std::sin (fAngle), 0.0f) * fRadius;
 
-                LeapUtilGL::drawGrid( LeapUtilGL::kPlane_ZX, 20, 20 );
+                engine.process (frame, i * 0.001);
             }
+
+            expectEquals (recorder.count (GestureEvent::kCircle, GestureEvent::kComplete), 2);
+
+            const GestureEvent* pEvent = recorder.find (GestureEvent::kCircle);
+            expect (pEvent != nullptr && pEvent->vDirection.z > 0.99f);
+            expect (pEvent != nullptr && std::abs (pEvent->fValue - fRadius) < fRadius * 0.05f);
+            expect (pEvent != nullptr && pEvent->vPosition.distanceTo (vCenter) < 5.0f);
+            expect (pEvent != nullptr && pEvent->getDescription().startsWith ("circle anticlockwise"));
         }
 
-        // draw fingers/tools as lines with sphere at the tip.
-        drawHands( frame );
+        beginTest ("Tremor isn't a circle");
 
         {
-          ScopedLock renderLock(m_renderMutex);
+            GestureEngine engine;
+            Recorder recorder;
+            engine.addListener (&recorder);
+            Random random (42);
+
+            for (int i = 0; i < 3000; ++i)
+            {
+                frame = pose;
+                frame.aHands[0].aFingers[1].avJoints[FingerSnapshot::kNumJoints - 1]
+                    += Leap::Vector (random.nextFloat() - 0.5f, random.nextFloat() - 0.5f, random.nextFloat() - 0.5f) * 6.0f;
+
+                engine.process (frame, i * 0.001);
+            }
 
-          // draw the text overlay
-          renderOpenGL2D();
+            expectEquals (recorder.count (GestureEvent::kCircle, GestureEvent::kComplete), 0);
         }
-    }
 
-    void drawHands( Leap::Frame frame )
-    {
-        LeapUtilGL::GLMatrixScope matrixScope;
+        beginTest ("Window sums stay exact once the ring is full");
+
+        {
+            GestureEngine engine;
+            Random random (7);
+
+            // at 10 kHz the longer windows want more samples than the ring holds
+            for (int i = 0; i < GestureEngine::kMaxSamples * 3; ++i)
+            {
+                frame = pose;
+                moveHand (frame.aHands[0], Leap::Vector (random.nextFloat(), random.nextFloat(), random.nextFloat()) * 20.0f);
+                frame.aHands[0].aFingers[1].avJoints[FingerSnapshot::kNumJoints - 1]
+                    += Leap::Vector (random.nextFloat(), random.nextFloat(), random.nextFloat()) * 20.0f;
+
+                engine.process (frame, i * 0.0001);
+            }
+
+            const GestureEngine::Hand& hand = engine.m_aHands[0];
+            const GestureEngine::Window* apWindows[] = { &hand.pinchWindow, &hand.grabWindow, &hand.swipeWindow, &hand.circleWindow };
+
+            expectEquals (hand.circleWindow.getNumSamples (hand.iNewest), GestureEngine::kMaxSamples - 1);
+
+            for (int w = 0; w < numElementsInArray (apWindows); ++w)
+            {
+                const GestureEngine::Window& window = *apWindows[w];
+
+                expect (window.getNumSamples (hand.iNewest) < GestureEngine::kMaxSamples);
 
-        glTranslatef(m_vFrameTranslation.x, m_vFrameTranslation.y, m_vFrameTranslation.z);
-        glScalef(m_fFrameScale, m_fFrameScale, m_fFrameScale);
+                for (int v = 0; v < GestureEngine::kNumValues; ++v)
+                {
+                    double fSum = 0.0;
+
+                    for (int64 j = window.iOldest; j <= hand.iNewest; ++j)
+                        fSum += hand.aSamples[j & (GestureEngine::kMaxSamples - 1)].afValues[v];
+
+                    expect (std::abs (window.afSums[v] - fSum) < 1.0e-3 * (1.0 + std::abs (fSum)),
+                            "window " + String (w) + " value " + String (v));
+                }
+            }
+        }
 
-        const Leap::HandList& hands = frame.hands();
+        beginTest ("Benchmark report");
 
-        for ( size_t i = 0, e = hands.count(); i < e; i++ )
         {
-            const Leap::Hand& hand        = hands[i];
-            const uint32_t    colorIndex  = static_cast<uint32_t>(hand.id()) % kNumColors;
+            FrameBenchmark::Settings settings;
+            settings.iNumFrames       = 2000;
+            settings.iNumWarmupFrames = 0;
+            settings.iNumHands        = 4;
+
+            GestureBenchmark benchmark (settings);
+            const var report (JSON::parse (benchmark.createReport()));
+
+            expectEquals ((int) report["hands"], 4);
+            expectEquals ((int) report["warmupFrames"], (int) GestureEngine::kMaxSamples);
+            expect ((double) report["frameUs"]["p99"] >= (double) report["frameUs"]["p50"]);
 
-            LeapUtilGL::drawSkeletonHand( hand, m_vBoneColor, m_avJointColors[colorIndex] );
+            // keeping up with 1000 Hz takes well under a millisecond a frame
+            expect ((double) report["budgetPercent"] < 50.0);
         }
     }
+};
 
-    virtual void onInit(const Leap::Controller&) 
-    {
-    }
+static GestureEngineTests gestureEngineTests;
+
+//==============================================================================
+class SceneShadingTests  : public UnitTest
+{
+public:
+    SceneShadingTests() : UnitTest ("SceneShading") {}
 
-    virtual void onConnect(const Leap::Controller&) 
+    static bool isNear (const Leap::Vector& a, const Leap::Vector& b)
     {
+        return std::abs (a.x - b.x) < 1.0e-4f && std::abs (a.y - b.y) < 1.0e-4f && std::abs (a.z - b.z) < 1.0e-4f;
     }
 
-    virtual void onDisconnect(const Leap::Controller&) 
+    static Leap::Vector transformNormal (const SceneTransform& transform, const Leap::Vector& vNormal)
     {
+        GLfloat m[9];
+        transform.getNormalMatrix (m);
+
+        return Leap::Vector (m[0] * vNormal.x + m[3] * vNormal.y + m[6] * vNormal.z,
+                             m[1] * vNormal.x + m[4] * vNormal.y + m[7] * vNormal.z,
+                             m[2] * vNormal.x + m[5] * vNormal.y + m[8] * vNormal.z).normalized();
     }
 
-    virtual void onFrame(const Leap::Controller& controller)
+    void runTest()
     {
-        if ( !m_bPaused )
+        typedef SceneTransform::Matrix Matrix;
+
+        beginTest ("Model transform scales, then moves");
+
         {
-          Leap::Frame frame = controller.frame();
-          update( frame );
-          m_lastFrame = frame;
-          m_openGLContext.triggerRepaint();
+            const SceneTransform model = SceneTransform().withModel (Leap::Vector (0.0f, -2.0f, 0.5f), 0.0075f);
+
+            expect (isNear (model.project (Leap::Vector (100.0f, 200.0f, -40.0f)), Leap::Vector (0.75f, -0.5f, 0.2f)));
+
+            const Matrix product = SceneTransform::multiply (Matrix(), model.getModelView());
+
+            for (int i = 0; i < 16; ++i)
+                expect (product.mat[i] == model.getModelView().mat[i]);
         }
-    }
 
-    void resetCamera()
-    {
-        m_camera.SetOrbitTarget( Leap::Vector::zero() );
-        m_camera.SetPOVLookAt( Leap::Vector( 0, 0, 4 ), m_camera.GetOrbitTarget() );
-    }
+        beginTest ("Perspective matches gluPerspective");
 
-    void initColors()
-    {
-      unsigned int i = 0;
+        {
+            const SceneTransform transform (SceneTransform::getPerspective (90.0f, 2.0f, 1.0f, 10.0f), Matrix());
 
-      m_vBoneColor = GLColor(Colours::darkgrey);
+            expect (isNear (transform.project (Leap::Vector (0.0f, 0.0f, -1.0f)), Leap::Vector (0.0f, 0.0f, -1.0f)));
+            expect (isNear (transform.project (Leap::Vector (0.0f, 0.0f, -10.0f)), Leap::Vector (0.0f, 0.0f, 1.0f)));
+            expect (isNear (transform.project (Leap::Vector (1.0f, 1.0f, -1.0f)), Leap::Vector (0.5f, 1.0f, -1.0f)));
+        }
 
-      m_avJointColors[i++] = GLColor(Colours::aqua);
-      m_avJointColors[i++] = GLColor(Colours::darkgreen);
-      m_avJointColors[i++] = GLColor(Colours::blueviolet);
-      m_avJointColors[i++] = GLColor(Colours::crimson);
-      m_avJointColors[i++] = GLColor(Colours::salmon);
-      m_avJointColors[i++] = GLColor(Colours::blue);
-      m_avJointColors[i++] = GLColor(Colours::seagreen);
-      m_avJointColors[i++] = GLColor(Colours::orange);
+        beginTest ("View is the inverse of the point of view");
 
-      jassert(i == kNumColors);
-    }
+        {
+            const Leap::Matrix front (Leap::Vector::xAxis(), Leap::Vector::yAxis(), Leap::Vector::zAxis(), Leap::Vector (0.0f, 0.0f, 4.0f));
+            const SceneTransform frontView (Matrix(), SceneTransform::getView (front));
 
-private:
-    OpenGLContext               m_openGLContext;
-    LeapUtilGL::CameraGL        m_camera;
-    Leap::Frame                 m_lastFrame;
-    double                      m_fLastUpdateTimeSeconds;
-    double                      m_fLastRenderTimeSeconds;
-    Leap::Vector                m_vFrameTranslation;
-    float                       m_fFrameScale;
-    LeapUtil::RollingAverage<>  m_avgUpdateDeltaTime;
-    LeapUtil::RollingAverage<>  m_avgRenderDeltaTime;
-    String                      m_strUpdateFPS;
-    String                      m_strRenderFPS;
-    String                      m_strPrompt;
-    String                      m_strHelp;
-    Font                        m_fixedFont;
-    CriticalSection             m_renderMutex;
-    bool                        m_bShowHelp;
-    bool                        m_bPaused;
+            expect (isNear (frontView.project (Leap::Vector::zero()), Leap::Vector (0.0f, 0.0f, -4.0f)));
 
-    GLColor                     m_vBoneColor;
-    enum  { kNumColors = 8 };
-    GLColor                     m_avJointColors[kNumColors];
+            // the top view from ViewLayout, looking down with -z up on screen
+            const Leap::Matrix top (Leap::Vector (1.0f, 0.0f, 0.0f), Leap::Vector (0.0f, 0.0f, -1.0f),
+                                    Leap::Vector (0.0f, 1.0f, 0.0f), Leap::Vector (0.0f, 4.0f, 0.0f));
+            const SceneTransform topView (Matrix(), SceneTransform::getView (top));
+
+            expect (isNear (topView.project (Leap::Vector (1.0f, 0.0f, -1.0f)), Leap::Vector (1.0f, 1.0f, -4.0f)));
+        }
+
+        beginTest ("Normal matrix");
+
+        {
+            // a quarter turn about z, x goes to y
+            const Matrix rotation (0.0f, 1.0f, 0.0f, 0.0f,
+                                   -1.0f, 0.0f, 0.0f, 0.0f,
+                                   0.0f, 0.0f, 1.0f, 0.0f,
+                                   0.0f, 0.0f, 0.0f, 1.0f);
+            const SceneTransform rotated = SceneTransform (Matrix(), rotation).withModel (Leap::Vector (1.0f, 2.0f, 3.0f), 0.0075f);
+
+            expect (isNear (transformNormal (rotated, Leap::Vector::xAxis()), Leap::Vector::yAxis()));
+
+            // stretching x twice tilts the normal of the plane x = y towards -y
+            Matrix stretch;
+            stretch.mat[0] = 2.0f;
+
+            const Leap::Vector vNormal = transformNormal (SceneTransform (Matrix(), stretch), Leap::Vector (1.0f, -1.0f, 0.0f));
+            expect (isNear (vNormal, Leap::Vector (1.0f, -2.0f, 0.0f).normalized()));
+        }
+
+        beginTest ("Light block is std140");
+
+        expectEquals ((int) offsetof (SceneLighting::Lights, aafPosition), 16);
+        expectEquals ((int) offsetof (SceneLighting::Lights, aafDiffuse), 16 + 16 * SceneLighting::kNumLights);
+        expectEquals ((int) sizeof (SceneLighting::Lights), 16 + 32 * SceneLighting::kNumLights);
+
+        beginTest ("Shader translation");
+
+        {
+            const char* szVertex   = "attribute vec3 position;\nvarying vec4 color;\nvoid main() {}\n";
+            const char* szFragment = "varying vec4 color;\nvoid main() { gl_FragColor = color; }\n";
+
+            const String strVertex120   = SceneLighting::translateShader (szVertex, GL_VERTEX_SHADER, false);
+            const String strVertex140   = SceneLighting::translateShader (szVertex, GL_VERTEX_SHADER, true);
+            const String strFragment140 = SceneLighting::translateShader (szFragment, GL_FRAGMENT_SHADER, true);
+
+            expect (strVertex120.startsWith ("#version 120\n"));
+            expect (strVertex120.contains ("uniform vec4 lightPosition[3];"));
+            expect (strVertex120.contains ("attribute vec3 position;"));
+            expect (strVertex120.contains ("shadeVertex"));
+
+            expect (strVertex140.startsWith ("#version 140\n"));
+            expect (strVertex140.contains ("uniform SceneLights"));
+            expect (strVertex140.contains ("in vec3 position;"));
+            expect (strVertex140.contains ("out vec4 color;"));
+            expect (! strVertex140.contains ("attribute"));
+
+            expect (strFragment140.startsWith ("#version 140\n"));
+            expect (strFragment140.contains ("in vec4 color;"));
+            expect (strFragment140.contains ("fragmentColor = color;"));
+            expect (! strFragment140.contains ("gl_FragColor"));
+            expect (SceneLighting::translateShader (szFragment, GL_FRAGMENT_SHADER, false) == "#version 120\n" + String (szFragment));
+        }
+    }
 };
 
+static SceneShadingTests sceneShadingTests;
+
 //==============================================================================
-/**
-    This is the top-level window that we'll pop up. Inside it, we'll create and
-    show a component from the MainComponent.cpp file (you can open this file using
-    the Jucer to edit it).
-*/
-class FingerVisualizerWindow  : public DocumentWindow
+class FrameProfilerTests  : public UnitTest
 {
 public:
-    //==============================================================================
-    FingerVisualizerWindow()
-        : DocumentWindow ("Leap Finger Visualizer",
-                          Colours::lightgrey,
-                          DocumentWindow::allButtons,
-                          true)
+    FrameProfilerTests() : UnitTest ("FrameProfiler") {}
+
+    void runTest()
     {
-        setContentOwned (new OpenGLCanvas(), true);
+        beginTest ("Disabled records nothing");
 
-        // Centre the window on the screen
-        centreWithSize (getWidth(), getHeight());
+        {
+            ScopedPointer<FrameProfiler> profiler (new FrameProfiler());
 
-        // And show it!
-        setVisible (true);
+            {
+                const ScopedProfile profile (*profiler, FrameProfiler::kScope_Render);
+            }
 
-        getChildComponent(0)->grabKeyboardFocus();
+            expect (! profiler->collect());
+
+            profiler->setEnabled (true);
+
+            {
+                const ScopedProfile profile (*profiler, FrameProfiler::kScope_Render);
+            }
+
+            expect (profiler->collect());
+            expectEquals (profiler->getReport().aCpu[FrameProfiler::kScope_Render].iNumSamples, 1);
+        }
+
+        beginTest ("Scopes nest and add up per frame");
+
+        {
+            ScopedPointer<FrameProfiler> profiler (new FrameProfiler());
+            profiler->setEnabled (true);
+
+            // two views each draw a grid inside the render scope
+            const int iRender = profiler->enterScope (FrameProfiler::kScope_Render);
+            expectEquals (iRender, 0);
+
+            for (int i = 0; i < 2; ++i)
+            {
+                const int iGrid = profiler->enterScope (FrameProfiler::kScope_Grid);
+                expectEquals (iGrid, 1);
+                profiler->leaveScope (FrameProfiler::kScope_Grid, ms (1 + i * 3), ms (3 + i * 3), iGrid);
+            }
+
+            profiler->leaveScope (FrameProfiler::kScope_Render, ms (0), ms (10), iRender);
+
+            // a scope on another thread doesn't end the render frame
+            const int iFilter = profiler->enterScope (FrameProfiler::kScope_Filter);
+            expectEquals (iFilter, 0);
+            profiler->leaveScope (FrameProfiler::kScope_Filter, ms (0), ms (1), iFilter);
+
+            expect (profiler->collect());
+
+            const FrameProfiler::Report& report = profiler->getReport();
+            expectEquals (report.aCpu[FrameProfiler::kScope_Grid].iNumSamples, 1);
+            expect (std::abs (report.aCpu[FrameProfiler::kScope_Grid].fP50Ms - 4.0f) < 0.01f);
+            expect (std::abs (report.aCpu[FrameProfiler::kScope_Render].fMaxMs - 10.0f) < 0.01f);
+
+            // the processing thread's frame stays open until its root ends
+            expectEquals (report.aCpu[FrameProfiler::kScope_Filter].iNumSamples, 0);
+
+            expectEquals (report.cpuFlame.iNumBars, 3);
+            expect (std::abs (report.cpuFlame.fLengthMs - 10.0f) < 0.01f);
+            expectEquals (report.cpuFlame.aBars[1].iDepth, 1);
+            expect (std::abs (report.cpuFlame.aBars[1].fStartMs - 4.0f) < 0.01f);
+        }
+
+        beginTest ("Percentiles and histogram");
+
+        {
+            ScopedPointer<FrameProfiler> profiler (new FrameProfiler());
+            profiler->setEnabled (true);
+
+            for (int i = 1; i <= 100; ++i)
+                profiler->leaveScope (FrameProfiler::kScope_Timer, 0, ms (i * 0.1), profiler->enterScope (FrameProfiler::kScope_Timer));
+
+            profiler->collect();
+
+            const FrameProfiler::ScopeStats& stats = profiler->getReport().aCpu[FrameProfiler::kScope_Timer];
+            expectEquals (stats.iNumSamples, 100);
+            expect (std::abs (stats.fP50Ms - 5.0f) < 0.01f);
+            expect (std::abs (stats.fP99Ms - 9.9f) < 0.01f);
+            expect (std::abs (stats.fMaxMs - 10.0f) < 0.01f);
+
+            int iTotal = 0;
+
+            for (int i = 0; i < FrameProfiler::kNumBuckets; ++i)
+                iTotal += stats.aiHistogram[i];
+
+            expectEquals (iTotal, 100);
+
+            // 4 to 8 ms: 4.0 .. 7.9
+            expectEquals (stats.aiHistogram[FrameProfiler::getBucket (5.0f)], 40);
+            expectEquals (FrameProfiler::getBucket (1.0f), (int) FrameProfiler::kBucketShift);
+            expectEquals (FrameProfiler::getBucket (0.0f), 0);
+            expectEquals (FrameProfiler::getBucket (1.0e6f), FrameProfiler::kNumBuckets - 1);
+            expectEquals (FrameProfiler::getBucketStartMs (FrameProfiler::kBucketShift + 2), 4.0f);
+        }
+
+        beginTest ("GPU events arrive separately");
+
+        {
+            ScopedPointer<FrameProfiler> profiler (new FrameProfiler());
+            profiler->setEnabled (true);
+
+            // read back innermost first, the root last
+            profiler->addGpuEvent (FrameProfiler::kScope_Hands, 1000000, 3000000, 1);
+            profiler->addGpuEvent (FrameProfiler::kScope_Render, 0, 5000000, 0);
+            profiler->collect();
+
+            const FrameProfiler::Report& report = profiler->getReport();
+            expect (report.bHasGpu);
+            expectEquals (report.aCpu[FrameProfiler::kScope_Hands].iNumSamples, 0);
+            expect (std::abs (report.aGpu[FrameProfiler::kScope_Hands].fP50Ms - 2.0f) < 0.001f);
+            expect (std::abs (report.gpuFlame.fLengthMs - 5.0f) < 0.001f);
+        }
+
+        beginTest ("Full ring drops events");
+
+        {
+            ScopedPointer<FrameProfiler> profiler (new FrameProfiler());
+            profiler->setEnabled (true);
+
+            for (int i = 0; i < FrameProfiler::kRingSize + 10; ++i)
+                profiler->addEvent (FrameProfiler::kScope_Swap, 0, ms (1));
+
+            profiler->collect();
+            expectEquals (profiler->getReport().iNumDropped, 10);
+
+            // draining makes room again
+            profiler->leaveScope (FrameProfiler::kScope_Render, 0, ms (1), profiler->enterScope (FrameProfiler::kScope_Render));
+            expect (profiler->collect());
+            expectEquals (profiler->getReport().aCpu[FrameProfiler::kScope_Swap].iNumSamples, 1);
+        }
     }
 
-    ~FingerVisualizerWindow()
+    static int64 ms (double fMs)
     {
-        // (the content component will be deleted automatically, so no need to do it here)
+        return Time::secondsToHighResolutionTicks (fMs * 0.001);
     }
+};
 
-    //==============================================================================
-    void closeButtonPressed()
+static FrameProfilerTests frameProfilerTests;
+
+//==============================================================================
+class SkeletonDetailTests  : public UnitTest
+{
+public:
+    SkeletonDetailTests() : UnitTest ("SkeletonDetail") {}
+
+    void runTest()
     {
-        // When the user presses the close button, we'll tell the app to quit. This
-        JUCEApplication::quit();
+        beginTest ("Projected radius");
+
+        {
+            // a 90 degree view, the model half size and 10 units in front of the camera
+            const SceneTransform transform = SceneTransform (SceneTransform::getPerspective (90.0f, 1.0f, 1.0f, 100.0f), SceneTransform::Matrix())
+                                               .withModel (Leap::Vector (0.0f, 0.0f, -10.0f), 0.5f);
+
+            expect (std::abs (transform.getProjectedRadius (Leap::Vector::zero(), 2.0f, 400) - 20.0f) < 1.0e-3f);
+
+            // twice as far is half the size
+            expect (std::abs (transform.getProjectedRadius (Leap::Vector (0.0f, 0.0f, -20.0f), 2.0f, 400) - 10.0f) < 1.0e-3f);
+
+            // behind the camera
+            expectEquals (transform.getProjectedRadius (Leap::Vector (0.0f, 0.0f, 30.0f), 2.0f, 400), 0.0f);
+        }
+
+        beginTest ("Levels get coarser with size");
+
+        {
+            expectEquals ((int) SkeletonDetail::getLevelForRadius (50.0f), (int) SkeletonDetail::kLevel_Full);
+            expectEquals ((int) SkeletonDetail::getLevelForRadius (7.0f),  (int) SkeletonDetail::kLevel_Medium);
+            expectEquals ((int) SkeletonDetail::getLevelForRadius (3.0f),  (int) SkeletonDetail::kLevel_Low);
+            expectEquals ((int) SkeletonDetail::getLevelForRadius (0.5f),  (int) SkeletonDetail::kLevel_Impostor);
+
+            expectEquals (SkeletonDetail::getSphereVertexCount (SkeletonDetail::kLevel_Full), 8 * 12 * 6);
+            expectEquals (SkeletonDetail::getSphereVertexCount (SkeletonDetail::kLevel_Impostor), (int) SkeletonDetail::kSpriteVertices);
+
+            for (int i = 1; i < SkeletonDetail::kNumLevels; ++i)
+                expect (SkeletonDetail::getHandVertexCount ((SkeletonDetail::Level) i)
+                          < SkeletonDetail::getHandVertexCount ((SkeletonDetail::Level) (i - 1)));
+        }
+
+        const float afPixels[] = { 20.0f, 3.0f, 12.0f, 1.0f };
+        const int   iFull      = SkeletonDetail::getHandVertexCount (SkeletonDetail::kLevel_Full);
+        const int   iImpostor  = SkeletonDetail::getHandVertexCount (SkeletonDetail::kLevel_Impostor);
+
+        SkeletonDetail::Level aLevels[4];
+
+        beginTest ("Without a budget sizes decide");
+
+        {
+            SkeletonDetail detail;
+
+            detail.chooseLevels (afPixels, 4, aLevels);
+            expectEquals ((int) aLevels[0], (int) SkeletonDetail::kLevel_Full);
+            expectEquals ((int) aLevels[1], (int) SkeletonDetail::kLevel_Low);
+            expectEquals ((int) aLevels[2], (int) SkeletonDetail::kLevel_Full);
+            expectEquals ((int) aLevels[3], (int) SkeletonDetail::kLevel_Impostor);
+
+            detail.setEnabled (false);
+            detail.setVertexBudget (1);
+            expectEquals (detail.chooseLevels (afPixels, 4, aLevels), 4 * iFull);
+            expectEquals ((int) aLevels[3], (int) SkeletonDetail::kLevel_Full);
+        }
+
+        beginTest ("Budget coarsens the smallest hands first");
+
+        {
+            SkeletonDetail detail;
+
+            detail.setVertexBudget (iFull + 3 * iImpostor);
+            expectEquals (detail.chooseLevels (afPixels, 4, aLevels), iFull + 3 * iImpostor);
+            expectEquals ((int) aLevels[0], (int) SkeletonDetail::kLevel_Full);
+            expectEquals ((int) aLevels[1], (int) SkeletonDetail::kLevel_Impostor);
+            expectEquals ((int) aLevels[2], (int) SkeletonDetail::kLevel_Impostor);
+
+            // stops as soon as the frame fits, the second smallest hand keeps its detail
+            detail.setVertexBudget (2 * iFull + 2 * iImpostor);
+            detail.chooseLevels (afPixels, 4, aLevels);
+            expectEquals ((int) aLevels[1], (int) SkeletonDetail::kLevel_Impostor);
+            expectEquals ((int) aLevels[2], (int) SkeletonDetail::kLevel_Full);
+
+            // impostors are as coarse as it gets
+            detail.setVertexBudget (1);
+            expectEquals (detail.chooseLevels (afPixels, 4, aLevels), 4 * iImpostor);
+        }
     }
 };
 
-void FingerVisualizerApplication::initialise (const String& commandLine)
-{
-    (void) commandLine;
-    // Do your application's initialisation code here..
-    m_pMainWindow = new FingerVisualizerWindow();
-}
+static SkeletonDetailTests skeletonDetailTests;
+
+#endif
 
 //==============================================================================
 // This macro generates the main() routine that starts the app.
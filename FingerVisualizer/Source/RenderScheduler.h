@@ -0,0 +1,120 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_RENDERSCHEDULER_H_INCLUDED
+#define FINGERVISUALIZER_RENDERSCHEDULER_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/**
+    Decides when the visualizer redraws.
+
+    While somebody is using it, frames are drawn either as they arrive from the
+    tracker or at every display refresh, whichever mode is preferred; prediction
+    always needs the display rate.  Once no hand has been seen and nobody has
+    touched the mouse or keyboard for the idle timeout, or while paused, it
+    drops to idle and only redraws at a low rate from a timer.  The first frame
+    with a hand in it is drawn straight away, and wakes it up again.
+
+    frameArrived() is called by the thread processing frames, everything else
+    by the message thread.  Times are in seconds on any clock that doesn't go
+    backwards.
+*/
+class RenderScheduler
+{
+public:
+    enum Mode
+    {
+        /// redraw when a tracking frame arrives.
+        kMode_TrackDriven,
+        /// redraw continuously, paced by the buffer swap waiting for vsync.
+        kMode_DisplayLocked,
+        /// redraw only from a low rate timer, or when something changes.
+        kMode_Idle
+    };
+
+    RenderScheduler()
+      : m_preferredMode( kMode_TrackDriven ),
+        m_fIdleTimeoutSeconds( 5.0 ),
+        m_mode( kMode_TrackDriven )
+    {
+    }
+
+    /** Track driven or display locked, for when it isn't idle. */
+    void setPreferredMode( Mode mode ) noexcept
+    {
+        jassert( mode != kMode_Idle );
+        m_preferredMode = mode;
+    }
+
+    Mode getPreferredMode() const noexcept          { return m_preferredMode; }
+
+    /** How long without hands or input before going idle, zero or less never does. */
+    void setIdleTimeout( double fSeconds ) noexcept { m_fIdleTimeoutSeconds = fSeconds; }
+    double getIdleTimeout() const noexcept          { return m_fIdleTimeoutSeconds; }
+
+    Mode getMode() const noexcept                   { return static_cast<Mode>(m_mode.get()); }
+
+    static const char* getModeName( Mode mode ) noexcept
+    {
+        switch ( mode )
+        {
+        case kMode_TrackDriven:   return "track driven";
+        case kMode_DisplayLocked: return "display locked";
+        default:                  return "idle";
+        }
+    }
+
+    //==============================================================================
+    /** Processing thread: notes a tracking frame and returns true if it should trigger a redraw. */
+    bool frameArrived( bool bHandsVisible, double fNowSeconds ) noexcept
+    {
+        if ( bHandsVisible )
+            noteActivity( fNowSeconds );
+
+        const Mode mode = getMode();
+
+        return mode == kMode_TrackDriven || (mode == kMode_Idle && bHandsVisible);
+    }
+
+    /** Keeps it awake, for user input. */
+    void noteActivity( double fNowSeconds ) noexcept
+    {
+        m_iLastActivityMs.set( static_cast<int64>(fNowSeconds * 1000.0) );
+    }
+
+    //==============================================================================
+    /** Message thread: picks the mode for now.  Returns true if it changed, the caller
+        then turns continuous repainting on for kMode_DisplayLocked and off otherwise.
+    */
+    bool update( double fNowSeconds, bool bPaused, bool bNeedsDisplayRate ) noexcept
+    {
+        const double fIdleSeconds = fNowSeconds - m_iLastActivityMs.get() * 0.001;
+        const bool   bIdle        = bPaused || (m_fIdleTimeoutSeconds > 0.0 && fIdleSeconds > m_fIdleTimeoutSeconds);
+
+        Mode mode = m_preferredMode;
+
+        if ( bIdle )
+            mode = kMode_Idle;
+        else if ( bNeedsDisplayRate )
+            mode = kMode_DisplayLocked;
+
+        return m_mode.exchange( mode ) != mode;
+    }
+
+private:
+    Mode            m_preferredMode;
+    double          m_fIdleTimeoutSeconds;
+    Atomic<int>     m_mode;
+    Atomic<int64>   m_iLastActivityMs;
+
+    JUCE_DECLARE_NON_COPYABLE (RenderScheduler)
+};
+
+#endif // FINGERVISUALIZER_RENDERSCHEDULER_H_INCLUDED
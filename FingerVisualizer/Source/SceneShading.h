@@ -0,0 +1,500 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_SCENESHADING_H_INCLUDED
+#define FINGERVISUALIZER_SCENESHADING_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "LeapUtilGL.h"
+#include <cmath>
+
+#ifndef FINGERVISUALIZER_GL_CALL
+ #if JUCE_WINDOWS
+  #define FINGERVISUALIZER_GL_CALL __stdcall
+ #else
+  #define FINGERVISUALIZER_GL_CALL
+ #endif
+#endif
+
+#ifndef GL_UNIFORM_BUFFER
+ #define GL_UNIFORM_BUFFER 0x8A11
+#endif
+
+#ifndef GL_INVALID_INDEX
+ #define GL_INVALID_INDEX 0xFFFFFFFFu
+#endif
+
+//==============================================================================
+/**
+    The projection and model view matrices of one draw, for the shaders.
+
+    These are the matrices CameraGL::SetupGLProjection() and SetupGLView() load
+    into the fixed-function stacks, worked out on the CPU into juce::Matrix3D
+    so the renderers can pass them as uniforms.  Matrix3D only stores the
+    values, in OpenGL's column-major order, so the arithmetic lives here.
+*/
+class SceneTransform
+{
+public:
+    typedef Matrix3D<float> Matrix;
+
+    SceneTransform() noexcept {}
+
+    SceneTransform( const Matrix& projection, const Matrix& modelView ) noexcept
+      : m_projection( projection ),
+        m_modelView( modelView )
+    {
+    }
+
+    /** The view of a camera at its current aspect ratio. */
+    explicit SceneTransform( const LeapUtilGL::CameraGL& camera )
+      : m_projection( getPerspective( camera.GetVerticalFOVDegrees(), camera.GetAspectRatio(),
+                                      camera.GetNearClip(), camera.GetFarClip() ) ),
+        m_modelView( getView( camera.GetPOV() ) )
+    {
+    }
+
+    /** The same view of a model that is scaled, then moved, like glTranslatef() followed by glScalef(). */
+    SceneTransform withModel( const Leap::Vector& vTranslation, float fScale ) const noexcept
+    {
+        return SceneTransform( m_projection, multiply( m_modelView, getTranslateScale( vTranslation, fScale ) ) );
+    }
+
+    const Matrix& getProjection() const noexcept    { return m_projection; }
+    const Matrix& getModelView() const noexcept     { return m_modelView; }
+
+    /** The 3x3 inverse transpose of the model view, column-major, for eye space normals. */
+    void getNormalMatrix( GLfloat* pfOut ) const noexcept
+    {
+        const float* m = m_modelView.mat;
+
+        // cofactors of the upper left 3x3, m[column * 4 + row]
+        const float c00 = m[5] * m[10] - m[9] * m[6];
+        const float c01 = m[9] * m[2]  - m[1] * m[10];
+        const float c02 = m[1] * m[6]  - m[5] * m[2];
+        const float c10 = m[8] * m[6]  - m[4] * m[10];
+        const float c11 = m[0] * m[10] - m[8] * m[2];
+        const float c12 = m[4] * m[2]  - m[0] * m[6];
+        const float c20 = m[4] * m[9]  - m[8] * m[5];
+        const float c21 = m[8] * m[1]  - m[0] * m[9];
+        const float c22 = m[0] * m[5]  - m[4] * m[1];
+
+        const float fDet    = m[0] * c00 + m[4] * c01 + m[8] * c02;
+        const float fInvDet = std::abs( fDet ) > 1.0e-12f ? 1.0f / fDet : 0.0f;
+
+        // the cofactor matrix over the determinant is the inverse transposed
+        pfOut[0] = c00 * fInvDet;  pfOut[1] = c10 * fInvDet;  pfOut[2] = c20 * fInvDet;
+        pfOut[3] = c01 * fInvDet;  pfOut[4] = c11 * fInvDet;  pfOut[5] = c21 * fInvDet;
+        pfOut[6] = c02 * fInvDet;  pfOut[7] = c12 * fInvDet;  pfOut[8] = c22 * fInvDet;
+    }
+
+    /** Where a point ends up in normalized device coordinates. */
+    Leap::Vector project( const Leap::Vector& vPoint ) const noexcept
+    {
+        float afEye[4], afClip[4];
+        const float afPoint[4] = { vPoint.x, vPoint.y, vPoint.z, 1.0f };
+
+        transform( m_modelView, afPoint, afEye );
+        transform( m_projection, afEye, afClip );
+
+        const float fInvW = afClip[3] != 0.0f ? 1.0f / afClip[3] : 0.0f;
+
+        return Leap::Vector( afClip[0] * fInvW, afClip[1] * fInvW, afClip[2] * fInvW );
+    }
+
+    /** How many pixels a sphere around vPoint covers, from its center to its edge,
+        in a viewport iViewportHeight pixels high.  Zero behind the camera.
+    */
+    float getProjectedRadius( const Leap::Vector& vPoint, float fRadius, int iViewportHeight ) const noexcept
+    {
+        float afEye[4], afClip[4];
+        const float afPoint[4] = { vPoint.x, vPoint.y, vPoint.z, 1.0f };
+
+        transform( m_modelView, afPoint, afEye );
+        transform( m_projection, afEye, afClip );
+
+        if ( afClip[3] <= 0.0f )
+            return 0.0f;
+
+        // the model's scale is the length of a model view column, the projection's
+        // vertical scale its second diagonal element
+        const float* m      = m_modelView.mat;
+        const float  fScale = std::sqrt( m[0] * m[0] + m[1] * m[1] + m[2] * m[2] );
+
+        return fRadius * fScale * m_projection.mat[5] * 0.5f * iViewportHeight / afClip[3];
+    }
+
+    /** Loads both matrices into the fixed-function stacks, for the immediate mode fallbacks. */
+    void loadIntoFixedFunction() const
+    {
+        glMatrixMode( GL_PROJECTION );
+        glLoadMatrixf( m_projection.mat );
+        glMatrixMode( GL_MODELVIEW );
+        glLoadMatrixf( m_modelView.mat );
+    }
+
+    //==============================================================================
+    /** a * b, so b applies to points first. */
+    static Matrix multiply( const Matrix& a, const Matrix& b ) noexcept
+    {
+        Matrix result;
+
+        for ( int iColumn = 0; iColumn < 4; iColumn++ )
+        {
+            for ( int iRow = 0; iRow < 4; iRow++ )
+            {
+                float fSum = 0.0f;
+
+                for ( int k = 0; k < 4; k++ )
+                    fSum += a.mat[k * 4 + iRow] * b.mat[iColumn * 4 + k];
+
+                result.mat[iColumn * 4 + iRow] = fSum;
+            }
+        }
+
+        return result;
+    }
+
+    /** Same as gluPerspective(). */
+    static Matrix getPerspective( float fFovYDegrees, float fAspectRatio, float fNear, float fFar ) noexcept
+    {
+        const float f      = 1.0f / std::tan( fFovYDegrees * float_Pi / 360.0f );
+        const float fDepth = fNear - fFar;
+
+        return Matrix( f / jmax( fAspectRatio, 1.0e-6f ), 0.0f, 0.0f, 0.0f,
+                       0.0f, f, 0.0f, 0.0f,
+                       0.0f, 0.0f, (fFar + fNear) / fDepth, -1.0f,
+                       0.0f, 0.0f, 2.0f * fFar * fNear / fDepth, 0.0f );
+    }
+
+    /** The inverse of a camera's point of view, which is a rigid transform. */
+    static Matrix getView( const Leap::Matrix& mtxPOV ) noexcept
+    {
+        const Leap::Vector& x = mtxPOV.xBasis;
+        const Leap::Vector& y = mtxPOV.yBasis;
+        const Leap::Vector& z = mtxPOV.zBasis;
+        const Leap::Vector& o = mtxPOV.origin;
+
+        // the rows are the camera's axes
+        return Matrix( x.x, y.x, z.x, 0.0f,
+                       x.y, y.y, z.y, 0.0f,
+                       x.z, y.z, z.z, 0.0f,
+                       -x.dot( o ), -y.dot( o ), -z.dot( o ), 1.0f );
+    }
+
+    static Matrix getTranslateScale( const Leap::Vector& vTranslation, float fScale ) noexcept
+    {
+        return Matrix( fScale, 0.0f, 0.0f, 0.0f,
+                       0.0f, fScale, 0.0f, 0.0f,
+                       0.0f, 0.0f, fScale, 0.0f,
+                       vTranslation.x, vTranslation.y, vTranslation.z, 1.0f );
+    }
+
+private:
+    static void transform( const Matrix& m, const float* pfIn, float* pfOut ) noexcept
+    {
+        for ( int iRow = 0; iRow < 4; iRow++ )
+            pfOut[iRow] = m.mat[iRow] * pfIn[0] + m.mat[4 + iRow] * pfIn[1] + m.mat[8 + iRow] * pfIn[2] + m.mat[12 + iRow] * pfIn[3];
+    }
+
+    Matrix  m_projection;
+    Matrix  m_modelView;
+};
+
+//==============================================================================
+/**
+    The scene's lights, set up once per context for every shader that draws the scene.
+
+    The three lights and the ambient term are the ones the fixed-function
+    pipeline used to be given every frame, in eye space so they move with the
+    camera.  Where GLSL 1.40 and uniform buffers are available they go into one
+    std140 uniform block, uploaded and bound once in initialise(), which each
+    program only has to be pointed at.  Otherwise the shaders are compiled as
+    GLSL 1.20 and attach() copies the lights into each program's uniforms, which
+    also stay set for the life of the context.
+
+    The shader sources are written in GLSL 1.20; getShaderSource() rewrites
+    them for 1.40 and adds the light declarations and a shadeVertex() function
+    that lights a color the way GL_COLOR_MATERIAL did.
+*/
+class SceneLighting
+{
+public:
+    enum
+    {
+        kNumLights    = 3,
+        kBindingPoint = 0
+    };
+
+    /** The uniform block, laid out as std140. */
+    struct Lights
+    {
+        GLfloat afAmbient[4];
+        GLfloat aafPosition[kNumLights][4];
+        GLfloat aafDiffuse[kNumLights][4];
+    };
+
+    explicit SceneLighting( OpenGLContext& context )
+      : m_context( context ),
+        m_bAvailable( false ),
+        m_iBuffer( 0 ),
+        m_pfnGetUniformBlockIndex( nullptr ),
+        m_pfnUniformBlockBinding( nullptr )
+    {
+    }
+
+    ~SceneLighting()
+    {
+        // release() has to be called while the context is still active.
+        jassert( !m_bAvailable );
+    }
+
+    static const Lights& getLights() noexcept
+    {
+        static const Lights lights =
+        {
+            // Colours::darkgrey
+            { 0.333f, 0.333f, 0.333f, 1.0f },
+            {
+                // left, high, near - corner light
+                { -3.0f, 3.0f, -3.0f, 1.0f },
+                // right, near - side light
+                {  3.0f, 0.0f, -1.5f, 1.0f },
+                // near - head light
+                {  0.0f, 0.0f, -3.0f, 1.0f }
+            },
+            {
+                { 0.25f, 0.20f, 0.20f,  1.0f },
+                { 0.0f,  0.0f,  0.125f, 1.0f },
+                { 0.15f, 0.15f, 0.15f,  1.0f }
+            }
+        };
+
+        return lights;
+    }
+
+    //==============================================================================
+    /** Creates and binds the uniform block if it can, call from newOpenGLContextCreated().
+        Returns false without GLSL 1.20, leaving only the fixed-function pipeline.
+    */
+    bool initialise()
+    {
+        release();
+
+        const double fLanguageVersion = OpenGLShaderProgram::getLanguageVersion();
+
+        if ( fLanguageVersion < 1.199 )
+            return false;
+
+        m_bAvailable = true;
+
+        typedef void (FINGERVISUALIZER_GL_CALL *BindBufferBaseFunction) (GLenum, GLuint, GLuint);
+
+        BindBufferBaseFunction pfnBindBufferBase = reinterpret_cast<BindBufferBaseFunction>(getExtensionFunction( "glBindBufferBase" ));
+        m_pfnGetUniformBlockIndex = reinterpret_cast<GetUniformBlockIndexFunction>(getExtensionFunction( "glGetUniformBlockIndex" ));
+        m_pfnUniformBlockBinding  = reinterpret_cast<UniformBlockBindingFunction>(getExtensionFunction( "glUniformBlockBinding" ));
+
+        if ( fLanguageVersion < 1.399 || pfnBindBufferBase == nullptr
+              || m_pfnGetUniformBlockIndex == nullptr || m_pfnUniformBlockBinding == nullptr )
+        {
+            m_pfnGetUniformBlockIndex = nullptr;
+            m_pfnUniformBlockBinding  = nullptr;
+            return true;
+        }
+
+        m_context.extensions.glGenBuffers( 1, &m_iBuffer );
+        m_context.extensions.glBindBuffer( GL_UNIFORM_BUFFER, m_iBuffer );
+        m_context.extensions.glBufferData( GL_UNIFORM_BUFFER, static_cast<pointer_sized_int>(sizeof (Lights)), &getLights(), GL_STATIC_DRAW );
+        m_context.extensions.glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+
+        // nothing else uses uniform blocks, so the binding lasts as long as the context
+        pfnBindBufferBase( GL_UNIFORM_BUFFER, kBindingPoint, m_iBuffer );
+        return true;
+    }
+
+    /** Frees the uniform buffer, call from openGLContextClosing(). */
+    void release()
+    {
+        if ( m_iBuffer != 0 )
+            m_context.extensions.glDeleteBuffers( 1, &m_iBuffer );
+
+        m_iBuffer                 = 0;
+        m_bAvailable              = false;
+        m_pfnGetUniformBlockIndex = nullptr;
+        m_pfnUniformBlockBinding  = nullptr;
+    }
+
+    /** True when the scene can be drawn with shaders. */
+    bool isAvailable() const noexcept       { return m_bAvailable; }
+
+    bool hasUniformBlock() const noexcept   { return m_iBuffer != 0; }
+
+    /** The source of a GLSL 1.20 shader as this context compiles it. */
+    String getShaderSource( const char* szSource, GLenum shaderType ) const
+    {
+        return translateShader( szSource, shaderType, hasUniformBlock() );
+    }
+
+    /** Gives a linked program the lights, call once after linking it. */
+    void attach( OpenGLShaderProgram& program ) const
+    {
+        if ( hasUniformBlock() )
+        {
+            const GLuint iBlock = m_pfnGetUniformBlockIndex( program.programID, "SceneLights" );
+
+            if ( iBlock != GL_INVALID_INDEX )
+                m_pfnUniformBlockBinding( program.programID, iBlock, kBindingPoint );
+
+            return;
+        }
+
+        const Lights& lights = getLights();
+
+        program.use();
+        setVector( program, "lightAmbient", lights.afAmbient );
+
+        for ( int i = 0; i < kNumLights; i++ )
+        {
+            setVector( program, "lightPosition[" + String( i ) + "]", lights.aafPosition[i] );
+            setVector( program, "lightDiffuse[" + String( i ) + "]", lights.aafDiffuse[i] );
+        }
+
+        m_context.extensions.glUseProgram( 0 );
+    }
+
+    /** Gives the fixed-function pipeline the same lights, for immediate mode drawing.
+        Light positions go through the model view, so it's reset around them.
+    */
+    static void applyToFixedFunction()
+    {
+        const Lights&   lights = getLights();
+        const GLfloat   afBlack[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+        glMatrixMode( GL_MODELVIEW );
+        glPushMatrix();
+        glLoadIdentity();
+
+        glLightModelfv( GL_LIGHT_MODEL_AMBIENT, lights.afAmbient );
+
+        for ( int i = 0; i < kNumLights; i++ )
+        {
+            const GLenum iLight = static_cast<GLenum>(GL_LIGHT0 + i);
+
+            glLightfv( iLight, GL_POSITION, lights.aafPosition[i] );
+            glLightfv( iLight, GL_DIFFUSE, lights.aafDiffuse[i] );
+            glLightfv( iLight, GL_AMBIENT, afBlack );
+            glEnable( iLight );
+        }
+
+        glPopMatrix();
+    }
+
+    /** Rewrites GLSL 1.20 for the context and adds the lights to vertex shaders. */
+    static String translateShader( const char* szSource, GLenum shaderType, bool bUniformBlock )
+    {
+        String strSource( szSource );
+
+        if ( shaderType != GL_VERTEX_SHADER )
+        {
+            return bUniformBlock ? "#version 140\nout vec4 fragmentColor;\n"
+                                     + strSource.replace( "varying ", "in " ).replace( "gl_FragColor", "fragmentColor" )
+                                 : "#version 120\n" + strSource;
+        }
+
+        const char* szLights = bUniformBlock
+            ? "#version 140\n"
+              "layout (std140) uniform SceneLights\n"
+              "{\n"
+              "    vec4 lightAmbient;\n"
+              "    vec4 lightPosition[3];\n"
+              "    vec4 lightDiffuse[3];\n"
+              "};\n"
+            : "#version 120\n"
+              "uniform vec4 lightAmbient;\n"
+              "uniform vec4 lightPosition[3];\n"
+              "uniform vec4 lightDiffuse[3];\n";
+
+        // per vertex diffuse lighting with the color as material, like GL_COLOR_MATERIAL
+        const char* szShade =
+            "vec4 shadeVertex (vec4 color, vec3 eyePosition, vec3 eyeNormal)\n"
+            "{\n"
+            "    vec3 light = lightAmbient.rgb;\n"
+            "    for (int i = 0; i < 3; ++i)\n"
+            "        light += lightDiffuse[i].rgb * max (dot (eyeNormal, normalize (lightPosition[i].xyz - eyePosition)), 0.0);\n"
+            "    return vec4 (min (color.rgb * light, vec3 (1.0)), color.a);\n"
+            "}\n";
+
+        if ( bUniformBlock )
+            strSource = strSource.replace( "attribute ", "in " ).replace( "varying ", "out " );
+
+        return String( szLights ) + szShade + strSource;
+    }
+
+    /** Looks up a GL entry point, falling back to the ARB extension's name. */
+    static void* getExtensionFunction( const char* szName )
+    {
+        if ( void* pfn = OpenGLHelpers::getExtensionFunction( szName ) )
+            return pfn;
+
+        return OpenGLHelpers::getExtensionFunction( (String( szName ) + "ARB").toRawUTF8() );
+    }
+
+private:
+    typedef GLuint (FINGERVISUALIZER_GL_CALL *GetUniformBlockIndexFunction) (GLuint, const GLchar*);
+    typedef void (FINGERVISUALIZER_GL_CALL *UniformBlockBindingFunction) (GLuint, GLuint, GLuint);
+
+    static void setVector( const OpenGLShaderProgram& program, const String& strName, const GLfloat* pfValue )
+    {
+        const OpenGLShaderProgram::Uniform uniform( program, strName.toRawUTF8() );
+
+        if ( uniform.uniformID >= 0 )
+            uniform.set( pfValue[0], pfValue[1], pfValue[2], pfValue[3] );
+    }
+
+    OpenGLContext&                  m_context;
+    bool                            m_bAvailable;
+    GLuint                          m_iBuffer;
+    GetUniformBlockIndexFunction    m_pfnGetUniformBlockIndex;
+    UniformBlockBindingFunction     m_pfnUniformBlockBinding;
+
+    JUCE_DECLARE_NON_COPYABLE (SceneLighting)
+};
+
+//==============================================================================
+/** The matrix uniforms every scene shader declares, looked up once per program. */
+struct SceneUniforms
+{
+    explicit SceneUniforms( const OpenGLShaderProgram& program )
+      : projection( program, "projectionMatrix" ),
+        modelView( program, "modelViewMatrix" ),
+        normal( program, "normalMatrix" )
+    {
+    }
+
+    /** Call with the program in use. */
+    void set( const SceneTransform& transform ) const
+    {
+        projection.setMatrix4( transform.getProjection().mat, 1, GL_FALSE );
+        modelView.setMatrix4( transform.getModelView().mat, 1, GL_FALSE );
+
+        if ( normal.uniformID >= 0 )
+        {
+            GLfloat afNormal[9];
+            transform.getNormalMatrix( afNormal );
+            normal.setMatrix3( afNormal, 1, GL_FALSE );
+        }
+    }
+
+    OpenGLShaderProgram::Uniform    projection;
+    OpenGLShaderProgram::Uniform    modelView;
+    OpenGLShaderProgram::Uniform    normal;
+
+    JUCE_DECLARE_NON_COPYABLE (SceneUniforms)
+};
+
+#endif // FINGERVISUALIZER_SCENESHADING_H_INCLUDED
@@ -0,0 +1,189 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_SKELETONDETAIL_H_INCLUDED
+#define FINGERVISUALIZER_SKELETONDETAIL_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FrameSnapshot.h"
+#include "SceneShading.h"
+
+//==============================================================================
+/**
+    Picks how finely each hand's skeleton is tessellated from its size on screen.
+
+    A hand's size is the projected radius of its joint spheres through the
+    camera's SceneTransform, in pixels.  Hands whose joints cover many pixels get
+    the full sphere and cylinder meshes, smaller ones coarser meshes, and hands
+    whose joints are only a couple of pixels across collapse to impostors: a
+    camera facing sprite per joint and three sided bones.
+
+    With a vertex budget the sizes only set an upper limit.  While the frame
+    would draw more vertices than the budget, the smallest hand that can still
+    lose detail drops a level, so drawing cost stops growing with the number of
+    hands and the nearest hands are the last to be coarsened.
+*/
+class SkeletonDetail
+{
+public:
+    enum Level
+    {
+        kLevel_Full,
+        kLevel_Medium,
+        kLevel_Low,
+        /// joints drawn as sprites instead of spheres
+        kLevel_Impostor,
+        kNumLevels
+    };
+
+    enum
+    {
+        kSpheresPerHand   = HandSnapshot::kNumFingers * (FingerSnapshot::kNumJoints - 1) + 2,
+        kCylindersPerHand = HandSnapshot::kNumFingers * (FingerSnapshot::kNumJoints - 1) + 1,
+        /// the two triangles of a sprite
+        kSpriteVertices   = 6
+    };
+
+    /** Tessellation of one level, impostors have no sphere stacks. */
+    struct Mesh
+    {
+        int iSphereStacks;
+        int iSphereSlices;
+        int iCylinderSlices;
+    };
+
+    SkeletonDetail()
+      : m_bEnabled( true ),
+        m_iVertexBudget( 0 )
+    {
+    }
+
+    //==============================================================================
+    static const Mesh& getMesh( Level level ) noexcept
+    {
+        static const Mesh s_aMeshes[kNumLevels] =
+        {
+            { 8, 12, 12 },
+            { 6,  8,  8 },
+            { 4,  6,  6 },
+            { 0,  0,  3 }
+        };
+
+        return s_aMeshes[level];
+    }
+
+    static int getSphereVertexCount( Level level ) noexcept
+    {
+        const Mesh& mesh = getMesh( level );
+
+        return mesh.iSphereStacks > 0 ? mesh.iSphereStacks * mesh.iSphereSlices * 6 : static_cast<int>(kSpriteVertices);
+    }
+
+    static int getCylinderVertexCount( Level level ) noexcept
+    {
+        return getMesh( level ).iCylinderSlices * 6;
+    }
+
+    /** Vertices one hand's skeleton takes at a level. */
+    static int getHandVertexCount( Level level ) noexcept
+    {
+        return kSpheresPerHand * getSphereVertexCount( level ) + kCylindersPerHand * getCylinderVertexCount( level );
+    }
+
+    /** The finest level worth drawing joints of this many pixels radius at. */
+    static Level getLevelForRadius( float fPixels ) noexcept
+    {
+        if ( fPixels >= 10.0f )
+            return kLevel_Full;
+
+        if ( fPixels >= 5.0f )
+            return kLevel_Medium;
+
+        if ( fPixels >= 2.0f )
+            return kLevel_Low;
+
+        return kLevel_Impostor;
+    }
+
+    /** How many pixels a typical joint sphere of the hand covers, from its center to its edge. */
+    static float getProjectedJointRadius( const HandSnapshot& hand, const SceneTransform& transform, int iViewportHeight ) noexcept
+    {
+        // the joint spheres of the middle finger, drawn 0.75 times half the finger's width
+        const float fJointRadius = hand.aFingers[2].fWidth * 0.5f * 0.75f;
+
+        return transform.getProjectedRadius( hand.vPalmPosition, fJointRadius, iViewportHeight );
+    }
+
+    //==============================================================================
+    /** With level of detail off every hand gets the full meshes, budget or not. */
+    void setEnabled( bool bEnabled ) noexcept           { m_bEnabled = bEnabled; }
+    bool isEnabled() const noexcept                     { return m_bEnabled; }
+
+    /** The most vertices a frame's skeletons may take, 0 for no limit. */
+    void setVertexBudget( int iVertices ) noexcept      { m_iVertexBudget = jmax( 0, iVertices ); }
+    int getVertexBudget() const noexcept                { return m_iVertexBudget; }
+
+    /** Picks each hand's level from the projected joint radius in afPixels, then
+        coarsens the smallest hands until the frame fits the budget.  A hand at
+        impostor level can't get any coarser, so the budget is exceeded only when
+        every hand is an impostor.  Returns the number of vertices the frame takes.
+    */
+    int chooseLevels( const float* afPixels, int iNumHands, Level* aLevels ) const noexcept
+    {
+        iNumHands = jmin( iNumHands, static_cast<int>(FrameSnapshot::kMaxHands) );
+
+        int iTotal = 0;
+
+        for ( int i = 0; i < iNumHands; i++ )
+        {
+            aLevels[i] = m_bEnabled ? getLevelForRadius( afPixels[i] ) : kLevel_Full;
+            iTotal    += getHandVertexCount( aLevels[i] );
+        }
+
+        if ( !m_bEnabled || m_iVertexBudget == 0 || iTotal <= m_iVertexBudget )
+            return iTotal;
+
+        // smallest first, there are few enough hands for an insertion sort
+        int aiOrder[FrameSnapshot::kMaxHands];
+
+        for ( int i = 0; i < iNumHands; i++ )
+        {
+            int j = i;
+
+            for ( ; j > 0 && afPixels[aiOrder[j - 1]] > afPixels[i]; j-- )
+                aiOrder[j] = aiOrder[j - 1];
+
+            aiOrder[j] = i;
+        }
+
+        int iNext = 0;
+
+        while ( iTotal > m_iVertexBudget && iNext < iNumHands )
+        {
+            Level& level = aLevels[aiOrder[iNext]];
+
+            if ( level == kLevel_Impostor )
+            {
+                ++iNext;
+                continue;
+            }
+
+            iTotal -= getHandVertexCount( level );
+            level   = static_cast<Level>(level + 1);
+            iTotal += getHandVertexCount( level );
+        }
+
+        return iTotal;
+    }
+
+private:
+    bool    m_bEnabled;
+    int     m_iVertexBudget;
+};
+
+#endif // FINGERVISUALIZER_SKELETONDETAIL_H_INCLUDED
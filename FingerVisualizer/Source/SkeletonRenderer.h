@@ -0,0 +1,534 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_SKELETONRENDERER_H_INCLUDED
+#define FINGERVISUALIZER_SKELETONRENDERER_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FrameSnapshot.h"
+#include "SceneShading.h"
+#include "SkeletonDetail.h"
+#include <cmath>
+#include <cstddef>
+
+//==============================================================================
+/**
+    Draws the joint spheres and bone cylinders of any number of hands with one
+    instanced draw call per primitive type and level of detail.
+
+    Between beginFrame() and draw() the primitives are only appended to a
+    preallocated instance array per SkeletonDetail level; draw() streams those
+    arrays into a single vertex buffer and renders each level's spheres, then
+    its cylinders, from unit meshes of that level's tessellation that live in a
+    static buffer.  Impostor spheres are camera facing squares, cut round and
+    shaded darker towards the rim in the fragment shader.  The shader takes its
+    matrices from a SceneTransform and its lights from the SceneLighting block,
+    lighting each vertex the way the fixed-function pipeline lights the
+    immediate mode skeletons.  Calling draw() again before the next
+    beginFrame(), as each view does, draws the same instances without
+    uploading them again.
+
+    Instanced drawing isn't part of JUCE's extension function table, so the entry
+    points are looked up by name.  When they or the shader lighting are missing,
+    initialise() returns false and the caller keeps drawing in immediate mode.
+*/
+class SkeletonRenderer
+{
+public:
+    enum
+    {
+        kSpheresPerHand   = SkeletonDetail::kSpheresPerHand,
+        kCylindersPerHand = SkeletonDetail::kCylindersPerHand
+    };
+
+    SkeletonRenderer( OpenGLContext& context, int iMaxHands )
+      : m_context( context ),
+        m_iCapacity( iMaxHands * static_cast<int>(kSpheresPerHand) ),
+        m_bUploaded( false ),
+        m_iMeshBuffer( 0 ),
+        m_iInstanceBuffer( 0 ),
+        m_pfnDrawArraysInstanced( nullptr ),
+        m_pfnVertexAttribDivisor( nullptr )
+    {
+        m_aSpheres.allocate( static_cast<size_t>(m_iCapacity * SkeletonDetail::kNumLevels), true );
+        m_aCylinders.allocate( static_cast<size_t>(m_iCapacity * SkeletonDetail::kNumLevels), true );
+
+        zerostruct( m_aiNumSpheres );
+        zerostruct( m_aiNumCylinders );
+        zerostruct( m_aiSphereFirst );
+        zerostruct( m_aiSphereVertexCount );
+        zerostruct( m_aiCylinderFirst );
+        zerostruct( m_aiCylinderVertexCount );
+    }
+
+    ~SkeletonRenderer()
+    {
+        // release() has to be called while the context is still active.
+        jassert( m_pProgram == nullptr );
+    }
+
+    //==============================================================================
+    /** Creates the shader and buffers, call from newOpenGLContextCreated(). */
+    bool initialise( const SceneLighting& lighting )
+    {
+        release();
+
+        m_pfnDrawArraysInstanced = reinterpret_cast<DrawArraysInstancedFunction>(SceneLighting::getExtensionFunction( "glDrawArraysInstanced" ));
+        m_pfnVertexAttribDivisor = reinterpret_cast<VertexAttribDivisorFunction>(SceneLighting::getExtensionFunction( "glVertexAttribDivisor" ));
+
+        if ( m_pfnDrawArraysInstanced == nullptr || m_pfnVertexAttribDivisor == nullptr || !lighting.isAvailable() )
+            return false;
+
+        m_pProgram = new OpenGLShaderProgram( m_context );
+
+        if ( !m_pProgram->addShader( lighting.getShaderSource( getVertexShader(), GL_VERTEX_SHADER ).toRawUTF8(), GL_VERTEX_SHADER )
+              || !m_pProgram->addShader( lighting.getShaderSource( getFragmentShader(), GL_FRAGMENT_SHADER ).toRawUTF8(), GL_FRAGMENT_SHADER )
+              || !m_pProgram->link() )
+        {
+            Logger::writeToLog( "SkeletonRenderer: " + m_pProgram->getLastError() );
+            m_pProgram = nullptr;
+            return false;
+        }
+
+        m_pPosition       = new OpenGLShaderProgram::Attribute( *m_pProgram, "position" );
+        m_pInstanceStart  = new OpenGLShaderProgram::Attribute( *m_pProgram, "instanceStart" );
+        m_pInstanceEnd    = new OpenGLShaderProgram::Attribute( *m_pProgram, "instanceEnd" );
+        m_pInstanceColor  = new OpenGLShaderProgram::Attribute( *m_pProgram, "instanceColor" );
+        m_pIsCylinder     = new OpenGLShaderProgram::Uniform( *m_pProgram, "isCylinder" );
+        m_pIsSprite       = new OpenGLShaderProgram::Uniform( *m_pProgram, "isSprite" );
+        m_pScene          = new SceneUniforms( *m_pProgram );
+
+        lighting.attach( *m_pProgram );
+
+        createMeshBuffer();
+
+        m_context.extensions.glGenBuffers( 1, &m_iInstanceBuffer );
+        m_context.extensions.glBindBuffer( GL_ARRAY_BUFFER, m_iInstanceBuffer );
+        m_context.extensions.glBufferData( GL_ARRAY_BUFFER, getInstanceBufferSize(), nullptr, GL_STREAM_DRAW );
+        m_context.extensions.glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+        return true;
+    }
+
+    /** Frees the GL objects, call from openGLContextClosing(). */
+    void release()
+    {
+        if ( m_iMeshBuffer != 0 )
+            m_context.extensions.glDeleteBuffers( 1, &m_iMeshBuffer );
+
+        if ( m_iInstanceBuffer != 0 )
+            m_context.extensions.glDeleteBuffers( 1, &m_iInstanceBuffer );
+
+        m_iMeshBuffer     = 0;
+        m_iInstanceBuffer = 0;
+        m_bUploaded       = false;
+
+        m_pScene          = nullptr;
+        m_pIsSprite       = nullptr;
+        m_pIsCylinder     = nullptr;
+        m_pInstanceColor  = nullptr;
+        m_pInstanceEnd    = nullptr;
+        m_pInstanceStart  = nullptr;
+        m_pPosition       = nullptr;
+        m_pProgram        = nullptr;
+    }
+
+    bool isAvailable() const noexcept       { return m_pProgram != nullptr; }
+
+    //==============================================================================
+    void beginFrame() noexcept
+    {
+        zerostruct( m_aiNumSpheres );
+        zerostruct( m_aiNumCylinders );
+        m_bUploaded = false;
+    }
+
+    void addSphere( const Leap::Vector& vCenter, float fRadius, const GLfloat* pfColor,
+                    SkeletonDetail::Level level = SkeletonDetail::kLevel_Full ) noexcept
+    {
+        if ( m_aiNumSpheres[level] < m_iCapacity )
+            m_aSpheres[level * m_iCapacity + m_aiNumSpheres[level]++].set( vCenter, fRadius, vCenter, pfColor );
+    }
+
+    void addCylinder( const Leap::Vector& vBottom, const Leap::Vector& vTop, float fRadius, const GLfloat* pfColor,
+                      SkeletonDetail::Level level = SkeletonDetail::kLevel_Full ) noexcept
+    {
+        if ( m_aiNumCylinders[level] < m_iCapacity )
+            m_aCylinders[level * m_iCapacity + m_aiNumCylinders[level]++].set( vBottom, fRadius, vTop, pfColor );
+    }
+
+    /** Same skeleton as drawSkeletonHand() in Main.cpp, at one level of detail. */
+    void addHand( const HandSnapshot& hand, const GLfloat* pfBoneColor, const GLfloat* pfJointColor,
+                  SkeletonDetail::Level level = SkeletonDetail::kLevel_Full ) noexcept
+    {
+        static const float kfJointRadiusScale = 0.75f;
+        static const float kfBoneRadiusScale  = 0.5f;
+        static const float kfPalmRadiusScale  = 1.15f;
+
+        float         fRadius = 0.0f;
+        Leap::Vector  vLastBoxBase = hand.vWrist;
+
+        for ( int i = 0; i < HandSnapshot::kNumFingers; i++ )
+        {
+            const FingerSnapshot& finger = hand.aFingers[i];
+
+            fRadius = finger.fWidth * 0.5f;
+
+            for ( int j = 2; j < FingerSnapshot::kNumJoints; j++ )
+            {
+                addCylinder( finger.avJoints[j - 1], finger.avJoints[j], kfBoneRadiusScale * fRadius, pfBoneColor, level );
+                addSphere( finger.avJoints[j], kfJointRadiusScale * fRadius, pfJointColor, level );
+            }
+
+            const Leap::Vector& vCurBoxBase = finger.avJoints[1];
+
+            addCylinder( vCurBoxBase, vLastBoxBase, kfBoneRadiusScale * fRadius, pfBoneColor, level );
+            addSphere( vCurBoxBase, kfJointRadiusScale * fRadius, pfJointColor, level );
+
+            vLastBoxBase = vCurBoxBase;
+        }
+
+        fRadius = hand.aFingers[0].fWidth * 0.5f;
+
+        addCylinder( hand.vWrist, vLastBoxBase, kfBoneRadiusScale * fRadius, pfBoneColor, level );
+        addSphere( hand.vWrist, kfJointRadiusScale * fRadius, pfJointColor, level );
+        addSphere( hand.vPalmPosition, kfPalmRadiusScale * fRadius, pfJointColor, level );
+    }
+
+    /** Draws everything added since beginFrame(), uploading it the first time. */
+    void draw( const SceneTransform& transform )
+    {
+        if ( !isAvailable() || getNumInstances() == 0 )
+            return;
+
+        OpenGLExtensionFunctions& gl = m_context.extensions;
+
+        if ( !m_bUploaded )
+        {
+            // orphan last frame's storage so the driver doesn't stall on it
+            gl.glBindBuffer( GL_ARRAY_BUFFER, m_iInstanceBuffer );
+            gl.glBufferData( GL_ARRAY_BUFFER, getInstanceBufferSize(), nullptr, GL_STREAM_DRAW );
+
+            for ( int i = 0; i < SkeletonDetail::kNumLevels; i++ )
+            {
+                if ( m_aiNumSpheres[i] > 0 )
+                    gl.glBufferSubData( GL_ARRAY_BUFFER, getSphereBase( i ), static_cast<pointer_sized_int>(m_aiNumSpheres[i] * sizeof (Instance)),
+                                        m_aSpheres + i * m_iCapacity );
+
+                if ( m_aiNumCylinders[i] > 0 )
+                    gl.glBufferSubData( GL_ARRAY_BUFFER, getCylinderBase( i ), static_cast<pointer_sized_int>(m_aiNumCylinders[i] * sizeof (Instance)),
+                                        m_aCylinders + i * m_iCapacity );
+            }
+
+            m_bUploaded = true;
+        }
+
+        m_pProgram->use();
+        m_pScene->set( transform );
+
+        gl.glBindBuffer( GL_ARRAY_BUFFER, m_iMeshBuffer );
+        gl.glVertexAttribPointer( static_cast<GLuint>(m_pPosition->attributeID), 3, GL_FLOAT, GL_FALSE, 0, nullptr );
+        gl.glEnableVertexAttribArray( static_cast<GLuint>(m_pPosition->attributeID) );
+
+        gl.glBindBuffer( GL_ARRAY_BUFFER, m_iInstanceBuffer );
+        enableInstanceAttributes( true );
+
+        for ( int i = 0; i < SkeletonDetail::kNumLevels; i++ )
+        {
+            if ( m_aiNumSpheres[i] > 0 )
+            {
+                m_pIsCylinder->set( 0.0f );
+                m_pIsSprite->set( i == SkeletonDetail::kLevel_Impostor ? 1.0f : 0.0f );
+                setInstanceBase( getSphereBase( i ) );
+                m_pfnDrawArraysInstanced( GL_TRIANGLES, m_aiSphereFirst[i], m_aiSphereVertexCount[i], m_aiNumSpheres[i] );
+            }
+
+            if ( m_aiNumCylinders[i] > 0 )
+            {
+                m_pIsCylinder->set( 1.0f );
+                m_pIsSprite->set( 0.0f );
+                setInstanceBase( getCylinderBase( i ) );
+                m_pfnDrawArraysInstanced( GL_TRIANGLES, m_aiCylinderFirst[i], m_aiCylinderVertexCount[i], m_aiNumCylinders[i] );
+            }
+        }
+
+        // the JUCE 2D renderer expects divisors of zero and no program bound
+        enableInstanceAttributes( false );
+        gl.glDisableVertexAttribArray( static_cast<GLuint>(m_pPosition->attributeID) );
+        gl.glBindBuffer( GL_ARRAY_BUFFER, 0 );
+        gl.glUseProgram( 0 );
+    }
+
+    /** Spheres and cylinders added since beginFrame(), at every level. */
+    int getNumInstances() const noexcept
+    {
+        int iCount = 0;
+
+        for ( int i = 0; i < SkeletonDetail::kNumLevels; i++ )
+            iCount += m_aiNumSpheres[i] + m_aiNumCylinders[i];
+
+        return iCount;
+    }
+
+private:
+    //==============================================================================
+    struct Instance
+    {
+        void set( const Leap::Vector& vStart, float fRadius, const Leap::Vector& vEnd, const GLfloat* pfColor ) noexcept
+        {
+            afStart[0] = vStart.x;  afStart[1] = vStart.y;  afStart[2] = vStart.z;  afStart[3] = fRadius;
+            afEnd[0]   = vEnd.x;    afEnd[1]   = vEnd.y;    afEnd[2]   = vEnd.z;    afEnd[3]   = 0.0f;
+
+            for ( int i = 0; i < 4; i++ )
+                afColor[i] = pfColor[i];
+        }
+
+        GLfloat afStart[4];     // center or bottom, and radius
+        GLfloat afEnd[4];       // top of a cylinder
+        GLfloat afColor[4];
+    };
+
+    typedef void (FINGERVISUALIZER_GL_CALL *DrawArraysInstancedFunction) (GLenum, GLint, GLsizei, GLsizei);
+    typedef void (FINGERVISUALIZER_GL_CALL *VertexAttribDivisorFunction) (GLuint, GLuint);
+
+    static const char* getVertexShader()
+    {
+        return
+            "attribute vec3 position;\n"
+            "attribute vec4 instanceStart;\n"
+            "attribute vec3 instanceEnd;\n"
+            "attribute vec4 instanceColor;\n"
+            "uniform float isCylinder;\n"
+            "uniform float isSprite;\n"
+            "uniform mat4 projectionMatrix;\n"
+            "uniform mat4 modelViewMatrix;\n"
+            "uniform mat3 normalMatrix;\n"
+            "varying vec4 color;\n"
+            "varying vec2 spriteCoord;\n"
+            "void main()\n"
+            "{\n"
+            "    spriteCoord = position.xy;\n"
+            "    if (isSprite > 0.5)\n"
+            "    {\n"
+            "        vec4 vCenter = modelViewMatrix * vec4 (instanceStart.xyz, 1.0);\n"
+            "        vCenter.xy += position.xy * instanceStart.w * length (modelViewMatrix[0].xyz);\n"
+            "        color = shadeVertex (instanceColor, vCenter.xyz, vec3 (0.0, 0.0, 1.0));\n"
+            "        gl_Position = projectionMatrix * vCenter;\n"
+            "        return;\n"
+            "    }\n"
+            "    vec3 vNormal = position;\n"
+            "    vec3 vWorld  = instanceStart.xyz + position * instanceStart.w;\n"
+            "    if (isCylinder > 0.5)\n"
+            "    {\n"
+            "        vec3 vAxis = instanceEnd - instanceStart.xyz;\n"
+            "        vec3 vDir  = length (vAxis) > 1.0e-6 ? normalize (vAxis) : vec3 (0.0, 1.0, 0.0);\n"
+            "        vec3 vRef  = abs (vDir.y) < 0.99 ? vec3 (0.0, 1.0, 0.0) : vec3 (1.0, 0.0, 0.0);\n"
+            "        vec3 vU    = normalize (cross (vRef, vDir));\n"
+            "        vec3 vW    = cross (vU, vDir);\n"
+            "        vNormal = vU * position.x + vW * position.z;\n"
+            "        vWorld  = instanceStart.xyz + vAxis * position.y + vNormal * instanceStart.w;\n"
+            "    }\n"
+            "    vec4 vEye = modelViewMatrix * vec4 (vWorld, 1.0);\n"
+            "    color = shadeVertex (instanceColor, vEye.xyz, normalize (normalMatrix * vNormal));\n"
+            "    gl_Position = projectionMatrix * vEye;\n"
+            "}\n";
+    }
+
+    static const char* getFragmentShader()
+    {
+        return
+            "uniform float isSprite;\n"
+            "varying vec4 color;\n"
+            "varying vec2 spriteCoord;\n"
+            "void main()\n"
+            "{\n"
+            "    vec4 vColor = color;\n"
+            "    if (isSprite > 0.5)\n"
+            "    {\n"
+            "        float fDistance = dot (spriteCoord, spriteCoord);\n"
+            "        if (fDistance > 1.0)\n"
+            "            discard;\n"
+            "        vColor.rgb *= 0.6 + 0.4 * sqrt (1.0 - fDistance);\n"
+            "    }\n"
+            "    gl_FragColor = vColor;\n"
+            "}\n";
+    }
+
+    /// spheres of each level, then cylinders of each level, each level with room for all of them.
+    pointer_sized_int getInstanceBufferSize() const noexcept
+    {
+        return static_cast<pointer_sized_int>(2 * SkeletonDetail::kNumLevels * m_iCapacity * sizeof (Instance));
+    }
+
+    pointer_sized_int getSphereBase( int iLevel ) const noexcept
+    {
+        return static_cast<pointer_sized_int>(iLevel * m_iCapacity * sizeof (Instance));
+    }
+
+    pointer_sized_int getCylinderBase( int iLevel ) const noexcept
+    {
+        return getSphereBase( SkeletonDetail::kNumLevels + iLevel );
+    }
+
+    /// for each level a unit sphere, or the impostor's square, then a unit cylinder
+    /// along +y, as counter-clockwise triangles.
+    void createMeshBuffer()
+    {
+        int iNumVertices = 0;
+
+        for ( int i = 0; i < SkeletonDetail::kNumLevels; i++ )
+        {
+            const SkeletonDetail::Level level = static_cast<SkeletonDetail::Level>(i);
+
+            m_aiSphereFirst[i]          = iNumVertices;
+            m_aiSphereVertexCount[i]    = SkeletonDetail::getSphereVertexCount( level );
+            m_aiCylinderFirst[i]        = m_aiSphereFirst[i] + m_aiSphereVertexCount[i];
+            m_aiCylinderVertexCount[i]  = SkeletonDetail::getCylinderVertexCount( level );
+
+            iNumVertices = m_aiCylinderFirst[i] + m_aiCylinderVertexCount[i];
+        }
+
+        HeapBlock<GLfloat>  afVertices( static_cast<size_t>(iNumVertices * 3) );
+        GLfloat*            pfOut = afVertices;
+
+        for ( int iLevel = 0; iLevel < SkeletonDetail::kNumLevels; iLevel++ )
+        {
+            const SkeletonDetail::Mesh& mesh = SkeletonDetail::getMesh( static_cast<SkeletonDetail::Level>(iLevel) );
+
+            if ( mesh.iSphereStacks == 0 )
+            {
+                static const GLfloat afSprite[] = { -1, -1, 0,   1, -1, 0,   1, 1, 0,
+                                                    -1, -1, 0,   1,  1, 0,  -1, 1, 0 };
+
+                memcpy( pfOut, afSprite, sizeof (afSprite) );
+                pfOut += numElementsInArray( afSprite );
+            }
+
+            for ( int i = 0; i < mesh.iSphereStacks; i++ )
+            {
+                for ( int j = 0; j < mesh.iSphereSlices; j++ )
+                {
+                    // a, b below it, c below and around, d around
+                    pfOut = addSpherePoint( pfOut, mesh, i,     j );
+                    pfOut = addSpherePoint( pfOut, mesh, i + 1, j + 1 );
+                    pfOut = addSpherePoint( pfOut, mesh, i + 1, j );
+
+                    pfOut = addSpherePoint( pfOut, mesh, i,     j );
+                    pfOut = addSpherePoint( pfOut, mesh, i,     j + 1 );
+                    pfOut = addSpherePoint( pfOut, mesh, i + 1, j + 1 );
+                }
+            }
+
+            for ( int j = 0; j < mesh.iCylinderSlices; j++ )
+            {
+                pfOut = addCylinderPoint( pfOut, mesh, j,     0.0f );
+                pfOut = addCylinderPoint( pfOut, mesh, j + 1, 1.0f );
+                pfOut = addCylinderPoint( pfOut, mesh, j + 1, 0.0f );
+
+                pfOut = addCylinderPoint( pfOut, mesh, j,     0.0f );
+                pfOut = addCylinderPoint( pfOut, mesh, j,     1.0f );
+                pfOut = addCylinderPoint( pfOut, mesh, j + 1, 1.0f );
+            }
+        }
+
+        jassert( pfOut == afVertices + iNumVertices * 3 );
+
+        m_context.extensions.glGenBuffers( 1, &m_iMeshBuffer );
+        m_context.extensions.glBindBuffer( GL_ARRAY_BUFFER, m_iMeshBuffer );
+        m_context.extensions.glBufferData( GL_ARRAY_BUFFER, static_cast<pointer_sized_int>((pfOut - afVertices) * sizeof (GLfloat)),
+                                           afVertices, GL_STATIC_DRAW );
+        m_context.extensions.glBindBuffer( GL_ARRAY_BUFFER, 0 );
+    }
+
+    static GLfloat* addSpherePoint( GLfloat* pfOut, const SkeletonDetail::Mesh& mesh, int iStack, int iSlice )
+    {
+        const float fTheta = float_Pi * iStack / mesh.iSphereStacks;
+        const float fPhi   = 2.0f * float_Pi * iSlice / mesh.iSphereSlices;
+
+        *pfOut++ = std::sin( fTheta ) * std::cos( fPhi );
+        *pfOut++ = std::cos( fTheta );
+        *pfOut++ = std::sin( fTheta ) * std::sin( fPhi );
+        return pfOut;
+    }
+
+    static GLfloat* addCylinderPoint( GLfloat* pfOut, const SkeletonDetail::Mesh& mesh, int iSlice, float fHeight )
+    {
+        const float fPhi = 2.0f * float_Pi * iSlice / mesh.iCylinderSlices;
+
+        *pfOut++ = std::cos( fPhi );
+        *pfOut++ = fHeight;
+        *pfOut++ = std::sin( fPhi );
+        return pfOut;
+    }
+
+    void enableInstanceAttributes( bool bEnable )
+    {
+        const OpenGLShaderProgram::Attribute* apAttributes[] = { m_pInstanceStart, m_pInstanceEnd, m_pInstanceColor };
+
+        for ( int i = 0; i < numElementsInArray( apAttributes ); i++ )
+        {
+            if ( apAttributes[i]->attributeID < 0 )
+                continue;
+
+            const GLuint iAttribute = static_cast<GLuint>(apAttributes[i]->attributeID);
+
+            if ( bEnable )
+                m_context.extensions.glEnableVertexAttribArray( iAttribute );
+            else
+                m_context.extensions.glDisableVertexAttribArray( iAttribute );
+
+            m_pfnVertexAttribDivisor( iAttribute, bEnable ? 1 : 0 );
+        }
+    }
+
+    /// points the instance attributes at the instance data starting at iByteOffset.
+    void setInstanceBase( pointer_sized_int iByteOffset )
+    {
+        const GLsizei iStride = sizeof (Instance);
+        const char*   pBase   = nullptr;
+
+        setInstanceAttribute( *m_pInstanceStart, 4, iStride, pBase + iByteOffset + offsetof (Instance, afStart) );
+        setInstanceAttribute( *m_pInstanceEnd,   3, iStride, pBase + iByteOffset + offsetof (Instance, afEnd) );
+        setInstanceAttribute( *m_pInstanceColor, 4, iStride, pBase + iByteOffset + offsetof (Instance, afColor) );
+    }
+
+    void setInstanceAttribute( const OpenGLShaderProgram::Attribute& attribute, GLint iSize, GLsizei iStride, const void* pOffset )
+    {
+        if ( attribute.attributeID >= 0 )
+            m_context.extensions.glVertexAttribPointer( static_cast<GLuint>(attribute.attributeID), iSize, GL_FLOAT, GL_FALSE, iStride, pOffset );
+    }
+
+    OpenGLContext&                                  m_context;
+    int                                             m_iCapacity;
+    HeapBlock<Instance>                             m_aSpheres;
+    HeapBlock<Instance>                             m_aCylinders;
+    int                                             m_aiNumSpheres[SkeletonDetail::kNumLevels];
+    int                                             m_aiNumCylinders[SkeletonDetail::kNumLevels];
+    bool                                            m_bUploaded;
+
+    ScopedPointer<OpenGLShaderProgram>              m_pProgram;
+    ScopedPointer<OpenGLShaderProgram::Attribute>   m_pPosition;
+    ScopedPointer<OpenGLShaderProgram::Attribute>   m_pInstanceStart;
+    ScopedPointer<OpenGLShaderProgram::Attribute>   m_pInstanceEnd;
+    ScopedPointer<OpenGLShaderProgram::Attribute>   m_pInstanceColor;
+    ScopedPointer<OpenGLShaderProgram::Uniform>     m_pIsCylinder;
+    ScopedPointer<OpenGLShaderProgram::Uniform>     m_pIsSprite;
+    ScopedPointer<SceneUniforms>                    m_pScene;
+    GLuint                                          m_iMeshBuffer;
+    GLuint                                          m_iInstanceBuffer;
+    GLint                                           m_aiSphereFirst[SkeletonDetail::kNumLevels];
+    GLsizei                                         m_aiSphereVertexCount[SkeletonDetail::kNumLevels];
+    GLint                                           m_aiCylinderFirst[SkeletonDetail::kNumLevels];
+    GLsizei                                         m_aiCylinderVertexCount[SkeletonDetail::kNumLevels];
+    DrawArraysInstancedFunction                     m_pfnDrawArraysInstanced;
+    VertexAttribDivisorFunction                     m_pfnVertexAttribDivisor;
+
+    JUCE_DECLARE_NON_COPYABLE (SkeletonRenderer)
+};
+
+#endif // FINGERVISUALIZER_SKELETONRENDERER_H_INCLUDED
@@ -0,0 +1,225 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_SYNTHETICHANDS_H_INCLUDED
+#define FINGERVISUALIZER_SYNTHETICHANDS_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FrameSnapshot.h"
+#include <cmath>
+
+//==============================================================================
+/**
+    Procedurally animated hands, posed as a pure function of time.
+
+    Hands are laid out on a grid in the tracking volume (millimeters, like the
+    Leap API) and wave, turn and open and close their fingers.  When a hand
+    lifetime is given, each hand periodically "leaves" and comes back with a
+    new id, like a real hand moving out of and into the field of view.
+*/
+class SyntheticHands
+{
+public:
+    explicit SyntheticHands( int iNumHands, float fHandLifetimeSeconds = 0.0f )
+      : m_iNumHands( jlimit( 0, static_cast<int>(FrameSnapshot::kMaxHands), iNumHands ) ),
+        m_fHandLifetimeSeconds( fHandLifetimeSeconds )
+    {
+    }
+
+    int getNumHands() const noexcept    { return m_iNumHands; }
+
+    /// fills in the frame as it looks fSeconds after the animation started.
+    void poseFrame( double fSeconds, FrameSnapshot& frame ) const
+    {
+        frame.iTimestamp = static_cast<int64_t>(fSeconds * 1.0e6);
+        frame.iNumHands  = m_iNumHands;
+
+        for ( int i = 0; i < m_iNumHands; i++ )
+        {
+            poseHand( i, fSeconds, frame.aHands[i] );
+        }
+    }
+
+private:
+    void poseHand( int iIndex, double fSeconds, HandSnapshot& hand ) const
+    {
+        // spread the hands on a grid centered over the device
+        const int     iColumns = jmax( 1, static_cast<int>(std::ceil( std::sqrt( static_cast<double>(m_iNumHands) ) )) );
+        const float   fSpacing = 140.0f;
+        const float   fX = (iIndex % iColumns - (iColumns - 1) * 0.5f) * fSpacing;
+        const float   fZ = (iIndex / iColumns - (iColumns - 1) * 0.5f) * fSpacing;
+
+        const float   fPhase = iIndex * 0.7f;
+        const float   t      = static_cast<float>(fSeconds);
+
+        hand.bIsLeft = (iIndex & 1) != 0;
+
+        int iGeneration = 0;
+
+        if ( m_fHandLifetimeSeconds > 0.0f )
+        {
+            iGeneration = static_cast<int>(std::floor( (t + fPhase) / m_fHandLifetimeSeconds ));
+        }
+
+        hand.iId = 1 + iIndex + iGeneration * FrameSnapshot::kMaxHands;
+
+        const float fYaw  = 0.4f * std::sin( t * 0.9f + fPhase );
+        const float fRoll = 0.5f * std::sin( t * 0.6f + fPhase * 1.3f );
+        const float fCurl = 0.5f + 0.5f * std::sin( t * 2.1f + fPhase * 2.0f );
+
+        hand.vPalmPosition = Leap::Vector( fX + 40.0f * std::sin( t * 1.3f + fPhase ),
+                                           200.0f + 60.0f * std::sin( t * 0.8f + fPhase * 0.5f ),
+                                           fZ + 30.0f * std::cos( t * 1.1f + fPhase ) );
+
+        // fingers point away from the user (-z), palm faces down (-y)
+        hand.vDirection = Leap::Vector( std::sin( fYaw ), 0.0f, -std::cos( fYaw ) );
+
+        const Leap::Vector vFlatSide = hand.vDirection.cross( Leap::Vector( 0.0f, -1.0f, 0.0f ) );
+
+        hand.vPalmNormal = Leap::Vector( 0.0f, -std::cos( fRoll ), 0.0f ) + vFlatSide * std::sin( fRoll );
+
+        // points from the palm center towards the thumb
+        const Leap::Vector vThumbSide = hand.vDirection.cross( hand.vPalmNormal ).normalized() * (hand.bIsLeft ? -1.0f : 1.0f);
+
+        hand.vWrist = hand.vPalmPosition - hand.vDirection * 55.0f;
+
+        static const float s_afSideOffset[HandSnapshot::kNumFingers]      = { 30.0f, 24.0f, 2.0f, -18.0f, -34.0f };
+        static const float s_afBaseOffset[HandSnapshot::kNumFingers]      = { 15.0f, 6.0f, 0.0f, 3.0f, 8.0f };
+        static const float s_afBoneLengths[HandSnapshot::kNumFingers][4]  = { {  0.0f, 46.0f, 32.0f, 22.0f },
+                                                                              { 68.0f, 39.0f, 22.0f, 16.0f },
+                                                                              { 64.0f, 44.0f, 26.0f, 17.0f },
+                                                                              { 58.0f, 41.0f, 25.0f, 17.0f },
+                                                                              { 53.0f, 32.0f, 18.0f, 16.0f } };
+        static const float s_afWidths[HandSnapshot::kNumFingers]          = { 20.0f, 19.0f, 18.5f, 17.5f, 15.5f };
+
+        for ( int j = 0; j < HandSnapshot::kNumFingers; j++ )
+        {
+            FingerSnapshot& finger  = hand.aFingers[j];
+            const bool      bThumb  = (j == 0);
+
+            finger.fWidth = s_afWidths[j];
+
+            // the thumb leaves the palm at an angle, the other fingers run along it
+            const Leap::Vector vFingerDir = bThumb ? (hand.vDirection + vThumbSide).normalized() : hand.vDirection;
+
+            Leap::Vector vJoint = hand.vWrist + vThumbSide * (s_afSideOffset[j] * 0.5f) + hand.vDirection * s_afBaseOffset[j];
+
+            finger.avJoints[0] = vJoint;
+
+            // metacarpal
+            vJoint += (vFingerDir * s_afBoneLengths[j][0]) + vThumbSide * (s_afSideOffset[j] * 0.5f);
+            finger.avJoints[1] = vJoint;
+
+            // bend each knuckle towards the palm
+            const float fFingerCurl = fCurl * (bThumb ? 0.35f : 0.55f) * (1.0f + 0.15f * std::sin( t * 3.0f + j ));
+            float       fAngle = 0.0f;
+
+            for ( int k = 1; k < 4; k++ )
+            {
+                fAngle += fFingerCurl;
+
+                const Leap::Vector vBoneDir = vFingerDir * std::cos( fAngle ) + hand.vPalmNormal * std::sin( fAngle );
+
+                vJoint += vBoneDir * s_afBoneLengths[j][k];
+                finger.avJoints[k + 1] = vJoint;
+            }
+        }
+    }
+
+    int     m_iNumHands;
+    float   m_fHandLifetimeSeconds;
+};
+
+//==============================================================================
+/**
+    FrameSource that feeds SyntheticHands frames at a fixed rate from its own
+    thread, standing in for the Leap service on machines without a device.
+*/
+class SyntheticFrameSource  : public FrameSource,
+                              private Thread
+{
+public:
+    SyntheticFrameSource( int iNumHands, double fFramesPerSecond, float fHandLifetimeSeconds = 0.0f )
+      : Thread( "SyntheticFrameSource" ),
+        m_hands( iNumHands, fHandLifetimeSeconds ),
+        m_fFramesPerSecond( jlimit( 1.0, 1000.0, fFramesPerSecond ) ),
+        m_pConsumer( nullptr )
+    {
+    }
+
+    ~SyntheticFrameSource()
+    {
+        stop();
+    }
+
+    void start( FrameSnapshotConsumer& consumer )
+    {
+        stop();
+        m_pConsumer = &consumer;
+        startThread( 8 );
+    }
+
+    void stop()
+    {
+        stopThread( 5000 );
+    }
+
+    String getDescription() const
+    {
+        return "Synthetic: " + String( m_hands.getNumHands() ) + " hands at " + String( m_fFramesPerSecond, 0 ) + " Hz";
+    }
+
+private:
+    void run()
+    {
+        const double  fPeriodMs = 1000.0 / m_fFramesPerSecond;
+        const double  fStartMs  = Time::getMillisecondCounterHiRes();
+        double        fDueMs    = fStartMs;
+        int64_t       iFrameId  = 0;
+
+        while ( !threadShouldExit() )
+        {
+            FrameSnapshot& frame = m_pConsumer->beginFrame();
+
+            m_hands.poseFrame( (fDueMs - fStartMs) * 0.001, frame );
+            frame.iFrameId = ++iFrameId;
+
+            m_pConsumer->endFrame();
+
+            fDueMs += fPeriodMs;
+
+            double fNowMs = Time::getMillisecondCounterHiRes();
+
+            // after a long stall, carry on from now rather than bursting to catch up
+            if ( fNowMs - fDueMs > 100.0 )
+                fDueMs = fNowMs;
+
+            // sleep for whole milliseconds, then yield through the remainder so rates
+            // above 500 Hz keep their spacing
+            while ( fNowMs < fDueMs && !threadShouldExit() )
+            {
+                const int iWaitMs = static_cast<int>(fDueMs - fNowMs) - 1;
+
+                if ( iWaitMs > 0 )
+                    wait( iWaitMs );
+                else
+                    Thread::yield();
+
+                fNowMs = Time::getMillisecondCounterHiRes();
+            }
+        }
+    }
+
+    SyntheticHands          m_hands;
+    double                  m_fFramesPerSecond;
+    FrameSnapshotConsumer*  m_pConsumer;
+
+    JUCE_DECLARE_NON_COPYABLE (SyntheticFrameSource)
+};
+
+#endif // FINGERVISUALIZER_SYNTHETICHANDS_H_INCLUDED
@@ -0,0 +1,252 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_TRAILHISTORY_H_INCLUDED
+#define FINGERVISUALIZER_TRAILHISTORY_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FrameSnapshot.h"
+
+//==============================================================================
+/**
+    The recent positions of every finger joint of a few hands, for drawing trails.
+
+    Each hand id gets a slot with a fixed capacity ring of samples.  A sample is
+    every joint of the hand at one time, stored contiguously, so the trail of one
+    joint is a strided run through the ring.  A slot is freed once its newest
+    sample is older than the trail duration, and a new hand takes a free slot or
+    the one that has been idle longest.  Nothing is allocated after construction
+    unless the capacity changes.
+
+    Times are kept as float seconds from a base that moves up whenever no trail
+    is left, so they stay precise in long sessions.  The pending count of each
+    slot says how many of its newest samples haven't been copied to the GPU yet.
+*/
+class TrailHistory
+{
+public:
+    enum
+    {
+        kPointsPerSample = HandSnapshot::kNumFingers * FingerSnapshot::kNumJoints,
+        kMinCapacity     = 2,
+        kMaxCapacity     = 16384
+    };
+
+    struct Vertex
+    {
+        float x, y, z;
+        float fTime;
+    };
+
+    TrailHistory( int iMaxHands, int iCapacity )
+      : m_iMaxHands( jmax( 1, iMaxHands ) ),
+        m_iCapacity( 0 ),
+        m_fBaseSeconds( 0.0 )
+    {
+        m_aSlots.allocate( static_cast<size_t>(m_iMaxHands), true );
+        setCapacity( iCapacity );
+    }
+
+    int getMaxHands() const noexcept        { return m_iMaxHands; }
+    int getCapacity() const noexcept        { return m_iCapacity; }
+
+    /** Changes how many samples each trail keeps, clearing all of them. */
+    void setCapacity( int iCapacity )
+    {
+        iCapacity = jlimit( static_cast<int>(kMinCapacity), static_cast<int>(kMaxCapacity), iCapacity );
+
+        if ( iCapacity != m_iCapacity )
+        {
+            m_iCapacity = iCapacity;
+            m_aVertices.allocate( static_cast<size_t>(m_iMaxHands) * m_iCapacity * kPointsPerSample, true );
+        }
+
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        for ( int i = 0; i < m_iMaxHands; i++ )
+            m_aSlots[i] = Slot();
+    }
+
+    //==============================================================================
+    /** Records every hand in frame at fSeconds, forgetting trails older than fDurationSeconds. */
+    void addFrame( const FrameSnapshot& frame, double fSeconds, double fDurationSeconds )
+    {
+        bool bAnyActive = false;
+
+        for ( int i = 0; i < m_iMaxHands; i++ )
+        {
+            // time going backwards, a new source or a replay that looped, starts over
+            if ( m_aSlots[i].bActive && m_aSlots[i].fNewestTime > getTime( fSeconds ) )
+            {
+                reset();
+                bAnyActive = false;
+                break;
+            }
+
+            if ( m_aSlots[i].bActive && m_aSlots[i].fNewestTime < getTime( fSeconds - fDurationSeconds ) )
+                m_aSlots[i].bActive = false;
+
+            bAnyActive = bAnyActive || m_aSlots[i].bActive;
+        }
+
+        if ( !bAnyActive )
+            m_fBaseSeconds = fSeconds;
+
+        const float fTime = getTime( fSeconds );
+
+        for ( int i = 0; i < frame.iNumHands; i++ )
+        {
+            const int iSlot = findSlotForHand( frame.aHands[i].iId, fTime );
+
+            if ( iSlot >= 0 )
+                addSample( m_aSlots[iSlot], iSlot, frame.aHands[i], fTime );
+        }
+    }
+
+    /** The time since the base, as stored in the vertices. */
+    float getTime( double fSeconds ) const noexcept
+    {
+        return static_cast<float>(fSeconds - m_fBaseSeconds);
+    }
+
+    //==============================================================================
+    bool isActive( int iSlot ) const noexcept       { return m_aSlots[iSlot].bActive; }
+    int32_t getId( int iSlot ) const noexcept       { return m_aSlots[iSlot].iId; }
+    int getNumSamples( int iSlot ) const noexcept   { return m_aSlots[iSlot].iCount; }
+
+    /** Ring index of the newest sample in the slot. */
+    int getNewestIndex( int iSlot ) const noexcept
+    {
+        return (m_aSlots[iSlot].iHead + m_iCapacity - 1) % m_iCapacity;
+    }
+
+    /** The kPointsPerSample vertices of one sample, finger by finger, joint by joint. */
+    const Vertex* getSample( int iSlot, int iIndex ) const noexcept
+    {
+        return m_aVertices + (static_cast<size_t>(iSlot) * m_iCapacity + iIndex) * kPointsPerSample;
+    }
+
+    /** How many of the newest samples were taken at fTime or later. */
+    int getNumSamplesSince( int iSlot, float fTime ) const noexcept
+    {
+        const Slot& slot = m_aSlots[iSlot];
+
+        // samples get older with the distance from the head, so binary search it
+        int iLow = 0, iHigh = slot.iCount;
+
+        while ( iLow < iHigh )
+        {
+            const int iMid   = (iLow + iHigh) / 2;
+            const int iIndex = (slot.iHead + m_iCapacity - 1 - iMid) % m_iCapacity;
+
+            if ( getSample( iSlot, iIndex )->fTime >= fTime )
+                iLow = iMid + 1;
+            else
+                iHigh = iMid;
+        }
+
+        return iLow;
+    }
+
+    //==============================================================================
+    int getNumPending( int iSlot ) const noexcept   { return m_aSlots[iSlot].iPending; }
+    void clearPending( int iSlot ) noexcept         { m_aSlots[iSlot].iPending = 0; }
+
+    /** Marks everything as not uploaded, for a new GPU buffer. */
+    void markAllPending() noexcept
+    {
+        for ( int i = 0; i < m_iMaxHands; i++ )
+            m_aSlots[i].iPending = m_aSlots[i].iCount;
+    }
+
+private:
+    struct Slot
+    {
+        Slot() : iId( 0 ), bActive( false ), iHead( 0 ), iCount( 0 ), iPending( 0 ), fNewestTime( 0.0f ) {}
+
+        int32_t iId;
+        bool    bActive;
+        int     iHead;
+        int     iCount;
+        int     iPending;
+        float   fNewestTime;
+    };
+
+    /// the hand's slot, a free one, or the one idle longest; -1 if all were updated this frame.
+    int findSlotForHand( int32_t iId, float fTime ) noexcept
+    {
+        int iFree = -1, iOldest = -1;
+
+        for ( int i = 0; i < m_iMaxHands; i++ )
+        {
+            const Slot& slot = m_aSlots[i];
+
+            if ( !slot.bActive )
+            {
+                if ( iFree < 0 )
+                    iFree = i;
+            }
+            else if ( slot.iId == iId )
+            {
+                return i;
+            }
+            else if ( slot.fNewestTime < fTime && (iOldest < 0 || slot.fNewestTime < m_aSlots[iOldest].fNewestTime) )
+            {
+                iOldest = i;
+            }
+        }
+
+        const int iSlot = (iFree >= 0) ? iFree : iOldest;
+
+        if ( iSlot >= 0 )
+        {
+            m_aSlots[iSlot] = Slot();
+            m_aSlots[iSlot].iId     = iId;
+            m_aSlots[iSlot].bActive = true;
+        }
+
+        return iSlot;
+    }
+
+    void addSample( Slot& slot, int iSlot, const HandSnapshot& hand, float fTime ) noexcept
+    {
+        Vertex* pVertex = m_aVertices + (static_cast<size_t>(iSlot) * m_iCapacity + slot.iHead) * kPointsPerSample;
+
+        for ( int i = 0; i < HandSnapshot::kNumFingers; i++ )
+        {
+            for ( int j = 0; j < FingerSnapshot::kNumJoints; j++ )
+            {
+                const Leap::Vector& vJoint = hand.aFingers[i].avJoints[j];
+
+                pVertex->x     = vJoint.x;
+                pVertex->y     = vJoint.y;
+                pVertex->z     = vJoint.z;
+                pVertex->fTime = fTime;
+                ++pVertex;
+            }
+        }
+
+        slot.iHead       = (slot.iHead + 1) % m_iCapacity;
+        slot.iCount      = jmin( slot.iCount + 1, m_iCapacity );
+        slot.iPending    = jmin( slot.iPending + 1, m_iCapacity );
+        slot.fNewestTime = fTime;
+    }
+
+    int                 m_iMaxHands;
+    int                 m_iCapacity;
+    double              m_fBaseSeconds;
+    HeapBlock<Slot>     m_aSlots;
+    HeapBlock<Vertex>   m_aVertices;
+
+    JUCE_DECLARE_NON_COPYABLE (TrailHistory)
+};
+
+#endif // FINGERVISUALIZER_TRAILHISTORY_H_INCLUDED
@@ -0,0 +1,262 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_TRAILRENDERER_H_INCLUDED
+#define FINGERVISUALIZER_TRAILRENDERER_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "TrailHistory.h"
+#include "SceneShading.h"
+
+//==============================================================================
+/**
+    Draws the TrailHistory of every hand as fading polylines, one per joint.
+
+    The history is mirrored into a vertex buffer that lives as long as the
+    context.  Each slot's ring is stored twice in a row, sample i at i and at
+    i + capacity, so the newest samples are always one contiguous run however
+    the ring has wrapped, and each joint's trail is a single strided line strip.
+    Only the samples added since the last draw are uploaded, usually one per
+    hand per frame, instead of streaming the whole history every frame.
+
+    The age of each vertex is worked out in the shader from the time stored with
+    it, so the fade needs no per-frame work on the CPU.  Without the shader
+    pipeline initialise() returns false and no trails are drawn.
+*/
+class TrailRenderer
+{
+public:
+    TrailRenderer( OpenGLContext& context, int iMaxHands, int iSamplesPerTrail )
+      : m_context( context ),
+        m_history( iMaxHands, iSamplesPerTrail ),
+        m_iVertexBuffer( 0 )
+    {
+    }
+
+    ~TrailRenderer()
+    {
+        // release() has to be called while the context is still active.
+        jassert( m_pProgram == nullptr );
+    }
+
+    //==============================================================================
+    /** Creates the shader and buffer, call from newOpenGLContextCreated(). */
+    bool initialise( const SceneLighting& lighting )
+    {
+        release();
+
+        if ( !lighting.isAvailable() )
+            return false;
+
+        m_pProgram = new OpenGLShaderProgram( m_context );
+
+        if ( !m_pProgram->addShader( lighting.getShaderSource( getVertexShader(), GL_VERTEX_SHADER ).toRawUTF8(), GL_VERTEX_SHADER )
+              || !m_pProgram->addShader( lighting.getShaderSource( getFragmentShader(), GL_FRAGMENT_SHADER ).toRawUTF8(), GL_FRAGMENT_SHADER )
+              || !m_pProgram->link() )
+        {
+            Logger::writeToLog( "TrailRenderer: " + m_pProgram->getLastError() );
+            m_pProgram = nullptr;
+            return false;
+        }
+
+        m_pPosition   = new OpenGLShaderProgram::Attribute( *m_pProgram, "position" );
+        m_pNow        = new OpenGLShaderProgram::Uniform( *m_pProgram, "now" );
+        m_pDuration   = new OpenGLShaderProgram::Uniform( *m_pProgram, "duration" );
+        m_pTrailColor = new OpenGLShaderProgram::Uniform( *m_pProgram, "trailColor" );
+        m_pScene      = new SceneUniforms( *m_pProgram );
+
+        m_context.extensions.glGenBuffers( 1, &m_iVertexBuffer );
+        allocateVertexBuffer();
+
+        return true;
+    }
+
+    /** Frees the GL objects, call from openGLContextClosing(). */
+    void release()
+    {
+        if ( m_iVertexBuffer != 0 )
+            m_context.extensions.glDeleteBuffers( 1, &m_iVertexBuffer );
+
+        m_iVertexBuffer = 0;
+
+        m_pScene      = nullptr;
+        m_pTrailColor = nullptr;
+        m_pDuration   = nullptr;
+        m_pNow        = nullptr;
+        m_pPosition   = nullptr;
+        m_pProgram    = nullptr;
+    }
+
+    bool isAvailable() const noexcept           { return m_pProgram != nullptr; }
+
+    TrailHistory& getHistory() noexcept         { return m_history; }
+
+    /** Changes the samples kept per trail, clearing the trails.  Needs the context active. */
+    void setSamplesPerTrail( int iSamplesPerTrail )
+    {
+        m_history.setCapacity( iSamplesPerTrail );
+
+        if ( m_iVertexBuffer != 0 )
+            allocateVertexBuffer();
+    }
+
+    //==============================================================================
+    /** Uploads new samples and draws everything newer than fDurationSeconds before fNowSeconds.
+        Hand slots take their colors from apfColors by id, like the skeletons.
+    */
+    void draw( const SceneTransform& transform, double fNowSeconds, double fDurationSeconds, const GLfloat* const* apfColors, int iNumColors )
+    {
+        if ( !isAvailable() )
+            return;
+
+        OpenGLExtensionFunctions& gl = m_context.extensions;
+
+        gl.glBindBuffer( GL_ARRAY_BUFFER, m_iVertexBuffer );
+        uploadPendingSamples();
+
+        m_pProgram->use();
+        m_pScene->set( transform );
+        m_pNow->set( m_history.getTime( fNowSeconds ) );
+        m_pDuration->set( static_cast<GLfloat>(jmax( 0.001, fDurationSeconds )) );
+
+        const GLuint  iPosition   = static_cast<GLuint>(m_pPosition->attributeID);
+        const GLsizei iStride     = static_cast<GLsizei>(TrailHistory::kPointsPerSample * sizeof (TrailHistory::Vertex));
+        const float   fOldestTime = m_history.getTime( fNowSeconds - fDurationSeconds );
+        const int     iCapacity   = m_history.getCapacity();
+        const char*   pBase       = nullptr;
+
+        gl.glEnableVertexAttribArray( iPosition );
+
+        for ( int iSlot = 0; iSlot < m_history.getMaxHands(); iSlot++ )
+        {
+            if ( !m_history.isActive( iSlot ) )
+                continue;
+
+            const GLsizei iCount = static_cast<GLsizei>(m_history.getNumSamplesSince( iSlot, fOldestTime ));
+
+            if ( iCount < 2 )
+                continue;
+
+            const GLfloat* pfColor = apfColors[static_cast<uint32_t>(m_history.getId( iSlot )) % static_cast<uint32_t>(iNumColors)];
+            m_pTrailColor->set( pfColor[0], pfColor[1], pfColor[2], pfColor[3] );
+
+            // the newest iCount samples end at the newest index's mirror
+            const GLint iFirst = m_history.getNewestIndex( iSlot ) + iCapacity - iCount + 1;
+
+            for ( int iPoint = 0; iPoint < TrailHistory::kPointsPerSample; iPoint++ )
+            {
+                const pointer_sized_int iOffset = getVertexOffset( iSlot, 0 )
+                                                    + static_cast<pointer_sized_int>(iPoint * sizeof (TrailHistory::Vertex));
+
+                gl.glVertexAttribPointer( iPosition, 4, GL_FLOAT, GL_FALSE, iStride, pBase + iOffset );
+                glDrawArrays( GL_LINE_STRIP, iFirst, iCount );
+            }
+        }
+
+        gl.glDisableVertexAttribArray( iPosition );
+        gl.glBindBuffer( GL_ARRAY_BUFFER, 0 );
+        gl.glUseProgram( 0 );
+    }
+
+private:
+    //==============================================================================
+    static const char* getVertexShader()
+    {
+        return
+            "attribute vec4 position;\n"
+            "uniform float now;\n"
+            "uniform float duration;\n"
+            "uniform vec4 trailColor;\n"
+            "uniform mat4 projectionMatrix;\n"
+            "uniform mat4 modelViewMatrix;\n"
+            "varying vec4 color;\n"
+            "void main()\n"
+            "{\n"
+            "    float fAge = clamp ((now - position.w) / duration, 0.0, 1.0);\n"
+            "    color = vec4 (trailColor.rgb, trailColor.a * (1.0 - fAge));\n"
+            "    gl_Position = projectionMatrix * (modelViewMatrix * vec4 (position.xyz, 1.0));\n"
+            "}\n";
+    }
+
+    static const char* getFragmentShader()
+    {
+        return
+            "varying vec4 color;\n"
+            "void main()\n"
+            "{\n"
+            "    gl_FragColor = color;\n"
+            "}\n";
+    }
+
+    /// byte offset of a sample in the buffer, iIndex running up to twice the capacity.
+    pointer_sized_int getVertexOffset( int iSlot, int iIndex ) const noexcept
+    {
+        const int iSamplesPerSlot = 2 * m_history.getCapacity();
+
+        return static_cast<pointer_sized_int>((static_cast<size_t>(iSlot) * iSamplesPerSlot + iIndex)
+                                                * TrailHistory::kPointsPerSample * sizeof (TrailHistory::Vertex));
+    }
+
+    void allocateVertexBuffer()
+    {
+        m_context.extensions.glBindBuffer( GL_ARRAY_BUFFER, m_iVertexBuffer );
+        m_context.extensions.glBufferData( GL_ARRAY_BUFFER, getVertexOffset( m_history.getMaxHands(), 0 ), nullptr, GL_STREAM_DRAW );
+        m_context.extensions.glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+        // a new buffer starts empty, so the whole history has to go up again
+        m_history.markAllPending();
+    }
+
+    /// copies the samples added since the last call into both halves of their slots.
+    void uploadPendingSamples()
+    {
+        const int iCapacity = m_history.getCapacity();
+
+        for ( int iSlot = 0; iSlot < m_history.getMaxHands(); iSlot++ )
+        {
+            const int iPending = m_history.getNumPending( iSlot );
+
+            if ( iPending == 0 )
+                continue;
+
+            const int iFirst = (m_history.getNewestIndex( iSlot ) - iPending + 1 + iCapacity) % iCapacity;
+            const int iRun   = jmin( iPending, iCapacity - iFirst );
+
+            uploadRun( iSlot, iFirst, iRun );
+
+            if ( iRun < iPending )
+                uploadRun( iSlot, 0, iPending - iRun );
+
+            m_history.clearPending( iSlot );
+        }
+    }
+
+    void uploadRun( int iSlot, int iFirst, int iCount )
+    {
+        const pointer_sized_int iBytes = static_cast<pointer_sized_int>(iCount * TrailHistory::kPointsPerSample * sizeof (TrailHistory::Vertex));
+        const TrailHistory::Vertex* pData = m_history.getSample( iSlot, iFirst );
+
+        m_context.extensions.glBufferSubData( GL_ARRAY_BUFFER, getVertexOffset( iSlot, iFirst ), iBytes, pData );
+        m_context.extensions.glBufferSubData( GL_ARRAY_BUFFER, getVertexOffset( iSlot, iFirst + m_history.getCapacity() ), iBytes, pData );
+    }
+
+    OpenGLContext&                                  m_context;
+    TrailHistory                                    m_history;
+
+    ScopedPointer<OpenGLShaderProgram>              m_pProgram;
+    ScopedPointer<OpenGLShaderProgram::Attribute>   m_pPosition;
+    ScopedPointer<OpenGLShaderProgram::Uniform>     m_pNow;
+    ScopedPointer<OpenGLShaderProgram::Uniform>     m_pDuration;
+    ScopedPointer<OpenGLShaderProgram::Uniform>     m_pTrailColor;
+    ScopedPointer<SceneUniforms>                    m_pScene;
+    GLuint                                          m_iVertexBuffer;
+
+    JUCE_DECLARE_NON_COPYABLE (TrailRenderer)
+};
+
+#endif // FINGERVISUALIZER_TRAILRENDERER_H_INCLUDED
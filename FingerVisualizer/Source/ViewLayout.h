@@ -0,0 +1,118 @@
+/******************************************************************************\
+* Copyright (C) Leap Motion, Inc. 2011-2014.                                   *
+* Leap Motion proprietary and  confidential.  Not for distribution.            *
+* Use subject to the terms of the Leap Motion SDK Agreement available at       *
+* https://developer.leapmotion.com/sdk_agreement, or another agreement between *
+* Leap Motion and you, your company or other organization.                     *
+\******************************************************************************/
+
+#ifndef FINGERVISUALIZER_VIEWLAYOUT_H_INCLUDED
+#define FINGERVISUALIZER_VIEWLAYOUT_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "LeapUtilGL.h"
+
+//==============================================================================
+/**
+    How the window is split into views of the same hands.
+
+    With kLayout_Quad the window is split 2x2 into top, front and side views
+    from fixed cameras and a perspective view from the orbit camera the mouse
+    and arrow keys move.  All views are drawn in one pass of one context, each
+    with its own viewport and scissor rectangle, from the same buffers.
+
+    Pane rectangles have their origin at the top left like components, the
+    caller flips them for glViewport().
+*/
+class ViewLayout
+{
+public:
+    enum Layout
+    {
+        kLayout_Single,
+        kLayout_Quad,
+        kNumLayouts
+    };
+
+    enum ViewAngle
+    {
+        /// the orbit camera
+        kView_Perspective,
+        kView_Top,
+        kView_Front,
+        kView_Side
+    };
+
+    enum
+    {
+        kMaxViews = 4,
+        /// pixels between panes
+        kGap      = 2
+    };
+
+    static int getNumViews( Layout layout ) noexcept
+    {
+        return layout == kLayout_Quad ? 4 : 1;
+    }
+
+    static ViewAngle getViewAngle( Layout layout, int iView ) noexcept
+    {
+        // the usual arrangement of modelling tools, perspective bottom right
+        static const ViewAngle aQuadAngles[kMaxViews] = { kView_Top, kView_Front, kView_Side, kView_Perspective };
+
+        return layout == kLayout_Quad ? aQuadAngles[iView & 3] : kView_Perspective;
+    }
+
+    /** The pane of a view in an area of iWidth by iHeight. */
+    static Rectangle<int> getViewBounds( Layout layout, int iView, int iWidth, int iHeight ) noexcept
+    {
+        if ( layout != kLayout_Quad )
+            return Rectangle<int>( 0, 0, iWidth, iHeight );
+
+        // the left column and top row get the odd pixel
+        const int iLeftWidth = (iWidth - kGap + 1) / 2;
+        const int iTopHeight = (iHeight - kGap + 1) / 2;
+        const int iColumn    = iView & 1;
+        const int iRow       = (iView >> 1) & 1;
+
+        const int iX = iColumn == 0 ? 0 : iLeftWidth + kGap;
+        const int iY = iRow == 0 ? 0 : iTopHeight + kGap;
+
+        return Rectangle<int>( iX, iY,
+                               jmax( 1, iColumn == 0 ? iLeftWidth : iWidth - iX ),
+                               jmax( 1, iRow == 0 ? iTopHeight : iHeight - iY ) );
+    }
+
+    static const char* getViewName( ViewAngle angle ) noexcept
+    {
+        switch ( angle )
+        {
+        case kView_Top:   return "Top";
+        case kView_Front: return "Front";
+        case kView_Side:  return "Side";
+        default:          return "Perspective";
+        }
+    }
+
+    /** Points a camera at the scene origin from a fixed direction, at the orbit camera's default distance. */
+    static void setupFixedCamera( ViewAngle angle, LeapUtilGL::CameraGL& camera )
+    {
+        const float fDistance = 4.0f;
+
+        switch ( angle )
+        {
+        case kView_Top:
+            // looking down, away from the user is up on screen
+            camera.SetPOVLookAt( Leap::Vector( 0, fDistance, 0 ), Leap::Vector::zero(), Leap::Vector( 0, 0, -1 ) );
+            break;
+        case kView_Side:
+            camera.SetPOVLookAt( Leap::Vector( fDistance, 0, 0 ), Leap::Vector::zero() );
+            break;
+        default:
+            camera.SetPOVLookAt( Leap::Vector( 0, 0, fDistance ), Leap::Vector::zero() );
+            break;
+        }
+    }
+};
+
+#endif // FINGERVISUALIZER_VIEWLAYOUT_H_INCLUDED
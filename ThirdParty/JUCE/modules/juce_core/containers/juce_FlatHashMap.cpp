@@ -0,0 +1,398 @@
+/*
+  ==============================================================================
+
+   This file is part of the juce_core module of the JUCE library.
+   Copyright (c) 2013 - Raw Material Software Ltd.
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose with
+   or without fee is hereby granted, provided that the above copyright notice and this
+   permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+   ------------------------------------------------------------------------------
+
+   NOTE! This permissive ISC license applies ONLY to files within the juce_core module!
+   All other JUCE modules are covered by a dual GPL/commercial license, so if you are
+   using any other modules, be sure to check that you also comply with their license.
+
+   For more details, visit www.juce.com
+
+  ==============================================================================
+*/
+#if JUCE_UNIT_TESTS
+
+namespace FlatHashMapTestHelpers
+{
+    /** Puts every key in the same few slots, to exercise long probe runs. */
+    struct CollidingHashFunctions
+    {
+        uint32 generateHash (const int key) const noexcept      { return (uint32) (key & 3) * 0x40000000u; }
+    };
+
+    /** Hashes with a seed, so maps using different seeds lay the same keys out differently. */
+    struct SeededHashFunctions
+    {
+        SeededHashFunctions (uint32 s = 0) noexcept : seed (s) {}
+
+        uint32 generateHash (const int key) const noexcept      { return DefaultFlatHashFunctions::mix ((uint32) key ^ seed); }
+
+        uint32 seed;
+    };
+
+    /** A value that counts how many of it are alive, to check nothing leaks or is destroyed twice. */
+    struct CountedValue
+    {
+        CountedValue() noexcept                         : value (0)             { ++numAlive; }
+        CountedValue (int v) noexcept                   : value (v)             { ++numAlive; }
+        CountedValue (const CountedValue& other) noexcept : value (other.value) { ++numAlive; }
+        ~CountedValue() noexcept                                                { --numAlive; }
+
+        CountedValue& operator= (const CountedValue& other) noexcept   { value = other.value; return *this; }
+
+        int value;
+        static int numAlive;
+    };
+
+    int CountedValue::numAlive = 0;
+
+   #if JUCE_COMPILER_SUPPORTS_MOVE_SEMANTICS
+    /** A value that can be moved but not copied. */
+    struct MoveOnlyValue
+    {
+        MoveOnlyValue() noexcept                        : value (nullptr) {}
+        MoveOnlyValue (int v)                           : value (new int (v)) {}
+        MoveOnlyValue (MoveOnlyValue&& other) noexcept  : value (other.value.release()) {}
+
+        MoveOnlyValue& operator= (MoveOnlyValue&& other) noexcept
+        {
+            value = other.value.release();
+            return *this;
+        }
+
+        ScopedPointer<int> value;
+
+    private:
+        MoveOnlyValue (const MoveOnlyValue&);
+        MoveOnlyValue& operator= (const MoveOnlyValue&);
+    };
+   #endif
+}
+
+//==============================================================================
+class FlatHashMapTests  : public UnitTest
+{
+public:
+    FlatHashMapTests() : UnitTest ("FlatHashMap") {}
+
+    template <class MapType>
+    void checkMatchesReference (MapType& map, const HashMap<int, int>& reference, int maxKey)
+    {
+        expectEquals (map.size(), reference.size());
+
+        for (int key = 0; key < maxKey; ++key)
+        {
+            const bool isInReference = reference.contains (key);
+            expect (map.contains (key) == isInReference);
+
+            if (isInReference)
+                expectEquals ((int) *map.find (key), reference[key]);
+        }
+    }
+
+    template <class MapType>
+    void randomOperations (MapType& map)
+    {
+        Random r (getRandom());
+        HashMap<int, int> reference;
+        const int maxKey = 2000;
+
+        for (int i = 0; i < 20000; ++i)
+        {
+            const int key = r.nextInt (maxKey);
+
+            if (r.nextInt (3) == 0)
+            {
+                expect (map.remove (key) == reference.contains (key));
+                reference.remove (key);
+            }
+            else
+            {
+                map.set (key, i);
+                reference.set (key, i);
+            }
+        }
+
+        checkMatchesReference (map, reference, maxKey);
+    }
+
+    void runTest()
+    {
+        using namespace FlatHashMapTestHelpers;
+
+        beginTest ("Basic operations");
+        {
+            FlatHashMap<int, String> map;
+            expect (map.isEmpty());
+            expect (map.find (1) == nullptr);
+            expect (! map.remove (1));
+
+            map.set (1, "one");
+            map.set (2, "two");
+            map.set (1, "uno");
+            expectEquals (map.size(), 2);
+            expectEquals (map[1], String ("uno"));
+            expectEquals (map[2], String ("two"));
+            expectEquals (map[3], String());
+            expect (! map.contains (3));
+
+            map.getReference (3) << "three";
+            expectEquals (*map.find (3), String ("three"));
+
+            expect (map.remove (1));
+            expect (! map.contains (1));
+            expectEquals (map.size(), 2);
+
+            map.clear();
+            expect (map.isEmpty());
+            expect (! map.contains (2));
+        }
+
+        beginTest ("Random operations");
+        {
+            FlatHashMap<int, int> map;
+            randomOperations (map);
+        }
+
+        beginTest ("Colliding hashes");
+        {
+            FlatHashMap<int, int, CollidingHashFunctions> map;
+            randomOperations (map);
+        }
+
+        beginTest ("Values are destroyed");
+        {
+            {
+                FlatHashMap<int, CountedValue> map;
+
+                for (int i = 0; i < 1000; ++i)
+                    map.set (i, CountedValue (i));
+
+                expectEquals (CountedValue::numAlive, 1000);
+
+                for (int i = 0; i < 1000; i += 2)
+                    map.remove (i);
+
+                expectEquals (CountedValue::numAlive, 500);
+
+                for (int i = 1; i < 1000; i += 2)
+                    expectEquals (map.find (i)->value, i);
+            }
+
+            expectEquals (CountedValue::numAlive, 0);
+        }
+
+        beginTest ("String keys found by StringRef");
+        {
+            FlatHashMap<String, int> map;
+
+            for (int i = 0; i < 500; ++i)
+                map.set ("key" + String (i), i);
+
+            expectEquals (*map.find ("key123"), 123);
+            expectEquals (*map.find (StringRef ("key321")), 321);
+            expect (map.find ("key500") == nullptr);
+            expect (map.remove ("key0"));
+            expect (! map.contains (StringRef ("key0")));
+
+            const DefaultFlatHashFunctions hash;
+            expect (hash.generateHash (String ("abc")) == hash.generateHash (StringRef ("abc")));
+            expect (hash.generateHash (123) == hash.generateHash ((int64) 123));
+        }
+
+       #if JUCE_COMPILER_SUPPORTS_MOVE_SEMANTICS
+        beginTest ("Move-only values");
+        {
+            FlatHashMap<int, MoveOnlyValue> map;
+
+            for (int i = 0; i < 1000; ++i)
+                map.set (i, MoveOnlyValue (i));
+
+            for (int i = 0; i < 1000; i += 3)
+                map.remove (i);
+
+            for (int i = 0; i < 1000; ++i)
+            {
+                MoveOnlyValue* v = map.find (i);
+                expect ((v != nullptr) == (i % 3 != 0));
+
+                if (v != nullptr)
+                    expectEquals (*v->value, i);
+            }
+
+            expect (map.getReference (2000).value == nullptr);
+        }
+       #endif
+
+        beginTest ("Reserve");
+        {
+            FlatHashMap<int, int> map;
+            map.reserve (1000);
+            const int capacity = map.getCapacity();
+            expect (capacity >= 1000);
+
+            for (int i = 0; i < 1000; ++i)
+                map.set (i, i);
+
+            expectEquals (map.getCapacity(), capacity);
+        }
+
+        beginTest ("Swapping keeps the hash function with the items");
+        {
+            typedef FlatHashMap<int, int, SeededHashFunctions> MapType;
+            MapType a (SeededHashFunctions (0x12345678u)), b (SeededHashFunctions (0x9abcdef0u));
+
+            for (int i = 0; i < 100; ++i)
+            {
+                a.set (i, i);
+                b.set (i + 1000, i);
+            }
+
+            a.swapWith (b);
+
+            for (int i = 0; i < 100; ++i)
+            {
+                expect (b.contains (i) && b[i] == i);
+                expect (a.contains (i + 1000) && a[i + 1000] == i);
+            }
+
+            expect (! a.contains (0));
+            expect (! b.contains (1000));
+        }
+
+        beginTest ("Iteration");
+        {
+            FlatHashMap<int, int> map;
+            int expectedKeySum = 0;
+
+            for (int i = 0; i < 300; ++i)
+            {
+                map.set (i * 7, i);
+                expectedKeySum += i * 7;
+            }
+
+            int numItems = 0, keySum = 0;
+
+            for (FlatHashMap<int, int>::Iterator i (map); i.next();)
+            {
+                expectEquals (i.getValue() * 7, i.getKey());
+                keySum += i.getKey();
+                ++numItems;
+            }
+
+            expectEquals (numItems, 300);
+            expectEquals (keySum, expectedKeySum);
+        }
+    }
+};
+
+static FlatHashMapTests flatHashMapUnitTests;
+
+#if JUCE_UNIT_TEST_BENCHMARKS
+
+//==============================================================================
+class FlatHashMapBenchmarks  : public UnitTest
+{
+public:
+    FlatHashMapBenchmarks() : UnitTest ("FlatHashMap benchmarks") {}
+
+    struct Timings
+    {
+        double insert, lookup, erase;
+    };
+
+    /** Nanoseconds per item to insert the keys, then look them up and erase them in a
+        different order, so that neither map gains from keys being allocated in sequence.
+    */
+    template <class MapType>
+    Timings timeMap (const Array<int>& keys, const Array<int>& shuffledKeys, int64& checksum)
+    {
+        Timings t;
+        const int num = keys.size();
+        ScopedPointer<MapType> map (new MapType());
+
+        double start = Time::getMillisecondCounterHiRes();
+
+        for (int i = 0; i < num; ++i)
+            map->set (keys.getUnchecked (i), i);
+
+        t.insert = (Time::getMillisecondCounterHiRes() - start) * 1.0e6 / num;
+        start = Time::getMillisecondCounterHiRes();
+
+        for (int i = 0; i < num; ++i)
+            checksum += (*map)[shuffledKeys.getUnchecked (i)];
+
+        t.lookup = (Time::getMillisecondCounterHiRes() - start) * 1.0e6 / num;
+        start = Time::getMillisecondCounterHiRes();
+
+        for (int i = 0; i < num; ++i)
+            map->remove (shuffledKeys.getUnchecked (i));
+
+        t.erase = (Time::getMillisecondCounterHiRes() - start) * 1.0e6 / num;
+        expect (map->size() == 0);
+        return t;
+    }
+
+    void runTest()
+    {
+        beginTest ("Insert, lookup and erase");
+
+        int64 checksum = 0;
+        Random r (getRandom());
+
+        for (int num = 1000; num <= 10000000; num *= 10)
+        {
+            Array<int> keys;
+            keys.ensureStorageAllocated (num);
+
+            for (int i = 0; i < num; ++i)
+                keys.add (r.nextInt());
+
+            Array<int> shuffledKeys (keys);
+
+            for (int i = num; --i > 0;)
+                shuffledKeys.swap (i, r.nextInt (i + 1));
+
+            // repeat the small sizes so there's something to measure, and run the large ones once
+            const int repeats = jmax (1, 100000 / num);
+            Timings flat = { 0, 0, 0 }, chained = { 0, 0, 0 };
+
+            for (int i = 0; i < repeats; ++i)
+            {
+                const Timings f = timeMap<FlatHashMap<int, int> > (keys, shuffledKeys, checksum);
+                const Timings c = timeMap<HashMap<int, int> > (keys, shuffledKeys, checksum);
+
+                flat.insert += f.insert / repeats;   chained.insert += c.insert / repeats;
+                flat.lookup += f.lookup / repeats;   chained.lookup += c.lookup / repeats;
+                flat.erase  += f.erase  / repeats;   chained.erase  += c.erase  / repeats;
+            }
+
+            logMessage (String (num) + " items, ns per item (FlatHashMap / HashMap): insert "
+                          + String (flat.insert, 1) + " / " + String (chained.insert, 1)
+                          + ", lookup " + String (flat.lookup, 1) + " / " + String (chained.lookup, 1)
+                          + ", erase " + String (flat.erase, 1) + " / " + String (chained.erase, 1));
+        }
+
+        expect (checksum != 0);
+    }
+};
+
+static FlatHashMapBenchmarks flatHashMapBenchmarks;
+
+#endif
+#endif
@@ -0,0 +1,536 @@
+/*
+  ==============================================================================
+
+   This file is part of the juce_core module of the JUCE library.
+   Copyright (c) 2013 - Raw Material Software Ltd.
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose with
+   or without fee is hereby granted, provided that the above copyright notice and this
+   permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+   ------------------------------------------------------------------------------
+
+   NOTE! This permissive ISC license applies ONLY to files within the juce_core module!
+   All other JUCE modules are covered by a dual GPL/commercial license, so if you are
+   using any other modules, be sure to check that you also comply with their license.
+
+   For more details, visit www.juce.com
+
+  ==============================================================================
+*/
+
+#ifndef JUCE_FLATHASHMAP_H_INCLUDED
+#define JUCE_FLATHASHMAP_H_INCLUDED
+
+
+//==============================================================================
+/**
+    Generates well-mixed 32-bit hashes for FlatHashMap.
+
+    Strings are hashed from their characters, so a String key and a StringRef or
+    string literal with the same text always get the same hash. Ints and int64s
+    with the same value also get the same hash.
+
+    @see FlatHashMap
+*/
+struct DefaultFlatHashFunctions
+{
+    /** Generates a hash from an integer. */
+    uint32 generateHash (const int key) const noexcept          { return generateHash ((int64) key); }
+
+    /** Generates a hash from an int64. */
+    uint32 generateHash (const int64 key) const noexcept        { return mix ((uint32) key ^ mix ((uint32) (key >> 32))); }
+
+    /** Generates a hash from a string. */
+    uint32 generateHash (const String& key) const noexcept      { return generateHash (StringRef (key)); }
+
+    /** Generates a hash from a string literal. */
+    uint32 generateHash (const char* key) const noexcept        { return generateHash (StringRef (key)); }
+
+    /** Generates a hash from the text of a string. */
+    uint32 generateHash (StringRef key) const noexcept
+    {
+        uint32 result = 0;
+
+        for (String::CharPointerType t (key.text); ! t.isEmpty();)
+            result = 31 * result + (uint32) t.getAndAdvance();
+
+        return mix (result);
+    }
+
+    /** Spreads the bits of a hash so that nearby values don't end up in nearby slots. */
+    static uint32 mix (uint32 h) noexcept
+    {
+        h ^= h >> 16;
+        h *= 0x85ebca6b;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35;
+        h ^= h >> 16;
+        return h;
+    }
+};
+
+
+//==============================================================================
+/**
+    Holds a set of mappings between some key/value pairs, in one contiguous block
+    of memory.
+
+    This does the same job as HashMap, but instead of allocating an entry per item
+    and chaining the entries of each slot together, it stores the items in the
+    slots themselves and looks for the next free slot when two keys collide. A
+    lookup usually touches one or two neighbouring slots rather than following a
+    chain of pointers, and adding an item doesn't allocate unless the table has
+    to grow.
+
+    Collisions are resolved with Robin Hood hashing: an item that has been pushed
+    further from its ideal slot takes precedence over one that's closer to its own,
+    which keeps every item near where a lookup starts looking for it. Each slot also
+    keeps the item's full hash, so most mismatches are rejected without comparing
+    keys, and the table can grow without hashing the keys again. Removing an item
+    moves the items after it back, so there are no tombstones to slow lookups down.
+    The table doubles in size whenever it would become more than half full, since
+    probe runs - and the mispredicted branches at the end of them - grow quickly
+    beyond that.
+
+    The keys and values are moved rather than copied when the table grows, so with
+    a compiler that supports move semantics the value type can be move-only. Lookups
+    are templates, so a map with String keys can be searched with a StringRef or a
+    string literal without creating a String - as long as the hash function gives
+    both the same hash, as DefaultFlatHashFunctions does.
+
+    The hash function class must have the form:
+
+    @code
+    struct MyHashGenerator
+    {
+        uint32 generateHash (MyKeyType key) const
+        {
+            return someWellMixedFunctionOf (key);
+        }
+    };
+    @endcode
+
+    e.g.
+    @code
+    FlatHashMap<String, int> map;
+    map.reserve (1000);
+    map.set ("one", 1);
+
+    if (int* value = map.find ("one"))
+        *value += 1;
+
+    for (FlatHashMap<String, int>::Iterator i (map); i.next();)
+        DBG (i.getKey() << " -> " << i.getValue());
+    @endcode
+
+    Unlike HashMap, this class isn't thread-safe, and any pointer or reference to a
+    value becomes invalid when items are added or removed.
+
+    @see HashMap, DefaultFlatHashFunctions
+*/
+template <typename KeyType,
+          typename ValueType,
+          class HashFunctionType = DefaultFlatHashFunctions>
+class FlatHashMap
+{
+private:
+    typedef PARAMETER_TYPE (KeyType)   KeyTypeParameter;
+    typedef PARAMETER_TYPE (ValueType) ValueTypeParameter;
+
+public:
+    //==============================================================================
+    /** Creates an empty map. Nothing is allocated until the first item is added. */
+    explicit FlatHashMap (HashFunctionType hashFunction = HashFunctionType())
+        : hashFunctionToUse (hashFunction), numSlots (0), numItems (0), mask (0)
+    {
+    }
+
+    /** Destructor. */
+    ~FlatHashMap()
+    {
+        clear();
+    }
+
+    //==============================================================================
+    /** Removes all the items, but keeps the memory allocated for them. */
+    void clear()
+    {
+        for (int i = 0; i < numSlots; ++i)
+        {
+            if (slots[i].hash != 0)
+            {
+                getEntry (i).~Entry();
+                slots[i].hash = 0;
+            }
+        }
+
+        numItems = 0;
+    }
+
+    /** Returns the number of items in the map. */
+    inline int size() const noexcept                    { return numItems; }
+
+    /** Returns true if the map is empty. */
+    inline bool isEmpty() const noexcept                { return numItems == 0; }
+
+    /** Returns the number of items the map can hold before it has to grow. */
+    inline int getCapacity() const noexcept             { return getCapacityForSlots (numSlots); }
+
+    /** Makes sure the map can hold at least this many items without having to grow. */
+    void reserve (const int numItemsNeeded)
+    {
+        if (numItemsNeeded > getCapacity())
+        {
+            int newNumSlots = jmax ((int) minNumSlots, numSlots);
+
+            while (getCapacityForSlots (newNumSlots) < numItemsNeeded && newNumSlots < maxNumSlots)
+                newNumSlots *= 2;
+
+            // more items than the largest table can hold
+            jassert (getCapacityForSlots (newNumSlots) >= numItemsNeeded);
+
+            rehash (newNumSlots);
+        }
+    }
+
+    //==============================================================================
+    /** Returns a pointer to the value for a key, or nullptr if the key isn't in the map.
+        The key can be any type that the hash function accepts and that can be compared
+        with KeyType, e.g. a StringRef when KeyType is String.
+    */
+    template <typename LookupKeyType>
+    ValueType* find (const LookupKeyType& key) noexcept
+    {
+        const int index = findIndex (key);
+        return index >= 0 ? &(getEntry (index).value) : nullptr;
+    }
+
+    /** Returns a pointer to the value for a key, or nullptr if the key isn't in the map. */
+    template <typename LookupKeyType>
+    const ValueType* find (const LookupKeyType& key) const noexcept
+    {
+        const int index = findIndex (key);
+        return index >= 0 ? &(getEntry (index).value) : nullptr;
+    }
+
+    /** Returns true if the map contains the given key. */
+    template <typename LookupKeyType>
+    bool contains (const LookupKeyType& key) const noexcept
+    {
+        return findIndex (key) >= 0;
+    }
+
+    /** Returns a copy of the value for a key, or a default-constructed value if the
+        key isn't in the map.
+    */
+    template <typename LookupKeyType>
+    ValueType operator[] (const LookupKeyType& key) const
+    {
+        const int index = findIndex (key);
+        return index >= 0 ? getEntry (index).value : ValueType();
+    }
+
+    /** Returns a reference to the value for a key, adding a default-constructed value
+        first if the key isn't in the map yet.
+    */
+    ValueType& getReference (KeyTypeParameter key)
+    {
+        const uint32 hash = hashFor (key);
+        const int index = findIndex (key, hash);
+
+        if (index >= 0)
+            return getEntry (index).value;
+
+        return insertEntry (hash, key, ValueType());
+    }
+
+    /** Adds or replaces the value for a key. */
+    void set (KeyTypeParameter key, ValueTypeParameter value)
+    {
+        const uint32 hash = hashFor (key);
+        const int index = findIndex (key, hash);
+
+        if (index >= 0)
+            getEntry (index).value = value;
+        else
+            insertEntry (hash, key, value);
+    }
+
+   #if JUCE_COMPILER_SUPPORTS_MOVE_SEMANTICS
+    /** Adds or replaces the value for a key, moving the value into the map. */
+    void set (KeyTypeParameter key, ValueType&& value)
+    {
+        const uint32 hash = hashFor (key);
+        const int index = findIndex (key, hash);
+
+        if (index >= 0)
+            getEntry (index).value = static_cast<ValueType&&> (value);
+        else
+            insertEntry (hash, key, static_cast<ValueType&&> (value));
+    }
+   #endif
+
+    /** Removes the item with the given key, returning false if there wasn't one. */
+    template <typename LookupKeyType>
+    bool remove (const LookupKeyType& key)
+    {
+        int index = findIndex (key);
+
+        if (index < 0)
+            return false;
+
+        getEntry (index).~Entry();
+
+        // pull the following items that aren't in their ideal slot back by one
+        for (int next = (index + 1) & mask; slots[next].hash != 0 && getDistance (next) > 0; next = (next + 1) & mask)
+        {
+            moveEntry (index, next);
+            index = next;
+        }
+
+        slots[index].hash = 0;
+        --numItems;
+        return true;
+    }
+
+    /** Swaps the contents of this map with another one. */
+    void swapWith (FlatHashMap& other) noexcept
+    {
+        slots.swapWith (other.slots);
+        std::swap (numSlots, other.numSlots);
+        std::swap (mask, other.mask);
+        std::swap (numItems, other.numItems);
+        std::swap (hashFunctionToUse, other.hashFunctionToUse);
+    }
+
+    //==============================================================================
+    /** Iterates over the items in a FlatHashMap, in no particular order.
+
+        e.g.
+        @code
+        for (FlatHashMap<int, String>::Iterator i (map); i.next();)
+            DBG (i.getKey() << " -> " << i.getValue());
+        @endcode
+
+        Adding or removing items invalidates any iterators.
+    */
+    class Iterator
+    {
+    public:
+        Iterator (const FlatHashMap& mapToIterate) noexcept
+            : map (mapToIterate), index (-1)
+        {
+        }
+
+        /** Moves to the next item, returning false when there are no more. */
+        bool next() noexcept
+        {
+            while (++index < map.numSlots)
+                if (map.slots[index].hash != 0)
+                    return true;
+
+            return false;
+        }
+
+        /** Returns the current item's key. */
+        const KeyType& getKey() const noexcept          { return map.getEntry (index).key; }
+
+        /** Returns the current item's value. */
+        ValueType& getValue() const noexcept            { return const_cast <FlatHashMap&> (map).getEntry (index).value; }
+
+    private:
+        const FlatHashMap& map;
+        int index;
+
+        JUCE_DECLARE_NON_COPYABLE (Iterator)
+    };
+
+private:
+    //==============================================================================
+    enum
+    {
+        minNumSlots = 8,
+        maxNumSlots = 1 << 30,
+        maxLoadPercent = 50
+    };
+
+    static int getCapacityForSlots (const int slotCount) noexcept
+    {
+        return (int) (((int64) slotCount * maxLoadPercent) / 100);
+    }
+
+    struct Entry
+    {
+        Entry (KeyTypeParameter k, ValueTypeParameter v)  : key (k), value (v) {}
+
+       #if JUCE_COMPILER_SUPPORTS_MOVE_SEMANTICS
+        Entry (KeyTypeParameter k, ValueType&& v)  : key (k), value (static_cast<ValueType&&> (v)) {}
+        Entry (Entry&& other)  : key (static_cast<KeyType&&> (other.key)), value (static_cast<ValueType&&> (other.value)) {}
+       #endif
+
+        KeyType key;
+        ValueType value;
+    };
+
+    // the entry is only constructed while the hash is non-zero
+    struct Slot
+    {
+        uint32 hash;
+        Entry entry;
+    };
+
+    friend class Iterator;
+
+    HashFunctionType hashFunctionToUse;
+    HeapBlock<Slot> slots;
+    int numSlots, numItems;
+    uint32 mask;
+
+    Entry& getEntry (const int index) const noexcept
+    {
+        return slots[index].entry;
+    }
+
+    /** The hash stored for a key, never 0 so that 0 can mark an empty slot. */
+    template <typename LookupKeyType>
+    uint32 hashFor (const LookupKeyType& key) const noexcept
+    {
+        const uint32 hash = hashFunctionToUse.generateHash (key);
+        return hash != 0 ? hash : 1;
+    }
+
+    /** How far the item in a slot is from the slot its hash points to. */
+    uint32 getDistance (const int index) const noexcept
+    {
+        return ((uint32) index - slots[index].hash) & mask;
+    }
+
+    template <typename LookupKeyType>
+    int findIndex (const LookupKeyType& key) const noexcept
+    {
+        return numItems > 0 ? findIndex (key, hashFor (key)) : -1;
+    }
+
+    template <typename LookupKeyType>
+    int findIndex (const LookupKeyType& key, const uint32 hash) const noexcept
+    {
+        if (numSlots == 0)
+            return -1;
+
+        for (uint32 index = hash & mask, distance = 0;; index = (index + 1) & mask, ++distance)
+        {
+            const Slot& slot = slots[index];
+
+            if (slot.hash == hash && slot.entry.key == key)
+                return (int) index;
+
+            // an empty slot, or one whose item is closer to home than this key would be,
+            // means the key isn't here
+            if (slot.hash == 0 || ((index - slot.hash) & mask) < distance)
+                return -1;
+        }
+    }
+
+    void moveEntry (const int destIndex, const int sourceIndex)
+    {
+        Entry& source = getEntry (sourceIndex);
+
+       #if JUCE_COMPILER_SUPPORTS_MOVE_SEMANTICS
+        new (&getEntry (destIndex)) Entry (static_cast<Entry&&> (source));
+       #else
+        new (&getEntry (destIndex)) Entry (source);
+       #endif
+
+        source.~Entry();
+        slots[destIndex].hash = slots[sourceIndex].hash;
+    }
+
+    /** Finds the slot for a new item with this hash, shifting the following run of
+        items up by one if it has to take a richer item's place. */
+    int makeSlotFor (const uint32 hash)
+    {
+        uint32 index = hash & mask;
+
+        for (uint32 distance = 0; slots[index].hash != 0 && getDistance ((int) index) >= distance; ++distance)
+            index = (index + 1) & mask;
+
+        if (slots[index].hash != 0)
+        {
+            uint32 empty = index;
+
+            while (slots[empty].hash != 0)
+                empty = (empty + 1) & mask;
+
+            for (uint32 i = empty; i != index;)
+            {
+                const uint32 previous = (i - 1) & mask;
+                moveEntry ((int) i, (int) previous);
+                i = previous;
+            }
+        }
+
+        slots[index].hash = hash;
+        return (int) index;
+    }
+
+    ValueType& insertEntry (const uint32 hash, KeyTypeParameter key, ValueTypeParameter value)
+    {
+        reserve (numItems + 1);
+        const int index = makeSlotFor (hash);
+        new (&getEntry (index)) Entry (key, value);
+        ++numItems;
+        return getEntry (index).value;
+    }
+
+   #if JUCE_COMPILER_SUPPORTS_MOVE_SEMANTICS
+    ValueType& insertEntry (const uint32 hash, KeyTypeParameter key, ValueType&& value)
+    {
+        reserve (numItems + 1);
+        const int index = makeSlotFor (hash);
+        new (&getEntry (index)) Entry (key, static_cast<ValueType&&> (value));
+        ++numItems;
+        return getEntry (index).value;
+    }
+   #endif
+
+    void rehash (const int newNumSlots)
+    {
+        HeapBlock<Slot> oldSlots;
+        oldSlots.swapWith (slots);
+        const int oldNumSlots = numSlots;
+
+        slots.calloc ((size_t) newNumSlots);
+        numSlots = newNumSlots;
+        mask = (uint32) newNumSlots - 1;
+
+        for (int i = 0; i < oldNumSlots; ++i)
+        {
+            if (oldSlots[i].hash != 0)
+            {
+                Entry& old = oldSlots[i].entry;
+                const int index = makeSlotFor (oldSlots[i].hash);
+
+               #if JUCE_COMPILER_SUPPORTS_MOVE_SEMANTICS
+                new (&getEntry (index)) Entry (static_cast<Entry&&> (old));
+               #else
+                new (&getEntry (index)) Entry (old);
+               #endif
+
+                old.~Entry();
+            }
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FlatHashMap)
+};
+
+
+#endif   // JUCE_FLATHASHMAP_H_INCLUDED
@@ -0,0 +1,180 @@
+/*
+  ==============================================================================
+
+   This file is part of the juce_core module of the JUCE library.
+   Copyright (c) 2013 - Raw Material Software Ltd.
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose with
+   or without fee is hereby granted, provided that the above copyright notice and this
+   permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+   ------------------------------------------------------------------------------
+
+   NOTE! This permissive ISC license applies ONLY to files within the juce_core module!
+   All other JUCE modules are covered by a dual GPL/commercial license, so if you are
+   using any other modules, be sure to check that you also comply with their license.
+
+   For more details, visit www.juce.com
+
+  ==============================================================================
+*/
+
+#ifndef JUCE_LOCKFREEFIFO_H_INCLUDED
+#define JUCE_LOCKFREEFIFO_H_INCLUDED
+
+
+//==============================================================================
+/**
+    A bounded, lock-free FIFO of objects for one writing thread and one reading thread.
+
+    Unlike AbstractFifo, this holds the objects itself. push() may only be called by
+    one thread and pop() by one other thread, and neither of them ever blocks or
+    allocates memory.
+
+    The read and write positions are kept on separate cache lines, and each side keeps
+    its own copy of the other side's position. It only reloads that copy when the copy
+    says the FIFO is full or empty, so in a steady stream the two threads rarely touch
+    each other's cache lines. Pushing or popping a block of items costs the same
+    synchronisation as a single item.
+
+    ElementType must be default-constructible and copyable. A slot is reset to a
+    default-constructed value when its item is popped, so the FIFO doesn't keep
+    references alive.
+
+    @see LockFreeQueue, LockFreeIntrusiveQueue, AbstractFifo
+*/
+template <typename ElementType>
+class LockFreeFifo
+{
+public:
+    //==============================================================================
+    /** Creates a FIFO that can hold at least the given number of items. The actual
+        capacity is rounded up so the buffer size is a power of two.
+    */
+    explicit LockFreeFifo (const int minimumCapacity)
+        : bufferSize (nextPowerOfTwo (jmax (1, minimumCapacity) + 1)),
+          mask (bufferSize - 1)
+    {
+        buffer.malloc ((size_t) bufferSize);
+
+        for (int i = 0; i < bufferSize; ++i)
+            new (buffer + i) ElementType();
+    }
+
+    /** Destructor. */
+    ~LockFreeFifo()
+    {
+        for (int i = 0; i < bufferSize; ++i)
+            buffer[i].~ElementType();
+    }
+
+    //==============================================================================
+    /** Returns the number of items the FIFO can hold. */
+    int getCapacity() const noexcept                { return mask; }
+
+    /** Returns the number of items waiting to be popped. When called by anything but
+        the reading thread this is only a snapshot.
+    */
+    int getNumReady() const noexcept                { return (writer.position.loadAcquire() - reader.position.loadAcquire()) & mask; }
+
+    /** Returns true if there's nothing to pop. */
+    bool isEmpty() const noexcept                   { return getNumReady() == 0; }
+
+    //==============================================================================
+    /** Adds an item, returning false if the FIFO is full. Only call this from the writing thread. */
+    bool push (const ElementType& item)             { return push (&item, 1) == 1; }
+
+    /** Adds as many of the given items as there's room for, in order, and returns
+        how many were added. Only call this from the writing thread.
+    */
+    int push (const ElementType* const items, const int numItems)
+    {
+        const int writePos = writer.position.value;
+        int space = (writer.otherPosition - writePos - 1) & mask;
+
+        if (space < numItems)
+        {
+            writer.otherPosition = reader.position.loadAcquire();
+            space = (writer.otherPosition - writePos - 1) & mask;
+        }
+
+        const int num = jmin (numItems, space);
+
+        if (num > 0)
+        {
+            for (int i = 0; i < num; ++i)
+                buffer [(writePos + i) & mask] = items[i];
+
+            writer.position.storeRelease ((writePos + num) & mask);
+        }
+
+        return num;
+    }
+
+    //==============================================================================
+    /** Takes the oldest item, returning false if the FIFO is empty. Only call this from the reading thread. */
+    bool pop (ElementType& item)                    { return pop (&item, 1) == 1; }
+
+    /** Takes up to maxItems of the oldest items, in order, and returns how many were
+        taken. Only call this from the reading thread.
+    */
+    int pop (ElementType* const items, const int maxItems)
+    {
+        const int readPos = reader.position.value;
+        int numReady = (reader.otherPosition - readPos) & mask;
+
+        if (numReady < maxItems)
+        {
+            reader.otherPosition = writer.position.loadAcquire();
+            numReady = (reader.otherPosition - readPos) & mask;
+        }
+
+        const int num = jmin (maxItems, numReady);
+
+        if (num > 0)
+        {
+            for (int i = 0; i < num; ++i)
+            {
+                ElementType& slot = buffer [(readPos + i) & mask];
+                items[i] = slot;
+                slot = ElementType();
+            }
+
+            reader.position.storeRelease ((readPos + num) & mask);
+        }
+
+        return num;
+    }
+
+private:
+    //==============================================================================
+    enum { cacheLineSize = 64 };
+
+    /** One side's position and its copy of the other side's, on a cache line of their own. */
+    struct Side
+    {
+        Side() noexcept  : otherPosition (0) {}
+
+        Atomic<int> position;
+        int otherPosition;
+        char padding [cacheLineSize - sizeof (Atomic<int>) - sizeof (int)];
+    };
+
+    HeapBlock<ElementType> buffer;
+    const int bufferSize, mask;
+
+    char padding [cacheLineSize];
+    Side writer, reader;
+
+    JUCE_DECLARE_NON_COPYABLE (LockFreeFifo)
+};
+
+
+#endif   // JUCE_LOCKFREEFIFO_H_INCLUDED
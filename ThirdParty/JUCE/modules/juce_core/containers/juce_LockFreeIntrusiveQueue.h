@@ -0,0 +1,199 @@
+/*
+  ==============================================================================
+
+   This file is part of the juce_core module of the JUCE library.
+   Copyright (c) 2013 - Raw Material Software Ltd.
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose with
+   or without fee is hereby granted, provided that the above copyright notice and this
+   permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+   ------------------------------------------------------------------------------
+
+   NOTE! This permissive ISC license applies ONLY to files within the juce_core module!
+   All other JUCE modules are covered by a dual GPL/commercial license, so if you are
+   using any other modules, be sure to check that you also comply with their license.
+
+   For more details, visit www.juce.com
+
+  ==============================================================================
+*/
+
+#ifndef JUCE_LOCKFREEINTRUSIVEQUEUE_H_INCLUDED
+#define JUCE_LOCKFREEINTRUSIVEQUEUE_H_INCLUDED
+
+
+//==============================================================================
+/**
+    An unbounded, lock-free queue of objects that any number of threads can push to,
+    but only one thread can pop from.
+
+    The queue doesn't allocate anything: the objects are linked together through a
+    Node that they inherit from, e.g.
+
+    @code
+    struct Message  : public LockFreeIntrusiveQueue<Message>::Node
+    {
+        int value;
+    };
+
+    LockFreeIntrusiveQueue<Message> queue;
+    queue.push (&message);      // from any thread
+    Message* m = queue.pop();   // from the reading thread
+    @endcode
+
+    Pushing swaps the new object in as the head of the list with one atomic exchange,
+    and then links the previous head to it. Popping only follows links, so it never
+    waits for the writers. A batch of objects is linked up first and pushed with a
+    single exchange, and popping a batch takes as many objects as it can in one walk
+    along the links, moving the reader's end of the list just once. The writers' end
+    and the reader's end of the list are on separate cache lines.
+
+    An object can only be in one queue at a time, and the queue doesn't own the
+    objects, so anything still in it when it's deleted is simply forgotten.
+
+    @see LockFreeQueue, LockFreeFifo
+*/
+template <typename ObjectType>
+class LockFreeIntrusiveQueue
+{
+public:
+    //==============================================================================
+    /** The base class for objects that can be put into a LockFreeIntrusiveQueue. */
+    class Node
+    {
+    public:
+        Node() noexcept {}
+
+    private:
+        friend class LockFreeIntrusiveQueue;
+        Atomic<Node*> nextInQueue;
+    };
+
+    //==============================================================================
+    /** Creates an empty queue. */
+    LockFreeIntrusiveQueue() noexcept
+        : tail (&stub)
+    {
+        head.value.value = &stub;
+    }
+
+    //==============================================================================
+    /** Adds an object to the queue. This can be called from any thread. */
+    void push (ObjectType* const object) noexcept
+    {
+        jassert (object != nullptr);
+        pushChain (object, object);
+    }
+
+    /** Adds several objects to the queue, in order, with a single atomic exchange.
+        This can be called from any thread.
+    */
+    void push (ObjectType* const* const objects, const int numObjects) noexcept
+    {
+        if (numObjects <= 0)
+            return;
+
+        for (int i = 0; i < numObjects - 1; ++i)
+            static_cast<Node*> (objects[i])->nextInQueue.value = objects[i + 1];
+
+        pushChain (objects[0], objects[numObjects - 1]);
+    }
+
+    //==============================================================================
+    /** Takes the oldest object from the queue, or returns nullptr if it's empty.
+
+        Only call this from the reading thread. It can also return nullptr when a
+        writer is half way through pushing the next object, in which case that object
+        and anything pushed after it will come out on a later call.
+    */
+    ObjectType* pop() noexcept
+    {
+        ObjectType* object;
+        return pop (&object, 1) != 0 ? object : nullptr;
+    }
+
+    /** Takes up to maxObjects of the oldest objects and returns how many were taken.
+
+        Only call this from the reading thread. Like pop(), this can stop short at an
+        object that a writer is still linking in.
+    */
+    int pop (ObjectType** const objects, const int maxObjects) noexcept
+    {
+        int num = 0;
+        Node* first = tail;
+
+        while (num < maxObjects)
+        {
+            Node* next = first->nextInQueue.loadAcquire();
+
+            if (first == &stub)
+            {
+                if (next == nullptr)
+                    break;
+
+                first = next;
+                continue;
+            }
+
+            if (next == nullptr)
+            {
+                if (first != head.value.loadAcquire())
+                    break;
+
+                // the last object can only be taken once something else follows it
+                pushChain (&stub, &stub);
+                next = first->nextInQueue.loadAcquire();
+
+                if (next == nullptr)
+                    break;
+            }
+
+            objects [num++] = static_cast<ObjectType*> (first);
+            first = next;
+        }
+
+        tail = first;
+        return num;
+    }
+
+    /** Returns true if there's nothing to pop. Only call this from the reading thread. */
+    bool isEmpty() const noexcept
+    {
+        return tail == &stub && stub.nextInQueue.loadAcquire() == nullptr;
+    }
+
+private:
+    //==============================================================================
+    enum { cacheLineSize = 64 };
+
+    struct Head
+    {
+        Atomic<Node*> value;
+        char padding [cacheLineSize - sizeof (Atomic<Node*>)];
+    };
+
+    char padding [cacheLineSize];
+    Head head;
+    Node* tail;
+    Node stub;
+
+    void pushChain (Node* const first, Node* const last) noexcept
+    {
+        last->nextInQueue.value = nullptr;
+        Node* const previous = head.value.exchange (last);
+        previous->nextInQueue.storeRelease (first);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (LockFreeIntrusiveQueue)
+};
+
+
+#endif   // JUCE_LOCKFREEINTRUSIVEQUEUE_H_INCLUDED
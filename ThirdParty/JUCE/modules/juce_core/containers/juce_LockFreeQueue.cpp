@@ -0,0 +1,559 @@
+/*
+  ==============================================================================
+
+   This file is part of the juce_core module of the JUCE library.
+   Copyright (c) 2013 - Raw Material Software Ltd.
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose with
+   or without fee is hereby granted, provided that the above copyright notice and this
+   permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+   ------------------------------------------------------------------------------
+
+   NOTE! This permissive ISC license applies ONLY to files within the juce_core module!
+   All other JUCE modules are covered by a dual GPL/commercial license, so if you are
+   using any other modules, be sure to check that you also comply with their license.
+
+   For more details, visit www.juce.com
+
+  ==============================================================================
+*/
+
+#if JUCE_UNIT_TESTS
+
+namespace LockFreeQueueTestHelpers
+{
+    /** A CriticalSection around a ring buffer, to compare the lock-free containers with. */
+    template <typename ElementType>
+    class LockedQueue
+    {
+    public:
+        LockedQueue (int capacity)  : size (capacity), start (0), numItems (0)
+        {
+            items.calloc ((size_t) capacity);
+        }
+
+        int push (const ElementType* source, int num)
+        {
+            const ScopedLock sl (lock);
+            num = jmin (num, size - numItems);
+
+            for (int i = 0; i < num; ++i)
+                items [(start + numItems++) % size] = source[i];
+
+            return num;
+        }
+
+        int pop (ElementType* dest, int num)
+        {
+            const ScopedLock sl (lock);
+            num = jmin (num, numItems);
+
+            for (int i = 0; i < num; ++i)
+            {
+                dest[i] = items [start];
+                start = (start + 1) % size;
+                --numItems;
+            }
+
+            return num;
+        }
+
+    private:
+        CriticalSection lock;
+        HeapBlock<ElementType> items;
+        int size, start, numItems;
+    };
+
+    struct Item  : public LockFreeIntrusiveQueue<Item>::Node
+    {
+        int value;
+    };
+
+    /** A block of constructed Items, so that their links start out empty. */
+    class ItemBlock
+    {
+    public:
+        explicit ItemBlock (int num)    : items (new Item [(size_t) num]) {}
+        ~ItemBlock()                    { delete[] items; }
+
+        operator Item*() const noexcept { return items; }
+
+    private:
+        Item* const items;
+
+        JUCE_DECLARE_NON_COPYABLE (ItemBlock)
+    };
+
+    inline int makeValue (int producer, int sequence) noexcept     { return (producer << 24) | sequence; }
+    inline int getProducer (int value) noexcept                    { return value >> 24; }
+    inline int getSequence (int value) noexcept                    { return value & 0xffffff; }
+
+    /** Pushes numItems values tagged with its index, in random batches, retrying while the queue is full. */
+    template <typename QueueType>
+    class Producer  : public Thread
+    {
+    public:
+        Producer (QueueType& q, int index_, int num, int maxBatch_, Random rng)
+            : Thread ("producer"), queue (q), index (index_), numItems (num), maxBatch (maxBatch_), random (rng)
+        {
+        }
+
+        void run()
+        {
+            HeapBlock<int> batch ((size_t) maxBatch);
+            int next = 0;
+
+            while (next < numItems && ! threadShouldExit())
+            {
+                const int num = jmin (numItems - next, random.nextInt (maxBatch) + 1);
+
+                for (int i = 0; i < num; ++i)
+                    batch[i] = makeValue (index, next + i);
+
+                int done = 0;
+
+                while (done < num && ! threadShouldExit())
+                {
+                    const int pushed = queue.push (batch + done, num - done);
+
+                    if (pushed == 0)
+                        Thread::yield();
+
+                    done += pushed;
+                }
+
+                next += num;
+            }
+        }
+
+    private:
+        QueueType& queue;
+        const int index, numItems, maxBatch;
+        Random random;
+    };
+
+    /** Pops values in random batches until the shared total has been reached, checking that
+        the values from each producer arrive in order. */
+    template <typename QueueType>
+    class Consumer  : public Thread
+    {
+    public:
+        Consumer (QueueType& q, Atomic<int>& total, int target, int numProducers, int maxBatch_, Random rng)
+            : Thread ("consumer"), queue (q), numPopped (total), targetTotal (target),
+              maxBatch (maxBatch_), random (rng), lastSequence ((size_t) numProducers), outOfOrder (false), checksum (0)
+        {
+            for (int i = 0; i < numProducers; ++i)
+                lastSequence[i] = -1;
+        }
+
+        void run()
+        {
+            HeapBlock<int> batch ((size_t) maxBatch);
+
+            while (numPopped.get() < targetTotal && ! threadShouldExit())
+            {
+                const int num = queue.pop (batch, random.nextInt (maxBatch) + 1);
+
+                if (num == 0)
+                {
+                    Thread::yield();
+                    continue;
+                }
+
+                for (int i = 0; i < num; ++i)
+                {
+                    const int producer = getProducer (batch[i]);
+                    const int sequence = getSequence (batch[i]);
+
+                    outOfOrder = outOfOrder || sequence <= lastSequence[producer];
+                    lastSequence[producer] = sequence;
+                    checksum += batch[i];
+                }
+
+                numPopped += num;
+            }
+        }
+
+        QueueType& queue;
+        Atomic<int>& numPopped;
+        const int targetTotal, maxBatch;
+        Random random;
+        HeapBlock<int> lastSequence;
+        bool outOfOrder;
+        int64 checksum;
+    };
+}
+
+//==============================================================================
+class LockFreeQueueTests  : public UnitTest
+{
+public:
+    LockFreeQueueTests() : UnitTest ("Lock-free queues") {}
+
+    typedef LockFreeQueueTestHelpers::Item Item;
+
+    template <typename QueueType>
+    void runProducersAndConsumers (QueueType& queue, int numProducers, int numConsumers, int itemsPerProducer, int maxBatch)
+    {
+        using namespace LockFreeQueueTestHelpers;
+
+        const int total = numProducers * itemsPerProducer;
+        Atomic<int> numPopped;
+
+        OwnedArray<Consumer<QueueType> > consumers;
+        OwnedArray<Producer<QueueType> > producers;
+
+        for (int i = 0; i < numConsumers; ++i)
+            consumers.add (new Consumer<QueueType> (queue, numPopped, total, numProducers, maxBatch, getRandom()));
+
+        for (int i = 0; i < numProducers; ++i)
+            producers.add (new Producer<QueueType> (queue, i, itemsPerProducer, maxBatch, getRandom()));
+
+        for (int i = 0; i < consumers.size(); ++i)  consumers[i]->startThread();
+        for (int i = 0; i < producers.size(); ++i)  producers[i]->startThread();
+
+        for (int i = 0; i < producers.size(); ++i)  expect (producers[i]->waitForThreadToExit (20000));
+        for (int i = 0; i < consumers.size(); ++i)  expect (consumers[i]->waitForThreadToExit (20000));
+
+        int64 checksum = 0, expectedChecksum = 0;
+
+        for (int i = 0; i < consumers.size(); ++i)
+        {
+            expect (! consumers[i]->outOfOrder, "items from one producer arrived out of order");
+            checksum += consumers[i]->checksum;
+        }
+
+        for (int p = 0; p < numProducers; ++p)
+            for (int s = 0; s < itemsPerProducer; ++s)
+                expectedChecksum += makeValue (p, s);
+
+        expectEquals (numPopped.get(), total);
+        expect (checksum == expectedChecksum, "items were lost or duplicated");
+    }
+
+    void runTest()
+    {
+        beginTest ("Single producer, single consumer FIFO");
+
+        {
+            LockFreeFifo<int> fifo (100);
+            expectEquals (fifo.getCapacity(), 127);
+
+            int values[200];
+            for (int i = 0; i < 200; ++i)
+                values[i] = i;
+
+            expectEquals (fifo.push (values, 200), 127);
+            expect (! fifo.push (0));
+            expectEquals (fifo.getNumReady(), 127);
+
+            int out[200];
+            expectEquals (fifo.pop (out, 50), 50);
+            expect (out[0] == 0 && out[49] == 49);
+            expectEquals (fifo.push (values + 127, 73), 50);
+            expectEquals (fifo.pop (out, 200), 127);
+            expect (out[0] == 50 && out[126] == 176);
+            expect (fifo.isEmpty());
+
+            LockFreeFifo<String> strings (4);
+            expect (strings.push ("abc"));
+            String s;
+            expect (strings.pop (s) && s == "abc");
+            expect (! strings.pop (s));
+
+            runProducersAndConsumers (fifo, 1, 1, 1000000, 64);
+        }
+
+        beginTest ("Multiple producer, multiple consumer queue");
+
+        {
+            LockFreeQueue<int> queue (100);
+            expectEquals (queue.getCapacity(), 128);
+
+            int values[200], out[200];
+            for (int i = 0; i < 200; ++i)
+                values[i] = i;
+
+            expectEquals (queue.push (values, 200), 128);
+            expect (! queue.push (0));
+            expectEquals (queue.pop (out, 100), 100);
+            expectEquals (queue.push (values + 128, 72), 72);
+            expectEquals (queue.getNumReady(), 100);
+            expectEquals (queue.pop (out, 200), 100);
+            expect (out[0] == 100 && out[99] == 199);
+
+            runProducersAndConsumers (queue, 4, 4, 250000, 32);
+        }
+
+        beginTest ("Multiple producer, single consumer intrusive queue");
+
+        {
+            LockFreeIntrusiveQueue<Item> queue;
+            expect (queue.isEmpty());
+            expect (queue.pop() == nullptr);
+
+            Item items[3];
+            Item* pointers[] = { items, items + 1, items + 2 };
+            queue.push (items + 2);
+            queue.push (pointers, 2);
+            expect (! queue.isEmpty());
+            expect (queue.pop() == items + 2);
+            expect (queue.pop() == items);
+            expect (queue.pop() == items + 1);
+            expect (queue.pop() == nullptr);
+            expect (queue.isEmpty());
+
+            Item* popped[4];
+            queue.push (pointers, 3);
+            expectEquals (queue.pop (popped, 2), 2);
+            expect (popped[0] == items && popped[1] == items + 1);
+            queue.push (pointers, 1);
+            expectEquals (queue.pop (popped, 4), 2);
+            expect (popped[0] == items + 2 && popped[1] == items);
+            expectEquals (queue.pop (popped, 4), 0);
+            expect (queue.isEmpty());
+
+            const int numProducers = 4, itemsPerProducer = 200000;
+            const LockFreeQueueTestHelpers::ItemBlock allItems (numProducers * itemsPerProducer);
+            IntrusiveProducer* producers [numProducers];
+
+            for (int p = 0; p < numProducers; ++p)
+                producers[p] = new IntrusiveProducer (queue, allItems + p * itemsPerProducer, p, itemsPerProducer, getRandom());
+
+            HeapBlock<int> lastSequence ((size_t) numProducers);
+            for (int p = 0; p < numProducers; ++p)
+                lastSequence[p] = -1;
+
+            int numPopped = 0;
+            bool outOfOrder = false;
+            Item* batch[16];
+            const uint32 start = Time::getMillisecondCounter();
+
+            while (numPopped < numProducers * itemsPerProducer && Time::getMillisecondCounter() < start + 20000)
+            {
+                const int num = queue.pop (batch, 16);
+
+                if (num == 0)
+                    Thread::yield();
+
+                for (int i = 0; i < num; ++i)
+                {
+                    const int producer = LockFreeQueueTestHelpers::getProducer (batch[i]->value);
+                    const int sequence = LockFreeQueueTestHelpers::getSequence (batch[i]->value);
+                    outOfOrder = outOfOrder || sequence != lastSequence[producer] + 1;
+                    lastSequence[producer] = sequence;
+                }
+
+                numPopped += num;
+            }
+
+            for (int p = 0; p < numProducers; ++p)
+                delete producers[p];
+
+            expectEquals (numPopped, numProducers * itemsPerProducer);
+            expect (! outOfOrder, "items from one producer arrived out of order");
+            expect (queue.isEmpty());
+        }
+    }
+
+    /** Pushes its items one at a time or in random batches. */
+    class IntrusiveProducer  : public Thread
+    {
+    public:
+        IntrusiveProducer (LockFreeIntrusiveQueue<Item>& q, Item* i, int index, int num, Random rng)
+            : Thread ("producer"), queue (q), items (i), numItems (num), random (rng)
+        {
+            for (int n = 0; n < num; ++n)
+                items[n].value = LockFreeQueueTestHelpers::makeValue (index, n);
+
+            startThread();
+        }
+
+        ~IntrusiveProducer()
+        {
+            stopThread (5000);
+        }
+
+        void run()
+        {
+            Item* batch[16];
+
+            for (int next = 0; next < numItems && ! threadShouldExit();)
+            {
+                const int num = jmin (numItems - next, random.nextInt (16) + 1);
+
+                if (num == 1)
+                {
+                    queue.push (items + next);
+                }
+                else
+                {
+                    for (int i = 0; i < num; ++i)
+                        batch[i] = items + next + i;
+
+                    queue.push (batch, num);
+                }
+
+                next += num;
+            }
+        }
+
+    private:
+        LockFreeIntrusiveQueue<Item>& queue;
+        Item* items;
+        const int numItems;
+        Random random;
+    };
+};
+
+static LockFreeQueueTests lockFreeQueueUnitTests;
+
+#if JUCE_UNIT_TEST_BENCHMARKS
+
+//==============================================================================
+class LockFreeQueueBenchmarks  : public UnitTest
+{
+public:
+    LockFreeQueueBenchmarks() : UnitTest ("Lock-free queue benchmarks") {}
+
+    template <typename QueueType>
+    double timeTransfer (QueueType& queue, int numProducers, int numConsumers, int maxBatch)
+    {
+        using namespace LockFreeQueueTestHelpers;
+
+        const int itemsPerProducer = (1 << 20) / numProducers;
+        Atomic<int> numPopped;
+        OwnedArray<Thread> threads;
+
+        for (int i = 0; i < numConsumers; ++i)
+            threads.add (new Consumer<QueueType> (queue, numPopped, itemsPerProducer * numProducers, numProducers, maxBatch, getRandom()));
+
+        for (int i = 0; i < numProducers; ++i)
+            threads.add (new Producer<QueueType> (queue, i, itemsPerProducer, maxBatch, getRandom()));
+
+        const double start = Time::getMillisecondCounterHiRes();
+
+        for (int i = 0; i < threads.size(); ++i)
+            threads[i]->startThread();
+
+        for (int i = 0; i < threads.size(); ++i)
+            threads[i]->waitForThreadToExit (60000);
+
+        const double seconds = (Time::getMillisecondCounterHiRes() - start) / 1000.0;
+        return itemsPerProducer * numProducers / (seconds * 1.0e6);
+    }
+
+    void report (const String& name, double lockFree, double locked)
+    {
+        logMessage (name + ": " + String (lockFree, 1) + " M items/s lock-free, "
+                      + String (locked, 1) + " M items/s locked");
+    }
+
+    /** Single items from several threads into the intrusive queue, against a locked queue of pointers. */
+    double timeIntrusive (int numProducers, bool useLockedQueue)
+    {
+        typedef LockFreeQueueTestHelpers::Item Item;
+
+        const int itemsPerProducer = (1 << 20) / numProducers;
+        const LockFreeQueueTestHelpers::ItemBlock items (itemsPerProducer * numProducers);
+        LockFreeIntrusiveQueue<Item> queue;
+        LockFreeQueueTestHelpers::LockedQueue<Item*> lockedQueue (1 << 20);
+
+        struct Pusher  : public Thread
+        {
+            Pusher (LockFreeIntrusiveQueue<Item>& q, LockFreeQueueTestHelpers::LockedQueue<Item*>& lq, bool locked, Item* i, int n)
+                : Thread ("pusher"), queue (q), lockedQueue (lq), useLocked (locked), items (i), num (n) {}
+
+            void run()
+            {
+                for (int i = 0; i < num; ++i)
+                {
+                    Item* item = items + i;
+
+                    if (useLocked)
+                        lockedQueue.push (&item, 1);
+                    else
+                        queue.push (item);
+                }
+            }
+
+            LockFreeIntrusiveQueue<Item>& queue;
+            LockFreeQueueTestHelpers::LockedQueue<Item*>& lockedQueue;
+            bool useLocked;
+            Item* items;
+            int num;
+        };
+
+        OwnedArray<Thread> threads;
+
+        for (int i = 0; i < numProducers; ++i)
+            threads.add (new Pusher (queue, lockedQueue, useLockedQueue, items + i * itemsPerProducer, itemsPerProducer));
+
+        const double start = Time::getMillisecondCounterHiRes();
+
+        for (int i = 0; i < threads.size(); ++i)
+            threads[i]->startThread();
+
+        for (int numPopped = 0; numPopped < itemsPerProducer * numProducers;)
+        {
+            Item* batch[32];
+            const int num = useLockedQueue ? lockedQueue.pop (batch, 32) : queue.pop (batch, 32);
+
+            if (num == 0)
+                Thread::yield();
+
+            numPopped += num;
+        }
+
+        const double seconds = (Time::getMillisecondCounterHiRes() - start) / 1000.0;
+
+        for (int i = 0; i < threads.size(); ++i)
+            threads[i]->waitForThreadToExit (60000);
+
+        return itemsPerProducer * numProducers / (seconds * 1.0e6);
+    }
+
+    void runTest()
+    {
+        using LockFreeQueueTestHelpers::LockedQueue;
+
+        beginTest ("Single producer, single consumer");
+
+        for (int batch = 1; batch <= 64; batch *= 64)
+        {
+            LockFreeFifo<int> fifo (4096);
+            LockedQueue<int> locked (4096);
+
+            report ("SPSC, batches of up to " + String (batch),
+                    timeTransfer (fifo, 1, 1, batch), timeTransfer (locked, 1, 1, batch));
+        }
+
+        beginTest ("Multiple producers, multiple consumers");
+
+        for (int batch = 1; batch <= 64; batch *= 64)
+        {
+            LockFreeQueue<int> queue (4096);
+            LockedQueue<int> locked (4096);
+
+            report ("MPMC 4x4, batches of up to " + String (batch),
+                    timeTransfer (queue, 4, 4, batch), timeTransfer (locked, 4, 4, batch));
+        }
+
+        beginTest ("Multiple producers, single consumer");
+
+        report ("MPSC 4x1, single pushes", timeIntrusive (4, false), timeIntrusive (4, true));
+    }
+};
+
+static LockFreeQueueBenchmarks lockFreeQueueBenchmarks;
+
+#endif
+#endif
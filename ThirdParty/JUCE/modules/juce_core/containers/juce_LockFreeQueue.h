@@ -0,0 +1,211 @@
+/*
+  ==============================================================================
+
+   This file is part of the juce_core module of the JUCE library.
+   Copyright (c) 2013 - Raw Material Software Ltd.
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose with
+   or without fee is hereby granted, provided that the above copyright notice and this
+   permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+   ------------------------------------------------------------------------------
+
+   NOTE! This permissive ISC license applies ONLY to files within the juce_core module!
+   All other JUCE modules are covered by a dual GPL/commercial license, so if you are
+   using any other modules, be sure to check that you also comply with their license.
+
+   For more details, visit www.juce.com
+
+  ==============================================================================
+*/
+
+#ifndef JUCE_LOCKFREEQUEUE_H_INCLUDED
+#define JUCE_LOCKFREEQUEUE_H_INCLUDED
+
+
+//==============================================================================
+/**
+    A bounded, lock-free queue of objects that any number of threads can push to
+    and pop from at the same time.
+
+    Each slot carries a sequence number that says whether it's ready to be written
+    or read on the current lap around the buffer. A thread claims a run of slots by
+    moving the shared write or read position on with one compare-and-swap, then
+    copies its items and publishes each slot by bumping its sequence number. Threads
+    only ever wait for each other when a slot they have claimed is still being copied
+    by the thread that had it on the previous lap.
+
+    Pushing or popping a block of items claims all the slots it can get with a
+    single compare-and-swap. The write and read positions are on separate cache lines.
+
+    ElementType must be default-constructible and copyable. A slot is reset to a
+    default-constructed value when its item is popped.
+
+    @see LockFreeFifo, LockFreeIntrusiveQueue
+*/
+template <typename ElementType>
+class LockFreeQueue
+{
+public:
+    //==============================================================================
+    /** Creates a queue that can hold at least the given number of items. The actual
+        capacity is rounded up to a power of two.
+    */
+    explicit LockFreeQueue (const int minimumCapacity)
+        : capacity (nextPowerOfTwo (jmax (2, minimumCapacity))),
+          mask ((uint32) capacity - 1)
+    {
+        cells.malloc ((size_t) capacity);
+
+        for (int i = 0; i < capacity; ++i)
+        {
+            new (cells + i) Cell();
+            cells[i].sequence.value = (uint32) i;
+        }
+    }
+
+    /** Destructor. */
+    ~LockFreeQueue()
+    {
+        for (int i = 0; i < capacity; ++i)
+            cells[i].~Cell();
+    }
+
+    //==============================================================================
+    /** Returns the number of items the queue can hold. */
+    int getCapacity() const noexcept                { return capacity; }
+
+    /** Returns roughly how many items are waiting to be popped. While other threads
+        are pushing or popping this is only a snapshot.
+    */
+    int getNumReady() const noexcept
+    {
+        return jlimit (0, capacity, (int) (uint32) (writePosition.counter.loadAcquire() - readPosition.counter.loadAcquire()));
+    }
+
+    //==============================================================================
+    /** Adds an item, returning false if the queue is full. */
+    bool push (const ElementType& item)             { return push (&item, 1) == 1; }
+
+    /** Adds as many of the given items as there's room for, in order, and returns
+        how many were added. Items pushed by other threads at the same time may be
+        queued before, after or in between them.
+    */
+    int push (const ElementType* const items, const int numItems)
+    {
+        uint32 pos;
+        const int num = claim (writePosition, 0, numItems, pos);
+
+        for (int i = 0; i < num; ++i)
+        {
+            Cell& cell = cells [(pos + (uint32) i) & mask];
+            cell.item = items[i];
+            cell.sequence.storeRelease (pos + (uint32) i + 1);
+        }
+
+        return num;
+    }
+
+    //==============================================================================
+    /** Takes the oldest item, returning false if the queue is empty. */
+    bool pop (ElementType& item)                    { return pop (&item, 1) == 1; }
+
+    /** Takes up to maxItems of the oldest items and returns how many were taken.
+        Items pushed by one thread come out in the order they were pushed.
+    */
+    int pop (ElementType* const items, const int maxItems)
+    {
+        uint32 pos;
+        const int num = claim (readPosition, 1, maxItems, pos);
+
+        for (int i = 0; i < num; ++i)
+        {
+            Cell& cell = cells [(pos + (uint32) i) & mask];
+            items[i] = cell.item;
+            cell.item = ElementType();
+            cell.sequence.storeRelease (pos + (uint32) i + mask + 1);
+        }
+
+        return num;
+    }
+
+private:
+    //==============================================================================
+    enum { cacheLineSize = 64 };
+
+    struct Cell
+    {
+        Atomic<uint32> sequence;
+        ElementType item;
+    };
+
+    struct Position
+    {
+        Atomic<uint32> counter;
+        char padding [cacheLineSize - sizeof (Atomic<uint32>)];
+    };
+
+    HeapBlock<Cell> cells;
+    const int capacity;
+    const uint32 mask;
+
+    char padding [cacheLineSize];
+    Position writePosition, readPosition;
+
+    /** Claims a run of up to maxNum slots starting at the given position. A slot is
+        ready for a writer when its sequence equals its position, and for a reader
+        when it equals its position + 1.
+    */
+    int claim (Position& position, const uint32 readyOffset, const int maxNum, uint32& start) noexcept
+    {
+        if (maxNum <= 0)
+            return 0;
+
+        uint32 pos = position.counter.loadAcquire();
+
+        for (;;)
+        {
+            int num = 0;
+
+            while (num < maxNum)
+            {
+                const uint32 slot = pos + (uint32) num;
+                const int diff = (int) (cells [slot & mask].sequence.loadAcquire() - (slot + readyOffset));
+
+                if (diff != 0)
+                {
+                    // a slot from a later lap means our position is out of date
+                    if (num == 0 && diff > 0)
+                        num = -1;
+
+                    break;
+                }
+
+                ++num;
+            }
+
+            if (num == 0)
+                return 0;   // full when pushing, empty when popping
+
+            if (num > 0 && position.counter.compareAndSetBool (pos + (uint32) num, pos))
+            {
+                start = pos;
+                return num;
+            }
+
+            pos = position.counter.loadAcquire();
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (LockFreeQueue)
+};
+
+
+#endif   // JUCE_LOCKFREEQUEUE_H_INCLUDED
@@ -110,7 +110,9 @@ namespace juce
 {
 
 #include "containers/juce_AbstractFifo.cpp"
+#include "containers/juce_LockFreeQueue.cpp"
 #include "containers/juce_DynamicObject.cpp"
+#include "containers/juce_FlatHashMap.cpp"
 #include "containers/juce_NamedValueSet.cpp"
 #include "containers/juce_PropertySet.cpp"
 #include "containers/juce_Variant.cpp"
@@ -154,6 +156,7 @@ namespace juce
 #include "threads/juce_ReadWriteLock.cpp"
 #include "threads/juce_Thread.cpp"
 #include "threads/juce_ThreadPool.cpp"
+#include "threads/juce_TaskGroup.cpp"
 #include "threads/juce_TimeSliceThread.cpp"
 #include "time/juce_PerformanceCounter.cpp"
 #include "time/juce_RelativeTime.cpp"
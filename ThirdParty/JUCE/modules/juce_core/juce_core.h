@@ -125,6 +125,15 @@
  //#define JUCE_CATCH_UNHANDLED_EXCEPTIONS 1
 #endif
 
+/** Config: JUCE_UNIT_TEST_BENCHMARKS
+    Adds the timing comparisons of some containers to the unit tests. These are slow and
+    only worth running in an optimised build, so they're left out of UnitTestRunner::runAllTests()
+    unless you enable this flag alongside JUCE_UNIT_TESTS.
+*/
+#ifndef JUCE_UNIT_TEST_BENCHMARKS
+ #define JUCE_UNIT_TEST_BENCHMARKS 0
+#endif
+
 #ifndef JUCE_STRING_UTF_TYPE
  #define JUCE_STRING_UTF_TYPE 8
 #endif
@@ -204,6 +213,9 @@ extern JUCE_API void JUCE_CALLTYPE logAssertion (const char* file, int line) noe
 #include "containers/juce_SortedSet.h"
 #include "containers/juce_SparseSet.h"
 #include "containers/juce_AbstractFifo.h"
+#include "containers/juce_LockFreeFifo.h"
+#include "containers/juce_LockFreeQueue.h"
+#include "containers/juce_LockFreeIntrusiveQueue.h"
 #include "text/juce_NewLine.h"
 #include "text/juce_StringPool.h"
 #include "text/juce_Identifier.h"
@@ -216,6 +228,7 @@ extern JUCE_API void JUCE_CALLTYPE logAssertion (const char* file, int line) noe
 #include "containers/juce_NamedValueSet.h"
 #include "containers/juce_DynamicObject.h"
 #include "containers/juce_HashMap.h"
+#include "containers/juce_FlatHashMap.h"
 #include "time/juce_RelativeTime.h"
 #include "time/juce_Time.h"
 #include "streams/juce_InputStream.h"
@@ -252,6 +265,7 @@ extern JUCE_API void JUCE_CALLTYPE logAssertion (const char* file, int line) noe
 #include "threads/juce_Thread.h"
 #include "threads/juce_ThreadLocalValue.h"
 #include "threads/juce_ThreadPool.h"
+#include "threads/juce_TaskGroup.h"
 #include "threads/juce_TimeSliceThread.h"
 #include "threads/juce_ReadWriteLock.h"
 #include "threads/juce_ScopedReadLock.h"
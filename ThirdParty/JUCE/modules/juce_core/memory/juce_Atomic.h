@@ -81,6 +81,26 @@ public:
     /** Atomically sets the current value, returning the value that was replaced. */
     Type exchange (Type value) noexcept;
 
+    /** Reads the value with a plain load followed by a memory barrier, so that no
+        later reads or writes can be moved in front of it.
+
+        Unlike get(), this doesn't need exclusive access to the value's cache line,
+        so it's much cheaper when other threads are reading the same value. Only use
+        it for 32-bit values and pointers, which the CPU can load in one go.
+        @see storeRelease
+    */
+    Type loadAcquire() const noexcept;
+
+    /** Writes the value with a memory barrier followed by a plain store, so that
+        no earlier reads or writes can be moved after it. A thread that reads the new
+        value with loadAcquire() also sees everything written before it was stored.
+
+        Only use it for 32-bit values and pointers, and only when no other thread
+        can be changing the value at the same time.
+        @see loadAcquire
+    */
+    void storeRelease (Type newValue) noexcept;
+
     /** Atomically adds a number to this value, returning the new value. */
     Type operator+= (Type amountToAdd) noexcept;
 
@@ -377,6 +397,33 @@ inline Type Atomic<Type>::compareAndSetValue (const Type newValue, const Type va
   #endif
 }
 
+template <typename Type>
+inline Type Atomic<Type>::loadAcquire() const noexcept
+{
+  #if defined (__ATOMIC_ACQUIRE)
+    return sizeof (Type) == 4 ? castFrom32Bit ((int32) __atomic_load_n ((volatile int32*) &value, __ATOMIC_ACQUIRE))
+                              : castFrom64Bit ((int64) __atomic_load_n ((volatile int64*) &value, __ATOMIC_ACQUIRE));
+  #else
+    const Type v = value;
+    memoryBarrier();
+    return v;
+  #endif
+}
+
+template <typename Type>
+inline void Atomic<Type>::storeRelease (const Type newValue) noexcept
+{
+  #if defined (__ATOMIC_RELEASE)
+    if (sizeof (Type) == 4)
+        __atomic_store_n ((volatile int32*) &value, castTo32Bit (newValue), __ATOMIC_RELEASE);
+    else
+        __atomic_store_n ((volatile int64*) &value, castTo64Bit (newValue), __ATOMIC_RELEASE);
+  #else
+    memoryBarrier();
+    value = newValue;
+  #endif
+}
+
 template <typename Type>
 inline void Atomic<Type>::memoryBarrier() noexcept
 {
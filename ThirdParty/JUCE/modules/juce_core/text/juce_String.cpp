@@ -207,6 +207,17 @@ public:
         return bufferFromText (text)->allocatedNumBytes;
     }
 
+    static int getReferenceCount (const CharPointerType text) noexcept
+    {
+        StringHolder* const b = bufferFromText (text);
+
+        // the empty string lives in read-only memory, so mustn't be touched atomically
+        if (b == (StringHolder*) &emptyString)
+            return emptyString.refCount;
+
+        return b->refCount.get() + 1;
+    }
+
     //==============================================================================
     Atomic<int> refCount;
     size_t allocatedNumBytes;
@@ -291,6 +302,11 @@ void String::preallocateBytes (const size_t numBytesNeeded)
     text = StringHolder::makeUniqueWithByteSize (text, numBytesNeeded + sizeof (CharPointerType::CharType));
 }
 
+int String::getReferenceCount() const noexcept
+{
+    return StringHolder::getReferenceCount (text);
+}
+
 //==============================================================================
 String::String (const char* const t)
     : text (StringHolder::createFromCharPointer (CharPointer_ASCII (t)))
@@ -1185,6 +1185,12 @@ public:
     */
     void swapWith (String& other) noexcept;
 
+    /** Returns the number of String objects that are sharing this string's data.
+        This is mainly for containers like StringPool, which use it to find out when
+        nobody else is still holding one of their strings.
+    */
+    int getReferenceCount() const noexcept;
+
     //==============================================================================
    #if JUCE_MAC || JUCE_IOS || DOXYGEN
     /** MAC ONLY - Creates a String from an OSX CFString. */
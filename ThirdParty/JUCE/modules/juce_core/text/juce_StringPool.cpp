@@ -26,56 +26,289 @@
   ==============================================================================
 */
 
-StringPool::StringPool() noexcept   {}
-StringPool::~StringPool()           {}
-
+//==============================================================================
 namespace StringPoolHelpers
 {
-    template <class StringType>
-    String::CharPointerType getPooledStringFromArray (Array<String>& strings,
-                                                      StringType newString,
-                                                      const CriticalSection& lock)
+    enum { shardBits = 4 };
+
+    inline String::CharPointerType getCharPointer (const String& s) noexcept  { return s.getCharPointer(); }
+    inline CharPointer_ASCII getCharPointer (const char* s) noexcept          { return CharPointer_ASCII (s); }
+
+    template <class CharPointer>
+    uint32 getHash (CharPointer t) noexcept
+    {
+        uint32 result = 0;
+
+        while (! t.isEmpty())
+            result = 31 * result + (uint32) t.getAndAdvance();
+
+        return DefaultFlatHashFunctions::mix (result);
+    }
+}
+
+//==============================================================================
+struct StringPool::Entry
+{
+    Entry (const String& s, const uint32 h)  : text (s), hash (h) {}
+
+    /** Stops the entry from being garbage-collected, because someone's holding a raw pointer to it. */
+    void pin() noexcept
+    {
+        if (pinned.loadAcquire() == 0)
+            pinned = 1;
+    }
+
+    bool isUnused() const noexcept
+    {
+        return pinned.loadAcquire() == 0 && text.getReferenceCount() <= 1;
+    }
+
+    const String text;
+    const uint32 hash;
+    Atomic<int> pinned;
+
+    JUCE_DECLARE_NON_COPYABLE (Entry)
+};
+
+//==============================================================================
+/** An open-addressing table of entries, which is never changed once readers can see it,
+    except to fill in empty slots.
+*/
+struct StringPool::Table
+{
+    Table (const int size)  : numSlots (size), mask ((uint32) size - 1)
+    {
+        slots.calloc ((size_t) size);
+    }
+
+    void add (Entry* const entry) noexcept
+    {
+        uint32 i = entry->hash & mask;
+
+        while (slots[i].get() != nullptr)
+            i = (i + 1) & mask;
+
+        slots[i].storeRelease (entry);
+    }
+
+    template <class CharPointer>
+    Entry* find (const CharPointer text, const uint32 hash) const noexcept
+    {
+        for (uint32 i = hash & mask;; i = (i + 1) & mask)
+        {
+            Entry* const e = slots[i].loadAcquire();
+
+            if (e == nullptr || (e->hash == hash && e->text.getCharPointer().compare (text) == 0))
+                return e;
+        }
+    }
+
+    const int numSlots;
+    const uint32 mask;
+    HeapBlock<Atomic<Entry*> > slots;
+
+    JUCE_DECLARE_NON_COPYABLE (Table)
+};
+
+//==============================================================================
+/**
+    One shard of the pool. Lookups read the current table without locking, and only
+    register themselves in one of two reader counts so that a writer replacing the table
+    knows when the old one (and any entries it dropped) can be deleted. Writers take the
+    shard's lock.
+*/
+struct StringPool::Shard
+{
+    Shard()  : table (new Table (minNumSlots))
     {
-        const ScopedLock sl (lock);
-        int start = 0;
-        int end = strings.size();
+    }
+
+    ~Shard()
+    {
+        ScopedPointer<Table> t (table.get());
+
+        for (int i = 0; i < t->numSlots; ++i)
+            delete t->slots[i].get();
+    }
+
+    /** Counts a lookup in progress for as long as it's in scope.
 
-        for (;;)
+        If the phase flips between reading it and registering, a writer may already have
+        checked that counter, so the reader backs out and registers in the new phase.
+    */
+    struct ReadScope
+    {
+        ReadScope (Shard& shard) noexcept
         {
-            if (start >= end)
+            for (;;)
             {
-                jassert (start <= end);
-                strings.insert (start, newString);
-                return strings.getReference (start).getCharPointer();
+                const int currentPhase = shard.phase.loadAcquire();
+                numReaders = shard.numReaders + (currentPhase & 1);
+                ++*numReaders;
+
+                if (shard.phase.loadAcquire() == currentPhase)
+                    break;
+
+                --*numReaders;
             }
+        }
+
+        ~ReadScope() noexcept
+        {
+            --*numReaders;
+        }
+
+        Atomic<int>* numReaders;
+
+        JUCE_DECLARE_NON_COPYABLE (ReadScope)
+    };
+
+    /** Publishes a new table, then waits until no lookup can still be using the old one.
+        Lookups that register after the flip of the phase count in the other counter and
+        can only see the new table, so this only has to wait for the ones already running.
+    */
+    void replaceTable (Table* const newTable)
+    {
+        table.storeRelease (newTable);
+        const int oldPhase = (++phase - 1) & 1;
+
+        while (numReaders[oldPhase].get() != 0)
+            Thread::yield();
+    }
+
+    /** Must be called with the lock held. */
+    void add (Entry* const entry)
+    {
+        Table* const t = table.get();
+
+        if ((numEntries.get() + 1) * 2 > t->numSlots)
+        {
+            Table* const bigger = new Table (t->numSlots * 2);
+
+            for (int i = 0; i < t->numSlots; ++i)
+                if (Entry* const e = t->slots[i].get())
+                    bigger->add (e);
 
-            const String& startString = strings.getReference (start);
+            bigger->add (entry);
+            replaceTable (bigger);
+            delete t;
+        }
+        else
+        {
+            t->add (entry);
+        }
+
+        ++numEntries;
+    }
 
-            if (startString == newString)
-                return startString.getCharPointer();
+    /** Finds or adds a string, then either pins it or copies it into a String before a
+        garbage-collection could remove it.
+    */
+    template <class StringType>
+    Entry* getEntry (const StringType& original, const uint32 hash, String* const reference)
+    {
+        using StringPoolHelpers::getCharPointer;
 
-            const int halfway = (start + end) >> 1;
+        {
+            const ReadScope scope (*this);
 
-            if (halfway == start)
+            if (Entry* const e = table.loadAcquire()->find (getCharPointer (original), hash))
             {
-                if (startString.compare (newString) < 0)
-                    ++start;
+                if (reference != nullptr)
+                    *reference = e->text;
+                else
+                    e->pin();
+
+                return e;
+            }
+        }
+
+        const SpinLock::ScopedLockType sl (lock);
+        Entry* e = table.get()->find (getCharPointer (original), hash);
+
+        if (e == nullptr)
+        {
+            e = new Entry (String (original), hash);
+            add (e);
+        }
+
+        if (reference != nullptr)
+            *reference = e->text;
+        else
+            e->pin();
 
-                strings.insert (start, newString);
-                return strings.getReference (start).getCharPointer();
+        return e;
+    }
+
+    int garbageCollect()
+    {
+        const SpinLock::ScopedLockType sl (lock);
+        Table* const t = table.get();
+        ScopedPointer<Table> newTable (new Table (t->numSlots));
+        Array<Entry*> unused;
+
+        for (int i = 0; i < t->numSlots; ++i)
+        {
+            if (Entry* const e = t->slots[i].get())
+            {
+                if (e->isUnused())
+                    unused.add (e);
+                else
+                    newTable->add (e);
             }
+        }
+
+        if (unused.size() == 0)
+            return 0;
 
-            const int comp = strings.getReference (halfway).compare (newString);
+        replaceTable (newTable.release());
+        delete t;
 
-            if (comp == 0)
-                return strings.getReference (halfway).getCharPointer();
+        // a lookup that found one of these before the table was replaced may have taken
+        // a reference or a pointer to it, in which case it has to go back
+        int numRemoved = 0;
 
-            if (comp < 0)
-                start = halfway;
+        for (int i = 0; i < unused.size(); ++i)
+        {
+            Entry* const e = unused.getUnchecked (i);
+
+            if (e->isUnused())
+            {
+                delete e;
+                ++numRemoved;
+            }
             else
-                end = halfway;
+            {
+                table.get()->add (e);
+            }
         }
+
+        numEntries -= numRemoved;
+        return numRemoved;
     }
+
+    enum { minNumSlots = 16 };
+
+    SpinLock lock;
+    Atomic<Table*> table;
+    Atomic<int> phase, numEntries;
+    Atomic<int> numReaders[2];
+
+    JUCE_DECLARE_NON_COPYABLE (Shard)
+};
+
+//==============================================================================
+StringPool::StringPool()
+{
+    for (int i = 0; i < (1 << StringPoolHelpers::shardBits); ++i)
+        shards.add (new Shard());
+}
+
+StringPool::~StringPool() {}
+
+StringPool::Shard& StringPool::getShardFor (const uint32 hash) const noexcept
+{
+    return *shards.getUnchecked ((int) (hash >> (32 - StringPoolHelpers::shardBits)));
 }
 
 String::CharPointerType StringPool::getPooledString (const String& s)
@@ -83,7 +316,8 @@ String::CharPointerType StringPool::getPooledString (const String& s)
     if (s.isEmpty())
         return String::empty.getCharPointer();
 
-    return StringPoolHelpers::getPooledStringFromArray (strings, s, lock);
+    const uint32 hash = StringPoolHelpers::getHash (s.getCharPointer());
+    return getShardFor (hash).getEntry (s, hash, nullptr)->text.getCharPointer();
 }
 
 String::CharPointerType StringPool::getPooledString (const char* const s)
@@ -91,7 +325,8 @@ String::CharPointerType StringPool::getPooledString (const char* const s)
     if (s == nullptr || *s == 0)
         return String::empty.getCharPointer();
 
-    return StringPoolHelpers::getPooledStringFromArray (strings, s, lock);
+    const uint32 hash = StringPoolHelpers::getHash (CharPointer_ASCII (s));
+    return getShardFor (hash).getEntry (s, hash, nullptr)->text.getCharPointer();
 }
 
 String::CharPointerType StringPool::getPooledString (const wchar_t* const s)
@@ -99,15 +334,402 @@ String::CharPointerType StringPool::getPooledString (const wchar_t* const s)
     if (s == nullptr || *s == 0)
         return String::empty.getCharPointer();
 
-    return StringPoolHelpers::getPooledStringFromArray (strings, s, lock);
+    return getPooledString (String (s));
+}
+
+void StringPool::getPooledStrings (const String* const originals, const int numStrings,
+                                   String::CharPointerType* const results)
+{
+    using namespace StringPoolHelpers;
+    HeapBlock<uint32> hashes ((size_t) numStrings);
+    Array<int> missing;
+
+    for (int i = 0; i < numStrings; ++i)
+    {
+        const String& s = originals[i];
+        results[i] = String::empty.getCharPointer();
+
+        if (s.isNotEmpty())
+        {
+            hashes[i] = getHash (s.getCharPointer());
+            Shard& shard = getShardFor (hashes[i]);
+            const Shard::ReadScope scope (shard);
+
+            if (Entry* const e = shard.table.loadAcquire()->find (s.getCharPointer(), hashes[i]))
+            {
+                e->pin();
+                results[i] = e->text.getCharPointer();
+            }
+            else
+            {
+                missing.add (i);
+            }
+        }
+    }
+
+    for (int i = 0; i < shards.size() && missing.size() > 0; ++i)
+    {
+        Shard& shard = *shards.getUnchecked (i);
+        const SpinLock::ScopedLockType sl (shard.lock);
+
+        for (int j = missing.size(); --j >= 0;)
+        {
+            const int index = missing.getUnchecked (j);
+
+            if (&getShardFor (hashes[index]) == &shard)
+            {
+                Entry* e = shard.table.get()->find (originals[index].getCharPointer(), hashes[index]);
+
+                if (e == nullptr)
+                {
+                    e = new Entry (originals[index], hashes[index]);
+                    shard.add (e);
+                }
+
+                e->pin();
+                results[index] = e->text.getCharPointer();
+                missing.remove (j);
+            }
+        }
+    }
+}
+
+String StringPool::getPooledStringReference (const String& s)
+{
+    if (s.isEmpty())
+        return String::empty;
+
+    const uint32 hash = StringPoolHelpers::getHash (s.getCharPointer());
+    String result;
+    getShardFor (hash).getEntry (s, hash, &result);
+    return result;
+}
+
+int StringPool::garbageCollect()
+{
+    int numRemoved = 0;
+
+    for (int i = 0; i < shards.size(); ++i)
+        numRemoved += shards.getUnchecked (i)->garbageCollect();
+
+    return numRemoved;
 }
 
 int StringPool::size() const noexcept
 {
-    return strings.size();
+    int total = 0;
+
+    for (int i = 0; i < shards.size(); ++i)
+        total += shards.getUnchecked (i)->numEntries.get();
+
+    return total;
+}
+
+String::CharPointerType StringPool::operator[] (int index) const noexcept
+{
+    for (int i = 0; i < shards.size(); ++i)
+    {
+        Shard& shard = *shards.getUnchecked (i);
+        const SpinLock::ScopedLockType sl (shard.lock);
+        const Table* const t = shard.table.get();
+
+        for (int j = 0; j < t->numSlots; ++j)
+        {
+            if (Entry* const e = t->slots[j].get())
+            {
+                if (--index < 0)
+                {
+                    e->pin();
+                    return e->text.getCharPointer();
+                }
+            }
+        }
+    }
+
+    return String::empty.getCharPointer();
 }
 
-String::CharPointerType StringPool::operator[] (const int index) const noexcept
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+namespace StringPoolTestHelpers
 {
-    return strings [index].getCharPointer();
+    /** The pool as it used to be: a sorted array behind one lock, to compare the sharded one with. */
+    class LockedSortedPool
+    {
+    public:
+        String::CharPointerType getPooledString (const String& s)
+        {
+            const ScopedLock sl (lock);
+            int index = strings.indexOf (s);
+
+            if (index < 0)
+            {
+                strings.add (s);
+                index = strings.indexOf (s);
+            }
+
+            return strings.getReference (index).getCharPointer();
+        }
+
+    private:
+        SortedSet<String> strings;
+        CriticalSection lock;
+    };
+
+    template <class PoolType>
+    class PoolingThread  : public Thread
+    {
+    public:
+        PoolingThread (PoolType& p, const StringArray& s, int seed, int reps)
+            : Thread ("pooling"), pool (p), strings (s), random (seed), numRepeats (reps)
+        {
+            results.calloc ((size_t) strings.size());
+        }
+
+        void run()
+        {
+            for (int rep = 0; rep < numRepeats; ++rep)
+            {
+                const int offset = random.nextInt (strings.size());
+
+                for (int i = 0; i < strings.size(); ++i)
+                {
+                    const int index = (i + offset) % strings.size();
+                    results[index] = pool.getPooledString (strings[index]);
+                }
+            }
+        }
+
+        PoolType& pool;
+        const StringArray& strings;
+        Random random;
+        const int numRepeats;
+        HeapBlock<String::CharPointerType> results;
+    };
+
+    /** Keeps taking and dropping references to strings, and collecting the pool. */
+    class CollectingThread  : public Thread
+    {
+    public:
+        CollectingThread (StringPool& p, int seed)  : Thread ("collecting"), pool (p), random (seed), ok (true) {}
+
+        void run()
+        {
+            for (int i = 0; i < 200; ++i)
+            {
+                StringArray held;
+
+                for (int j = 0; j < 100; ++j)
+                {
+                    const String s ("temp" + String (random.nextInt (500)));
+                    const String pooled (pool.getPooledStringReference (s));
+
+                    ok = ok && pooled == s && pool.getPooledStringReference (s).getCharPointer() == pooled.getCharPointer();
+
+                    if (random.nextBool())
+                        held.add (pooled);
+                }
+
+                pool.garbageCollect();
+
+                for (int j = 0; j < held.size(); ++j)
+                    ok = ok && pool.getPooledStringReference (held[j]).getCharPointer() == held[j].getCharPointer();
+            }
+        }
+
+        StringPool& pool;
+        Random random;
+        bool ok;
+    };
+
+    inline StringArray createStrings (int num)
+    {
+        StringArray strings;
+
+        for (int i = 0; i < num; ++i)
+            strings.add ("identifier_" + String (i));
+
+        return strings;
+    }
 }
+
+//==============================================================================
+class StringPoolTests  : public UnitTest
+{
+public:
+    StringPoolTests() : UnitTest ("StringPool") {}
+
+    void runTest()
+    {
+        using namespace StringPoolTestHelpers;
+
+        beginTest ("Pooling");
+        {
+            StringPool pool;
+            const String::CharPointerType a (pool.getPooledString (String ("abc")));
+
+            expect (pool.getPooledString ("abc") == a);
+            expect (pool.getPooledString (L"abc") == a);
+            expect (pool.getPooledString (String ("ab") + "c") == a);
+            expect (pool.getPooledString ("abd") != a);
+            expect (pool.getPooledString (String::empty) == String::empty.getCharPointer());
+            expect (pool.getPooledString ((const char*) nullptr) == String::empty.getCharPointer());
+            expectEquals (pool.size(), 2);
+
+            const StringArray strings (createStrings (1000));
+
+            for (int i = 0; i < strings.size(); ++i)
+                pool.getPooledString (strings[i]);
+
+            expectEquals (pool.size(), 1002);
+
+            for (int i = 0; i < strings.size(); ++i)
+                expect (pool.getPooledString (strings[i]) == pool.getPooledString (strings[i].toRawUTF8()));
+
+            int numFound = 0;
+
+            for (int i = pool.size(); --i >= 0;)
+                if (pool.getPooledString (String (pool[i])) == pool[i])
+                    ++numFound;
+
+            expectEquals (numFound, pool.size());
+        }
+
+        beginTest ("Bulk pooling");
+        {
+            StringPool pool;
+            StringArray strings (createStrings (500));
+            pool.getPooledString (strings[10]);
+            strings.addArray (createStrings (600));
+            strings.add (String::empty);
+
+            HeapBlock<String::CharPointerType> results ((size_t) strings.size());
+            pool.getPooledStrings (strings.begin(), strings.size(), results);
+            expectEquals (pool.size(), 600);
+
+            for (int i = 0; i < strings.size(); ++i)
+                expect (results[i] == pool.getPooledString (strings[i]));
+        }
+
+        beginTest ("Garbage collection");
+        {
+            StringPool pool;
+            const String::CharPointerType pinned (pool.getPooledString ("pinned"));
+            pool.getPooledStringReference ("pinned");
+
+            String kept (pool.getPooledStringReference ("kept"));
+            pool.getPooledStringReference ("dropped");
+
+            {
+                // the pooled strings share their data with these ones until they're gone
+                const StringArray strings (createStrings (200));
+
+                for (int i = 0; i < strings.size(); ++i)
+                    pool.getPooledStringReference (strings[i]);
+
+                expectEquals (pool.garbageCollect(), 1);
+            }
+
+            expectEquals (pool.size(), 202);
+            expectEquals (pool.garbageCollect(), 200);
+            expectEquals (pool.size(), 2);
+            expect (pool.getPooledString ("pinned") == pinned);
+            expect (pool.getPooledStringReference ("kept").getCharPointer() == kept.getCharPointer());
+
+            kept = String::empty;
+            expectEquals (pool.garbageCollect(), 1);
+            expectEquals (pool.garbageCollect(), 0);
+            expectEquals (pool.size(), 1);
+        }
+
+        beginTest ("Pooling from several threads");
+        {
+            StringPool pool;
+            const StringArray strings (createStrings (2000));
+            OwnedArray<PoolingThread<StringPool> > threads;
+
+            for (int i = 0; i < 4; ++i)
+                threads.add (new PoolingThread<StringPool> (pool, strings, getRandom().nextInt(), 10));
+
+            CollectingThread collector (pool, getRandom().nextInt());
+            collector.startThread();
+
+            for (int i = 0; i < threads.size(); ++i)
+                threads.getUnchecked (i)->startThread();
+
+            for (int i = 0; i < threads.size(); ++i)
+                expect (threads.getUnchecked (i)->waitForThreadToExit (60000));
+
+            expect (collector.waitForThreadToExit (60000));
+            expect (collector.ok);
+
+            int numMismatched = 0;
+
+            for (int i = 0; i < strings.size(); ++i)
+                for (int j = 0; j < threads.size(); ++j)
+                    if (threads.getUnchecked (j)->results[i] != pool.getPooledString (strings[i]))
+                        ++numMismatched;
+
+            expectEquals (numMismatched, 0);
+        }
+    }
+};
+
+static StringPoolTests stringPoolUnitTests;
+
+#if JUCE_UNIT_TEST_BENCHMARKS
+
+//==============================================================================
+class StringPoolBenchmarks  : public UnitTest
+{
+public:
+    StringPoolBenchmarks() : UnitTest ("StringPool benchmarks") {}
+
+    /** Millions of lookups per second of strings that are already in the pool. */
+    template <class PoolType>
+    double timeLookups (const StringArray& strings, int numThreads)
+    {
+        using StringPoolTestHelpers::PoolingThread;
+
+        PoolType pool;
+
+        for (int i = 0; i < strings.size(); ++i)
+            pool.getPooledString (strings[i]);
+
+        const int numRepeats = 200 / numThreads;
+        OwnedArray<PoolingThread<PoolType> > threads;
+
+        for (int i = 0; i < numThreads; ++i)
+            threads.add (new PoolingThread<PoolType> (pool, strings, getRandom().nextInt(), numRepeats));
+
+        const double start = Time::getMillisecondCounterHiRes();
+
+        for (int i = 0; i < threads.size(); ++i)
+            threads.getUnchecked (i)->startThread();
+
+        for (int i = 0; i < threads.size(); ++i)
+            threads.getUnchecked (i)->waitForThreadToExit (60000);
+
+        const double seconds = (Time::getMillisecondCounterHiRes() - start) / 1000.0;
+        return numRepeats * numThreads * strings.size() / (seconds * 1.0e6);
+    }
+
+    void runTest()
+    {
+        beginTest ("Lookups of pooled strings");
+
+        const StringArray strings (StringPoolTestHelpers::createStrings (10000));
+
+        for (int numThreads = 1; numThreads <= 4; numThreads *= 2)
+            logMessage (String (numThreads) + " threads: "
+                          + String (timeLookups<StringPool> (strings, numThreads), 1) + " M lookups/s sharded, "
+                          + String (timeLookups<StringPoolTestHelpers::LockedSortedPool> (strings, numThreads), 1)
+                          + " M lookups/s with one lock");
+    }
+};
+
+static StringPoolBenchmarks stringPoolBenchmarks;
+
+#endif
+#endif
@@ -40,13 +40,22 @@
     is returned every time a matching string is asked for. This means that it's trivial to
     compare two pooled strings for equality, as you can simply compare their pointers. It
     also cuts down on storage if you're using many copies of the same string.
+
+    The pool is split into shards by the strings' hashes, each with its own hash table.
+    Looking up a string that's already in the pool doesn't take any locks, so several
+    threads can pool strings at the same time (e.g. while parsing documents that create
+    lots of Identifiers); only adding a new string locks the shard it goes into.
+
+    Strings that are returned as character pointers stay in the pool until it is deleted.
+    Strings returned by getPooledStringReference() are reference-counted instead, and
+    garbageCollect() removes the ones that nobody is holding any more.
 */
 class JUCE_API  StringPool
 {
 public:
     //==============================================================================
     /** Creates an empty pool. */
-    StringPool() noexcept;
+    StringPool();
 
     /** Destructor */
     ~StringPool();
@@ -76,16 +85,50 @@ public:
     */
     String::CharPointerType getPooledString (const wchar_t* original);
 
+    /** Pools a whole array of strings, writing their pooled pointers into the results array.
+
+        This does the same as calling getPooledString() for each of them, but the strings that
+        aren't in the pool yet are added with one lock per shard rather than one per string.
+    */
+    void getPooledStrings (const String* originals, int numStrings, String::CharPointerType* results);
+
+    /** Returns the pool's copy of a string, which only stays in the pool while it's in use.
+
+        Like getPooledString(), every matching string returns the same character data, but
+        the pool doesn't keep it forever: once all the String objects that were returned for
+        it have been deleted, the next call to garbageCollect() can remove it.
+    */
+    String getPooledStringReference (const String& original);
+
+    /** Removes the reference-counted strings that nothing else is using any more.
+
+        Strings that have ever been returned as character pointers are never removed.
+        Other threads can carry on pooling strings while this runs, although the ones
+        that need to add a string to a shard will wait until that shard has been cleaned.
+        Returns the number of strings that were removed.
+    */
+    int garbageCollect();
+
     //==============================================================================
     /** Returns the number of strings in the pool. */
     int size() const noexcept;
 
-    /** Returns one of the strings in the pool, by index. */
+    /** Returns one of the strings in the pool, by index.
+        The strings aren't in any particular order, and this has to scan the pool to find
+        the one you ask for, so avoid calling it in a loop over a large pool.
+    */
     String::CharPointerType operator[] (int index) const noexcept;
 
 private:
-    Array <String> strings;
-    CriticalSection lock;
+    //==============================================================================
+    struct Entry;
+    struct Table;
+    struct Shard;
+    OwnedArray<Shard> shards;
+
+    Shard& getShardFor (uint32 hash) const noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE (StringPool)
 };
 
 
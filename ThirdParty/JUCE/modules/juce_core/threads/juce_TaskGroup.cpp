@@ -0,0 +1,590 @@
+/*
+  ==============================================================================
+
+   This file is part of the juce_core module of the JUCE library.
+   Copyright (c) 2013 - Raw Material Software Ltd.
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose with
+   or without fee is hereby granted, provided that the above copyright notice and this
+   permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+   ------------------------------------------------------------------------------
+
+   NOTE! This permissive ISC license applies ONLY to files within the juce_core module!
+   All other JUCE modules are covered by a dual GPL/commercial license, so if you are
+   using any other modules, be sure to check that you also comply with their license.
+
+   For more details, visit www.juce.com
+
+  ==============================================================================
+*/
+
+TaskGroup::Task::Task() noexcept
+    : group (nullptr),
+      nextReady (nullptr),
+      numPending (1),
+      closed (false),
+      numSuccessors (0)
+{
+}
+
+TaskGroup::Task::~Task()
+{
+    // you mustn't delete a task that has been added to a group until it has finished!
+    jassert (group == nullptr || isFinished());
+}
+
+void TaskGroup::Task::addDependency (Task& taskToWaitFor)
+{
+    // dependencies have to be set up before the task is added to a group
+    jassert (group == nullptr);
+    jassert (&taskToWaitFor != this);
+
+    const SpinLock::ScopedLockType sl (taskToWaitFor.successorLock);
+
+    if (! taskToWaitFor.closed)
+    {
+        ++numPending;
+
+        if (taskToWaitFor.numSuccessors < numInlineSuccessors)
+            taskToWaitFor.successors [taskToWaitFor.numSuccessors++] = this;
+        else
+            taskToWaitFor.moreSuccessors.add (this);
+    }
+}
+
+void TaskGroup::Task::reset() noexcept
+{
+    jassert (group == nullptr || isFinished());
+
+    group = nullptr;
+    nextReady = nullptr;
+    numPending = 1;
+    finished = 0;
+    closed = false;
+    numSuccessors = 0;
+    moreSuccessors.clearQuick();
+}
+
+//==============================================================================
+struct TaskGroup::Waiter
+{
+    Waiter() noexcept  : next (nullptr) {}
+
+    WaitableEvent event;
+    Waiter* next;
+};
+
+//==============================================================================
+/** Runs the group's ready tasks on one of the pool's threads until there are none left. */
+class TaskGroup::Runner  : public ThreadPoolJob
+{
+public:
+    Runner (TaskGroup& g)  : ThreadPoolJob ("TaskGroup"), group (g), hasStarted (false)
+    {
+        setJobPriority (group.priority);
+
+        const ScopedLock sl (group.runnerLock);
+        group.runners.add (this);
+    }
+
+    ~Runner()
+    {
+        // a runner the pool threw away before it got going still holds its place
+        if (! hasStarted)
+            --group.activeRunners;
+
+        // the group may be deleted as soon as the last runner has gone
+        const ScopedLock sl (group.runnerLock);
+        group.runners.removeFirstMatchingValue (this);
+
+        if (group.runners.size() == 0)
+            group.allRunnersGone.signal();
+    }
+
+    JobStatus runJob() override
+    {
+        hasStarted = true;
+
+        for (;;)
+        {
+            while (! shouldExit())
+            {
+                Task* const task = group.popReadyTask();
+
+                if (task == nullptr)
+                    break;
+
+                group.runTask (*task);
+            }
+
+            // A task made ready after the list was found empty but before activeRunners
+            // went down will not have started a new runner, so look once more.
+            --group.activeRunners;
+
+            if (shouldExit() || ! group.hasReadyTasks() || ! group.tryAddRunner())
+                break;
+        }
+
+        return jobHasFinished;
+    }
+
+private:
+    TaskGroup& group;
+    bool hasStarted;
+
+    JUCE_DECLARE_NON_COPYABLE (Runner)
+};
+
+//==============================================================================
+TaskGroup::TaskGroup (ThreadPool& p, const ThreadPoolJob::JobPriority jobPriority)
+    : pool (p),
+      priority (jobPriority),
+      firstReady (nullptr),
+      lastReady (nullptr),
+      firstWaiter (nullptr)
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+    wait();
+    removeRunners();
+}
+
+void TaskGroup::removeRunners()
+{
+    {
+        // holding the lock keeps the runners from being deleted while they're looked at,
+        // and it's re-entrant for the ones that removeJob() deletes straight away
+        const ScopedLock sl (runnerLock);
+
+        for (int i = runners.size(); --i >= 0;)
+            pool.removeJob (runners[i], false, 0);
+    }
+
+    // the ones left were already running, and have nothing to do but return
+    for (;;)
+    {
+        {
+            const ScopedLock sl (runnerLock);
+
+            if (runners.size() == 0)
+                return;
+        }
+
+        allRunnersGone.wait (-1);
+    }
+}
+
+void TaskGroup::add (Task& task)
+{
+    // a task can only be in one group at a time - call Task::reset() before re-using it
+    jassert (task.group == nullptr);
+
+    task.group = this;
+    ++numUnfinished;
+    release (task);
+}
+
+void TaskGroup::release (Task& task)
+{
+    if (--task.numPending == 0)
+        task.group->makeReady (task);
+}
+
+void TaskGroup::makeReady (Task& task)
+{
+    {
+        const SpinLock::ScopedLockType sl (lock);
+
+        task.nextReady = nullptr;
+
+        if (lastReady != nullptr)
+            lastReady->nextReady = &task;
+        else
+            firstReady = &task;
+
+        lastReady = &task;
+
+        for (Waiter* w = firstWaiter; w != nullptr; w = w->next)
+            w->event.signal();
+    }
+
+    if (tryAddRunner())
+        pool.addJob (new Runner (*this), true);
+}
+
+TaskGroup::Task* TaskGroup::popReadyTask()
+{
+    const SpinLock::ScopedLockType sl (lock);
+    Task* const task = firstReady;
+
+    if (task != nullptr)
+    {
+        firstReady = task->nextReady;
+
+        if (firstReady == nullptr)
+            lastReady = nullptr;
+    }
+
+    return task;
+}
+
+bool TaskGroup::hasReadyTasks() const
+{
+    const SpinLock::ScopedLockType sl (lock);
+    return firstReady != nullptr;
+}
+
+bool TaskGroup::tryAddRunner() noexcept
+{
+    const int maxRunners = pool.getNumThreads();
+
+    for (;;)
+    {
+        const int n = activeRunners.get();
+
+        if (n >= maxRunners)
+            return false;
+
+        if (activeRunners.compareAndSetBool (n + 1, n))
+            return true;
+    }
+}
+
+void TaskGroup::runTask (Task& task)
+{
+    JUCE_TRY
+    {
+        task.run();
+    }
+    JUCE_CATCH_ALL_ASSERT
+
+    Task* successors [Task::numInlineSuccessors];
+    Array<Task*> moreSuccessors;
+    int numSuccessors;
+
+    {
+        const SpinLock::ScopedLockType sl (task.successorLock);
+
+        task.closed = true;
+        numSuccessors = task.numSuccessors;
+        memcpy (successors, task.successors, sizeof (Task*) * (size_t) numSuccessors);
+        moreSuccessors.swapWith (task.moreSuccessors);
+    }
+
+    for (int i = 0; i < numSuccessors; ++i)
+        release (*successors[i]);
+
+    for (int i = 0; i < moreSuccessors.size(); ++i)
+        release (*moreSuccessors.getUnchecked(i));
+
+    // only once the tasks waiting for it have been told, so isFinished() means that too.
+    // The task's owner may delete it from here on.
+    task.finished = 1;
+
+    --numUnfinished;
+    notifyWaiters();
+}
+
+void TaskGroup::notifyWaiters()
+{
+    if (numWaiters.get() > 0)
+    {
+        const SpinLock::ScopedLockType sl (lock);
+
+        for (Waiter* w = firstWaiter; w != nullptr; w = w->next)
+            w->event.signal();
+    }
+}
+
+void TaskGroup::wait()
+{
+    waitUntilFinished (nullptr);
+}
+
+void TaskGroup::waitFor (const Task& task)
+{
+    waitUntilFinished (&task);
+}
+
+void TaskGroup::waitUntilFinished (const Task* const task)
+{
+    for (;;)
+    {
+        if (task != nullptr ? task->isFinished() : numUnfinished.get() == 0)
+            return;
+
+        if (Task* const readyTask = popReadyTask())
+        {
+            runTask (*readyTask);
+            continue;
+        }
+
+        // Nothing to help with, so sleep until a task finishes or becomes ready. The
+        // waiter is registered before the last look, so neither can be missed.
+        Waiter waiter;
+        bool shouldSleep;
+
+        {
+            const SpinLock::ScopedLockType sl (lock);
+            waiter.next = firstWaiter;
+            firstWaiter = &waiter;
+            ++numWaiters;
+            shouldSleep = firstReady == nullptr;
+        }
+
+        if (shouldSleep && (task != nullptr ? ! task->isFinished() : numUnfinished.get() != 0))
+            waiter.event.wait (-1);
+
+        {
+            const SpinLock::ScopedLockType sl (lock);
+
+            for (Waiter** w = &firstWaiter; *w != nullptr; w = &((*w)->next))
+            {
+                if (*w == &waiter)
+                {
+                    *w = waiter.next;
+                    break;
+                }
+            }
+
+            --numWaiters;
+        }
+    }
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class TaskGroupTests  : public UnitTest
+{
+public:
+    TaskGroupTests() : UnitTest ("TaskGroup") {}
+
+    struct Counter
+    {
+        void operator() (int start, int end)
+        {
+            for (int i = start; i < end; ++i)
+                ++visits[i];
+        }
+
+        HeapBlock<Atomic<int> > visits;
+    };
+
+    class OrderedTask  : public TaskGroup::Task
+    {
+    public:
+        OrderedTask() : position (-1), clock (nullptr) {}
+
+        void run() override     { position = ++*clock; }
+
+        int position;
+        Atomic<int>* clock;
+    };
+
+    class NestedTask  : public TaskGroup::Task
+    {
+    public:
+        NestedTask (TaskGroup& g, Counter& c, int n) : group (g), counter (c), numItems (n) {}
+
+        void run() override     { group.parallelFor (0, numItems, counter); }
+
+        TaskGroup& group;
+        Counter& counter;
+        int numItems;
+    };
+
+    class GateJob  : public ThreadPoolJob
+    {
+    public:
+        GateJob() : ThreadPoolJob ("gate") {}
+
+        JobStatus runJob()
+        {
+            started.signal();
+            gate.wait (5000);
+            return jobHasFinished;
+        }
+
+        WaitableEvent started, gate;
+    };
+
+    bool everyIndexVisitedOnce (const Counter& counter, int numItems)
+    {
+        for (int i = 0; i < numItems; ++i)
+            if (counter.visits[i].get() != 1)
+                return false;
+
+        return true;
+    }
+
+    void runTest()
+    {
+        ThreadPool pool (4);
+
+        beginTest ("Parallel for");
+
+        {
+            TaskGroup group (pool);
+            const int numItems = 1000003;
+
+            Counter counter;
+            counter.visits.calloc ((size_t) numItems);
+            group.parallelFor (0, numItems, counter);
+            expect (everyIndexVisitedOnce (counter, numItems));
+
+            Counter small;
+            small.visits.calloc (3);
+            group.parallelFor (0, 3, small, 16);
+            expect (everyIndexVisitedOnce (small, 3));
+
+            group.parallelFor (5, 5, small);
+            expectEquals (group.getNumUnfinishedTasks(), 0);
+        }
+
+        beginTest ("Dependencies");
+
+        for (int run = 0; run < 50; ++run)
+        {
+            TaskGroup group (pool);
+            Atomic<int> clock;
+            OrderedTask tasks [6];
+
+            for (int i = 0; i < numElementsInArray (tasks); ++i)
+                tasks[i].clock = &clock;
+
+            // 0 -> 1, 2, 3, 4 -> 5, where 5 also needs more than the inline successor slots of 0
+            for (int i = 1; i <= 4; ++i)
+            {
+                tasks[i].addDependency (tasks[0]);
+                tasks[5].addDependency (tasks[i]);
+            }
+
+            tasks[5].addDependency (tasks[0]);
+
+            for (int i = numElementsInArray (tasks); --i >= 0;)
+                group.add (tasks[i]);
+
+            group.wait();
+
+            for (int i = 1; i <= 4; ++i)
+            {
+                expect (tasks[i].position > tasks[0].position);
+                expect (tasks[i].position < tasks[5].position);
+            }
+
+            expectEquals (clock.get(), 6);
+
+            // a dependency on a finished task is already met
+            tasks[1].reset();
+            tasks[1].addDependency (tasks[0]);
+            group.add (tasks[1]);
+            group.waitFor (tasks[1]);
+            expectEquals (tasks[1].position, 7);
+        }
+
+        beginTest ("Nested parallel for");
+
+        {
+            TaskGroup group (pool);
+            Counter counter;
+            counter.visits.calloc (40000);
+
+            OwnedArray<NestedTask> tasks;
+
+            for (int i = 0; i < 8; ++i)
+            {
+                tasks.add (new NestedTask (group, counter, 40000));
+                group.add (*tasks.getLast());
+            }
+
+            group.wait();
+
+            bool allVisited = true;
+
+            for (int i = 0; i < 40000; ++i)
+                allVisited = allVisited && counter.visits[i].get() == 8;
+
+            expect (allVisited);
+        }
+
+        beginTest ("Waiting thread helps");
+
+        {
+            ThreadPool singleThread (1);
+            GateJob gate;
+            singleThread.addJob (&gate, false);
+            expect (gate.started.wait (5000));
+
+            // the pool's only thread is busy, so the tasks can only run on this one
+            TaskGroup group (singleThread);
+            Atomic<int> clock;
+            OrderedTask tasks [10];
+
+            for (int i = 0; i < numElementsInArray (tasks); ++i)
+            {
+                tasks[i].clock = &clock;
+                group.add (tasks[i]);
+            }
+
+            group.wait();
+            expectEquals (clock.get(), 10);
+
+            gate.gate.signal();
+            expect (singleThread.waitForJobToFinish (&gate, 5000));
+        }
+
+        beginTest ("Destroying with queued runners");
+        {
+            ThreadPool singleThread (1);
+            GateJob gate;
+            singleThread.addJob (&gate, false);
+            expect (gate.started.wait (5000));
+
+            for (int i = 0; i < 2; ++i)
+            {
+                const uint32 start = Time::getMillisecondCounter();
+
+                {
+                    TaskGroup group (singleThread);
+                    Atomic<int> clock;
+                    OrderedTask tasks [4];
+
+                    for (int j = 0; j < numElementsInArray (tasks); ++j)
+                    {
+                        tasks[j].clock = &clock;
+                        group.add (tasks[j]);
+                    }
+
+                    // the second time round, the pool throws the group's queued job away itself
+                    if (i == 1)
+                        singleThread.removeAllJobs (false, 0);
+
+                    group.wait();
+                    expectEquals (clock.get(), 4);
+                }
+
+                // the group mustn't wait for the busy thread to get round to its job
+                expect (Time::getMillisecondCounter() - start < 2000);
+                expectEquals (singleThread.getNumJobs(), 1);
+            }
+
+            gate.gate.signal();
+            expect (singleThread.waitForJobToFinish (&gate, 5000));
+        }
+    }
+};
+
+static TaskGroupTests taskGroupUnitTests;
+
+#endif
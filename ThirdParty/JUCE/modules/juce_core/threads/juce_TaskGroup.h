@@ -0,0 +1,277 @@
+/*
+  ==============================================================================
+
+   This file is part of the juce_core module of the JUCE library.
+   Copyright (c) 2013 - Raw Material Software Ltd.
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose with
+   or without fee is hereby granted, provided that the above copyright notice and this
+   permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+   ------------------------------------------------------------------------------
+
+   NOTE! This permissive ISC license applies ONLY to files within the juce_core module!
+   All other JUCE modules are covered by a dual GPL/commercial license, so if you are
+   using any other modules, be sure to check that you also comply with their license.
+
+   For more details, visit www.juce.com
+
+  ==============================================================================
+*/
+
+#ifndef JUCE_TASKGROUP_H_INCLUDED
+#define JUCE_TASKGROUP_H_INCLUDED
+
+
+//==============================================================================
+/**
+    Runs small pieces of work on a ThreadPool, with dependencies between them.
+
+    Unlike a ThreadPoolJob, a TaskGroup::Task isn't owned by the pool, so tasks can
+    live on the stack or inside other objects and adding one doesn't allocate. The
+    group puts one ThreadPoolJob per busy thread into the pool, and these run the
+    group's tasks in the order they became ready until there are none left.
+
+    A task can be made to wait for others with Task::addDependency(), in which
+    case it's started as soon as the last of them has finished. Threads that call
+    wait() or waitFor() run the group's tasks themselves while they wait, so
+    waiting from inside a task can't starve the pool.
+
+    parallelFor() splits a range of indexes into chunks and runs them across the
+    pool and the calling thread, e.g.
+
+    @code
+    struct Scaler
+    {
+        void operator() (int start, int end) const
+        {
+            for (int i = start; i < end; ++i)
+                samples[i] *= gain;
+        }
+
+        float* samples;
+        float gain;
+    };
+
+    Scaler scaler = { buffer, 0.5f };
+    taskGroup.parallelFor (0, numSamples, scaler);
+    @endcode
+
+    @see ThreadPool
+*/
+class JUCE_API  TaskGroup
+{
+public:
+    //==============================================================================
+    /** A piece of work that's run by a TaskGroup.
+
+        Subclasses implement run(). A task has to stay alive until it has finished,
+        which wait(), waitFor() or isFinished() will tell you.
+    */
+    class JUCE_API  Task
+    {
+    public:
+        /** Creates a task that isn't in a group yet. */
+        Task() noexcept;
+
+        /** Destructor. */
+        virtual ~Task();
+
+        /** Does the task's work. */
+        virtual void run() = 0;
+
+        /** Makes this task wait for another one to finish before it starts.
+
+            This has to be called before this task is added to a group. The other
+            task can be in any state, and if it has already finished this does nothing.
+        */
+        void addDependency (Task& taskToWaitFor);
+
+        /** Returns true once the task has been run and all the tasks waiting for
+            it have been told. The task may be deleted from then on.
+        */
+        bool isFinished() const noexcept            { return finished.get() != 0; }
+
+        /** Allows a finished task to be set up with new dependencies and added
+            to a group again.
+        */
+        void reset() noexcept;
+
+    private:
+        friend class TaskGroup;
+        enum { numInlineSuccessors = 4 };
+
+        TaskGroup* group;
+        Task* nextReady;
+        Atomic<int> numPending, finished;
+
+        SpinLock successorLock;
+        bool closed;
+        Task* successors [numInlineSuccessors];
+        int numSuccessors;
+        Array<Task*> moreSuccessors;
+
+        JUCE_DECLARE_NON_COPYABLE (Task)
+    };
+
+    //==============================================================================
+    /** Creates a group that runs its tasks on the given pool.
+
+        The group's jobs are queued with the given priority, so for example audio
+        work can overtake long background jobs that are already waiting.
+    */
+    explicit TaskGroup (ThreadPool& pool,
+                        ThreadPoolJob::JobPriority priority = ThreadPoolJob::normalPriority);
+
+    /** Destructor.
+        This waits for all the tasks that have been added to finish. Any of the group's
+        jobs that are still queued in the pool are removed, and only the ones that are
+        already running are waited for.
+    */
+    ~TaskGroup();
+
+    //==============================================================================
+    /** Adds a task to the group.
+
+        The task is started once all the tasks it depends on have finished, or
+        straight away if it has no dependencies.
+    */
+    void add (Task& task);
+
+    /** Waits until every task that has been added to the group has finished,
+        running tasks on the calling thread while there are any ready.
+
+        Don't call this from inside one of the group's tasks, as it would wait for
+        itself - use waitFor() instead.
+    */
+    void wait();
+
+    /** Waits until a particular task has finished, running the group's other tasks
+        on the calling thread in the meantime.
+    */
+    void waitFor (const Task& task);
+
+    /** Returns the number of tasks that have been added and haven't finished yet. */
+    int getNumUnfinishedTasks() const noexcept      { return numUnfinished.get(); }
+
+    //==============================================================================
+    /** Calls function (chunkStart, chunkEnd) for consecutive chunks that together
+        cover the range start to end, in parallel, and returns when they're all done.
+
+        The chunks are made small enough to balance the load across the pool's
+        threads, but never smaller than minChunkSize. The threads take the next
+        chunk from a shared counter whenever they finish one, so a few slow chunks
+        don't hold the rest up. The calling thread works on chunks too, and nothing
+        is allocated on the heap.
+
+        The function object is called from several threads at once, so it must be
+        thread-safe. This can be called from inside a task.
+    */
+    template <typename RangeFunction>
+    void parallelFor (const int start, const int end, RangeFunction& function, const int minChunkSize = 1)
+    {
+        const int numItems = end - start;
+
+        if (numItems <= 0)
+            return;
+
+        const int numThreads = pool.getNumThreads();
+        const int chunkSize = jmax (1, minChunkSize, numItems / ((numThreads + 1) * chunksPerThread));
+        const int numHelpers = jmin ((int) maxParallelForHelpers, numThreads, (numItems - 1) / chunkSize);
+
+        // the shared counter can overshoot the end by one chunk for each thread
+        jassert (end <= std::numeric_limits<int>::max() - (numHelpers + 1) * chunkSize);
+
+        Atomic<int> nextIndex (start);
+        ParallelForTask<RangeFunction> helpers [maxParallelForHelpers];
+
+        for (int i = 0; i < numHelpers; ++i)
+        {
+            helpers[i].function = &function;
+            helpers[i].nextIndex = &nextIndex;
+            helpers[i].end = end;
+            helpers[i].chunkSize = chunkSize;
+            add (helpers[i]);
+        }
+
+        runChunks (function, nextIndex, end, chunkSize);
+
+        for (int i = 0; i < numHelpers; ++i)
+            waitFor (helpers[i]);
+    }
+
+private:
+    //==============================================================================
+    enum
+    {
+        maxParallelForHelpers = 32,
+        chunksPerThread = 4
+    };
+
+    template <typename RangeFunction>
+    static void runChunks (RangeFunction& function, Atomic<int>& nextIndex, const int end, const int chunkSize)
+    {
+        for (;;)
+        {
+            const int chunkStart = (nextIndex += chunkSize) - chunkSize;
+
+            if (chunkStart >= end)
+                break;
+
+            function (chunkStart, jmin (chunkStart + chunkSize, end));
+        }
+    }
+
+    template <typename RangeFunction>
+    struct ParallelForTask  : public Task
+    {
+        ParallelForTask() noexcept  : function (nullptr), nextIndex (nullptr), end (0), chunkSize (0) {}
+
+        void run() override     { runChunks (*function, *nextIndex, end, chunkSize); }
+
+        RangeFunction* function;
+        Atomic<int>* nextIndex;
+        int end, chunkSize;
+    };
+
+    struct Waiter;
+    class Runner;
+    friend class Runner;
+
+    ThreadPool& pool;
+    const ThreadPoolJob::JobPriority priority;
+    Atomic<int> numUnfinished, numWaiters, activeRunners;
+
+    // the runners that the pool hasn't deleted yet, whether queued or running
+    CriticalSection runnerLock;
+    Array<Runner*> runners;
+    WaitableEvent allRunnersGone;
+
+    // guards the ready list and the waiters
+    SpinLock lock;
+    Task* firstReady;
+    Task* lastReady;
+    Waiter* firstWaiter;
+
+    void makeReady (Task&);
+    void release (Task&);
+    Task* popReadyTask();
+    bool hasReadyTasks() const;
+    void runTask (Task&);
+    bool tryAddRunner() noexcept;
+    void notifyWaiters();
+    void waitUntilFinished (const Task*);
+    void removeRunners();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TaskGroup)
+};
+
+
+#endif   // JUCE_TASKGROUP_H_INCLUDED
@@ -31,7 +31,11 @@ ThreadPoolJob::ThreadPoolJob (const String& name)
       pool (nullptr),
       shouldStop (false),
       isActive (false),
-      shouldBeDeleted (false)
+      shouldBeDeleted (false),
+      priority (normalPriority),
+      queuedPriority (normalPriority),
+      homeIndex (0),
+      memberIndex (0)
 {
 }
 
@@ -57,13 +61,20 @@ void ThreadPoolJob::signalJobShouldExit()
     shouldStop = true;
 }
 
+void ThreadPoolJob::setJobPriority (const JobPriority newPriority) noexcept
+{
+    jassert (newPriority >= lowPriority && newPriority <= highPriority);
+    priority = newPriority;
+}
+
 //==============================================================================
 class ThreadPool::ThreadPoolThread  : public Thread
 {
 public:
-    ThreadPoolThread (ThreadPool& pool_)
+    ThreadPoolThread (ThreadPool& pool_, const int index_)
         : Thread ("Pool"),
-          pool (pool_)
+          pool (pool_),
+          index (index_)
     {
     }
 
@@ -71,14 +82,145 @@ public:
     {
         while (! threadShouldExit())
         {
-            if (! pool.runNextJob())
-                wait (500);
+            if (pool.runNextJob (*this))
+                continue;
+
+            // Going idle has to be announced before the last look at the queues, so that
+            // a job added in the meantime is either seen here or wakes this thread up.
+            idle = 1;
+
+            if (! pool.hasQueuedJobs())
+                wait (-1);
+
+            idle = 0;
         }
     }
 
-private:
+    //==============================================================================
+    /** A FIFO of jobs waiting to run. Jobs are taken from the front by advancing a
+        read position, and the space in front of it is reclaimed when the queue runs
+        empty or the dead part gets bigger than the live one.
+    */
+    struct JobQueue
+    {
+        JobQueue() noexcept  : head (0) {}
+
+        bool isEmpty() const noexcept           { return head >= jobs.size(); }
+        void add (ThreadPoolJob* const job)     { jobs.add (job); }
+
+        ThreadPoolJob* removeFirst()
+        {
+            ThreadPoolJob* const job = jobs.getUnchecked (head++);
+
+            if (head >= jobs.size())
+            {
+                jobs.clearQuick();
+                head = 0;
+            }
+            else if (head > 32 && head > jobs.size() / 2)
+            {
+                jobs.removeRange (0, head);
+                head = 0;
+            }
+
+            return job;
+        }
+
+        bool remove (ThreadPoolJob* const job)
+        {
+            for (int i = head; i < jobs.size(); ++i)
+            {
+                if (jobs.getUnchecked (i) == job)
+                {
+                    jobs.remove (i);
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        Array<ThreadPoolJob*> jobs;
+        int head;
+    };
+
+    //==============================================================================
+    // These must be called with the lock held.
+    void addMember (ThreadPoolJob* const job)
+    {
+        job->homeIndex = index;
+        job->memberIndex = members.size();
+        members.add (job);
+    }
+
+    void removeMember (ThreadPoolJob* const job)
+    {
+        ThreadPoolJob* const last = members.getLast();
+        last->memberIndex = job->memberIndex;
+        members.set (job->memberIndex, last);
+        members.removeLast();
+    }
+
+    void queueJob (ThreadPoolJob* const job)
+    {
+        job->queuedPriority = job->priority;
+        queues [job->queuedPriority].add (job);
+        ++numQueued [job->queuedPriority];
+        ++pool.numQueuedJobs [job->queuedPriority];
+    }
+
+    void unqueueJob (ThreadPoolJob* const job)
+    {
+        if (queues [job->queuedPriority].remove (job))
+        {
+            --numQueued [job->queuedPriority];
+            --pool.numQueuedJobs [job->queuedPriority];
+        }
+    }
+
+    //==============================================================================
+    /** Takes the oldest runnable job of a priority from this thread's queue. This is
+        called by the thread itself and by other threads that have run out of work.
+    */
+    ThreadPoolJob* takeJob (const int priority, OwnedArray<ThreadPoolJob>& deletionList)
+    {
+        const SpinLock::ScopedLockType sl (lock);
+        JobQueue& queue = queues [priority];
+
+        while (! queue.isEmpty())
+        {
+            ThreadPoolJob* const job = queue.removeFirst();
+            --numQueued [priority];
+            --pool.numQueuedJobs [priority];
+
+            if (job->shouldStop)
+            {
+                removeMember (job);
+                --pool.numJobs;
+                pool.addToDeleteList (deletionList, job);
+                continue;
+            }
+
+            job->isActive = true;
+            return job;
+        }
+
+        return nullptr;
+    }
+
     ThreadPool& pool;
+    const int index;
+    Atomic<int> idle;
+    Atomic<int> numQueued [numJobPriorities];
 
+    // guards the queues, the members and the state of every member job
+    SpinLock lock;
+    JobQueue queues [numJobPriorities];
+
+    // every job added to the pool through this thread, whether it's queued or running
+    Array<ThreadPoolJob*> members;
+
+private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ThreadPoolThread)
 };
 
@@ -103,8 +245,10 @@ ThreadPool::~ThreadPool()
 
 void ThreadPool::createThreads (int numThreads)
 {
-    for (int i = jmax (1, numThreads); --i >= 0;)
-        threads.add (new ThreadPoolThread (*this));
+    numThreads = jmax (1, numThreads);
+
+    for (int i = 0; i < numThreads; ++i)
+        threads.add (new ThreadPoolThread (*this, i));
 
     for (int i = threads.size(); --i >= 0;)
         threads.getUnchecked(i)->startThread();
@@ -113,12 +257,49 @@ void ThreadPool::createThreads (int numThreads)
 void ThreadPool::stopThreads()
 {
     for (int i = threads.size(); --i >= 0;)
+    {
         threads.getUnchecked(i)->signalThreadShouldExit();
+        threads.getUnchecked(i)->notify();
+    }
 
     for (int i = threads.size(); --i >= 0;)
         threads.getUnchecked(i)->stopThread (500);
 }
 
+ThreadPool::ThreadPoolThread* ThreadPool::getCurrentPoolThread() const
+{
+    if (ThreadPoolThread* const thread = dynamic_cast <ThreadPoolThread*> (Thread::getCurrentThread()))
+        if (&(thread->pool) == this)
+            return thread;
+
+    return nullptr;
+}
+
+bool ThreadPool::hasQueuedJobs() const noexcept
+{
+    for (int i = 0; i < numJobPriorities; ++i)
+        if (numQueuedJobs[i].get() > 0)
+            return true;
+
+    return false;
+}
+
+void ThreadPool::wakeIdleThread (const int preferredIndex)
+{
+    const int numThreads = threads.size();
+
+    for (int i = 0; i < numThreads; ++i)
+    {
+        ThreadPoolThread* const thread = threads.getUnchecked ((preferredIndex + i) % numThreads);
+
+        if (thread->idle.compareAndSetBool (0, 1))
+        {
+            thread->notify();
+            break;
+        }
+    }
+}
+
 void ThreadPool::addJob (ThreadPoolJob* const job, const bool deleteJobWhenFinished)
 {
     jassert (job != nullptr);
@@ -131,37 +312,75 @@ void ThreadPool::addJob (ThreadPoolJob* const job, const bool deleteJobWhenFinis
         job->isActive = false;
         job->shouldBeDeleted = deleteJobWhenFinished;
 
+        // jobs added by one of our own threads stay with it, others are dealt out in turn
+        ThreadPoolThread* home = getCurrentPoolThread();
+
+        if (home == nullptr)
+            home = threads.getUnchecked ((int) ((uint32) ++nextThreadIndex % (uint32) threads.size()));
+
         {
-            const ScopedLock sl (lock);
-            jobs.add (job);
+            const SpinLock::ScopedLockType sl (home->lock);
+            ++numJobs;
+            home->addMember (job);
+            home->queueJob (job);
         }
 
-        for (int i = threads.size(); --i >= 0;)
-            threads.getUnchecked(i)->notify();
+        wakeIdleThread (home->index);
     }
 }
 
 int ThreadPool::getNumJobs() const
 {
-    return jobs.size();
+    return numJobs.get();
 }
 
-ThreadPoolJob* ThreadPool::getJob (const int index) const
+int ThreadPool::getNumThreads() const noexcept
 {
-    const ScopedLock sl (lock);
-    return jobs [index];
+    return threads.size();
+}
+
+ThreadPoolJob* ThreadPool::getJob (int index) const
+{
+    for (int i = 0; i < threads.size(); ++i)
+    {
+        const ThreadPoolThread& thread = *threads.getUnchecked(i);
+        const SpinLock::ScopedLockType sl (thread.lock);
+
+        if (index < thread.members.size())
+            return thread.members [index];
+
+        index -= thread.members.size();
+    }
+
+    return nullptr;
 }
 
 bool ThreadPool::contains (const ThreadPoolJob* const job) const
 {
-    const ScopedLock sl (lock);
-    return jobs.contains (const_cast <ThreadPoolJob*> (job));
+    for (int i = 0; i < threads.size(); ++i)
+    {
+        const ThreadPoolThread& thread = *threads.getUnchecked(i);
+        const SpinLock::ScopedLockType sl (thread.lock);
+
+        if (thread.members.contains (const_cast <ThreadPoolJob*> (job)))
+            return true;
+    }
+
+    return false;
 }
 
 bool ThreadPool::isJobRunning (const ThreadPoolJob* const job) const
 {
-    const ScopedLock sl (lock);
-    return jobs.contains (const_cast <ThreadPoolJob*> (job)) && job->isActive;
+    for (int i = 0; i < threads.size(); ++i)
+    {
+        const ThreadPoolThread& thread = *threads.getUnchecked(i);
+        const SpinLock::ScopedLockType sl (thread.lock);
+
+        if (thread.members.contains (const_cast <ThreadPoolJob*> (job)))
+            return job->isActive;
+    }
+
+    return false;
 }
 
 bool ThreadPool::waitForJobToFinish (const ThreadPoolJob* const job,
@@ -192,21 +411,29 @@ bool ThreadPool::removeJob (ThreadPoolJob* const job,
 
     if (job != nullptr)
     {
-        const ScopedLock sl (lock);
-
-        if (jobs.contains (job))
+        for (int i = 0; i < threads.size(); ++i)
         {
-            if (job->isActive)
-            {
-                if (interruptIfRunning)
-                    job->signalJobShouldExit();
+            ThreadPoolThread& thread = *threads.getUnchecked(i);
+            const SpinLock::ScopedLockType sl (thread.lock);
 
-                dontWait = false;
-            }
-            else
+            if (thread.members.contains (job))
             {
-                jobs.removeFirstMatchingValue (job);
-                addToDeleteList (deletionList, job);
+                if (job->isActive)
+                {
+                    if (interruptIfRunning)
+                        job->signalJobShouldExit();
+
+                    dontWait = false;
+                }
+                else
+                {
+                    thread.unqueueJob (job);
+                    thread.removeMember (job);
+                    --numJobs;
+                    addToDeleteList (deletionList, job);
+                }
+
+                break;
             }
         }
     }
@@ -222,12 +449,15 @@ bool ThreadPool::removeAllJobs (const bool interruptRunningJobs, const int timeO
     {
         OwnedArray<ThreadPoolJob> deletionList;
 
+        for (int t = 0; t < threads.size(); ++t)
         {
-            const ScopedLock sl (lock);
+            ThreadPoolThread& thread = *threads.getUnchecked(t);
+            const SpinLock::ScopedLockType sl (thread.lock);
 
-            for (int i = jobs.size(); --i >= 0;)
+            // removeMember() moves the last job into the gap, which has already been looked at
+            for (int i = thread.members.size(); --i >= 0;)
             {
-                ThreadPoolJob* const job = jobs.getUnchecked(i);
+                ThreadPoolJob* const job = thread.members.getUnchecked(i);
 
                 if (selectedJobsToRemove == nullptr || selectedJobsToRemove->isJobSuitable (job))
                 {
@@ -240,7 +470,9 @@ bool ThreadPool::removeAllJobs (const bool interruptRunningJobs, const int timeO
                     }
                     else
                     {
-                        jobs.remove (i);
+                        thread.unqueueJob (job);
+                        thread.removeMember (job);
+                        --numJobs;
                         addToDeleteList (deletionList, job);
                     }
                 }
@@ -275,13 +507,18 @@ bool ThreadPool::removeAllJobs (const bool interruptRunningJobs, const int timeO
 StringArray ThreadPool::getNamesOfAllJobs (const bool onlyReturnActiveJobs) const
 {
     StringArray s;
-    const ScopedLock sl (lock);
 
-    for (int i = 0; i < jobs.size(); ++i)
+    for (int t = 0; t < threads.size(); ++t)
     {
-        const ThreadPoolJob* const job = jobs.getUnchecked(i);
-        if (job->isActive || ! onlyReturnActiveJobs)
-            s.add (job->getJobName());
+        const ThreadPoolThread& thread = *threads.getUnchecked(t);
+        const SpinLock::ScopedLockType sl (thread.lock);
+
+        for (int i = 0; i < thread.members.size(); ++i)
+        {
+            const ThreadPoolJob* const job = thread.members.getUnchecked(i);
+            if (job->isActive || ! onlyReturnActiveJobs)
+                s.add (job->getJobName());
+        }
     }
 
     return s;
@@ -298,39 +535,32 @@ bool ThreadPool::setThreadPriorities (const int newPriority)
     return ok;
 }
 
-ThreadPoolJob* ThreadPool::pickNextJobToRun()
+ThreadPoolJob* ThreadPool::pickNextJobToRun (ThreadPoolThread& thread)
 {
     OwnedArray<ThreadPoolJob> deletionList;
+    const int numThreads = threads.size();
 
+    // A higher priority job anywhere in the pool beats a lower priority one in this
+    // thread's own queue. Within a priority, the thread's own queue comes first and
+    // then the other threads' queues are raided, starting with its neighbour.
+    for (int priority = numJobPriorities; --priority >= 0;)
     {
-        const ScopedLock sl (lock);
-
-        for (int i = 0; i < jobs.size(); ++i)
+        for (int i = 0; i < numThreads && numQueuedJobs [priority].get() > 0; ++i)
         {
-            ThreadPoolJob* job = jobs[i];
-
-            if (job != nullptr && ! job->isActive)
-            {
-                if (job->shouldStop)
-                {
-                    jobs.remove (i);
-                    addToDeleteList (deletionList, job);
-                    --i;
-                    continue;
-                }
+            ThreadPoolThread& victim = *threads.getUnchecked ((thread.index + i) % numThreads);
 
-                job->isActive = true;
-                return job;
-            }
+            if (victim.numQueued [priority].get() > 0)
+                if (ThreadPoolJob* const job = victim.takeJob (priority, deletionList))
+                    return job;
         }
     }
 
     return nullptr;
 }
 
-bool ThreadPool::runNextJob()
+bool ThreadPool::runNextJob (ThreadPoolThread& thread)
 {
-    ThreadPoolJob* const job = pickNextJobToRun();
+    ThreadPoolJob* const job = pickNextJobToRun (thread);
 
     if (job == nullptr)
         return false;
@@ -344,29 +574,32 @@ bool ThreadPool::runNextJob()
     JUCE_CATCH_ALL_ASSERT
 
     OwnedArray<ThreadPoolJob> deletionList;
+    bool finished = false;
 
     {
-        const ScopedLock sl (lock);
+        ThreadPoolThread& home = *threads.getUnchecked (job->homeIndex);
+        const SpinLock::ScopedLockType sl (home.lock);
 
-        if (jobs.contains (job))
-        {
-            job->isActive = false;
-
-            if (result != ThreadPoolJob::jobNeedsRunningAgain || job->shouldStop)
-            {
-                jobs.removeFirstMatchingValue (job);
-                addToDeleteList (deletionList, job);
+        jassert (home.members [job->memberIndex] == job);
+        job->isActive = false;
 
-                jobFinishedSignal.signal();
-            }
-            else
-            {
-                // move the job to the end of the queue if it wants another go
-                jobs.move (jobs.indexOf (job), -1);
-            }
+        if (result != ThreadPoolJob::jobNeedsRunningAgain || job->shouldStop)
+        {
+            home.removeMember (job);
+            --numJobs;
+            addToDeleteList (deletionList, job);
+            finished = true;
+        }
+        else
+        {
+            // move the job to the back of its queue if it wants another go
+            home.queueJob (job);
         }
     }
 
+    if (finished)
+        jobFinishedSignal.signal();
+
     return true;
 }
 
@@ -378,3 +611,227 @@ void ThreadPool::addToDeleteList (OwnedArray<ThreadPoolJob>& deletionList, Threa
     if (job->shouldBeDeleted)
         deletionList.add (job);
 }
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class ThreadPoolTests  : public UnitTest
+{
+public:
+    ThreadPoolTests() : UnitTest ("ThreadPool") {}
+
+    class CountingJob  : public ThreadPoolJob
+    {
+    public:
+        CountingJob (Atomic<int>& c, int runs = 1)
+            : ThreadPoolJob ("counting"), counter (c), runsLeft (runs)
+        {
+        }
+
+        JobStatus runJob()
+        {
+            ++counter;
+            return --runsLeft > 0 ? jobNeedsRunningAgain : jobHasFinished;
+        }
+
+    private:
+        Atomic<int>& counter;
+        int runsLeft;
+    };
+
+    /** Adds more jobs to the pool from inside it, which land on the adding thread's
+        own queue and have to be stolen by the others. */
+    class SpawningJob  : public ThreadPoolJob
+    {
+    public:
+        SpawningJob (ThreadPool& p, Atomic<int>& c, int n)
+            : ThreadPoolJob ("spawning"), pool (p), counter (c), numChildren (n)
+        {
+        }
+
+        JobStatus runJob()
+        {
+            for (int i = 0; i < numChildren; ++i)
+                pool.addJob (new CountingJob (counter), true);
+
+            return jobHasFinished;
+        }
+
+    private:
+        ThreadPool& pool;
+        Atomic<int>& counter;
+        int numChildren;
+    };
+
+    class GateJob  : public ThreadPoolJob
+    {
+    public:
+        GateJob() : ThreadPoolJob ("gate") {}
+
+        JobStatus runJob()
+        {
+            started.signal();
+            gate.wait (5000);
+            return jobHasFinished;
+        }
+
+        WaitableEvent started, gate;
+    };
+
+    class RecordingJob  : public ThreadPoolJob
+    {
+    public:
+        RecordingJob (Array<int>& o, int id_, JobPriority p)
+            : ThreadPoolJob ("recording " + String (id_)), order (o), id (id_)
+        {
+            setJobPriority (p);
+        }
+
+        JobStatus runJob()
+        {
+            order.add (id);
+            return jobHasFinished;
+        }
+
+    private:
+        Array<int>& order;
+        int id;
+    };
+
+    static bool waitForJobs (ThreadPool& pool, int timeOutMs)
+    {
+        const uint32 start = Time::getMillisecondCounter();
+
+        while (pool.getNumJobs() > 0)
+        {
+            if (Time::getMillisecondCounter() >= start + (uint32) timeOutMs)
+                return false;
+
+            Thread::sleep (1);
+        }
+
+        return true;
+    }
+
+    void runTest()
+    {
+        beginTest ("Short jobs");
+
+        {
+            ThreadPool pool (4);
+            Atomic<int> counter;
+
+            for (int i = 0; i < 20000; ++i)
+                pool.addJob (new CountingJob (counter), true);
+
+            expect (waitForJobs (pool, 10000));
+            expectEquals (counter.get(), 20000);
+        }
+
+        beginTest ("Jobs that need running again");
+
+        {
+            ThreadPool pool (3);
+            Atomic<int> counter;
+
+            for (int i = 0; i < 100; ++i)
+                pool.addJob (new CountingJob (counter, 10), true);
+
+            expect (waitForJobs (pool, 10000));
+            expectEquals (counter.get(), 1000);
+        }
+
+        beginTest ("Jobs added from inside the pool");
+
+        {
+            ThreadPool pool (4);
+            Atomic<int> counter;
+
+            for (int i = 0; i < 8; ++i)
+                pool.addJob (new SpawningJob (pool, counter, 500), true);
+
+            expect (waitForJobs (pool, 10000));
+            expectEquals (counter.get(), 4000);
+        }
+
+        beginTest ("Idle threads wake up for new jobs");
+
+        {
+            ThreadPool pool (2);
+            Atomic<int> counter;
+            Thread::sleep (50);
+
+            const uint32 start = Time::getMillisecondCounter();
+            pool.addJob (new CountingJob (counter), true);
+
+            expect (waitForJobs (pool, 5000));
+            expect (Time::getMillisecondCounter() - start < 250, "an idle thread waited before taking the job");
+        }
+
+        beginTest ("Priorities");
+
+        {
+            ThreadPool pool (1);
+            GateJob gate;
+            pool.addJob (&gate, false);
+            expect (gate.started.wait (5000));
+
+            Array<int> order;
+            pool.addJob (new RecordingJob (order, 0, ThreadPoolJob::lowPriority), true);
+            pool.addJob (new RecordingJob (order, 1, ThreadPoolJob::normalPriority), true);
+            pool.addJob (new RecordingJob (order, 2, ThreadPoolJob::highPriority), true);
+            pool.addJob (new RecordingJob (order, 3, ThreadPoolJob::normalPriority), true);
+            pool.addJob (new RecordingJob (order, 4, ThreadPoolJob::highPriority), true);
+
+            expectEquals (pool.getNumJobs(), 6);
+            expectEquals (pool.getNamesOfAllJobs (true).size(), 1);
+
+            gate.gate.signal();
+            expect (waitForJobs (pool, 5000));
+
+            const int expected[] = { 2, 4, 1, 3, 0 };
+            expect (order == Array<int> (expected, numElementsInArray (expected)));
+        }
+
+        beginTest ("Removing jobs");
+
+        {
+            ThreadPool pool (1);
+            GateJob gate;
+            pool.addJob (&gate, false);
+            expect (gate.started.wait (5000));
+
+            Atomic<int> counter;
+            CountingJob queued (counter);
+            pool.addJob (&queued, false);
+
+            for (int i = 0; i < 10; ++i)
+                pool.addJob (new CountingJob (counter), true);
+
+            expect (pool.contains (&queued));
+            expect (pool.isJobRunning (&gate));
+            expect (! pool.isJobRunning (&queued));
+            expect (pool.removeJob (&queued, false, 0));
+            expect (! pool.contains (&queued));
+            expectEquals (pool.getNumJobs(), 11);
+
+            struct CountingJobSelector  : public ThreadPool::JobSelector
+            {
+                bool isJobSuitable (ThreadPoolJob* job)    { return job->getJobName() == "counting"; }
+            };
+
+            CountingJobSelector selector;
+            expect (pool.removeAllJobs (false, 0, &selector));
+            expectEquals (pool.getNumJobs(), 1);
+            expect (pool.getJob (0) == &gate);
+
+            gate.gate.signal();
+            expect (pool.waitForJobToFinish (&gate, 5000));
+            expectEquals (counter.get(), 0);
+        }
+    }
+};
+
+static ThreadPoolTests threadPoolUnitTests;
+
+#endif
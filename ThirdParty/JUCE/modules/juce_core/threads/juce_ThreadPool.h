@@ -45,6 +45,9 @@ class ThreadPoolThread;
     method to see if something is trying to interrupt the job. If shouldExit() returns
     true, the runJob() method must return immediately.
 
+    Jobs with a higher priority are always started before any job of a lower one,
+    see setJobPriority().
+
     @see ThreadPool, Thread
 */
 class JUCE_API  ThreadPoolJob
@@ -70,6 +73,30 @@ public:
     */
     void setJobName (const String& newName);
 
+    //==============================================================================
+    /** The priorities a job can be queued with.
+        @see setJobPriority
+    */
+    enum JobPriority
+    {
+        lowPriority = 0,        /**< only started when no other jobs are waiting. */
+        normalPriority,         /**< the default. */
+        highPriority            /**< started before any waiting normal or low priority job. */
+    };
+
+    /** Changes the priority this job is queued with.
+
+        The new priority is used the next time the job is queued, i.e. when it's
+        added to a pool or when its runJob() method returns jobNeedsRunningAgain.
+        @see getJobPriority
+    */
+    void setJobPriority (JobPriority newPriority) noexcept;
+
+    /** Returns the priority this job is queued with.
+        @see setJobPriority
+    */
+    JobPriority getJobPriority() const noexcept         { return priority; }
+
     //==============================================================================
     /** These are the values that can be returned by the runJob() method.
     */
@@ -126,6 +153,8 @@ private:
     String jobName;
     ThreadPool* pool;
     bool shouldStop, isActive, shouldBeDeleted;
+    JobPriority priority, queuedPriority;
+    int homeIndex, memberIndex;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ThreadPoolJob)
 };
@@ -138,6 +167,13 @@ private:
     When a ThreadPoolJob object is added to the ThreadPool's list, its runJob() method
     will be called by the next pooled thread that becomes free.
 
+    Each thread keeps its own queue of jobs. Jobs added from one of the pool's threads
+    go onto that thread's queue, and jobs added from elsewhere are spread across the
+    queues in turn. A thread runs the jobs from its own queue first and takes jobs
+    from the other threads' queues once its own is empty, so threads only contend for
+    a lock when they touch the same queue. Threads with nothing to do sleep until a
+    job is added.
+
     @see ThreadPoolJob, Thread
 */
 class JUCE_API  ThreadPool
@@ -244,6 +280,10 @@ public:
     */
     int getNumJobs() const;
 
+    /** Returns the number of threads the pool runs its jobs on.
+    */
+    int getNumThreads() const noexcept;
+
     /** Returns one of the jobs in the queue.
 
         Note that this can be a very volatile list as jobs might be continuously getting shifted
@@ -287,18 +327,22 @@ public:
 
 private:
     //==============================================================================
-    Array <ThreadPoolJob*> jobs;
+    enum { numJobPriorities = ThreadPoolJob::highPriority + 1 };
 
     class ThreadPoolThread;
     friend class ThreadPoolThread;
     friend struct ContainerDeletePolicy<ThreadPoolThread>;
     OwnedArray<ThreadPoolThread> threads;
 
-    CriticalSection lock;
+    Atomic<int> numJobs, nextThreadIndex;
+    Atomic<int> numQueuedJobs [numJobPriorities];
     WaitableEvent jobFinishedSignal;
 
-    bool runNextJob();
-    ThreadPoolJob* pickNextJobToRun();
+    bool runNextJob (ThreadPoolThread&);
+    ThreadPoolJob* pickNextJobToRun (ThreadPoolThread&);
+    ThreadPoolThread* getCurrentPoolThread() const;
+    bool hasQueuedJobs() const noexcept;
+    void wakeIdleThread (int preferredIndex);
     void addToDeleteList (OwnedArray<ThreadPoolJob>&, ThreadPoolJob*) const;
     void createThreads (int numThreads);
     void stopThreads();